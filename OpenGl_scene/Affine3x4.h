@@ -0,0 +1,125 @@
+#ifndef AFFINE_3X4_H
+#define AFFINE_3X4_H
+
+#include <glm/glm.hpp>
+
+// ---------- affine transforms ----------
+// The top three rows of a mat4 whose last row is (0, 0, 0, 1), stored row
+// by row: rows[i] = (linear row i, translation i). 48 bytes instead of 64,
+// a point transform is three dot products and composing two is 36
+// multiplies instead of 64. The rows upload unchanged as a GLSL mat3x4
+// (glUniformMatrix3x4fv, no transpose) whose columns they become, applied
+// as `vec4(p, 1.0) * model`.
+struct Affine3x4
+{
+    glm::vec4 rows[3];
+
+    static Affine3x4 Identity()
+    {
+        return { { glm::vec4(1, 0, 0, 0), glm::vec4(0, 1, 0, 0), glm::vec4(0, 0, 1, 0) } };
+    }
+
+    static Affine3x4 Translation(const glm::vec3& t)
+    {
+        return { { glm::vec4(1, 0, 0, t.x), glm::vec4(0, 1, 0, t.y), glm::vec4(0, 0, 1, t.z) } };
+    }
+
+    // m's last row is assumed to be (0, 0, 0, 1) and dropped
+    static Affine3x4 FromMat4(const glm::mat4& m)
+    {
+        Affine3x4 a;
+        for (int r = 0; r < 3; ++r)
+            a.rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+        return a;
+    }
+
+    glm::mat4 ToMat4() const
+    {
+        glm::mat4 m(1.0f);
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 4; ++c)
+                m[c][r] = rows[r][c];
+        return m;
+    }
+
+    glm::vec3 translation() const { return glm::vec3(rows[0].w, rows[1].w, rows[2].w); }
+
+    glm::vec3 TransformPoint(const glm::vec3& p) const
+    {
+        glm::vec4 h(p, 1.0f);
+        return glm::vec3(glm::dot(rows[0], h), glm::dot(rows[1], h), glm::dot(rows[2], h));
+    }
+
+    glm::vec3 TransformVector(const glm::vec3& v) const
+    {
+        return glm::vec3(glm::dot(glm::vec3(rows[0]), v), glm::dot(glm::vec3(rows[1]), v), glm::dot(glm::vec3(rows[2]), v));
+    }
+};
+
+// a * b: applies b first, like the mat4 product
+inline Affine3x4 operator*(const Affine3x4& a, const Affine3x4& b)
+{
+    Affine3x4 out;
+    for (int r = 0; r < 3; ++r)
+    {
+        const glm::vec4& row = a.rows[r];
+        out.rows[r] = row.x * b.rows[0] + row.y * b.rows[1] + row.z * b.rows[2] + glm::vec4(0.0f, 0.0f, 0.0f, row.w);
+    }
+    return out;
+}
+
+// Cofactors of the linear part, cof[r][c] for row r, column c, and the
+// determinant; inverse(L) = transpose(cof) / det.
+inline float AffineCofactors(const Affine3x4& m, glm::vec3 cof[3])
+{
+    glm::vec3 r0(m.rows[0]), r1(m.rows[1]), r2(m.rows[2]);
+    cof[0] = glm::cross(r1, r2);
+    cof[1] = glm::cross(r2, r0);
+    cof[2] = glm::cross(r0, r1);
+    return glm::dot(r0, cof[0]);
+}
+
+// general inverse (scale and shear allowed); singular input gives inf/NaN
+inline Affine3x4 Inverse(const Affine3x4& m)
+{
+    glm::vec3 cof[3];
+    float invDet = 1.0f / AffineCofactors(m, cof);
+    glm::vec3 t = m.translation();
+    Affine3x4 out;
+    for (int r = 0; r < 3; ++r)
+    {
+        // row r of the inverse is column r of the cofactors
+        glm::vec3 row = glm::vec3(cof[0][r], cof[1][r], cof[2][r]) * invDet;
+        out.rows[r] = glm::vec4(row, -glm::dot(row, t));
+    }
+    return out;
+}
+
+// Inverse of a rotation + translation (orthonormal linear part): the
+// transposed rotation and the translation carried back through it.
+inline Affine3x4 InverseRigid(const Affine3x4& m)
+{
+    glm::vec3 t = m.translation();
+    Affine3x4 out;
+    for (int r = 0; r < 3; ++r)
+    {
+        glm::vec3 row(m.rows[0][r], m.rows[1][r], m.rows[2][r]);
+        out.rows[r] = glm::vec4(row, -glm::dot(row, t));
+    }
+    return out;
+}
+
+// transpose(inverse(linear part)), which keeps normals perpendicular to
+// surfaces under non-uniform scale; the cofactor matrix over the determinant
+inline glm::mat3 NormalMatrix(const Affine3x4& m)
+{
+    glm::vec3 cof[3];
+    float invDet = 1.0f / AffineCofactors(m, cof);
+    glm::mat3 n;
+    for (int c = 0; c < 3; ++c)
+        for (int r = 0; r < 3; ++r)
+            n[c][r] = cof[r][c] * invDet;
+    return n;
+}
+
+#endif
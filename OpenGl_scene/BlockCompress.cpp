@@ -0,0 +1,465 @@
+#include "BlockCompress.h"
+#include "JobSystem.h"
+#include "Simd8.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+int BlockBytes(BlockFormat format)
+{
+    return format == BLOCK_BC1 ? 8 : 16;
+}
+
+size_t BlockCompressedSize(BlockFormat format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+bool IsOpaque(const unsigned char* rgba, int width, int height)
+{
+    size_t count = (size_t)width * height;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (rgba[i * 4 + 3] != 255)
+            return false;
+    }
+    return true;
+}
+
+// ---------- 565 endpoints ----------
+
+static int Pack565(float r, float g, float b)
+{
+    int q[3];
+    const float c[3] = { r, g, b };
+    const int levels[3] = { 31, 63, 31 };
+    for (int i = 0; i < 3; ++i)
+        q[i] = (int)(std::min(std::max(c[i], 0.0f), 255.0f) * levels[i] / 255.0f + 0.5f);
+    return (q[0] << 11) | (q[1] << 5) | q[2];
+}
+
+static void Expand565(int color, int rgb[3])
+{
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// four-color mode: c0, c1, then the 2/3 and 1/3 mixes, rounded down
+static void ColorPalette(int c0, int c1, int palette[4][3])
+{
+    Expand565(c0, palette[0]);
+    Expand565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+// 8-alpha mode (a0 > a1): a0, a1 and six steps in between
+static void AlphaPalette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 2; i < 8; ++i)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; ++i)
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// ---------- encoder: one block per lane ----------
+
+// pixel p (row-major in the block) of 8 neighbouring blocks
+struct BlockBatch
+{
+    F32x8 channel[4][16];
+};
+
+static void LoadBatch(const unsigned char* rgba, int width, int height, int bx0, int by, int count, BlockBatch& batch)
+{
+    float lanes[4][16][8];
+    for (int l = 0; l < 8; ++l)
+    {
+        // unused lanes repeat the last block; their results are dropped
+        int bx = bx0 + std::min(l, count - 1);
+        for (int p = 0; p < 16; ++p)
+        {
+            int x = std::min(bx * 4 + (p & 3), width - 1);
+            int y = std::min(by * 4 + (p >> 2), height - 1);
+            const unsigned char* px = rgba + ((size_t)y * width + x) * 4;
+            for (int c = 0; c < 4; ++c)
+                lanes[c][p][l] = px[c];
+        }
+    }
+    for (int c = 0; c < 4; ++c)
+        for (int p = 0; p < 16; ++p)
+            batch.channel[c][p] = F32x8::Load(lanes[c][p]);
+}
+
+struct ColorFit
+{
+    int c0[8], c1[8];
+    uint32_t indices[8];
+    float error[8];
+};
+
+// quantizes the endpoints, orders them for four-color mode and picks the
+// nearest palette entry for every pixel
+static void FitColors(const BlockBatch& batch, const F32x8 ends[2][3], ColorFit& fit)
+{
+    float e[2][3][8];
+    for (int i = 0; i < 2; ++i)
+        for (int c = 0; c < 3; ++c)
+            ends[i][c].Store(e[i][c]);
+
+    float lanes[4][3][8];
+    for (int l = 0; l < 8; ++l)
+    {
+        int c0 = Pack565(e[0][0][l], e[0][1][l], e[0][2][l]);
+        int c1 = Pack565(e[1][0][l], e[1][1][l], e[1][2][l]);
+        if (c0 < c1)
+            std::swap(c0, c1);
+        fit.c0[l] = c0;
+        fit.c1[l] = c1;
+        // c0 == c1 gives four equal entries, so every index stays 0
+        int palette[4][3];
+        ColorPalette(c0, c1, palette);
+        for (int k = 0; k < 4; ++k)
+            for (int c = 0; c < 3; ++c)
+                lanes[k][c][l] = (float)palette[k][c];
+    }
+
+    F32x8 palette[4][3];
+    for (int k = 0; k < 4; ++k)
+        for (int c = 0; c < 3; ++c)
+            palette[k][c] = F32x8::Load(lanes[k][c]);
+
+    F32x8 error = F32x8::Set(0.0f);
+    float indices[16][8];
+    for (int p = 0; p < 16; ++p)
+    {
+        F32x8 best, index = F32x8::Set(0.0f);
+        for (int k = 0; k < 4; ++k)
+        {
+            F32x8 dr = batch.channel[0][p] - palette[k][0];
+            F32x8 dg = batch.channel[1][p] - palette[k][1];
+            F32x8 db = batch.channel[2][p] - palette[k][2];
+            F32x8 d = dr * dr + dg * dg + db * db;
+            if (k == 0)
+                best = d;
+            else
+            {
+                index = SelectLess(d, best, F32x8::Set((float)k), index);
+                best = Min(d, best);
+            }
+        }
+        error = error + best;
+        index.Store(indices[p]);
+    }
+    error.Store(fit.error);
+
+    for (int l = 0; l < 8; ++l)
+    {
+        uint32_t bits = 0;
+        for (int p = 0; p < 16; ++p)
+            bits |= (uint32_t)indices[p][l] << (2 * p);
+        fit.indices[l] = bits;
+    }
+}
+
+static F32x8 Abs(const F32x8& x)
+{
+    return Max(x, F32x8::Set(0.0f) - x);
+}
+
+static void EncodeColors(const BlockBatch& batch, ColorFit& out)
+{
+    const F32x8* r = batch.channel[0];
+    const F32x8* g = batch.channel[1];
+    const F32x8* b = batch.channel[2];
+    const F32x8 zero = F32x8::Set(0.0f), tiny = F32x8::Set(1e-30f), one = F32x8::Set(1.0f);
+
+    F32x8 mean[3] = { zero, zero, zero };
+    for (int p = 0; p < 16; ++p)
+    {
+        mean[0] = mean[0] + r[p];
+        mean[1] = mean[1] + g[p];
+        mean[2] = mean[2] + b[p];
+    }
+    for (int c = 0; c < 3; ++c)
+        mean[c] = mean[c] * F32x8::Set(1.0f / 16.0f);
+
+    F32x8 crr = zero, cgg = zero, cbb = zero, crg = zero, crb = zero, cgb = zero;
+    for (int p = 0; p < 16; ++p)
+    {
+        F32x8 dr = r[p] - mean[0], dg = g[p] - mean[1], db = b[p] - mean[2];
+        crr = crr + dr * dr;
+        cgg = cgg + dg * dg;
+        cbb = cbb + db * db;
+        crg = crg + dr * dg;
+        crb = crb + dr * db;
+        cgb = cgb + dg * db;
+    }
+
+    // principal axis by power iteration, seeded with the covariance row of
+    // the channel that varies most (never orthogonal to the answer)
+    F32x8 vx = crr, vy = crg, vz = crb, diagonal = crr;
+    vx = SelectLess(diagonal, cgg, crg, vx);
+    vy = SelectLess(diagonal, cgg, cgg, vy);
+    vz = SelectLess(diagonal, cgg, cgb, vz);
+    diagonal = Max(diagonal, cgg);
+    vx = SelectLess(diagonal, cbb, crb, vx);
+    vy = SelectLess(diagonal, cbb, cgb, vy);
+    vz = SelectLess(diagonal, cbb, cbb, vz);
+    for (int i = 0; i < 4; ++i)
+    {
+        F32x8 x = crr * vx + crg * vy + crb * vz;
+        F32x8 y = crg * vx + cgg * vy + cgb * vz;
+        F32x8 z = crb * vx + cgb * vy + cbb * vz;
+        F32x8 scale = one / Max(Max(Abs(x), Abs(y)), Max(Abs(z), tiny));
+        vx = x * scale;
+        vy = y * scale;
+        vz = z * scale;
+    }
+    F32x8 invLength2 = one / Max(vx * vx + vy * vy + vz * vz, tiny);
+
+    F32x8 t[16];
+    F32x8 tMin = F32x8::Set(1e30f), tMax = F32x8::Set(-1e30f);
+    for (int p = 0; p < 16; ++p)
+    {
+        t[p] = (r[p] - mean[0]) * vx + (g[p] - mean[1]) * vy + (b[p] - mean[2]) * vz;
+        tMin = Min(tMin, t[p]);
+        tMax = Max(tMax, t[p]);
+    }
+
+    // candidate 1: the extremes along the axis
+    F32x8 ends[2][3];
+    const F32x8 axis[3] = { vx, vy, vz };
+    for (int c = 0; c < 3; ++c)
+    {
+        ends[0][c] = mean[c] + axis[c] * (tMax * invLength2);
+        ends[1][c] = mean[c] + axis[c] * (tMin * invLength2);
+    }
+    ColorFit extremes;
+    FitColors(batch, ends, extremes);
+
+    // candidate 2: least-squares endpoints for the pixels snapped to the
+    // four palette positions along the axis
+    F32x8 invRange = F32x8::Set(3.0f) / Max(tMax - tMin, tiny);
+    F32x8 aa = zero, bb = zero, ab = zero;
+    F32x8 ax[3] = { zero, zero, zero }, bx[3] = { zero, zero, zero };
+    for (int p = 0; p < 16; ++p)
+    {
+        F32x8 s = (t[p] - tMin) * invRange;
+        F32x8 q = zero;
+        q = SelectLess(F32x8::Set(0.5f), s, F32x8::Set(1.0f / 3.0f), q);
+        q = SelectLess(F32x8::Set(1.5f), s, F32x8::Set(2.0f / 3.0f), q);
+        q = SelectLess(F32x8::Set(2.5f), s, one, q);
+        F32x8 alpha = one - q;      // weight of the low end
+        aa = aa + alpha * alpha;
+        bb = bb + q * q;
+        ab = ab + alpha * q;
+        for (int c = 0; c < 3; ++c)
+        {
+            ax[c] = ax[c] + alpha * batch.channel[c][p];
+            bx[c] = bx[c] + q * batch.channel[c][p];
+        }
+    }
+    // a degenerate system gives wild endpoints; the error comparison drops them
+    F32x8 invDet = one / Max(aa * bb - ab * ab, tiny);
+    for (int c = 0; c < 3; ++c)
+    {
+        ends[0][c] = (bx[c] * aa - ax[c] * ab) * invDet;
+        ends[1][c] = (ax[c] * bb - bx[c] * ab) * invDet;
+    }
+    ColorFit refit;
+    FitColors(batch, ends, refit);
+
+    for (int l = 0; l < 8; ++l)
+    {
+        const ColorFit& best = refit.error[l] < extremes.error[l] ? refit : extremes;
+        out.c0[l] = best.c0[l];
+        out.c1[l] = best.c1[l];
+        out.indices[l] = best.indices[l];
+        out.error[l] = best.error[l];
+    }
+}
+
+static void EncodeAlpha(const BlockBatch& batch, unsigned char out[8][8])
+{
+    const F32x8* a = batch.channel[3];
+    F32x8 aMin = a[0], aMax = a[0];
+    for (int p = 1; p < 16; ++p)
+    {
+        aMin = Min(aMin, a[p]);
+        aMax = Max(aMax, a[p]);
+    }
+    float lo[8], hi[8];
+    aMin.Store(lo);
+    aMax.Store(hi);
+
+    float lanes[8][8];
+    for (int l = 0; l < 8; ++l)
+    {
+        int palette[8];
+        AlphaPalette((int)hi[l], (int)lo[l], palette);
+        for (int k = 0; k < 8; ++k)
+            lanes[k][l] = (float)palette[k];
+        out[l][0] = (unsigned char)hi[l];
+        out[l][1] = (unsigned char)lo[l];
+    }
+
+    F32x8 palette[8];
+    for (int k = 0; k < 8; ++k)
+        palette[k] = F32x8::Load(lanes[k]);
+
+    float indices[16][8];
+    for (int p = 0; p < 16; ++p)
+    {
+        F32x8 best = Abs(a[p] - palette[0]), index = F32x8::Set(0.0f);
+        for (int k = 1; k < 8; ++k)
+        {
+            F32x8 d = Abs(a[p] - palette[k]);
+            index = SelectLess(d, best, F32x8::Set((float)k), index);
+            best = Min(d, best);
+        }
+        index.Store(indices[p]);
+    }
+
+    for (int l = 0; l < 8; ++l)
+    {
+        uint64_t bits = 0;
+        for (int p = 0; p < 16; ++p)
+            bits |= (uint64_t)indices[p][l] << (3 * p);
+        for (int i = 0; i < 6; ++i)
+            out[l][2 + i] = (unsigned char)(bits >> (8 * i));
+    }
+}
+
+static void PutColorBlock(unsigned char* dst, int c0, int c1, uint32_t indices)
+{
+    dst[0] = (unsigned char)c0;
+    dst[1] = (unsigned char)(c0 >> 8);
+    dst[2] = (unsigned char)c1;
+    dst[3] = (unsigned char)(c1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        dst[4 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+// block rows [by0, by1)
+static void CompressRows(BlockFormat format, const unsigned char* rgba, int width, int height, int by0, int by1, unsigned char* out)
+{
+    int blocksWide = (width + 3) / 4;
+    int bytes = BlockBytes(format);
+    BlockBatch batch;
+    ColorFit color;
+    unsigned char alpha[8][8];
+    for (int by = by0; by < by1; ++by)
+    {
+        for (int bx0 = 0; bx0 < blocksWide; bx0 += 8)
+        {
+            int count = std::min(8, blocksWide - bx0);
+            LoadBatch(rgba, width, height, bx0, by, count, batch);
+            EncodeColors(batch, color);
+            if (format == BLOCK_BC3)
+                EncodeAlpha(batch, alpha);
+
+            for (int l = 0; l < count; ++l)
+            {
+                unsigned char* dst = out + ((size_t)by * blocksWide + bx0 + l) * bytes;
+                if (format == BLOCK_BC3)
+                {
+                    std::memcpy(dst, alpha[l], 8);
+                    dst += 8;
+                }
+                PutColorBlock(dst, color.c0[l], color.c1[l], color.indices[l]);
+            }
+        }
+    }
+}
+
+void CompressBlocks(JobSystem* jobs, BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* out)
+{
+    int blocksHigh = (height + 3) / 4;
+    if (jobs && jobs->threadCount() > 1 && blocksHigh > 1)
+    {
+        JobCounter counter;
+        size_t grain = std::max<size_t>(1, (size_t)(blocksHigh + 255) / 256);
+        auto rows = [=](size_t begin, size_t end)
+        {
+            CompressRows(format, rgba, width, height, (int)begin, (int)end, out);
+        };
+        jobs->ParallelFor(counter, (size_t)blocksHigh, grain, rows);
+        jobs->Wait(counter);
+    }
+    else
+        CompressRows(format, rgba, width, height, 0, blocksHigh, out);
+}
+
+// ---------- decoder ----------
+
+void DecompressBlocks(BlockFormat format, const unsigned char* blocks, int width, int height, unsigned char* rgba)
+{
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    int bytes = BlockBytes(format);
+    for (int by = 0; by < blocksHigh; ++by)
+    {
+        for (int bx = 0; bx < blocksWide; ++bx)
+        {
+            const unsigned char* src = blocks + ((size_t)by * blocksWide + bx) * bytes;
+            int alphas[16];
+            if (format == BLOCK_BC3)
+            {
+                int palette[8];
+                AlphaPalette(src[0], src[1], palette);
+                uint64_t bits = 0;
+                for (int i = 0; i < 6; ++i)
+                    bits |= (uint64_t)src[2 + i] << (8 * i);
+                for (int p = 0; p < 16; ++p)
+                    alphas[p] = palette[(bits >> (3 * p)) & 7];
+                src += 8;
+            }
+            else
+                std::fill(alphas, alphas + 16, 255);
+
+            int c0 = src[0] | (src[1] << 8), c1 = src[2] | (src[3] << 8);
+            uint32_t indices = (uint32_t)src[4] | ((uint32_t)src[5] << 8) | ((uint32_t)src[6] << 16) | ((uint32_t)src[7] << 24);
+            int palette[4][3];
+            ColorPalette(c0, c1, palette);
+            bool transparentBlack = false;
+            if (c0 <= c1 && format == BLOCK_BC1)
+            {
+                // three-color mode; the encoder never writes it, other tools do
+                for (int c = 0; c < 3; ++c)
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+                transparentBlack = true;
+            }
+
+            for (int p = 0; p < 16; ++p)
+            {
+                int x = bx * 4 + (p & 3), y = by * 4 + (p >> 2);
+                if (x >= width || y >= height)
+                    continue;
+                int index = (indices >> (2 * p)) & 3;
+                unsigned char* dst = rgba + ((size_t)y * width + x) * 4;
+                for (int c = 0; c < 3; ++c)
+                    dst[c] = (unsigned char)palette[index][c];
+                dst[3] = (unsigned char)(transparentBlack && index == 3 ? 0 : alphas[p]);
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include <cstddef>
+
+class JobSystem;
+
+// ---------- S3TC block compression ----------
+// BC1 (DXT1: two RGB565 endpoints and 2-bit indices, 8 bytes per 4x4 block,
+// always in the opaque four-color mode) and BC3 (DXT5: BC1 colour plus
+// interpolated 8-bit alpha, 16 bytes per block). The encoder runs one block
+// per F32x8 lane: principal axis of the block's colours, a least-squares
+// refit of the endpoints, and per-pixel best-index search, with whichever
+// of the two endpoint pairs has less error kept. Partial blocks on the right
+// and bottom edges repeat the last column / row.
+enum BlockFormat
+{
+    BLOCK_BC1,
+    BLOCK_BC3,
+};
+
+int BlockBytes(BlockFormat format);
+
+// bytes for a width x height image: whole blocks, edges rounded up
+size_t BlockCompressedSize(BlockFormat format, int width, int height);
+
+// rgba: width * height * 4 bytes; out: BlockCompressedSize() bytes, block
+// rows top to bottom. Block rows are split over the job threads when `jobs`
+// is given (then call from a job thread).
+void CompressBlocks(JobSystem* jobs, BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* out);
+
+// the reverse, as a GPU decodes it (the 1/3 and 2/3 colours rounded down);
+// used for the RGBA8 fallback when the GL has no S3TC, and to measure error
+void DecompressBlocks(BlockFormat format, const unsigned char* blocks, int width, int height, unsigned char* rgba);
+
+// true when every alpha byte is 255, i.e. BC1 loses nothing over BC3
+bool IsOpaque(const unsigned char* rgba, int width, int height);
+
+#endif
@@ -0,0 +1,142 @@
+#include "FileView.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+#include <utility>
+
+// ---------- FileView ----------
+
+#ifdef _WIN32
+FileView::FileView(const char* path)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size))
+    {
+        length = (size_t)size.QuadPart;
+        if (length == 0)
+            opened = true;      // CreateFileMapping refuses empty files
+        else
+        {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping)
+                bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            opened = bytes != nullptr;
+        }
+    }
+    // the mapping keeps the file alive
+    CloseHandle(file);
+    if (!opened)
+        Close();
+}
+
+void FileView::Close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mapping)
+        CloseHandle(mapping);
+    bytes = nullptr;
+    mapping = nullptr;
+    length = 0;
+    opened = false;
+}
+#else
+FileView::FileView(const char* path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        length = (size_t)st.st_size;
+        if (length == 0)
+            opened = true;      // mmap refuses empty files
+        else
+        {
+            void* p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                bytes = (const unsigned char*)p;
+                opened = true;
+            }
+        }
+    }
+    // the mapping keeps the file alive
+    close(fd);
+    if (!opened)
+        length = 0;
+}
+
+void FileView::Close()
+{
+    if (bytes)
+        munmap((void*)bytes, length);
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+}
+#endif
+
+FileView::~FileView()
+{
+    Close();
+}
+
+FileView::FileView(FileView&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+FileView& FileView::operator=(FileView&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        std::swap(opened, other.opened);
+#ifdef _WIN32
+        std::swap(mapping, other.mapping);
+#endif
+    }
+    return *this;
+}
+
+// ---------- Vfs ----------
+
+FileView Vfs::Open(const char* path) const
+{
+    if (roots.empty())
+    {
+        FileView view(path);
+        if (!view.valid())
+            std::cout << "Failed to open " << path << "\n";
+        return view;
+    }
+
+    for (const std::string& root : roots)
+    {
+        FileView view((root + "/" + path).c_str());
+        if (view.valid())
+            return view;
+    }
+    std::cout << "Failed to open " << path << " in any mounted directory\n";
+    return FileView();
+}
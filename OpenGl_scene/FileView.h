@@ -0,0 +1,59 @@
+#ifndef FILE_VIEW_H
+#define FILE_VIEW_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// ---------- FileView ----------
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile). The bytes
+// come straight from the page cache: stbi_load_from_memory, glShaderSource
+// (with an explicit length) and ParseMeshBlob read them in place, with no
+// read() into a buffer and no std::string in between. Not NUL-terminated.
+class FileView
+{
+public:
+    FileView() = default;
+    explicit FileView(const char* path);
+    ~FileView();
+
+    FileView(FileView&& other) noexcept;
+    FileView& operator=(FileView&& other) noexcept;
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    // an empty file is valid, with data() == nullptr
+    bool valid() const { return opened; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    void Close();
+
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+// ---------- Vfs ----------
+// Search path over mounted directories, first match wins; with nothing
+// mounted, paths resolve against the working directory like before. The
+// app mounts its --assets directories into the one SceneRenderer keeps,
+// which loads every shader through it and hands it to TextureStreamer;
+// DecodeImage and LoadTextureFile take one as well.
+class Vfs
+{
+public:
+    void Mount(const std::string& directory) { roots.push_back(directory); }
+
+    // invalid view (and a message) when no root has the file
+    FileView Open(const char* path) const;
+
+private:
+    std::vector<std::string> roots;
+};
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef FRAME_MEMORY_H
+#define FRAME_MEMORY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// ---------- FrameArena ----------
+// N-buffered bump allocator for per-frame data. BeginFrame() switches to the
+// next buffer and rewinds it, so memory handed out in frame F stays valid
+// while frames F+1 .. F+N-1 are recorded (the GL thread can still be
+// replaying it). Allocate() is lock-free and may be called from any thread.
+//
+// A frame that runs out of space falls back to the heap; the buffer is
+// grown to the high-water mark the next time it is reused, so a steady
+// workload stops allocating after the first few frames.
+class FrameArena
+{
+public:
+    static constexpr unsigned int DEFAULT_FRAMES = 3;
+    static constexpr size_t ALIGNMENT = 64;
+
+    explicit FrameArena(size_t capacityPerFrame = 256 * 1024, unsigned int framesInFlight = DEFAULT_FRAMES)
+        : buffers(framesInFlight)
+    {
+        for (Buffer& b : buffers)
+            b.Reserve(capacityPerFrame);
+    }
+
+    ~FrameArena()
+    {
+        for (Buffer& b : buffers)
+        {
+            b.FreeOverflow();
+            b.Release();
+        }
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void BeginFrame()
+    {
+        current = (current + 1) % (unsigned int)buffers.size();
+        Buffer& b = buffers[current];
+        b.FreeOverflow();
+        size_t needed = b.offset.load(std::memory_order_relaxed);
+        if (needed > b.capacity)
+        {
+            b.Release();
+            b.Reserve(needed + needed / 2);
+        }
+        b.offset.store(0, std::memory_order_relaxed);
+        ++frame;
+    }
+
+    void* Allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        Buffer& b = buffers[current];
+        size_t cur = b.offset.load(std::memory_order_relaxed);
+        size_t aligned, next;
+        do
+        {
+            aligned = (cur + align - 1) & ~(align - 1);
+            next = aligned + size;
+        } while (!b.offset.compare_exchange_weak(cur, next, std::memory_order_relaxed));
+
+        if (next <= b.capacity)
+            return b.data + aligned;
+        return b.AllocateOverflow(size, align);
+    }
+
+    template<typename T>
+    T* AllocateArray(size_t count)
+    {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    size_t used() const { return buffers[current].offset.load(std::memory_order_relaxed); }
+    size_t capacity() const { return buffers[current].capacity; }
+    unsigned int framesInFlight() const { return (unsigned int)buffers.size(); }
+    uint64_t frameIndex() const { return frame; }
+
+private:
+    struct Buffer
+    {
+        char* data = nullptr;
+        size_t capacity = 0;
+        std::atomic<size_t> offset{ 0 };
+
+        std::mutex overflowMutex;
+        std::vector<std::pair<void*, size_t>> overflow;   // block, alignment
+
+        void Reserve(size_t size)
+        {
+            capacity = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            data = static_cast<char*>(::operator new(capacity, std::align_val_t(ALIGNMENT)));
+        }
+
+        void Release()
+        {
+            ::operator delete(data, std::align_val_t(ALIGNMENT));
+            data = nullptr;
+            capacity = 0;
+        }
+
+        void* AllocateOverflow(size_t size, size_t align)
+        {
+            align = std::max(align, alignof(std::max_align_t));
+            void* p = ::operator new(size, std::align_val_t(align));
+            std::lock_guard<std::mutex> lock(overflowMutex);
+            overflow.push_back(std::make_pair(p, align));
+            return p;
+        }
+
+        void FreeOverflow()
+        {
+            for (const auto& block : overflow)
+                ::operator delete(block.first, std::align_val_t(block.second));
+            overflow.clear();
+        }
+    };
+
+    std::vector<Buffer> buffers;
+    unsigned int current = 0;
+    uint64_t frame = 0;
+};
+
+// ---------- ArenaAllocator ----------
+// STL adapter over a FrameArena: deallocate() is a no-op, everything goes
+// away when the arena cycles back to this frame's buffer.
+//   std::vector<int, ArenaAllocator<int>> v{ ArenaAllocator<int>(arena) };
+template<typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return arena->AllocateArray<T>(n); }
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template<typename U> friend class ArenaAllocator;
+    FrameArena* arena;
+};
+
+// ---------- ObjectPool ----------
+// Fixed-size slots carved from chunks of CHUNK objects, recycled through an
+// intrusive free list. Not thread-safe; give each owner its own pool.
+// Objects still alive when the pool dies are not destructed.
+template<typename T, size_t CHUNK = 256>
+class ObjectPool
+{
+public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    template<typename... Args>
+    T* Create(Args&&... args)
+    {
+        if (!freeList)
+            Grow();
+        Slot* slot = freeList;
+        freeList = slot->next;
+        ++live;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void Destroy(T* object)
+    {
+        if (!object)
+            return;
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = freeList;
+        freeList = slot;
+        --live;
+    }
+
+    size_t liveCount() const { return live; }
+    size_t capacity() const { return chunks.size() * CHUNK; }
+
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void Grow()
+    {
+        chunks.emplace_back(new Slot[CHUNK]);
+        Slot* chunk = chunks.back().get();
+        for (size_t i = 0; i < CHUNK; ++i)
+        {
+            chunk[i].next = freeList;
+            freeList = &chunk[i];
+        }
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    Slot* freeList = nullptr;
+    size_t live = 0;
+};
+
+#endif
@@ -0,0 +1,400 @@
+#include "FramePipeline.h"
+#include "MatrixBatch.h"
+#include "Mesh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+// ---------- helpers ----------
+
+static Affine3x4 RotatingModel(float t)
+{
+    return Affine3x4::FromMat4(glm::rotate(glm::mat4(1.0f),
+        t * glm::radians(40.0f),
+        glm::vec3(0.5f, 1.0f, 0.0f)));
+}
+
+// Gribb/Hartmann: planes as (n, d) with n pointing inside, normalized
+static void ExtractFrustum(const glm::mat4& viewProj, glm::vec4 planes[6])
+{
+    glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+    planes[0] = row3 + row0;    // left
+    planes[1] = row3 - row0;    // right
+    planes[2] = row3 + row1;    // bottom
+    planes[3] = row3 - row1;    // top
+    planes[4] = row3 + row2;    // near
+    planes[5] = row3 - row2;    // far
+
+    for (int i = 0; i < 6; ++i)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+static bool SphereVisible(const glm::vec4 planes[6], const glm::vec3& c, float r)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if (glm::dot(glm::vec3(planes[i]), c) + planes[i].w < -r)
+            return false;
+    }
+    return true;
+}
+
+// projected radius in pixels decides the sphere tessellation
+static uint8_t SelectSphereLod(float radius, float viewDepth, float projScaleY, int viewportHeight)
+{
+    if (viewDepth <= 0.0f)
+        return MESH_SPHERE_LOD0;
+    float pixels = radius * projScaleY * 0.5f * (float)viewportHeight / viewDepth;
+    if (pixels >= 40.0f) return MESH_SPHERE_LOD0;
+    if (pixels >= 12.0f) return MESH_SPHERE_LOD1;
+    return MESH_SPHERE_LOD2;
+}
+
+// The coarsest sphere mesh (8 stacks, 16 sectors) keeps its faces within
+// cos(pi / 16)^2 ~ 0.96 of the radius; an occluder must stay inside it.
+static const float SPHERE_OCCLUDER_SCALE = 0.95f;
+
+// packets per job: 8 matrix blocks, 16 KB of scratch on the stack
+static const size_t MVP_BLOCKS = 8;
+static const size_t MVP_GROUP = MVP_BLOCKS * MATRIX_BATCH_LANES;
+
+static void PackModel(const Affine3x4& m, Mat4Block& block, int lane)
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        for (int r = 0; r < 3; ++r)
+            block.e[c * 4 + r][lane] = m.rows[r][c];
+        block.e[c * 4 + 3][lane] = c == 3 ? 1.0f : 0.0f;
+    }
+}
+
+// viewProj * model of up to MVP_GROUP packets
+static void MultiplyModels(const glm::mat4& viewProj, const DrawPacket* const* packets, size_t count, glm::mat4* out)
+{
+    const Affine3x4 identity = Affine3x4::Identity();   // pads the last block
+    Mat4Block models[MVP_BLOCKS], mvps[MVP_BLOCKS];
+    size_t blocks = MatrixBlockCount(count);
+    for (size_t i = 0; i < blocks * MATRIX_BATCH_LANES; ++i)
+    {
+        const Affine3x4& model = i < count ? packets[i]->model : identity;
+        PackModel(model, models[i / MATRIX_BATCH_LANES], (int)(i % MATRIX_BATCH_LANES));
+    }
+    MultiplyMat4Batch(viewProj, models, mvps, blocks);
+    UnpackMat4(mvps, count, out);
+}
+
+// ---------- FramePipeline ----------
+
+// a couple of slices per thread so stealing can even out uneven culling
+FramePipeline::FramePipeline(const Scene& scene, JobSystem& jobs)
+    : scene(scene), jobs(jobs), slices(std::min(jobs.threadCount() * 2, MAX_SLICES)),
+      arena(scene.objects.size() * (sizeof(DrawPacket) + sizeof(DrawPacket*)) + 64 * 1024),
+      occlusion(jobs)
+{
+    for (size_t i = 0; i < scene.objects.size(); ++i)
+        if (scene.objects[i].rotating)
+            movingObjects.push_back((uint32_t)i);
+}
+
+PacketStream FramePipeline::Record(const FrameParams& params)
+{
+    arena.BeginFrame();
+    frame = params;
+    viewProj = params.projection * params.view;
+    ExtractFrustum(viewProj, frustum);
+
+    if (params.occlusionCulling)
+    {
+        auto findOccluders = [this](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                FindOccluders((unsigned int)i);
+        };
+        JobCounter counter;
+        jobs.ParallelFor(counter, slices.size(), 1, findOccluders);
+        jobs.Wait(counter);
+        RasterizeOccluders();
+    }
+
+    auto recordSlices = [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            RecordSlice((unsigned int)i);
+    };
+    JobCounter counter;
+    jobs.ParallelFor(counter, slices.size(), 1, recordSlices);
+    jobs.Wait(counter);
+
+    Merge();
+    merged.mvps = nullptr;
+    if (params.computeMvp)
+        ComputeMvps();
+    return merged;
+}
+
+void FramePipeline::SliceRange(unsigned int sliceIndex, size_t& begin, size_t& end) const
+{
+    size_t total = scene.objects.size();
+    size_t per = (total + slices.size() - 1) / slices.size();
+    begin = std::min(total, per * sliceIndex);
+    end = std::min(total, begin + per);
+}
+
+// keeps the slice's MAX_OCCLUDERS visible objects with the largest
+// radius / depth, i.e. the largest on screen
+void FramePipeline::FindOccluders(unsigned int sliceIndex)
+{
+    Slice& slice = slices[sliceIndex];
+    size_t begin, end;
+    SliceRange(sliceIndex, begin, end);
+    slice.occluderCount = 0;
+
+    glm::vec4 viewRow2(frame.view[0][2], frame.view[1][2], frame.view[2][2], frame.view[3][2]);
+    unsigned int smallest = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const SceneObject& obj = scene.objects[i];
+        float viewDepth = -glm::dot(viewRow2, glm::vec4(obj.position, 1.0f));
+        if (viewDepth - obj.boundingRadius <= 0.0f || !SphereVisible(frustum, obj.position, obj.boundingRadius))
+            continue;
+
+        OccluderCandidate c = { obj.boundingRadius / viewDepth, (uint32_t)i };
+        if (slice.occluderCount < MAX_OCCLUDERS)
+        {
+            slice.occluders[slice.occluderCount++] = c;
+        }
+        else if (c.size > slice.occluders[smallest].size)
+        {
+            slice.occluders[smallest] = c;
+        }
+        else
+        {
+            continue;
+        }
+        for (unsigned int k = 0; k < slice.occluderCount; ++k)
+        {
+            if (slice.occluders[k].size < slice.occluders[smallest].size)
+                smallest = k;
+        }
+    }
+}
+
+// the overall largest candidates go into the culler
+void FramePipeline::RasterizeOccluders()
+{
+    OccluderCandidate all[MAX_SLICES * MAX_OCCLUDERS];
+    unsigned int count = 0;
+    for (const Slice& s : slices)
+    {
+        for (unsigned int k = 0; k < s.occluderCount; ++k)
+            all[count++] = s.occluders[k];
+    }
+    unsigned int used = std::min(count, MAX_OCCLUDERS);
+    std::partial_sort(all, all + used, all + count,
+        [](const OccluderCandidate& a, const OccluderCandidate& b) { return a.size > b.size; });
+
+    occlusion.Begin(frame.view, frame.projection);
+    Affine3x4 rotation = RotatingModel(frame.time);
+    for (unsigned int k = 0; k < used; ++k)
+    {
+        const SceneObject& obj = scene.objects[all[k].object];
+        if (obj.shape == SHAPE_SPHERE)
+        {
+            occlusion.AddSphereOccluder(obj.position, obj.boundingRadius * SPHERE_OCCLUDER_SCALE);
+        }
+        else
+        {
+            Affine3x4 model = Affine3x4::Translation(obj.position);
+            if (obj.rotating)
+                model = model * rotation;
+            occlusion.AddMeshOccluder(TETRA_VERTICES, 6, TETRA_INDICES, 12, model);
+        }
+    }
+    occlusion.Rasterize();
+}
+
+void FramePipeline::RecordSlice(unsigned int sliceIndex)
+{
+    Slice& slice = slices[sliceIndex];
+    size_t begin, end;
+    SliceRange(sliceIndex, begin, end);
+
+    slice.packets = arena.AllocateArray<DrawPacket>(end - begin);
+    slice.count = 0;
+    slice.culled = 0;
+    slice.occluded = 0;
+
+    // shared by every rotating object this frame
+    Affine3x4 rotation = RotatingModel(frame.time);
+    glm::vec4 viewRow2(frame.view[0][2], frame.view[1][2], frame.view[2][2], frame.view[3][2]);
+    float projScaleY = frame.projection[1][1];
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const SceneObject& obj = scene.objects[i];
+        if (!SphereVisible(frustum, obj.position, obj.boundingRadius))
+        {
+            ++slice.culled;
+            continue;
+        }
+        if (frame.occlusionCulling && !occlusion.SphereVisible(obj.position, obj.boundingRadius))
+        {
+            ++slice.occluded;
+            continue;
+        }
+
+        float viewDepth = -glm::dot(viewRow2, glm::vec4(obj.position, 1.0f));
+
+        uint8_t mesh = MESH_TETRA;
+        if (obj.shape == SHAPE_SPHERE)
+            mesh = SelectSphereLod(obj.boundingRadius, viewDepth, projScaleY, frame.viewportHeight);
+
+        DrawPacket& p = slice.packets[slice.count++];
+        p.model = Affine3x4::Translation(obj.position);
+        if (obj.rotating)
+            p.model = p.model * rotation;
+        p.mesh = mesh;
+        p.material = obj.material;
+        p.object = (uint32_t)i;
+        p.sortKey = frame.frontToBack ? MakeDepthSortKey(obj.material, mesh, viewDepth)
+            : MakeSortKey(obj.material, mesh, viewDepth);
+    }
+
+    std::sort(slice.packets, slice.packets + slice.count,
+        [](const DrawPacket& a, const DrawPacket& b) { return a.sortKey < b.sortKey; });
+}
+
+// ---------- shadow casters ----------
+
+void FramePipeline::RecordCasters(const glm::mat4* lightViewProj, int count, CasterSet set, PacketStream* out)
+{
+    auto record = [this, lightViewProj, set, out](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            RecordCasterList(lightViewProj[i], set, out[i]);
+    };
+    JobCounter counter;
+    jobs.ParallelFor(counter, (size_t)count, 1, record);
+    jobs.Wait(counter);
+}
+
+void FramePipeline::RecordCasterList(const glm::mat4& lightViewProj, CasterSet set, PacketStream& out)
+{
+    glm::vec4 planes[6];
+    ExtractFrustum(lightViewProj, planes);
+    Affine3x4 rotation = RotatingModel(frame.time);
+
+    bool movingOnly = set == CASTERS_MOVING;
+    size_t total = movingOnly ? movingObjects.size() : scene.objects.size();
+    DrawPacket* packets = arena.AllocateArray<DrawPacket>(total);
+    size_t count = 0;
+    for (size_t n = 0; n < total; ++n)
+    {
+        size_t i = movingOnly ? movingObjects[n] : n;
+        const SceneObject& obj = scene.objects[i];
+        if (set == CASTERS_STATIC && obj.rotating)
+            continue;
+        if (!SphereVisible(planes, obj.position, obj.boundingRadius))
+            continue;
+
+        // the coarsest sphere is plenty for a depth map
+        uint8_t mesh = obj.shape == SHAPE_SPHERE ? (uint8_t)MESH_SPHERE_LOD2 : (uint8_t)MESH_TETRA;
+        DrawPacket& p = packets[count++];
+        p.model = Affine3x4::Translation(obj.position);
+        if (obj.rotating)
+            p.model = p.model * rotation;
+        p.mesh = mesh;
+        p.material = obj.material;
+        p.object = (uint32_t)i;
+        p.sortKey = mesh;
+    }
+    std::sort(packets, packets + count,
+        [](const DrawPacket& a, const DrawPacket& b) { return a.sortKey < b.sortKey; });
+
+    const DrawPacket** list = arena.AllocateArray<const DrawPacket*>(count);
+    for (size_t i = 0; i < count; ++i)
+        list[i] = &packets[i];
+    out.packets = list;
+    out.count = count;
+    out.mvps = nullptr;
+    if (frame.computeMvp)
+    {
+        // already one job per map: its groups run right here
+        glm::mat4* mvps = arena.AllocateArray<glm::mat4>(count);
+        for (size_t first = 0; first < count; first += MVP_GROUP)
+            MultiplyModels(lightViewProj, list + first, std::min(MVP_GROUP, count - first), mvps + first);
+        out.mvps = mvps;
+    }
+}
+
+// k-way merge of the per-slice sorted runs into an arena array; the heap
+// lives in a fixed array so the merge itself does not allocate
+void FramePipeline::Merge()
+{
+    culled = 0;
+    occluded = 0;
+    size_t total = 0;
+    for (const Slice& s : slices)
+        total += s.count;
+
+    const DrawPacket** out = arena.AllocateArray<const DrawPacket*>(total);
+    merged.packets = out;
+    merged.count = total;
+
+    struct Head
+    {
+        const DrawPacket* cur;
+        const DrawPacket* end;
+    };
+    Head heads[MAX_SLICES];
+    size_t headCount = 0;
+
+    auto greater = [](const Head& a, const Head& b) { return a.cur->sortKey > b.cur->sortKey; };
+
+    for (const Slice& s : slices)
+    {
+        culled += s.culled;
+        occluded += s.occluded;
+        if (s.count == 0)
+            continue;
+        heads[headCount++] = Head{ s.packets, s.packets + s.count };
+    }
+
+    std::make_heap(heads, heads + headCount, greater);
+    while (headCount > 0)
+    {
+        std::pop_heap(heads, heads + headCount, greater);
+        Head& h = heads[headCount - 1];
+        *out++ = h.cur++;
+        if (h.cur == h.end)
+            --headCount;
+        else
+            std::push_heap(heads, heads + headCount, greater);
+    }
+}
+
+// ---------- MVPs ----------
+
+void FramePipeline::ComputeMvps()
+{
+    glm::mat4* out = arena.AllocateArray<glm::mat4>(merged.count);
+    merged.mvps = out;
+
+    auto multiply = [this, out](size_t begin, size_t end)
+    {
+        for (size_t g = begin; g < end; ++g)
+        {
+            size_t first = g * MVP_GROUP;
+            MultiplyModels(viewProj, merged.packets + first, std::min(MVP_GROUP, merged.count - first), out + first);
+        }
+    };
+    size_t groups = (merged.count + MVP_GROUP - 1) / MVP_GROUP;
+    JobCounter counter;
+    jobs.ParallelFor(counter, groups, 1, multiply);
+    jobs.Wait(counter);
+}
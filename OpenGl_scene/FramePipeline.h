@@ -0,0 +1,110 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include "FrameMemory.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct FrameParams
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    float time;             // drives the rotating objects
+    int viewportHeight;     // for LOD selection in pixels
+    bool computeMvp = false;    // fill PacketStream::mvps as well
+    bool frontToBack = false;   // sort by view depth first (MakeDepthSortKey), not by state
+    bool occlusionCulling = false;  // drop objects hidden behind the largest ones (OcclusionCuller)
+};
+
+// which objects RecordCasters takes: moving ones are those that rotate
+enum CasterSet
+{
+    CASTERS_ALL = 0,
+    CASTERS_STATIC,
+    CASTERS_MOVING      // visits only the moving objects, not the whole scene
+};
+
+// Records one frame of the scene as jobs: culling, LOD selection and model
+// matrix composition happen per object slice, each slice writes sorted
+// DrawPackets into the frame arena. Record() merges the slices into one
+// sorted stream the GL thread only has to replay, and on request multiplies
+// every model by the frame's view-projection in batches of 16 (MatrixBatch.h).
+// With occlusion culling a first pass over the slices picks the objects that
+// look biggest on screen as occluders, and the slices then also drop what
+// they hide. After warm-up a frame does not touch the heap.
+class FramePipeline
+{
+public:
+    // must be called from a JobSystem thread (normally the main thread)
+    FramePipeline(const Scene& scene, JobSystem& jobs);
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // stays valid for the next framesInFlight - 1 Record() calls
+    PacketStream Record(const FrameParams& params);
+
+    size_t culledCount() const { return culled; }
+    size_t occludedCount() const { return occluded; }
+    const OcclusionCuller& occlusionCuller() const { return occlusion; }
+
+    // projection * view of the last Record()
+    const glm::mat4& viewProjection() const { return viewProj; }
+
+    // Shadow casters: the objects of `set` inside each of `count` light
+    // frusta, one job per frustum, sorted by mesh only (the shadow passes
+    // draw depth), with each light's MVPs if that Record() computed MVPs.
+    // Call after Record() for the same frame; valid as long as its packets.
+    void RecordCasters(const glm::mat4* lightViewProj, int count, CasterSet set, PacketStream* out);
+
+private:
+    static constexpr unsigned int MAX_SLICES = 64;
+    static constexpr unsigned int MAX_OCCLUDERS = 32;
+
+    struct OccluderCandidate
+    {
+        float size;         // radius / view depth
+        uint32_t object;
+    };
+
+    struct Slice
+    {
+        DrawPacket* packets = nullptr;
+        size_t count = 0;
+        size_t culled = 0;
+        size_t occluded = 0;
+        OccluderCandidate occluders[MAX_OCCLUDERS];
+        unsigned int occluderCount = 0;
+    };
+
+    void SliceRange(unsigned int sliceIndex, size_t& begin, size_t& end) const;
+    void FindOccluders(unsigned int sliceIndex);
+    void RasterizeOccluders();
+    void RecordSlice(unsigned int sliceIndex);
+    void RecordCasterList(const glm::mat4& lightViewProj, CasterSet set, PacketStream& out);
+    void Merge();
+    void ComputeMvps();
+
+    const Scene& scene;
+    JobSystem& jobs;
+    std::vector<Slice> slices;
+    std::vector<uint32_t> movingObjects;     // indices of the rotating objects
+    FrameArena arena;
+    PacketStream merged;
+
+    FrameParams frame;
+    glm::mat4 viewProj;
+    glm::vec4 frustum[6];
+    size_t culled = 0;
+    size_t occluded = 0;
+    OcclusionCuller occlusion;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+
+FrameProfiler::FrameProfiler(unsigned int latency, size_t maxTraceEvents)
+    : ring(std::max(latency, 2u)), maxTrace(maxTraceEvents)
+{
+    for (FrameSlot& slot : ring)
+        glGenQueries(MAX_SCOPES_PER_FRAME * 2, slot.queries);
+
+    cpuEpoch = 0;
+    cpuEpoch = CpuNow();
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuEpoch = gpuNow;
+
+    // steady state must not allocate: reserve up front
+    scopeStats.reserve(MAX_SCOPES_PER_FRAME);
+    trace.reserve(maxTrace);
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    for (FrameSlot& slot : ring)
+        glDeleteQueries(MAX_SCOPES_PER_FRAME * 2, slot.queries);
+}
+
+int64_t FrameProfiler::CpuNow() const
+{
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return ns - cpuEpoch;
+}
+
+void FrameProfiler::BeginFrame()
+{
+    ++frame;
+    current = &ring[frame % ring.size()];
+    if (current->pending)
+        Collect(*current, false);
+
+    current->frameIndex = frame;
+    current->scopeCount = 0;
+    depth = 0;
+}
+
+void FrameProfiler::EndFrame()
+{
+    if (!current)
+        return;
+    current->pending = current->scopeCount > 0;
+    current = nullptr;
+}
+
+int FrameProfiler::BeginScope(const char* name)
+{
+    if (!current || current->scopeCount == MAX_SCOPES_PER_FRAME)
+        return -1;
+
+    int id = current->scopeCount++;
+    ScopeRecord& rec = current->scopes[id];
+    rec.name = name;
+    rec.depth = depth++;
+    rec.cpuBegin = CpuNow();
+    rec.cpuEnd = rec.cpuBegin;
+    glQueryCounter(current->queries[2 * id], GL_TIMESTAMP);
+    return id;
+}
+
+void FrameProfiler::EndScope(int scope)
+{
+    if (!current || scope < 0)
+        return;
+    glQueryCounter(current->queries[2 * scope + 1], GL_TIMESTAMP);
+    current->scopes[scope].cpuEnd = CpuNow();
+    --depth;
+}
+
+void FrameProfiler::Flush()
+{
+    // oldest first, so the trace stays in order
+    for (size_t i = 1; i <= ring.size(); ++i)
+    {
+        FrameSlot& slot = ring[(frame + i) % ring.size()];
+        if (slot.pending && &slot != current)
+            Collect(slot, true);
+    }
+}
+
+FrameProfiler::Stats& FrameProfiler::StatsFor(const char* name)
+{
+    for (Stats& s : scopeStats)
+    {
+        if (s.name == name || std::strcmp(s.name, name) == 0)
+            return s;
+    }
+    scopeStats.push_back(Stats());
+    scopeStats.back().name = name;
+    return scopeStats.back();
+}
+
+void FrameProfiler::Collect(FrameSlot& slot, bool wait)
+{
+    slot.pending = false;
+
+    bool gpuReady = true;
+    if (!wait)
+    {
+        for (int i = 0; i < slot.scopeCount && gpuReady; ++i)
+        {
+            GLuint available = 0;
+            glGetQueryObjectuiv(slot.queries[2 * i + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            gpuReady = available != 0;
+        }
+        if (!gpuReady)
+            ++dropped;
+    }
+
+    for (int i = 0; i < slot.scopeCount; ++i)
+    {
+        const ScopeRecord& rec = slot.scopes[i];
+        Stats& s = StatsFor(rec.name);
+
+        double cpuMs = (rec.cpuEnd - rec.cpuBegin) * 1e-6;
+        s.cpuMin = s.count ? std::min(s.cpuMin, cpuMs) : cpuMs;
+        s.cpuMax = s.count ? std::max(s.cpuMax, cpuMs) : cpuMs;
+        s.cpuSum += cpuMs;
+        ++s.count;
+
+        if (trace.size() < maxTrace)
+            trace.push_back(TraceEvent{ rec.name, 0, rec.depth, rec.cpuBegin, rec.cpuEnd });
+
+        if (!gpuReady)
+            continue;
+
+        GLuint64 gpuBegin = 0, gpuEnd = 0;
+        glGetQueryObjectui64v(slot.queries[2 * i], GL_QUERY_RESULT, &gpuBegin);
+        glGetQueryObjectui64v(slot.queries[2 * i + 1], GL_QUERY_RESULT, &gpuEnd);
+
+        double gpuMs = (gpuEnd > gpuBegin ? gpuEnd - gpuBegin : 0) * 1e-6;
+        s.gpuMin = s.gpuCount ? std::min(s.gpuMin, gpuMs) : gpuMs;
+        s.gpuMax = s.gpuCount ? std::max(s.gpuMax, gpuMs) : gpuMs;
+        s.gpuSum += gpuMs;
+        ++s.gpuCount;
+
+        if (trace.size() < maxTrace)
+            trace.push_back(TraceEvent{ rec.name, 1, rec.depth, (int64_t)gpuBegin - gpuEpoch, (int64_t)gpuEnd - gpuEpoch });
+    }
+}
+
+const FrameProfiler::Stats* FrameProfiler::Find(const char* name) const
+{
+    for (const Stats& s : scopeStats)
+    {
+        if (std::strcmp(s.name, name) == 0)
+            return &s;
+    }
+    return nullptr;
+}
+
+// ---------- export ----------
+
+static void WriteJsonString(FILE* f, const char* s)
+{
+    std::fputc('"', f);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            std::fputc('\\', f);
+        std::fputc(*s, f);
+    }
+    std::fputc('"', f);
+}
+
+bool FrameProfiler::WriteChromeTrace(const char* path) const
+{
+    FILE* f = std::fopen(path, "w");
+    if (!f)
+        return false;
+
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU (GL thread)\"}},\n");
+    std::fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+    for (const TraceEvent& e : trace)
+    {
+        std::fprintf(f, ",\n{\"name\":");
+        WriteJsonString(f, e.name);
+        std::fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            e.track == 0 ? "cpu" : "gpu", e.track + 1, e.begin * 1e-3, (e.end - e.begin) * 1e-3);
+    }
+
+    std::fprintf(f, "\n],\"otherData\":{\"frames\":%llu,\"droppedGpuFrames\":%llu,\"scopes\":{",
+        (unsigned long long)frame, (unsigned long long)dropped);
+    for (size_t i = 0; i < scopeStats.size(); ++i)
+    {
+        const Stats& s = scopeStats[i];
+        std::fprintf(f, "%s\n", i ? "," : "");
+        WriteJsonString(f, s.name);
+        std::fprintf(f, ":{\"count\":%llu,\"cpu_ms\":{\"min\":%.4f,\"avg\":%.4f,\"max\":%.4f}",
+            (unsigned long long)s.count, s.cpuMin, s.count ? s.cpuSum / s.count : 0.0, s.cpuMax);
+        std::fprintf(f, ",\"gpu_ms\":{\"min\":%.4f,\"avg\":%.4f,\"max\":%.4f}}",
+            s.gpuMin, s.gpuCount ? s.gpuSum / s.gpuCount : 0.0, s.gpuMax);
+    }
+    std::fprintf(f, "}}}\n");
+
+    return std::fclose(f) == 0;
+}
+
+void FrameProfiler::PrintSummary(std::ostream& out) const
+{
+    out << std::fixed << std::setprecision(3);
+    out << "scope                 cpu min/avg/max (ms)           gpu min/avg/max (ms)\n";
+    for (const Stats& s : scopeStats)
+    {
+        out << std::left << std::setw(20) << s.name << std::right
+            << std::setw(9) << s.cpuMin << std::setw(9) << (s.count ? s.cpuSum / s.count : 0.0) << std::setw(9) << s.cpuMax
+            << "    "
+            << std::setw(9) << s.gpuMin << std::setw(9) << (s.gpuCount ? s.gpuSum / s.gpuCount : 0.0) << std::setw(9) << s.gpuMax
+            << "\n";
+    }
+    if (dropped)
+        out << dropped << " frame(s) had GPU results still pending and were skipped\n";
+}
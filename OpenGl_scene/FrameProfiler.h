@@ -0,0 +1,119 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// ---------- FrameProfiler ----------
+// Named CPU + GPU scopes for the GL thread. Each scope takes a CPU timestamp
+// and issues glQueryCounter(GL_TIMESTAMP) at begin and end. Queries live in
+// a ring of `latency` frames and are read back `latency` frames later, when
+// they are normally already available, so the CPU never waits on the GPU
+// (a frame whose results are still pending is dropped instead).
+//
+// Per-scope min/avg/max are accumulated for both timelines; WriteChromeTrace
+// dumps the recorded events plus those stats for chrome://tracing / Perfetto.
+// Scope names must be string literals (stored by pointer).
+class FrameProfiler
+{
+public:
+    static constexpr int MAX_SCOPES_PER_FRAME = 64;
+
+    explicit FrameProfiler(unsigned int latency = 4, size_t maxTraceEvents = 200000);
+    ~FrameProfiler();
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    void BeginFrame();
+    void EndFrame();
+
+    int BeginScope(const char* name);
+    void EndScope(int scope);
+
+    // reads back every frame still in flight (blocking); call before exporting
+    void Flush();
+
+    bool WriteChromeTrace(const char* path) const;
+    void PrintSummary(std::ostream& out) const;
+
+    struct Stats
+    {
+        const char* name = nullptr;
+        uint64_t count = 0;
+        double cpuMin = 0.0, cpuMax = 0.0, cpuSum = 0.0;   // ms
+        uint64_t gpuCount = 0;
+        double gpuMin = 0.0, gpuMax = 0.0, gpuSum = 0.0;   // ms
+    };
+    const std::vector<Stats>& stats() const { return scopeStats; }
+    const Stats* Find(const char* name) const;
+
+    uint64_t droppedFrames() const { return dropped; }
+
+private:
+    struct ScopeRecord
+    {
+        const char* name;
+        int depth;
+        int64_t cpuBegin, cpuEnd;   // ns since profiler creation
+    };
+
+    struct FrameSlot
+    {
+        uint64_t frameIndex = 0;
+        bool pending = false;
+        int scopeCount = 0;
+        ScopeRecord scopes[MAX_SCOPES_PER_FRAME];
+        GLuint queries[MAX_SCOPES_PER_FRAME * 2];
+    };
+
+    struct TraceEvent
+    {
+        const char* name;
+        int track;          // 0 = CPU, 1 = GPU
+        int depth;
+        int64_t begin, end; // ns
+    };
+
+    void Collect(FrameSlot& slot, bool wait);
+    Stats& StatsFor(const char* name);
+    int64_t CpuNow() const;
+
+    std::vector<FrameSlot> ring;
+    FrameSlot* current = nullptr;
+    uint64_t frame = 0;
+    int depth = 0;
+
+    int64_t cpuEpoch;       // steady_clock ns at creation
+    int64_t gpuEpoch;       // GL_TIMESTAMP at creation
+
+    std::vector<Stats> scopeStats;
+    std::vector<TraceEvent> trace;
+    size_t maxTrace;
+    uint64_t dropped = 0;
+};
+
+// RAII helper: ProfileScope scope(profiler, "shadow pass");
+class ProfileScope
+{
+public:
+    ProfileScope(FrameProfiler* profiler, const char* name)
+        : profiler(profiler), id(profiler ? profiler->BeginScope(name) : -1) {}
+    ~ProfileScope()
+    {
+        if (profiler)
+            profiler->EndScope(id);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    FrameProfiler* profiler;
+    int id;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "HeadlessContext.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if SCENE_HAS_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+static EGLDisplay OpenDisplay()
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    EGLint major, minor;
+    if (getPlatformDisplay)
+    {
+        EGLDisplay d = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (d != EGL_NO_DISPLAY && eglInitialize(d, &major, &minor))
+            return d;
+    }
+
+    EGLDisplay d = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (d != EGL_NO_DISPLAY && eglInitialize(d, &major, &minor))
+        return d;
+    return EGL_NO_DISPLAY;
+}
+
+bool HeadlessContext::Create(int width, int height)
+{
+    EGLDisplay d = OpenDisplay();
+    if (d == EGL_NO_DISPLAY)
+    {
+        std::cout << "Failed to open an EGL display\n";
+        return false;
+    }
+    display = d;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "EGL: desktop OpenGL not supported\n";
+        Destroy();
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    eglChooseConfig(d, configAttribs, &config, 1, &configCount);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext ctx = eglCreateContext(d, configCount ? config : NULL, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx == EGL_NO_CONTEXT)
+    {
+        std::cout << "Failed to create EGL GL 3.3 core context (0x" << std::hex << eglGetError() << std::dec << ")\n";
+        Destroy();
+        return false;
+    }
+    context = ctx;
+
+    // surfaceless first; drivers without EGL_KHR_surfaceless_context get a tiny pbuffer
+    if (!eglMakeCurrent(d, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx))
+    {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        EGLSurface s = configCount ? eglCreatePbufferSurface(d, config, pbufferAttribs) : EGL_NO_SURFACE;
+        if (s == EGL_NO_SURFACE || !eglMakeCurrent(d, s, s, ctx))
+        {
+            std::cout << "Failed to make the EGL context current\n";
+            Destroy();
+            return false;
+        }
+        surface = s;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD\n";
+        Destroy();
+        return false;
+    }
+
+    // ---------- offscreen framebuffer ----------
+    fbWidth = width;
+    fbHeight = height;
+
+    glGenRenderbuffers(1, &colorRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depthRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRb);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen framebuffer is incomplete\n";
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::Destroy()
+{
+    if (context)
+    {
+        if (fbo) glDeleteFramebuffers(1, &fbo);
+        if (colorRb) glDeleteRenderbuffers(1, &colorRb);
+        if (depthRb) glDeleteRenderbuffers(1, &depthRb);
+        fbo = colorRb = depthRb = 0;
+
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+        context = nullptr;
+    }
+    if (surface)
+    {
+        eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+        surface = nullptr;
+    }
+    if (display)
+    {
+        eglTerminate((EGLDisplay)display);
+        display = nullptr;
+    }
+}
+
+#else
+
+bool HeadlessContext::Create(int, int)
+{
+    std::cout << "Headless mode needs EGL, which this build does not have\n";
+    return false;
+}
+
+void HeadlessContext::Destroy()
+{
+}
+
+#endif
+
+HeadlessContext::~HeadlessContext()
+{
+    Destroy();
+}
+
+void HeadlessContext::ReadPixels(std::vector<unsigned char>& rgba) const
+{
+    size_t rowBytes = (size_t)fbWidth * 4;
+    rgba.resize(rowBytes * fbHeight);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, fbWidth, fbHeight, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    // GL rows are bottom-up
+    std::vector<unsigned char> row(rowBytes);
+    for (int y = 0; y < fbHeight / 2; ++y)
+    {
+        unsigned char* a = &rgba[(size_t)y * rowBytes];
+        unsigned char* b = &rgba[(size_t)(fbHeight - 1 - y) * rowBytes];
+        std::copy(a, a + rowBytes, row.begin());
+        std::copy(b, b + rowBytes, a);
+        std::copy(row.begin(), row.end(), b);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// EGL (Mesa surfaceless / pbuffer) is only wired up on Linux; the build can
+// force it off with SCENE_HAS_EGL=0
+#if !defined(SCENE_HAS_EGL) && defined(__linux__)
+#define SCENE_HAS_EGL 1
+#endif
+
+// Windowless GL 3.3 core context rendering into an FBO of a fixed size.
+// Tries EGL_MESA_platform_surfaceless first (no X/Wayland, works with
+// llvmpipe), then the default EGL display with a 1x1 pbuffer.
+class HeadlessContext
+{
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // creates the context, loads GL through glad and binds the FBO
+    bool Create(int width, int height);
+    void Destroy();
+
+    // RGBA8, rows top to bottom
+    void ReadPixels(std::vector<unsigned char>& rgba) const;
+
+    int width() const { return fbWidth; }
+    int height() const { return fbHeight; }
+    GLuint framebuffer() const { return fbo; }
+
+private:
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+
+    GLuint fbo = 0;
+    GLuint colorRb = 0;
+    GLuint depthRb = 0;
+    int fbWidth = 0;
+    int fbHeight = 0;
+};
+
+#endif
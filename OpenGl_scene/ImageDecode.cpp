@@ -0,0 +1,76 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "ImageDecode.h"
+#include "FileView.h"
+
+#include <iostream>
+
+bool DecodeImage(const char* path, int desiredChannels, DecodedImage& out, const Vfs& files)
+{
+    // decoded straight from the mapped file instead of stbi_load's FILE* reads
+    FileView file = files.Open(path);   // reports a missing file itself
+    if (!file.valid())
+        return false;
+    if (file.size() > 0x7FFFFFFF)
+    {
+        std::cout << "Failed to load image " << path << ": too large" << std::endl;
+        return false;
+    }
+    int fileChannels = 0;
+    out.pixels = stbi_load_from_memory(file.data(), (int)file.size(), &out.width, &out.height, &fileChannels, desiredChannels);
+    out.channels = desiredChannels ? desiredChannels : fileChannels;
+    if (!out.pixels)
+    {
+        std::cout << "Failed to load image " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// stbi_parallel_for on the job system: one job per task, waited on here
+static void JobParallelFor(void* user, int count, stbi_parallel_task task, void* taskData)
+{
+    JobSystem& jobs = *(JobSystem*)user;
+    JobCounter counter;
+    auto run = [task, taskData](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            task(taskData, (int)i);
+    };
+    jobs.ParallelFor(counter, (size_t)count, 1, run);
+    jobs.Wait(counter);
+}
+
+bool DecodeImageParallel(JobSystem& jobs, const unsigned char* data, size_t size, int desiredChannels, DecodedImage& out)
+{
+    if (size > 0x7FFFFFFF)
+        return false;
+    // a few tasks per thread evens out restart intervals of uneven cost
+    int tasks = jobs.threadCount() > 1 ? (int)jobs.threadCount() * 4 : 1;
+    int fileChannels = 0;
+    out.pixels = stbi_load_from_memory_parallel(data, (int)size, &out.width, &out.height, &fileChannels, desiredChannels,
+        JobParallelFor, &jobs, tasks);
+    out.channels = desiredChannels ? desiredChannels : fileChannels;
+    return out.pixels != nullptr;
+}
+
+bool DecodeImageParallel(JobSystem& jobs, const char* path, int desiredChannels, DecodedImage& out,
+    const Vfs& files)
+{
+    FileView file = files.Open(path);
+    if (!file.valid())
+        return false;
+    if (!DecodeImageParallel(jobs, file.data(), file.size(), desiredChannels, out))
+    {
+        std::cout << "Failed to load image " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FreeDecodedImage(DecodedImage& image)
+{
+    stbi_image_free(image.pixels);
+    image = DecodedImage();
+}
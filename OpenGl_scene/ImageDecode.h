@@ -0,0 +1,30 @@
+#ifndef IMAGE_DECODE_H
+#define IMAGE_DECODE_H
+
+#include "FileView.h"
+#include "JobSystem.h"
+
+#include <cstddef>
+
+// stb_image result; pixels are owned until FreeDecodedImage()
+struct DecodedImage
+{
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+};
+
+// decodes `path` (looked up in `files`) with stb_image; desiredChannels = 0
+// keeps the file's count
+bool DecodeImage(const char* path, int desiredChannels, DecodedImage& out, const Vfs& files = Vfs());
+
+// like DecodeImage, but a JPEG's decode stages are split over the job
+// threads (stbi_load_from_memory_parallel); same pixels as the serial path.
+// Must be called from a job thread, which helps out while it waits.
+bool DecodeImageParallel(JobSystem& jobs, const unsigned char* data, size_t size, int desiredChannels, DecodedImage& out);
+bool DecodeImageParallel(JobSystem& jobs, const char* path, int desiredChannels, DecodedImage& out,
+    const Vfs& files = Vfs());
+void FreeDecodedImage(DecodedImage& image);
+
+#endif
@@ -0,0 +1,482 @@
+#include "ImageWrite.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        tableReady = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void PutU32(std::vector<unsigned char>& out, uint32_t v)
+{
+    out.push_back((unsigned char)(v >> 24));
+    out.push_back((unsigned char)(v >> 16));
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)v);
+}
+
+static void PutChunk(std::vector<unsigned char>& out, const char type[4], const std::vector<unsigned char>& data)
+{
+    PutU32(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    PutU32(out, Crc32(&out[start], out.size() - start));
+}
+
+bool WritePng(const char* path, int width, int height, int channels, const unsigned char* pixels)
+{
+    static const unsigned char colorTypes[5] = { 0, 0, 4, 2, 6 };   // gray, gray+alpha, RGB, RGBA
+    if (channels < 1 || channels > 4 || width <= 0 || height <= 0)
+        return false;
+
+    // filter byte 0 (none) in front of every row
+    size_t rowBytes = (size_t)width * channels;
+    std::vector<unsigned char> raw;
+    raw.reserve((rowBytes + 1) * height);
+    for (int y = 0; y < height; ++y)
+    {
+        raw.push_back(0);
+        const unsigned char* row = pixels + (size_t)y * rowBytes;
+        raw.insert(raw.end(), row, row + rowBytes);
+    }
+
+    // zlib: header, stored blocks of up to 65535 bytes, adler32
+    std::vector<unsigned char> z;
+    z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    z.push_back(0x78);
+    z.push_back(0x01);
+    size_t pos = 0;
+    do
+    {
+        size_t len = raw.size() - pos;
+        if (len > 65535) len = 65535;
+        bool last = pos + len == raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back((unsigned char)(len & 0xFF));
+        z.push_back((unsigned char)(len >> 8));
+        z.push_back((unsigned char)(~len & 0xFF));
+        z.push_back((unsigned char)((~len >> 8) & 0xFF));
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw)
+    {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    PutU32(z, (b << 16) | a);
+
+    std::vector<unsigned char> ihdr;
+    PutU32(ihdr, (uint32_t)width);
+    PutU32(ihdr, (uint32_t)height);
+    ihdr.push_back(8);                      // bit depth
+    ihdr.push_back(colorTypes[channels]);
+    ihdr.push_back(0);                      // deflate
+    ihdr.push_back(0);                      // adaptive filtering
+    ihdr.push_back(0);                      // no interlace
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> file(signature, signature + 8);
+    PutChunk(file, "IHDR", ihdr);
+    PutChunk(file, "IDAT", z);
+    PutChunk(file, "IEND", std::vector<unsigned char>());
+
+    FILE* f = std::fopen(path, "wb");
+    if (!f)
+        return false;
+    bool ok = std::fwrite(file.data(), 1, file.size(), f) == file.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+// ---------- JPEG ----------
+
+static const unsigned char JPEG_ZIGZAG[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static const unsigned char JPEG_LUMA_QUANT[64] = {
+    16, 11, 10, 16,  24,  40,  51,  61,
+    12, 12, 14, 19,  26,  58,  60,  55,
+    14, 13, 16, 24,  40,  57,  69,  56,
+    14, 17, 22, 29,  51,  87,  80,  62,
+    18, 22, 37, 56,  68, 109, 103,  77,
+    24, 35, 55, 64,  81, 104, 113,  92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103,  99
+};
+
+static const unsigned char JPEG_CHROMA_QUANT[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// Annex K.3 Huffman tables: code counts per length 1..16, then the symbols
+static const unsigned char JPEG_DC_LUMA_BITS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const unsigned char JPEG_DC_CHROMA_BITS[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const unsigned char JPEG_DC_VALUES[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const unsigned char JPEG_AC_LUMA_BITS[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const unsigned char JPEG_AC_LUMA_VALUES[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const unsigned char JPEG_AC_CHROMA_BITS[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const unsigned char JPEG_AC_CHROMA_VALUES[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+struct HuffmanCode
+{
+    uint16_t code[256];
+    uint8_t length[256];
+};
+
+// canonical codes from the per-length counts (Annex C)
+static void BuildHuffman(const unsigned char bits[16], const unsigned char* values, HuffmanCode& out)
+{
+    uint16_t code = 0;
+    int k = 0;
+    for (int len = 1; len <= 16; ++len)
+    {
+        for (int i = 0; i < bits[len - 1]; ++i, ++k)
+        {
+            out.code[values[k]] = code++;
+            out.length[values[k]] = (uint8_t)len;
+        }
+        code <<= 1;
+    }
+}
+
+class JpegBitWriter
+{
+public:
+    explicit JpegBitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+    void Put(uint32_t value, int count)
+    {
+        buffer = (buffer << count) | (value & ((1u << count) - 1));
+        bits += count;
+        while (bits >= 8)
+        {
+            bits -= 8;
+            unsigned char byte = (unsigned char)(buffer >> bits);
+            out.push_back(byte);
+            if (byte == 0xFF)
+                out.push_back(0);       // byte stuffing
+        }
+    }
+
+    // pad the last byte with 1 bits
+    void Flush()
+    {
+        if (bits > 0)
+            Put(0x7F, 8 - bits);
+        buffer = 0;
+    }
+
+private:
+    std::vector<unsigned char>& out;
+    uint32_t buffer = 0;
+    int bits = 0;
+};
+
+static int MagnitudeBits(int v)
+{
+    if (v < 0) v = -v;
+    int n = 0;
+    while (v)
+    {
+        ++n;
+        v >>= 1;
+    }
+    return n;
+}
+
+// forward DCT, quantization and Huffman coding of one 8x8 block of samples
+static void EncodeBlock(JpegBitWriter& writer, const float samples[64], const uint16_t quant[64],
+    const HuffmanCode& dc, const HuffmanCode& ac, int& dcPred)
+{
+    static float cosines[8][8];
+    static bool cosinesReady = false;
+    if (!cosinesReady)
+    {
+        for (int u = 0; u < 8; ++u)
+            for (int x = 0; x < 8; ++x)
+                cosines[u][x] = (float)std::cos((2 * x + 1) * u * 3.14159265358979 / 16.0) * (u == 0 ? (float)std::sqrt(0.125) : 0.5f);
+        cosinesReady = true;
+    }
+
+    float rows[64];
+    for (int y = 0; y < 8; ++y)
+        for (int u = 0; u < 8; ++u)
+        {
+            float sum = 0.0f;
+            for (int x = 0; x < 8; ++x)
+                sum += (samples[y * 8 + x] - 128.0f) * cosines[u][x];
+            rows[y * 8 + u] = sum;
+        }
+
+    int coeffs[64];
+    for (int v = 0; v < 8; ++v)
+        for (int u = 0; u < 8; ++u)
+        {
+            float sum = 0.0f;
+            for (int y = 0; y < 8; ++y)
+                sum += rows[y * 8 + u] * cosines[v][y];
+            coeffs[v * 8 + u] = (int)std::lround(sum / quant[v * 8 + u]);
+        }
+
+    int diff = coeffs[0] - dcPred;
+    dcPred = coeffs[0];
+    int size = MagnitudeBits(diff);
+    writer.Put(dc.code[size], dc.length[size]);
+    if (size)
+        writer.Put(diff < 0 ? diff - 1 : diff, size);
+
+    int run = 0;
+    for (int k = 1; k < 64; ++k)
+    {
+        int c = coeffs[JPEG_ZIGZAG[k]];
+        if (c == 0)
+        {
+            ++run;
+            continue;
+        }
+        for (; run > 15; run -= 16)
+            writer.Put(ac.code[0xF0], ac.length[0xF0]);     // ZRL
+        size = MagnitudeBits(c);
+        int symbol = (run << 4) | size;
+        writer.Put(ac.code[symbol], ac.length[symbol]);
+        writer.Put(c < 0 ? c - 1 : c, size);
+        run = 0;
+    }
+    if (run)
+        writer.Put(ac.code[0x00], ac.length[0x00]);         // EOB
+}
+
+static void PutU16(std::vector<unsigned char>& out, int v)
+{
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)v);
+}
+
+static void PutMarker(std::vector<unsigned char>& out, unsigned char marker, int length)
+{
+    out.push_back(0xFF);
+    out.push_back(marker);
+    PutU16(out, length);
+}
+
+static void PutHuffmanTable(std::vector<unsigned char>& out, int classAndId, const unsigned char bits[16], const unsigned char* values)
+{
+    int count = 0;
+    for (int i = 0; i < 16; ++i)
+        count += bits[i];
+    out.push_back((unsigned char)classAndId);
+    out.insert(out.end(), bits, bits + 16);
+    out.insert(out.end(), values, values + count);
+}
+
+bool EncodeJpeg(std::vector<unsigned char>& out, int width, int height, int channels, const unsigned char* pixels,
+    int quality, int restartInterval)
+{
+    if (channels < 1 || channels > 4 || width <= 0 || height <= 0 || width > 65535 || height > 65535 || restartInterval > 65535)
+        return false;
+    bool color = channels >= 3;
+    int components = color ? 3 : 1;
+
+    // libjpeg quality scaling of the Annex K tables
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    uint16_t quant[2][64];
+    for (int i = 0; i < 64; ++i)
+    {
+        int l = (JPEG_LUMA_QUANT[i] * scale + 50) / 100;
+        int c = (JPEG_CHROMA_QUANT[i] * scale + 50) / 100;
+        quant[0][i] = (uint16_t)(l < 1 ? 1 : l > 255 ? 255 : l);
+        quant[1][i] = (uint16_t)(c < 1 ? 1 : c > 255 ? 255 : c);
+    }
+
+    HuffmanCode dcCodes[2], acCodes[2];
+    BuildHuffman(JPEG_DC_LUMA_BITS, JPEG_DC_VALUES, dcCodes[0]);
+    BuildHuffman(JPEG_DC_CHROMA_BITS, JPEG_DC_VALUES, dcCodes[1]);
+    BuildHuffman(JPEG_AC_LUMA_BITS, JPEG_AC_LUMA_VALUES, acCodes[0]);
+    BuildHuffman(JPEG_AC_CHROMA_BITS, JPEG_AC_CHROMA_VALUES, acCodes[1]);
+
+    out.clear();
+    out.push_back(0xFF);
+    out.push_back(0xD8);                                    // SOI
+
+    static const unsigned char jfif[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    PutMarker(out, 0xE0, 16);
+    out.insert(out.end(), jfif, jfif + 14);
+
+    PutMarker(out, 0xDB, 2 + 65 * (color ? 2 : 1));         // DQT, zigzag order
+    for (int t = 0; t < (color ? 2 : 1); ++t)
+    {
+        out.push_back((unsigned char)t);
+        for (int k = 0; k < 64; ++k)
+            out.push_back((unsigned char)quant[t][JPEG_ZIGZAG[k]]);
+    }
+
+    PutMarker(out, 0xC0, 8 + 3 * components);               // SOF0
+    out.push_back(8);
+    PutU16(out, height);
+    PutU16(out, width);
+    out.push_back((unsigned char)components);
+    for (int c = 0; c < components; ++c)
+    {
+        out.push_back((unsigned char)(c + 1));
+        out.push_back(c == 0 && color ? 0x22 : 0x11);       // Y at 2x2, chroma 1x1: 4:2:0
+        out.push_back(c == 0 ? 0 : 1);
+    }
+
+    PutMarker(out, 0xC4, 2 + (17 + 12) + (17 + 162) + (color ? (17 + 12) + (17 + 162) : 0));   // DHT
+    PutHuffmanTable(out, 0x00, JPEG_DC_LUMA_BITS, JPEG_DC_VALUES);
+    PutHuffmanTable(out, 0x10, JPEG_AC_LUMA_BITS, JPEG_AC_LUMA_VALUES);
+    if (color)
+    {
+        PutHuffmanTable(out, 0x01, JPEG_DC_CHROMA_BITS, JPEG_DC_VALUES);
+        PutHuffmanTable(out, 0x11, JPEG_AC_CHROMA_BITS, JPEG_AC_CHROMA_VALUES);
+    }
+
+    if (restartInterval > 0)
+    {
+        PutMarker(out, 0xDD, 4);                            // DRI
+        PutU16(out, restartInterval);
+    }
+
+    PutMarker(out, 0xDA, 6 + 2 * components);               // SOS
+    out.push_back((unsigned char)components);
+    for (int c = 0; c < components; ++c)
+    {
+        out.push_back((unsigned char)(c + 1));
+        out.push_back(c == 0 ? 0x00 : 0x11);
+    }
+    out.push_back(0);
+    out.push_back(63);
+    out.push_back(0);
+
+    // edge pixels are replicated into partial MCUs
+    auto sample = [&](int x, int y, float& luma, float& cb, float& cr)
+    {
+        x = x < width ? x : width - 1;
+        y = y < height ? y : height - 1;
+        const unsigned char* p = pixels + ((size_t)y * width + x) * channels;
+        if (!color)
+        {
+            luma = p[0];
+            return;
+        }
+        float r = p[0], g = p[1], b = p[2];
+        luma = 0.299f * r + 0.587f * g + 0.114f * b;
+        cb = -0.168736f * r - 0.331264f * g + 0.5f * b + 128.0f;
+        cr = 0.5f * r - 0.418688f * g - 0.081312f * b + 128.0f;
+    };
+
+    int mcuSize = color ? 16 : 8;
+    int mcusX = (width + mcuSize - 1) / mcuSize;
+    int mcusY = (height + mcuSize - 1) / mcuSize;
+    int dcPred[3] = { 0, 0, 0 };
+    int restartCount = 0;
+    JpegBitWriter writer(out);
+    float blocks[6][64];
+    for (int my = 0; my < mcusY; ++my)
+    {
+        for (int mx = 0; mx < mcusX; ++mx)
+        {
+            int mcu = my * mcusX + mx;
+            if (restartInterval > 0 && mcu > 0 && mcu % restartInterval == 0)
+            {
+                writer.Flush();
+                out.push_back(0xFF);
+                out.push_back((unsigned char)(0xD0 + (restartCount++ & 7)));
+                dcPred[0] = dcPred[1] = dcPred[2] = 0;
+            }
+
+            if (!color)
+            {
+                float unused;
+                for (int y = 0; y < 8; ++y)
+                    for (int x = 0; x < 8; ++x)
+                        sample(mx * 8 + x, my * 8 + y, blocks[0][y * 8 + x], unused, unused);
+                EncodeBlock(writer, blocks[0], quant[0], dcCodes[0], acCodes[0], dcPred[0]);
+                continue;
+            }
+
+            // four luma blocks, then Cb and Cr averaged over 2x2 pixels
+            for (int i = 0; i < 64; ++i)
+                blocks[4][i] = blocks[5][i] = 0.0f;
+            for (int y = 0; y < 16; ++y)
+                for (int x = 0; x < 16; ++x)
+                {
+                    float luma, cb, cr;
+                    sample(mx * 16 + x, my * 16 + y, luma, cb, cr);
+                    blocks[(y >> 3) * 2 + (x >> 3)][(y & 7) * 8 + (x & 7)] = luma;
+                    blocks[4][(y >> 1) * 8 + (x >> 1)] += 0.25f * cb;
+                    blocks[5][(y >> 1) * 8 + (x >> 1)] += 0.25f * cr;
+                }
+            for (int b = 0; b < 4; ++b)
+                EncodeBlock(writer, blocks[b], quant[0], dcCodes[0], acCodes[0], dcPred[0]);
+            EncodeBlock(writer, blocks[4], quant[1], dcCodes[1], acCodes[1], dcPred[1]);
+            EncodeBlock(writer, blocks[5], quant[1], dcCodes[1], acCodes[1], dcPred[2]);
+        }
+    }
+    writer.Flush();
+    out.push_back(0xFF);
+    out.push_back(0xD9);                                    // EOI
+    return true;
+}
@@ -0,0 +1,18 @@
+#ifndef IMAGE_WRITE_H
+#define IMAGE_WRITE_H
+
+#include <vector>
+
+// Minimal PNG writer (8-bit, 1-4 channels, rows top to bottom). The zlib
+// stream uses stored blocks only: files are big but need no deflate code,
+// and stb_image reads them back fine.
+bool WritePng(const char* path, int width, int height, int channels, const unsigned char* pixels);
+
+// Baseline JPEG encoder (Annex K tables, libjpeg quality scaling). 3-4
+// channels are stored as YCbCr 4:2:0 with alpha dropped, 1-2 channels as
+// grayscale. restartInterval > 0 adds a DRI marker and an RSTn every that
+// many MCUs. Plain float DCT: meant for test and benchmark inputs, not speed.
+bool EncodeJpeg(std::vector<unsigned char>& out, int width, int height, int channels, const unsigned char* pixels,
+    int quality, int restartInterval = 0);
+
+#endif
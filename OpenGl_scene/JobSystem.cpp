@@ -0,0 +1,288 @@
+#include "JobSystem.h"
+
+#include <cassert>
+
+// ---------- WorkStealingDeque ----------
+// Le, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (PPoPP'13), without the resizing.
+
+WorkStealingDeque::WorkStealingDeque(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    buffer.reset(new std::atomic<Job*>[size]);
+    mask = size - 1;
+}
+
+bool WorkStealingDeque::Push(Job* job)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t > (int64_t)mask)
+        return false;
+    buffer[b & mask].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* WorkStealingDeque::Pop()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = buffer[b & mask].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        // last element: race against thieves
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingDeque::Steal()
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return nullptr;
+
+    Job* job = buffer[t & mask].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+// ---------- JobSystem ----------
+
+namespace
+{
+    struct ThreadSlot
+    {
+        const JobSystem* owner = nullptr;
+        int index = -1;
+    };
+    thread_local ThreadSlot tlsSlot;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    for (unsigned int i = 0; i <= workerCount; ++i)
+    {
+        queues.emplace_back(new ThreadQueue());
+        queues.back()->rng = 0x9E3779B9u * (i + 1);
+    }
+
+    tlsSlot.owner = this;
+    tlsSlot.index = 0;
+
+    for (unsigned int i = 1; i <= workerCount; ++i)
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit.store(true);
+    }
+    sleepCv.notify_all();
+    for (std::thread& w : workers)
+        w.join();
+
+    if (tlsSlot.owner == this)
+        tlsSlot = ThreadSlot();
+}
+
+int JobSystem::ThreadIndex()
+{
+    return tlsSlot.index;
+}
+
+// Jobs are recycled from a per-thread ring. Past JOBS_PER_THREAD in flight
+// the next slot may still hold a queued or running job, possibly one further
+// down this thread's own stack that is waiting on what we submit now: take
+// the next free slot instead, and with none free run other jobs until one is.
+Job* JobSystem::AllocateJob()
+{
+    assert(tlsSlot.owner == this && "jobs can only be submitted from job threads");
+    unsigned int self = (unsigned int)tlsSlot.index;
+    ThreadQueue& q = *queues[self];
+    for (;;)
+    {
+        for (size_t i = 0; i < JOBS_PER_THREAD; ++i)
+        {
+            Job* job = &q.jobs[q.nextJob++ & (JOBS_PER_THREAD - 1)];
+            if (!job->counter.load(std::memory_order_acquire))
+                return job;
+        }
+        if (!TryRunOne(self))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::Submit(Job* job)
+{
+    ThreadQueue& q = *queues[tlsSlot.index];
+    if (!q.deque.Push(job))
+    {
+        // deque full (it holds no more than the ring, so not reached while
+        // the two are the same size): run it right here instead of dropping it
+        if (job->dependency)
+            Wait(*job->dependency);
+        Execute(job);
+        return;
+    }
+
+    WakeWorker();
+}
+
+// ring full: run it right here, as Submit() does
+void JobSystem::SubmitBackground(Job* job)
+{
+    {
+        std::lock_guard<std::mutex> lock(backgroundMutex);
+        if (backgroundCount < BACKGROUND_JOBS)
+        {
+            background[(backgroundHead + backgroundCount++) % BACKGROUND_JOBS] = job;
+            job = nullptr;
+        }
+    }
+    if (job)
+    {
+        Execute(job);
+        return;
+    }
+    WakeWorker();
+}
+
+void JobSystem::WakeWorker()
+{
+    queued.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0)
+    {
+        // taking the lock orders us against a worker between its check and its wait
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        sleepCv.notify_one();
+    }
+}
+
+bool JobSystem::RunBackgroundJob()
+{
+    Job* job;
+    {
+        std::lock_guard<std::mutex> lock(backgroundMutex);
+        if (backgroundCount == 0)
+            return false;
+        job = background[backgroundHead];
+        backgroundHead = (backgroundHead + 1) % BACKGROUND_JOBS;
+        --backgroundCount;
+    }
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    Execute(job);
+    return true;
+}
+
+Job* JobSystem::FindJob(ThreadQueue& self, unsigned int selfIndex)
+{
+    Job* job = self.deque.Pop();
+    if (job)
+        return job;
+
+    unsigned int count = (unsigned int)queues.size();
+    if (count <= 1)
+        return nullptr;
+
+    // xorshift pick of the first victim, then sweep the rest
+    self.rng ^= self.rng << 13;
+    self.rng ^= self.rng >> 17;
+    self.rng ^= self.rng << 5;
+    unsigned int start = self.rng % count;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned int victim = (start + i) % count;
+        if (victim == selfIndex)
+            continue;
+        job = queues[victim]->deque.Steal();
+        if (job)
+            return job;
+    }
+    return nullptr;
+}
+
+bool JobSystem::TryRunOne(unsigned int selfIndex)
+{
+    Job* job = FindJob(*queues[selfIndex], selfIndex);
+    if (!job)
+        return false;
+    queued.fetch_sub(1, std::memory_order_relaxed);
+
+    // the dependency is somewhere in the queues; help until it drains
+    if (job->dependency && !job->dependency->done())
+        Wait(*job->dependency);
+
+    Execute(job);
+    return true;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    JobCounter* counter = job->counter.load(std::memory_order_relaxed);
+    job->invoke(*job);
+    // frees the slot for its owner; the callable is not touched after this
+    job->counter.store(nullptr, std::memory_order_release);
+    counter->value.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    int self = (tlsSlot.owner == this) ? tlsSlot.index : -1;
+    while (!counter.done())
+    {
+        if (self < 0 || !TryRunOne((unsigned int)self))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+    tlsSlot.owner = this;
+    tlsSlot.index = (int)index;
+
+    int idleSpins = 0;
+    while (!quit.load(std::memory_order_relaxed))
+    {
+        if (TryRunOne(index) || RunBackgroundJob())
+        {
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < 64)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCv.wait(lock, [&] { return quit.load() || queued.load(std::memory_order_seq_cst) > 0; });
+        }
+        sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        idleSpins = 0;
+    }
+}
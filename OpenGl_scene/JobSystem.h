@@ -0,0 +1,182 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ---------- Job counters ----------
+// Incremented when a job is submitted, decremented when it finishes.
+// Wait(counter) returns once it reaches zero; a job can also name a counter
+// it depends on and will not start before that one drains.
+struct JobCounter
+{
+    std::atomic<int> value{ 0 };
+
+    bool done() const { return value.load(std::memory_order_acquire) == 0; }
+};
+
+// ---------- Job ----------
+// One cache line: the callable is stored inline, so submitting never allocates.
+// `counter` doubles as the slot's busy flag: set while the job is queued or
+// running, cleared once it has returned.
+struct alignas(64) Job
+{
+    static constexpr size_t STORAGE = 40;
+
+    void (*invoke)(Job&);
+    std::atomic<JobCounter*> counter;
+    const JobCounter* dependency;
+    alignas(8) unsigned char storage[STORAGE];
+};
+static_assert(sizeof(Job) == 64, "Job should fill exactly one cache line");
+
+// ---------- Chase-Lev work-stealing deque ----------
+// The owning thread pushes/pops at the bottom, other threads steal from the
+// top. Fixed capacity (power of two); Push() returns false when full.
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(size_t capacity = 4096);
+
+    bool Push(Job* job);
+    Job* Pop();
+    Job* Steal();
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::unique_ptr<std::atomic<Job*>[]> buffer;
+    size_t mask;
+    alignas(64) std::atomic<int64_t> top{ 0 };
+    alignas(64) std::atomic<int64_t> bottom{ 0 };
+};
+
+// ---------- JobSystem ----------
+// Thread 0 is the thread that created the system; it runs jobs while it
+// waits. Workers 1..N pop their own deque first and steal from the others
+// when it is empty. Jobs may only be submitted from these threads.
+// Background jobs (RunInBackground) sit in a FIFO of their own that only
+// idle workers take from.
+class JobSystem
+{
+public:
+    explicit JobSystem(unsigned int workerCount);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // fn() runs on some job thread; counter is signalled when it returns
+    template<typename F>
+    void Run(JobCounter& counter, F&& fn)
+    {
+        Submit(MakeJob(counter, nullptr, std::forward<F>(fn)));
+    }
+
+    // like Run(), but does not start before `dependency` reaches zero
+    template<typename F>
+    void RunAfter(const JobCounter& dependency, JobCounter& counter, F&& fn)
+    {
+        Submit(MakeJob(counter, &dependency, std::forward<F>(fn)));
+    }
+
+    // splits [0, count) into ranges of at most `grain` and calls
+    // fn(begin, end) for each; returns immediately, so fn must stay alive
+    // until Wait() on the counter returns
+    template<typename F>
+    void ParallelFor(JobCounter& counter, size_t count, size_t grain, const F& fn)
+    {
+        if (grain == 0) grain = 1;
+        for (size_t begin = 0; begin < count; begin += grain)
+        {
+            size_t end = begin + grain < count ? begin + grain : count;
+            Run(counter, [&fn, begin, end] { fn(begin, end); });
+        }
+    }
+
+    // Like Run(), for long work nobody needs this frame (texture decodes):
+    // only a worker with nothing else to do takes it, so a thread helping
+    // out in Wait() never gets stuck in one. Without workers it runs only
+    // when some thread calls RunBackgroundJob().
+    template<typename F>
+    void RunInBackground(JobCounter& counter, F&& fn)
+    {
+        SubmitBackground(MakeJob(counter, nullptr, std::forward<F>(fn)));
+    }
+
+    // runs the oldest background job on the calling thread; false if none
+    bool RunBackgroundJob();
+
+    // runs other jobs until counter reaches zero; not background ones
+    void Wait(const JobCounter& counter);
+
+    // main thread + workers
+    unsigned int threadCount() const { return (unsigned int)queues.size(); }
+
+    // 0 for the creating thread, 1..N for workers, -1 elsewhere
+    static int ThreadIndex();
+
+private:
+    static constexpr size_t JOBS_PER_THREAD = 4096;
+    static constexpr size_t BACKGROUND_JOBS = 1024;
+
+    struct alignas(64) ThreadQueue
+    {
+        WorkStealingDeque deque{ JOBS_PER_THREAD };
+        std::unique_ptr<Job[]> jobs{ new Job[JOBS_PER_THREAD]() };
+        size_t nextJob = 0;
+        uint32_t rng = 0;
+    };
+
+    template<typename F>
+    Job* MakeJob(JobCounter& counter, const JobCounter* dependency, F&& fn)
+    {
+        typedef typename std::decay<F>::type Fn;
+        static_assert(sizeof(Fn) <= Job::STORAGE, "job lambda captures too much, capture by pointer");
+        static_assert(alignof(Fn) <= 8, "job lambda over-aligned");
+        static_assert(std::is_trivially_destructible<Fn>::value, "job lambda must be trivially destructible");
+
+        Job* job = AllocateJob();
+        new (job->storage) Fn(std::forward<F>(fn));
+        job->invoke = [](Job& j) { (*reinterpret_cast<Fn*>(j.storage))(); };
+        job->dependency = dependency;
+        job->counter.store(&counter, std::memory_order_relaxed);
+        counter.value.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    Job* AllocateJob();
+    void Submit(Job* job);
+    void SubmitBackground(Job* job);
+    void WakeWorker();
+    Job* FindJob(ThreadQueue& self, unsigned int selfIndex);
+    bool TryRunOne(unsigned int selfIndex);
+    void Execute(Job* job);
+    void WorkerLoop(unsigned int index);
+
+    std::vector<std::unique_ptr<ThreadQueue>> queues;
+    std::vector<std::thread> workers;
+
+    // ring of BACKGROUND_JOBS, oldest at backgroundHead
+    std::mutex backgroundMutex;
+    std::unique_ptr<Job*[]> background{ new Job*[BACKGROUND_JOBS]() };
+    size_t backgroundHead = 0;
+    size_t backgroundCount = 0;
+
+    std::atomic<int> queued{ 0 };
+    std::atomic<int> sleepers{ 0 };
+    std::atomic<bool> quit{ false };
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "LightClusters.h"
+#include "Simd8.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ---------- froxel bounds ----------
+
+// view-space box with depth = -z, so it grows away from the camera
+struct ClusterBox
+{
+    float minX, maxX, minY, maxY, minDepth, maxDepth;
+};
+
+// depth of the boundary in front of `slice`
+static float SliceDepth(int slice, float nearPlane, float farPlane)
+{
+    return nearPlane * std::pow(farPlane / nearPlane, (float)slice / (float)CLUSTER_SLICES);
+}
+
+// NDC [n0, n1] on one axis between two depths: at depth d, view = d * (ndc + skew) / scale
+static void AxisBounds(float n0, float n1, float d0, float d1, float scale, float skew, float& lo, float& hi)
+{
+    lo = std::min(d0 * (n0 + skew), d1 * (n0 + skew)) / scale;
+    hi = std::max(d0 * (n1 + skew), d1 * (n1 + skew)) / scale;
+}
+
+// Bit i set when light i of the eight at `at` overlaps the box: the squared
+// distance from the sphere's center to the box against its squared range.
+static int TouchMask(const ClusterBox& box, const float* x, const float* y, const float* depth, const float* range, size_t at)
+{
+    F32x8 zero = F32x8::Set(0.0f);
+    F32x8 lx = F32x8::Load(x + at), ly = F32x8::Load(y + at), ld = F32x8::Load(depth + at), lr = F32x8::Load(range + at);
+    F32x8 dx = Max(Max(F32x8::Set(box.minX) - lx, lx - F32x8::Set(box.maxX)), zero);
+    F32x8 dy = Max(Max(F32x8::Set(box.minY) - ly, ly - F32x8::Set(box.maxY)), zero);
+    F32x8 dd = Max(Max(F32x8::Set(box.minDepth) - ld, ld - F32x8::Set(box.maxDepth)), zero);
+    return LessMask(dx * dx + dy * dy + dd * dd, lr * lr);
+}
+
+// depth of the padding lights: far behind the camera, with no range
+static const float NOWHERE = -1e18f;
+
+// appends the lights of the 8-padded arrays that touch the box to the `to`
+// arrays, padding those to a multiple of 8 with lights that touch nothing
+static size_t Gather(const ClusterBox& box, const float* x, const float* y, const float* depth, const float* range,
+    const uint16_t* ids, size_t count, float* toX, float* toY, float* toDepth, float* toRange, uint16_t* toIds)
+{
+    size_t n = 0;
+    for (size_t at = 0; at < count; at += 8)
+    {
+        int mask = TouchMask(box, x, y, depth, range, at);
+        while (mask)
+        {
+            int lane = 0;
+            while (!(mask & (1 << lane)))
+                ++lane;
+            mask &= mask - 1;
+            size_t i = at + lane;
+            toX[n] = x[i];
+            toY[n] = y[i];
+            toDepth[n] = depth[i];
+            toRange[n] = range[i];
+            toIds[n] = ids ? ids[i] : (uint16_t)i;
+            ++n;
+        }
+    }
+    for (size_t i = n; i % 8; ++i)
+    {
+        toX[i] = toY[i] = toRange[i] = 0.0f;
+        toDepth[i] = NOWHERE;
+        toIds[i] = 0;
+    }
+    return n;
+}
+
+// ---------- LightClusters ----------
+
+LightClusters::LightClusters(JobSystem& jobs, size_t maxIndices)
+    : jobs(jobs), maxIndices(maxIndices), scratch(CLUSTER_SLICES), clusterRanges(CLUSTER_COUNT * 2)
+{
+    for (SliceScratch& s : scratch)
+        s.out.reserve((size_t)CLUSTERS_PER_SLICE * MAX_LIGHTS_PER_CLUSTER);
+}
+
+void LightClusters::Build(const glm::mat4& view, const glm::mat4& projection, const PointLight* lights, size_t count)
+{
+    count = std::min(count, MAX_CLUSTERED_LIGHTS);
+    viewMatrix = view;
+    projectionMatrix = projection;
+    viewDepthRow = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+
+    // perspective: P[2][2] = -(f + n) / (f - n), P[3][2] = -2fn / (f - n)
+    nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+    scale = CLUSTER_SLICES / std::log(farPlane / nearPlane);
+    bias = -std::log(nearPlane) * scale;
+
+    // grows with the light count, then stays
+    size_t padded = (count + 7) & ~(size_t)7;
+    if (lightX.size() < padded + 8)
+    {
+        size_t capacity = padded + 8;
+        for (std::vector<float>* v : { &lightX, &lightY, &lightDepth, &lightRange })
+            v->resize(capacity);
+        for (SliceScratch& s : scratch)
+        {
+            for (std::vector<float>* v : { &s.x, &s.y, &s.depth, &s.range, &s.rx, &s.ry, &s.rdepth, &s.rrange })
+                v->resize(capacity);
+            s.ids.resize(capacity);
+            s.rids.resize(capacity);
+        }
+    }
+    lightCount = count;
+    for (size_t i = count; i < padded + 8; ++i)
+    {
+        lightX[i] = lightY[i] = lightRange[i] = 0.0f;
+        lightDepth[i] = NOWHERE;
+    }
+
+    auto transform = [this, lights](size_t begin, size_t end) { TransformLights(lights, begin, end); };
+    JobCounter transformed;
+    jobs.ParallelFor(transformed, count, 1024, transform);
+    jobs.Wait(transformed);
+
+    auto assign = [this](size_t begin, size_t end)
+    {
+        for (size_t s = begin; s < end; ++s)
+            AssignSlice((int)s);
+    };
+    JobCounter assigned;
+    jobs.ParallelFor(assigned, CLUSTER_SLICES, 1, assign);
+    jobs.Wait(assigned);
+
+    // concatenate the slices; their ranges were relative to their own lists
+    size_t total = 0;
+    dropped = 0;
+    for (const SliceScratch& s : scratch)
+    {
+        total += s.out.size();
+        dropped += s.dropped;
+    }
+    if (indexList.size() < total)
+        indexList.resize(total);
+    indexTotal = 0;
+    for (int slice = 0; slice < CLUSTER_SLICES; ++slice)
+    {
+        const SliceScratch& s = scratch[slice];
+        size_t kept = std::min(s.out.size(), maxIndices - std::min(maxIndices, indexTotal));
+        if (kept)
+            std::memcpy(&indexList[indexTotal], s.out.data(), kept * sizeof(uint16_t));
+        uint32_t* range = &clusterRanges[(size_t)slice * CLUSTERS_PER_SLICE * 2];
+        for (int c = 0; c < CLUSTERS_PER_SLICE; ++c)
+        {
+            uint32_t first = std::min(range[c * 2], (uint32_t)kept), n = range[c * 2 + 1];
+            uint32_t keep = std::min(n, (uint32_t)kept - first);
+            dropped += n - keep;
+            range[c * 2] = (uint32_t)indexTotal + first;
+            range[c * 2 + 1] = keep;
+        }
+        indexTotal += kept;
+    }
+}
+
+void LightClusters::TransformLights(const PointLight* lights, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        glm::vec4 p = viewMatrix * glm::vec4(lights[i].position, 1.0f);
+        lightX[i] = p.x;
+        lightY[i] = p.y;
+        lightDepth[i] = -p.z;
+        lightRange[i] = lights[i].range;
+    }
+}
+
+// Narrows the lights down slice, then tile row, then tile, so each froxel
+// only tests the few that survived its row.
+void LightClusters::AssignSlice(int slice)
+{
+    SliceScratch& s = scratch[slice];
+    s.out.clear();
+    s.dropped = 0;
+    uint32_t* range = &clusterRanges[(size_t)slice * CLUSTERS_PER_SLICE * 2];
+
+    float sx = projectionMatrix[0][0], skewX = projectionMatrix[2][0];
+    float sy = projectionMatrix[1][1], skewY = projectionMatrix[2][1];
+    ClusterBox box;
+    box.minDepth = SliceDepth(slice, nearPlane, farPlane);
+    box.maxDepth = SliceDepth(slice + 1, nearPlane, farPlane);
+
+    AxisBounds(-1.0f, 1.0f, box.minDepth, box.maxDepth, sx, skewX, box.minX, box.maxX);
+    AxisBounds(-1.0f, 1.0f, box.minDepth, box.maxDepth, sy, skewY, box.minY, box.maxY);
+    size_t inSlice = Gather(box, lightX.data(), lightY.data(), lightDepth.data(), lightRange.data(), nullptr,
+        (lightCount + 7) & ~(size_t)7, s.x.data(), s.y.data(), s.depth.data(), s.range.data(), s.ids.data());
+
+    for (int ty = 0; ty < CLUSTER_TILES_Y; ++ty)
+    {
+        ClusterBox row = box;
+        AxisBounds(-1.0f + 2.0f * ty / CLUSTER_TILES_Y, -1.0f + 2.0f * (ty + 1) / CLUSTER_TILES_Y,
+            box.minDepth, box.maxDepth, sy, skewY, row.minY, row.maxY);
+        size_t inRow = Gather(row, s.x.data(), s.y.data(), s.depth.data(), s.range.data(), s.ids.data(),
+            (inSlice + 7) & ~(size_t)7, s.rx.data(), s.ry.data(), s.rdepth.data(), s.rrange.data(), s.rids.data());
+
+        for (int tx = 0; tx < CLUSTER_TILES_X; ++tx)
+        {
+            ClusterBox cell = row;
+            AxisBounds(-1.0f + 2.0f * tx / CLUSTER_TILES_X, -1.0f + 2.0f * (tx + 1) / CLUSTER_TILES_X,
+                box.minDepth, box.maxDepth, sx, skewX, cell.minX, cell.maxX);
+
+            uint32_t first = (uint32_t)s.out.size(), n = 0;
+            for (size_t at = 0; at < inRow; at += 8)
+            {
+                int mask = TouchMask(cell, s.rx.data(), s.ry.data(), s.rdepth.data(), s.rrange.data(), at);
+                for (int lane = 0; mask; ++lane, mask >>= 1)
+                {
+                    if (!(mask & 1))
+                        continue;
+                    if (n == MAX_LIGHTS_PER_CLUSTER)
+                    {
+                        ++s.dropped;
+                        continue;
+                    }
+                    s.out.push_back(s.rids[at + lane]);
+                    ++n;
+                }
+            }
+            int c = ty * CLUSTER_TILES_X + tx;
+            range[c * 2] = first;
+            range[c * 2 + 1] = n;
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------- clustered forward lighting ----------
+// The view frustum is cut into froxels: CLUSTER_TILES_X x CLUSTER_TILES_Y
+// screen tiles times CLUSTER_SLICES depth slices, spaced logarithmically
+// between the projection's near and far planes. Every frame the lights are
+// assigned to the froxels their spheres touch, on the job threads, eight
+// lights per sphere/box test; the fragment shader then loops over only the
+// lights of its own froxel.
+
+const int CLUSTER_TILES_X = 16;
+const int CLUSTER_TILES_Y = 9;
+const int CLUSTER_SLICES = 24;
+const int CLUSTERS_PER_SLICE = CLUSTER_TILES_X * CLUSTER_TILES_Y;
+const int CLUSTER_COUNT = CLUSTERS_PER_SLICE * CLUSTER_SLICES;
+
+// lights past this in one froxel are dropped (and counted)
+const int MAX_LIGHTS_PER_CLUSTER = 256;
+
+// light indices are 16 bit
+const size_t MAX_CLUSTERED_LIGHTS = 65535;
+
+// world space, laid out as the shader's two RGBA32F texels per light
+struct PointLight
+{
+    glm::vec3 position;
+    float range;            // influence radius; the light fades to zero there
+    glm::vec3 color;
+    float pad;
+};
+
+class LightClusters
+{
+public:
+    // maxIndices caps the light index list, e.g. at GL_MAX_TEXTURE_BUFFER_SIZE
+    explicit LightClusters(JobSystem& jobs, size_t maxIndices = SIZE_MAX);
+
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    // Assigns lights[0, count) to the froxels of view / projection (a
+    // perspective projection); count is clamped to MAX_CLUSTERED_LIGHTS.
+    void Build(const glm::mat4& view, const glm::mat4& projection, const PointLight* lights, size_t count);
+
+    // (first index, light count) per froxel: tile x fastest, then tile y
+    // (from the bottom of the screen), then depth slice
+    const uint32_t* ranges() const { return clusterRanges.data(); }
+
+    const uint16_t* indices() const { return indexList.data(); }
+    size_t indexCount() const { return indexTotal; }
+
+    // light / froxel pairs lost to MAX_LIGHTS_PER_CLUSTER or maxIndices
+    size_t droppedCount() const { return dropped; }
+
+    // slice = int(log(depth) * sliceScale + sliceBias), depth = dot(depthRow, world)
+    float sliceScale() const { return scale; }
+    float sliceBias() const { return bias; }
+    const glm::vec4& depthRow() const { return viewDepthRow; }
+
+private:
+    // per depth slice scratch, reused every frame
+    struct SliceScratch
+    {
+        std::vector<float> x, y, depth, range;      // lights touching the slice
+        std::vector<uint16_t> ids;
+        std::vector<float> rx, ry, rdepth, rrange;  // ... and the current tile row
+        std::vector<uint16_t> rids;
+        std::vector<uint16_t> out;                  // this slice's index list
+        size_t dropped = 0;
+    };
+
+    void TransformLights(const PointLight* lights, size_t begin, size_t end);
+    void AssignSlice(int slice);
+
+    JobSystem& jobs;
+    size_t maxIndices;
+
+    // view-space lights as arrays, padded to a multiple of 8
+    std::vector<float> lightX, lightY, lightDepth, lightRange;
+    size_t lightCount = 0;
+
+    std::vector<SliceScratch> scratch;
+    std::vector<uint32_t> clusterRanges;
+    std::vector<uint16_t> indexList;
+    size_t indexTotal = 0;
+    size_t dropped = 0;
+
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::vec4 viewDepthRow;
+    float nearPlane = 0.1f, farPlane = 100.0f;
+    float scale = 0.0f, bias = 0.0f;
+};
+
+#endif
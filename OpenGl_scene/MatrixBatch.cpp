@@ -0,0 +1,245 @@
+#include "MatrixBatch.h"
+#include "MatrixKernels.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+// ---------- portable lanes ----------
+// Four floats at a time, written as plain loops the compiler turns into one
+// SSE / NEON instruction each (or scalar code where there is none).
+namespace
+{
+struct PortableLanes
+{
+    static const int WIDTH = 4;
+    float v[WIDTH];
+
+    static PortableLanes Load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    static PortableLanes Broadcast(float x) { return { { x, x, x, x } }; }
+    void Store(float* p) const
+    {
+        for (int i = 0; i < WIDTH; ++i)
+            p[i] = v[i];
+    }
+
+    static PortableLanes MulAdd(const PortableLanes& a, const PortableLanes& b, const PortableLanes& c)
+    {
+        PortableLanes r;
+        for (int i = 0; i < WIDTH; ++i)
+            r.v[i] = a.v[i] * b.v[i] + c.v[i];
+        return r;
+    }
+
+#define PORTABLE_LANES_OP(op) \
+    PortableLanes operator op(const PortableLanes& b) const \
+    { \
+        PortableLanes r; \
+        for (int i = 0; i < WIDTH; ++i) \
+            r.v[i] = v[i] op b.v[i]; \
+        return r; \
+    }
+    PORTABLE_LANES_OP(+)
+    PORTABLE_LANES_OP(-)
+    PORTABLE_LANES_OP(*)
+    PORTABLE_LANES_OP(/)
+#undef PORTABLE_LANES_OP
+};
+}
+
+// ---------- dispatch ----------
+static bool CpuHasAvx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // FMA, OSXSAVE and AVX, then the OS must save the YMM state
+    const int bits = 1 << 12 | 1 << 27 | 1 << 28;
+    if ((info[2] & bits) != bits || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 5) & 1;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // also checks that the OS saves the YMM registers
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+static bool CpuHasAvx512()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    if (!CpuHasAvx2())
+        return false;
+    int info[4];
+    __cpuidex(info, 7, 0);
+    // and the OS must save the opmask and ZMM state
+    return ((info[1] >> 16) & 1) && (_xgetbv(0) & 0xe6) == 0xe6;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
+
+struct MatrixDispatch
+{
+    MatrixKernels kernels[3];
+    bool supported[3];
+    MatrixIsa active;
+
+    MatrixDispatch()
+    {
+        FillMatrixKernels<PortableLanes>(kernels[MATRIX_ISA_PORTABLE]);
+        supported[MATRIX_ISA_PORTABLE] = true;
+        supported[MATRIX_ISA_AVX2] = GetMatrixKernelsAvx2(kernels[MATRIX_ISA_AVX2]) && CpuHasAvx2();
+        supported[MATRIX_ISA_AVX512] = GetMatrixKernelsAvx512(kernels[MATRIX_ISA_AVX512]) && CpuHasAvx512();
+        active = MATRIX_ISA_PORTABLE;
+        for (int isa = MATRIX_ISA_AVX512; isa > MATRIX_ISA_PORTABLE; --isa)
+            if (supported[isa])
+            {
+                active = (MatrixIsa)isa;
+                break;
+            }
+    }
+};
+
+static MatrixDispatch& Dispatch()
+{
+    static MatrixDispatch dispatch;
+    return dispatch;
+}
+
+static const MatrixKernels& Kernels()
+{
+    MatrixDispatch& d = Dispatch();
+    return d.kernels[d.active];
+}
+
+bool MatrixIsaSupported(MatrixIsa isa)
+{
+    return isa >= MATRIX_ISA_PORTABLE && isa <= MATRIX_ISA_AVX512 && Dispatch().supported[isa];
+}
+
+MatrixIsa SetMatrixIsa(MatrixIsa isa)
+{
+    MatrixDispatch& d = Dispatch();
+    int i = isa > MATRIX_ISA_AVX512 ? MATRIX_ISA_AVX512 : isa;
+    while (i > MATRIX_ISA_PORTABLE && !d.supported[i])
+        --i;
+    d.active = (MatrixIsa)i;
+    return d.active;
+}
+
+MatrixIsa GetMatrixIsa()
+{
+    return Dispatch().active;
+}
+
+const char* MatrixIsaName(MatrixIsa isa)
+{
+    switch (isa)
+    {
+    case MATRIX_ISA_PORTABLE: return "portable";
+    case MATRIX_ISA_AVX2: return "avx2";
+    case MATRIX_ISA_AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+// ---------- packing ----------
+void PackMat4(const glm::mat4* in, size_t count, Mat4Block* out)
+{
+    size_t blocks = MatrixBlockCount(count);
+    for (size_t b = 0; b < blocks; ++b)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; ++lane)
+        {
+            size_t i = b * MATRIX_BATCH_LANES + lane;
+            const float* m = i < count ? &in[i][0][0] : nullptr;
+            for (int k = 0; k < 16; ++k)
+                out[b].e[k][lane] = m ? m[k] : (k % 5 == 0 ? 1.0f : 0.0f);
+        }
+}
+
+void UnpackMat4(const Mat4Block* in, size_t count, glm::mat4* out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Mat4Block& block = in[i / MATRIX_BATCH_LANES];
+        size_t lane = i % MATRIX_BATCH_LANES;
+        float* m = &out[i][0][0];
+        for (int k = 0; k < 16; ++k)
+            m[k] = block.e[k][lane];
+    }
+}
+
+void UnpackMat3(const Mat3Block* in, size_t count, glm::mat3* out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Mat3Block& block = in[i / MATRIX_BATCH_LANES];
+        size_t lane = i % MATRIX_BATCH_LANES;
+        float* m = &out[i][0][0];
+        for (int k = 0; k < 9; ++k)
+            m[k] = block.e[k][lane];
+    }
+}
+
+void PackVec4(const glm::vec4* in, size_t count, Vec4Block* out)
+{
+    size_t blocks = MatrixBlockCount(count);
+    for (size_t b = 0; b < blocks; ++b)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; ++lane)
+        {
+            size_t i = b * MATRIX_BATCH_LANES + lane;
+            for (int k = 0; k < 4; ++k)
+                out[b].e[k][lane] = i < count ? in[i][k] : 0.0f;
+        }
+}
+
+void UnpackVec4(const Vec4Block* in, size_t count, glm::vec4* out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Vec4Block& block = in[i / MATRIX_BATCH_LANES];
+        size_t lane = i % MATRIX_BATCH_LANES;
+        for (int k = 0; k < 4; ++k)
+            out[i][k] = block.e[k][lane];
+    }
+}
+
+// ---------- batches ----------
+void MultiplyMat4Batch(const Mat4Block* a, const Mat4Block* b, Mat4Block* out, size_t blocks)
+{
+    Kernels().multiply(a, b, out, blocks);
+}
+
+void MultiplyMat4Batch(const glm::mat4& a, const Mat4Block* b, Mat4Block* out, size_t blocks)
+{
+    Kernels().multiplyBroadcast(&a[0][0], b, out, blocks);
+}
+
+void TransformVec4Batch(const Mat4Block* m, const Vec4Block* v, Vec4Block* out, size_t blocks)
+{
+    Kernels().transform(m, v, out, blocks);
+}
+
+void TransformVec4Batch(const glm::mat4& m, const Vec4Block* v, Vec4Block* out, size_t blocks)
+{
+    Kernels().transformBroadcast(&m[0][0], v, out, blocks);
+}
+
+void InverseAffineBatch(const Mat4Block* m, Mat4Block* out, size_t blocks)
+{
+    Kernels().inverseAffine(m, out, blocks);
+}
+
+void NormalMatrixBatch(const Mat4Block* m, Mat3Block* out, size_t blocks)
+{
+    Kernels().normalMatrix(m, out, blocks);
+}
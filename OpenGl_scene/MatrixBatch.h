@@ -0,0 +1,87 @@
+#ifndef MATRIX_BATCH_H
+#define MATRIX_BATCH_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// ---------- batched matrix math ----------
+// Structure-of-arrays-of-structures (AoSoA) storage for many small matrices:
+// a block holds MATRIX_BATCH_LANES matrices with each element stored as a
+// row of lanes, so one SIMD register holds the same element of 16 (AVX-512)
+// or 8 (AVX2, half a block) matrices and a whole block transforms with no
+// shuffles. Elements are column-major like glm: e[column * 4 + row].
+//
+// The kernels are built three times, portable C++ (which the compiler
+// vectorizes for whatever the build targets), AVX2 + FMA and AVX-512, and
+// the best one the CPU runs is picked on first use; see SetMatrixIsa.
+// Inputs and outputs must not overlap.
+const int MATRIX_BATCH_LANES = 16;
+
+struct alignas(64) Mat4Block
+{
+    float e[16][MATRIX_BATCH_LANES];
+};
+
+struct alignas(64) Mat3Block
+{
+    float e[9][MATRIX_BATCH_LANES];     // e[column * 3 + row]
+};
+
+struct alignas(64) Vec4Block
+{
+    float e[4][MATRIX_BATCH_LANES];
+};
+
+// blocks needed for `count` matrices or vectors
+inline size_t MatrixBlockCount(size_t count)
+{
+    return (count + MATRIX_BATCH_LANES - 1) / MATRIX_BATCH_LANES;
+}
+
+// Lane i of block i / 16 <-> element i. Packing fills the lanes past `count`
+// in the last block with identity matrices (zero vectors), so every kernel
+// can run on whole blocks without producing NaNs there.
+void PackMat4(const glm::mat4* in, size_t count, Mat4Block* out);
+void UnpackMat4(const Mat4Block* in, size_t count, glm::mat4* out);
+void UnpackMat3(const Mat3Block* in, size_t count, glm::mat3* out);
+void PackVec4(const glm::vec4* in, size_t count, Vec4Block* out);
+void UnpackVec4(const Vec4Block* in, size_t count, glm::vec4* out);
+
+// out[i] = a[i] * b[i]
+void MultiplyMat4Batch(const Mat4Block* a, const Mat4Block* b, Mat4Block* out, size_t blocks);
+// out[i] = a * b[i], e.g. viewProj * model for every object
+void MultiplyMat4Batch(const glm::mat4& a, const Mat4Block* b, Mat4Block* out, size_t blocks);
+
+// out[i] = m[i] * v[i]
+void TransformVec4Batch(const Mat4Block* m, const Vec4Block* v, Vec4Block* out, size_t blocks);
+// out[i] = m * v[i], one matrix over a stream of points
+void TransformVec4Batch(const glm::mat4& m, const Vec4Block* v, Vec4Block* out, size_t blocks);
+
+// Inverse of matrices whose last row is (0, 0, 0, 1): the upper 3x3 is
+// inverted by cofactors and the translation carried through it, about a
+// third of the work of a general 4x4 inverse. Singular matrices give inf/NaN.
+void InverseAffineBatch(const Mat4Block* m, Mat4Block* out, size_t blocks);
+
+// transpose(inverse(mat3(m))), the matrix that keeps normals perpendicular
+// to surfaces under non-uniform scale
+void NormalMatrixBatch(const Mat4Block* m, Mat3Block* out, size_t blocks);
+
+enum MatrixIsa
+{
+    MATRIX_ISA_PORTABLE,
+    MATRIX_ISA_AVX2,        // AVX2 and FMA
+    MATRIX_ISA_AVX512,      // AVX-512F
+};
+
+// compiled in and supported by this CPU (and OS)
+bool MatrixIsaSupported(MatrixIsa isa);
+
+// Switches the kernels to `isa`, or to the best supported one below it, and
+// returns what is now in use. Defaults to the best supported. Not safe while
+// another thread is running a batch.
+MatrixIsa SetMatrixIsa(MatrixIsa isa);
+MatrixIsa GetMatrixIsa();
+const char* MatrixIsaName(MatrixIsa isa);
+
+#endif
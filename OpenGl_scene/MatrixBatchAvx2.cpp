@@ -0,0 +1,41 @@
+// AVX2 + FMA instantiation of MatrixKernels.h; CMakeLists.txt builds this file
+// with -mavx2 -mfma (/arch:AVX2), and MatrixBatch.cpp only calls into it once
+// the CPU reports both.
+#include "MatrixKernels.h"
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+
+namespace
+{
+struct Avx2Lanes
+{
+    static const int WIDTH = 8;
+    __m256 v;
+
+    static Avx2Lanes Load(const float* p) { return { _mm256_load_ps(p) }; }
+    static Avx2Lanes Broadcast(float x) { return { _mm256_set1_ps(x) }; }
+    void Store(float* p) const { _mm256_store_ps(p, v); }
+
+    static Avx2Lanes MulAdd(const Avx2Lanes& a, const Avx2Lanes& b, const Avx2Lanes& c)
+    {
+        return { _mm256_fmadd_ps(a.v, b.v, c.v) };
+    }
+    Avx2Lanes operator+(const Avx2Lanes& b) const { return { _mm256_add_ps(v, b.v) }; }
+    Avx2Lanes operator-(const Avx2Lanes& b) const { return { _mm256_sub_ps(v, b.v) }; }
+    Avx2Lanes operator*(const Avx2Lanes& b) const { return { _mm256_mul_ps(v, b.v) }; }
+    Avx2Lanes operator/(const Avx2Lanes& b) const { return { _mm256_div_ps(v, b.v) }; }
+};
+}
+
+bool GetMatrixKernelsAvx2(MatrixKernels& out)
+{
+    FillMatrixKernels<Avx2Lanes>(out);
+    return true;
+}
+#else
+bool GetMatrixKernelsAvx2(MatrixKernels&)
+{
+    return false;
+}
+#endif
@@ -0,0 +1,41 @@
+// AVX-512F instantiation of MatrixKernels.h; CMakeLists.txt builds this file
+// with -mavx512f (/arch:AVX512), and MatrixBatch.cpp only calls into it once
+// the CPU reports it.
+#include "MatrixKernels.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+namespace
+{
+struct Avx512Lanes
+{
+    static const int WIDTH = 16;
+    __m512 v;
+
+    static Avx512Lanes Load(const float* p) { return { _mm512_load_ps(p) }; }
+    static Avx512Lanes Broadcast(float x) { return { _mm512_set1_ps(x) }; }
+    void Store(float* p) const { _mm512_store_ps(p, v); }
+
+    static Avx512Lanes MulAdd(const Avx512Lanes& a, const Avx512Lanes& b, const Avx512Lanes& c)
+    {
+        return { _mm512_fmadd_ps(a.v, b.v, c.v) };
+    }
+    Avx512Lanes operator+(const Avx512Lanes& b) const { return { _mm512_add_ps(v, b.v) }; }
+    Avx512Lanes operator-(const Avx512Lanes& b) const { return { _mm512_sub_ps(v, b.v) }; }
+    Avx512Lanes operator*(const Avx512Lanes& b) const { return { _mm512_mul_ps(v, b.v) }; }
+    Avx512Lanes operator/(const Avx512Lanes& b) const { return { _mm512_div_ps(v, b.v) }; }
+};
+}
+
+bool GetMatrixKernelsAvx512(MatrixKernels& out)
+{
+    FillMatrixKernels<Avx512Lanes>(out);
+    return true;
+}
+#else
+bool GetMatrixKernelsAvx512(MatrixKernels&)
+{
+    return false;
+}
+#endif
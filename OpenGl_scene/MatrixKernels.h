@@ -0,0 +1,216 @@
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+#include "MatrixBatch.h"
+
+// ---------- batched matrix kernels ----------
+// Internal to MatrixBatch*.cpp. The kernels are written once over a lane type
+// L holding L::WIDTH floats, one per matrix, and walk each block in slices of
+// that width (16 / WIDTH registers per element row); they are instantiated in
+// three translation units: MatrixBatch.cpp with the portable lanes,
+// MatrixBatchAvx2.cpp and MatrixBatchAvx512.cpp built with those instruction
+// sets enabled. Everything here is static so no code built for a wider
+// instruction set can be shared with, and run by, the portable build; for the
+// same reason these files must not call inline functions of other headers
+// (glm included).
+//
+// L provides WIDTH, Load(p), Broadcast(x), Store(p), +, -, *, / and
+// MulAdd(a, b, c) = a * b + c, fused where the instruction set has it.
+struct MatrixKernels
+{
+    void (*multiply)(const Mat4Block* a, const Mat4Block* b, Mat4Block* out, size_t blocks);
+    void (*multiplyBroadcast)(const float* a, const Mat4Block* b, Mat4Block* out, size_t blocks);
+    void (*transform)(const Mat4Block* m, const Vec4Block* v, Vec4Block* out, size_t blocks);
+    void (*transformBroadcast)(const float* m, const Vec4Block* v, Vec4Block* out, size_t blocks);
+    void (*inverseAffine)(const Mat4Block* m, Mat4Block* out, size_t blocks);
+    void (*normalMatrix)(const Mat4Block* m, Mat3Block* out, size_t blocks);
+};
+
+// false when the file was built without the instruction set (another
+// compiler or architecture)
+bool GetMatrixKernelsAvx2(MatrixKernels& out);
+bool GetMatrixKernelsAvx512(MatrixKernels& out);
+
+template <class L>
+static void MultiplyBlocks(const Mat4Block* a, const Mat4Block* b, Mat4Block* out, size_t blocks)
+{
+    for (size_t i = 0; i < blocks; ++i)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; lane += L::WIDTH)
+        {
+            const Mat4Block& x = a[i];
+            const Mat4Block& y = b[i];
+            for (int c = 0; c < 4; ++c)
+            {
+                L y0 = L::Load(y.e[c * 4 + 0] + lane);
+                L y1 = L::Load(y.e[c * 4 + 1] + lane);
+                L y2 = L::Load(y.e[c * 4 + 2] + lane);
+                L y3 = L::Load(y.e[c * 4 + 3] + lane);
+                for (int r = 0; r < 4; ++r)
+                {
+                    L sum = L::Load(x.e[r] + lane) * y0;
+                    sum = L::MulAdd(L::Load(x.e[4 + r] + lane), y1, sum);
+                    sum = L::MulAdd(L::Load(x.e[8 + r] + lane), y2, sum);
+                    sum = L::MulAdd(L::Load(x.e[12 + r] + lane), y3, sum);
+                    sum.Store(out[i].e[c * 4 + r] + lane);
+                }
+            }
+        }
+}
+
+template <class L>
+static void MultiplyBroadcastBlocks(const float* a, const Mat4Block* b, Mat4Block* out, size_t blocks)
+{
+    L x[16];
+    for (int k = 0; k < 16; ++k)
+        x[k] = L::Broadcast(a[k]);
+    for (size_t i = 0; i < blocks; ++i)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; lane += L::WIDTH)
+        {
+            const Mat4Block& y = b[i];
+            for (int c = 0; c < 4; ++c)
+            {
+                L y0 = L::Load(y.e[c * 4 + 0] + lane);
+                L y1 = L::Load(y.e[c * 4 + 1] + lane);
+                L y2 = L::Load(y.e[c * 4 + 2] + lane);
+                L y3 = L::Load(y.e[c * 4 + 3] + lane);
+                for (int r = 0; r < 4; ++r)
+                {
+                    L sum = x[r] * y0;
+                    sum = L::MulAdd(x[4 + r], y1, sum);
+                    sum = L::MulAdd(x[8 + r], y2, sum);
+                    sum = L::MulAdd(x[12 + r], y3, sum);
+                    sum.Store(out[i].e[c * 4 + r] + lane);
+                }
+            }
+        }
+}
+
+template <class L>
+static void TransformBlocks(const Mat4Block* m, const Vec4Block* v, Vec4Block* out, size_t blocks)
+{
+    for (size_t i = 0; i < blocks; ++i)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; lane += L::WIDTH)
+        {
+            const Mat4Block& x = m[i];
+            L v0 = L::Load(v[i].e[0] + lane);
+            L v1 = L::Load(v[i].e[1] + lane);
+            L v2 = L::Load(v[i].e[2] + lane);
+            L v3 = L::Load(v[i].e[3] + lane);
+            for (int r = 0; r < 4; ++r)
+            {
+                L sum = L::Load(x.e[r] + lane) * v0;
+                sum = L::MulAdd(L::Load(x.e[4 + r] + lane), v1, sum);
+                sum = L::MulAdd(L::Load(x.e[8 + r] + lane), v2, sum);
+                sum = L::MulAdd(L::Load(x.e[12 + r] + lane), v3, sum);
+                sum.Store(out[i].e[r] + lane);
+            }
+        }
+}
+
+template <class L>
+static void TransformBroadcastBlocks(const float* m, const Vec4Block* v, Vec4Block* out, size_t blocks)
+{
+    L x[16];
+    for (int k = 0; k < 16; ++k)
+        x[k] = L::Broadcast(m[k]);
+    for (size_t i = 0; i < blocks; ++i)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; lane += L::WIDTH)
+        {
+            L v0 = L::Load(v[i].e[0] + lane);
+            L v1 = L::Load(v[i].e[1] + lane);
+            L v2 = L::Load(v[i].e[2] + lane);
+            L v3 = L::Load(v[i].e[3] + lane);
+            for (int r = 0; r < 4; ++r)
+            {
+                L sum = x[r] * v0;
+                sum = L::MulAdd(x[4 + r], v1, sum);
+                sum = L::MulAdd(x[8 + r], v2, sum);
+                sum = L::MulAdd(x[12 + r], v3, sum);
+                sum.Store(out[i].e[r] + lane);
+            }
+        }
+}
+
+// cofactors of the upper 3x3 of m at `lane`: cof[column * 3 + row], and 1 / det
+template <class L>
+static inline void Cofactors3(const Mat4Block& m, int lane, L cof[9], L& invDet)
+{
+    // a<row><column>
+    L a00 = L::Load(m.e[0] + lane), a10 = L::Load(m.e[1] + lane), a20 = L::Load(m.e[2] + lane);
+    L a01 = L::Load(m.e[4] + lane), a11 = L::Load(m.e[5] + lane), a21 = L::Load(m.e[6] + lane);
+    L a02 = L::Load(m.e[8] + lane), a12 = L::Load(m.e[9] + lane), a22 = L::Load(m.e[10] + lane);
+
+    cof[0] = a11 * a22 - a12 * a21;
+    cof[3] = a12 * a20 - a10 * a22;
+    cof[6] = a10 * a21 - a11 * a20;
+    cof[1] = a02 * a21 - a01 * a22;
+    cof[4] = a00 * a22 - a02 * a20;
+    cof[7] = a01 * a20 - a00 * a21;
+    cof[2] = a01 * a12 - a02 * a11;
+    cof[5] = a02 * a10 - a00 * a12;
+    cof[8] = a00 * a11 - a01 * a10;
+
+    L det = L::MulAdd(a00, cof[0], L::MulAdd(a01, cof[3], a02 * cof[6]));
+    invDet = L::Broadcast(1.0f) / det;
+}
+
+template <class L>
+static void InverseAffineBlocks(const Mat4Block* m, Mat4Block* out, size_t blocks)
+{
+    L zero = L::Broadcast(0.0f);
+    L one = L::Broadcast(1.0f);
+    for (size_t i = 0; i < blocks; ++i)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; lane += L::WIDTH)
+        {
+            L cof[9], invDet;
+            Cofactors3(m[i], lane, cof, invDet);
+
+            // inverse(row, column) = cofactor(column, row) / det
+            L inv[9];   // inv[column * 3 + row]
+            for (int c = 0; c < 3; ++c)
+                for (int r = 0; r < 3; ++r)
+                    inv[c * 3 + r] = cof[r * 3 + c] * invDet;
+
+            L t0 = L::Load(m[i].e[12] + lane), t1 = L::Load(m[i].e[13] + lane), t2 = L::Load(m[i].e[14] + lane);
+            Mat4Block& o = out[i];
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int r = 0; r < 3; ++r)
+                    inv[c * 3 + r].Store(o.e[c * 4 + r] + lane);
+                zero.Store(o.e[c * 4 + 3] + lane);
+            }
+            for (int r = 0; r < 3; ++r)
+            {
+                L t = L::MulAdd(inv[r], t0, L::MulAdd(inv[3 + r], t1, inv[6 + r] * t2));
+                (zero - t).Store(o.e[12 + r] + lane);
+            }
+            one.Store(o.e[15] + lane);
+        }
+}
+
+template <class L>
+static void NormalMatrixBlocks(const Mat4Block* m, Mat3Block* out, size_t blocks)
+{
+    for (size_t i = 0; i < blocks; ++i)
+        for (int lane = 0; lane < MATRIX_BATCH_LANES; lane += L::WIDTH)
+        {
+            L cof[9], invDet;
+            Cofactors3(m[i], lane, cof, invDet);
+            // transpose(inverse) is the cofactor matrix over the determinant
+            for (int k = 0; k < 9; ++k)
+                (cof[k] * invDet).Store(out[i].e[k] + lane);
+        }
+}
+
+template <class L>
+static void FillMatrixKernels(MatrixKernels& k)
+{
+    k.multiply = MultiplyBlocks<L>;
+    k.multiplyBroadcast = MultiplyBroadcastBlocks<L>;
+    k.transform = TransformBlocks<L>;
+    k.transformBroadcast = TransformBroadcastBlocks<L>;
+    k.inverseAffine = InverseAffineBlocks<L>;
+    k.normalMatrix = NormalMatrixBlocks<L>;
+}
+
+#endif
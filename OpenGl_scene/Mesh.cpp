@@ -0,0 +1,123 @@
+#include "Mesh.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+const float TETRA_VERTICES[24] = {
+    // positions           // colors
+     1.0f,  1.0f,  1.0f,    1.0f, 0.0f, 0.0f, // v0
+    -1.0f, -1.0f,  1.0f,    0.0f, 1.0f, 0.0f, // v1
+    -1.0f,  1.0f, -1.0f,    0.0f, 0.0f, 1.0f, // v2
+     1.0f, -1.0f, -1.0f,    1.0f, 1.0f, 0.0f  // v3
+};
+
+const unsigned int TETRA_INDICES[12] = {
+    0, 1, 2,
+    0, 3, 1,
+    0, 2, 3,
+    1, 3, 2
+};
+
+// ---------- Sphere generation: outputs interleaved pos(3) + normal(3) ----------
+void GenerateSpherePN(
+    float radius,
+    int stacks,
+    int sectors,
+    std::vector<float>& outInterleavedPN,   // [px,py,pz,nx,ny,nz]...
+    std::vector<unsigned int>& outIndices
+)
+{
+    outInterleavedPN.clear();
+    outIndices.clear();
+    outInterleavedPN.reserve((size_t)(stacks + 1) * (sectors + 1) * 6);
+    outIndices.reserve((size_t)stacks * sectors * 6);
+
+    const float PI = 3.14159265358979323846f;
+
+    // vertices
+    for (int i = 0; i <= stacks; ++i)
+    {
+        float v = (float)i / (float)stacks;
+        float theta = v * PI; // 0..pi
+
+        float y = radius * std::cos(theta);
+        float r = radius * std::sin(theta);
+
+        for (int j = 0; j <= sectors; ++j)
+        {
+            float u = (float)j / (float)sectors;
+            float phi = u * 2.0f * PI; // 0..2pi
+
+            float x = r * std::cos(phi);
+            float z = r * std::sin(phi);
+
+            glm::vec3 pos(x, y, z);
+            glm::vec3 nrm = glm::normalize(pos); // for a sphere centered at origin
+
+            outInterleavedPN.push_back(pos.x);
+            outInterleavedPN.push_back(pos.y);
+            outInterleavedPN.push_back(pos.z);
+
+            outInterleavedPN.push_back(nrm.x);
+            outInterleavedPN.push_back(nrm.y);
+            outInterleavedPN.push_back(nrm.z);
+        }
+    }
+
+    // indices
+    int ring = sectors + 1;
+    for (int i = 0; i < stacks; ++i)
+    {
+        for (int j = 0; j < sectors; ++j)
+        {
+            unsigned int k1 = i * ring + j;
+            unsigned int k2 = (i + 1) * ring + j;
+
+            outIndices.push_back(k1);
+            outIndices.push_back(k2);
+            outIndices.push_back(k1 + 1);
+
+            outIndices.push_back(k1 + 1);
+            outIndices.push_back(k2);
+            outIndices.push_back(k2 + 1);
+        }
+    }
+}
+
+// ---------- mesh blobs ----------
+
+bool ParseMeshBlob(const unsigned char* data, size_t size, MeshBlobView& out)
+{
+    if (!data || size < sizeof(MeshBlobHeader))
+        return false;
+
+    const MeshBlobHeader* header = (const MeshBlobHeader*)data;
+    if (header->magic != MESH_BLOB_MAGIC || header->version != MESH_BLOB_VERSION)
+        return false;
+
+    size_t vertexBytes = (size_t)header->vertexCount * 6 * sizeof(float);
+    size_t indexBytes = (size_t)header->indexCount * sizeof(uint32_t);
+    if (size < sizeof(MeshBlobHeader) + vertexBytes + indexBytes)
+        return false;
+
+    out.vertices = (const float*)(data + sizeof(MeshBlobHeader));
+    out.indices = (const uint32_t*)(data + sizeof(MeshBlobHeader) + vertexBytes);
+    out.vertexCount = header->vertexCount;
+    out.indexCount = header->indexCount;
+    return true;
+}
+
+bool WriteMeshBlob(const char* path, const std::vector<float>& interleaved, const std::vector<unsigned int>& indices)
+{
+    FILE* f = std::fopen(path, "wb");
+    if (!f)
+        return false;
+
+    MeshBlobHeader header = { MESH_BLOB_MAGIC, MESH_BLOB_VERSION, (uint32_t)(interleaved.size() / 6), (uint32_t)indices.size() };
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+        && std::fwrite(interleaved.data(), sizeof(float), interleaved.size(), f) == interleaved.size()
+        && std::fwrite(indices.data(), sizeof(unsigned int), indices.size(), f) == indices.size();
+    return std::fclose(f) == 0 && ok;
+}
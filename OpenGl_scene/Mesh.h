@@ -0,0 +1,54 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------- CPU-side mesh data shared by the GL and software renderers ----------
+
+// stacks, sectors for MESH_SPHERE_LOD0..2
+const int SPHERE_LODS[3][2] = { { 32, 64 }, { 16, 32 }, { 8, 16 } };
+
+// interleaved pos(3) + color(3), 4 vertices / 12 indices
+extern const float TETRA_VERTICES[24];
+extern const unsigned int TETRA_INDICES[12];
+
+// Sphere generation: outputs interleaved pos(3) + normal(3)
+void GenerateSpherePN(
+    float radius,
+    int stacks,
+    int sectors,
+    std::vector<float>& outInterleavedPN,   // [px,py,pz,nx,ny,nz]...
+    std::vector<unsigned int>& outIndices
+);
+
+// ---------- mesh blobs ----------
+// Raw little-endian mesh file: header, vertexCount * 6 floats interleaved
+// like GenerateSpherePN, then indexCount uint32 indices. Meant to be parsed
+// in place from a FileView, so the arrays can go straight to glBufferData.
+const uint32_t MESH_BLOB_MAGIC = 0x4853454D;   // "MESH"
+const uint32_t MESH_BLOB_VERSION = 1;
+
+struct MeshBlobHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+};
+
+struct MeshBlobView
+{
+    const float* vertices = nullptr;     // 6 floats per vertex
+    const uint32_t* indices = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+};
+
+// points `out` into data; false on a bad header or a truncated file
+bool ParseMeshBlob(const unsigned char* data, size_t size, MeshBlobView& out);
+
+bool WriteMeshBlob(const char* path, const std::vector<float>& interleaved, const std::vector<unsigned int>& indices);
+
+#endif
@@ -0,0 +1,247 @@
+#include "OcclusionCuller.h"
+#include "Simd8.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ---------- helpers ----------
+
+// Edge or depth plane a * x + b * y + c moved to its smallest value over a
+// pixel: evaluated at the pixel centre it then gives the minimum over the
+// whole pixel, so "inside" means fully covered and depth never overstates.
+static void ConservativePlane(float& a, float& b, float& c)
+{
+    c -= 0.5f * (std::fabs(a) + std::fabs(b));
+}
+
+// ---------- OcclusionCuller ----------
+
+OcclusionCuller::OcclusionCuller(JobSystem& jobs)
+    : jobs(jobs)
+{
+    for (int l = 0; l < LEVELS; ++l)
+        pyramid[l].assign((size_t)(WIDTH >> l) * (HEIGHT >> l), 0.0f);
+    triangles.reserve(256);
+}
+
+void OcclusionCuller::Begin(const glm::mat4& view, const glm::mat4& projection)
+{
+    viewMatrix = view;
+    viewProj = projection * view;
+    eye = glm::vec3(glm::inverse(view)[3]);
+    scaleX = projection[0][0];
+    scaleY = projection[1][1];
+    // perspective: z_clip = A * z + B, w = -z, near where z_clip = -w
+    nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    triangles.clear();
+    std::fill(pyramid[0].begin(), pyramid[0].end(), 0.0f);
+}
+
+void OcclusionCuller::AddSphereOccluder(const glm::vec3& center, float radius)
+{
+    // octagon in the plane through the centre facing the eye; its corners
+    // are on the sphere, so it stays inside it
+    glm::vec3 toEye = eye - center;
+    float distance = glm::length(toEye);
+    if (distance <= radius)
+        return;
+    glm::vec3 forward = toEye / distance;
+    glm::vec3 up = std::fabs(forward.y) < 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+    glm::vec3 right = glm::normalize(glm::cross(up, forward));
+    up = glm::cross(forward, right);
+
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        float angle = (float)i * 0.78539816f;
+        corners[i] = center + radius * (std::cos(angle) * right + std::sin(angle) * up);
+    }
+    // a fan in one plane: only the octagon's own edges need shrinking
+    for (int i = 1; i < 7; ++i)
+    {
+        unsigned int outer = EDGE_1 | (i == 1 ? EDGE_0 : 0) | (i == 6 ? EDGE_2 : 0);
+        AddTriangle(corners[0], corners[i], corners[i + 1], outer);
+    }
+}
+
+void OcclusionCuller::AddMeshOccluder(const float* positions, size_t stride, const unsigned int* indices,
+    size_t indexCount, const Affine3x4& model)
+{
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        glm::vec3 v[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            const float* p = positions + indices[i + k] * stride;
+            v[k] = model.TransformPoint(glm::vec3(p[0], p[1], p[2]));
+        }
+        AddTriangle(v[0], v[1], v[2], EDGE_0 | EDGE_1 | EDGE_2);
+    }
+}
+
+void OcclusionCuller::AddTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, unsigned int outerEdges)
+{
+    const glm::vec3* in[3] = { &a, &b, &c };
+    float x[3], y[3], z[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        glm::vec4 clip = viewProj * glm::vec4(*in[k], 1.0f);
+        if (clip.w < nearPlane)
+            return;
+        float invW = 1.0f / clip.w;
+        x[k] = (clip.x * invW * 0.5f + 0.5f) * (float)WIDTH;
+        y[k] = (clip.y * invW * 0.5f + 0.5f) * (float)HEIGHT;
+        z[k] = invW;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::fabs(area) < 1e-6f)
+        return;
+
+    Triangle t;
+    t.minX = std::max(0, (int)std::floor(std::min(x[0], std::min(x[1], x[2]))));
+    t.maxX = std::min(WIDTH - 1, (int)std::ceil(std::max(x[0], std::max(x[1], x[2]))));
+    t.minY = std::max(0, (int)std::floor(std::min(y[0], std::min(y[1], y[2]))));
+    t.maxY = std::min(HEIGHT - 1, (int)std::ceil(std::max(y[0], std::max(y[1], y[2]))));
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return;
+
+    // edge k runs from vertex k to k + 1; positive inside for either winding
+    float sign = area > 0.0f ? 1.0f : -1.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+        int n = (k + 1) % 3;
+        t.edgeA[k] = sign * (y[k] - y[n]);
+        t.edgeB[k] = sign * (x[n] - x[k]);
+        t.edgeC[k] = sign * (x[k] * y[n] - x[n] * y[k]);
+        if (outerEdges & (1u << k))
+            ConservativePlane(t.edgeA[k], t.edgeB[k], t.edgeC[k]);
+    }
+
+    // 1 / w through the three vertices
+    float invArea = 1.0f / area;
+    float dz1 = z[1] - z[0], dz2 = z[2] - z[0];
+    t.depthA = (dz1 * (y[2] - y[0]) - dz2 * (y[1] - y[0])) * invArea;
+    t.depthB = (dz2 * (x[1] - x[0]) - dz1 * (x[2] - x[0])) * invArea;
+    t.depthC = z[0] - t.depthA * x[0] - t.depthB * y[0];
+    ConservativePlane(t.depthA, t.depthB, t.depthC);
+
+    triangles.push_back(t);
+}
+
+void OcclusionCuller::Rasterize()
+{
+    auto rasterizeBands = [this](size_t begin, size_t end)
+    {
+        for (size_t band = begin; band < end; ++band)
+            RasterizeBand((int)band);
+    };
+    JobCounter counter;
+    jobs.ParallelFor(counter, HEIGHT / BAND_ROWS, 1, rasterizeBands);
+    jobs.Wait(counter);
+
+    BuildPyramid();
+}
+
+// keeps the nearest occluder per pixel: max of 1 / w where all three
+// edges cover the pixel
+void OcclusionCuller::RasterizeBand(int band)
+{
+    int bandMinY = band * BAND_ROWS;
+    int bandMaxY = bandMinY + BAND_ROWS - 1;
+    float* depth = pyramid[0].data();
+    const F32x8 zero = F32x8::Set(0.0f);
+
+    for (const Triangle& t : triangles)
+    {
+        int minY = std::max(t.minY, bandMinY);
+        int maxY = std::min(t.maxY, bandMaxY);
+        int minX = t.minX & ~7;
+        for (int y = minY; y <= maxY; ++y)
+        {
+            float py = (float)y + 0.5f;
+            float* row = depth + (size_t)y * WIDTH;
+            for (int x = minX; x <= t.maxX; x += 8)
+            {
+                float px = (float)x + 0.5f;
+                F32x8 e0 = F32x8::Ramp(t.edgeA[0] * px + t.edgeB[0] * py + t.edgeC[0], t.edgeA[0]);
+                F32x8 e1 = F32x8::Ramp(t.edgeA[1] * px + t.edgeB[1] * py + t.edgeC[1], t.edgeA[1]);
+                F32x8 e2 = F32x8::Ramp(t.edgeA[2] * px + t.edgeB[2] * py + t.edgeC[2], t.edgeA[2]);
+                F32x8 inside = Min(e0, Min(e1, e2));
+                if (LessMask(inside, zero) == 0xFF)
+                    continue;
+
+                F32x8 z = F32x8::Ramp(t.depthA * px + t.depthB * py + t.depthC, t.depthA);
+                F32x8 old = F32x8::Load(row + x);
+                SelectLess(inside, zero, old, Max(old, z)).Store(row + x);
+            }
+        }
+    }
+}
+
+// each texel of level l + 1 is the farthest (smallest 1 / w) of its 2x2
+void OcclusionCuller::BuildPyramid()
+{
+    for (int l = 1; l < LEVELS; ++l)
+    {
+        int w = WIDTH >> l, h = HEIGHT >> l;
+        const float* src = pyramid[l - 1].data();
+        float* dst = pyramid[l].data();
+        int srcW = w * 2;
+        for (int y = 0; y < h; ++y)
+        {
+            const float* r0 = src + (size_t)(2 * y) * srcW;
+            const float* r1 = r0 + srcW;
+            for (int x = 0; x < w; ++x)
+            {
+                float a = std::min(r0[2 * x], r0[2 * x + 1]);
+                float b = std::min(r1[2 * x], r1[2 * x + 1]);
+                dst[(size_t)y * w + x] = std::min(a, b);
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::SphereVisible(const glm::vec3& center, float radius) const
+{
+    glm::vec3 v = glm::vec3(viewMatrix * glm::vec4(center, 1.0f));
+    float depth = -v.z;
+    float nearest = depth - radius;
+    if (nearest <= nearPlane)
+        return true;
+
+    // screen rectangle in pixels: x / depth is extreme at the corners of
+    // the range of x over the range of depth, likewise y
+    float invNear = 1.0f / nearest, invFar = 1.0f / (depth + radius);
+    float sx = 0.5f * scaleX * (float)WIDTH, sy = 0.5f * scaleY * (float)HEIGHT;
+    float loX = std::min((v.x - radius) * invNear, (v.x - radius) * invFar) * sx + 0.5f * WIDTH;
+    float hiX = std::max((v.x + radius) * invNear, (v.x + radius) * invFar) * sx + 0.5f * WIDTH;
+    float loY = std::min((v.y - radius) * invNear, (v.y - radius) * invFar) * sy + 0.5f * HEIGHT;
+    float hiY = std::max((v.y + radius) * invNear, (v.y + radius) * invFar) * sy + 0.5f * HEIGHT;
+    if (hiX < 0.0f || hiY < 0.0f || loX >= (float)WIDTH || loY >= (float)HEIGHT)
+        return true;    // off screen: the frustum test's call
+
+    // clamped first, so truncating is flooring
+    int x0 = (int)std::max(loX, 0.0f);
+    int x1 = (int)std::min(hiX, (float)(WIDTH - 1));
+    int y0 = (int)std::max(loY, 0.0f);
+    int y1 = (int)std::min(hiY, (float)(HEIGHT - 1));
+
+    int l = 0;
+    while (l < LEVELS - 1 && ((x1 >> l) - (x0 >> l) >= LOOKUP || (y1 >> l) - (y0 >> l) >= LOOKUP))
+        ++l;
+    x0 >>= l; x1 >>= l; y0 >>= l; y1 >>= l;
+
+    const float* texels = pyramid[l].data();
+    int w = WIDTH >> l;
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float* row = texels + (size_t)y * w;
+        for (int x = x0; x <= x1; ++x)
+        {
+            if (invNear >= row[x])
+                return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,92 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "Affine3x4.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// ---------- CPU occlusion culling ----------
+// A few large occluders are rasterized into a 256x128 float buffer of 1 / w
+// (reversed depth: bigger is nearer, 0 is nothing drawn) on the job
+// threads, one band of rows per job, 8 pixels at a time (Simd8.h). 1 / w is
+// affine in screen space, so it interpolates exactly. A min pyramid over it
+// holds, per texel, the farthest occluder depth below it. A bounding sphere
+// is hidden when its nearest point is farther than that over every texel
+// its screen rectangle covers, read from the finest level where the
+// rectangle spans at most LOOKUP x LOOKUP texels.
+//
+// Occluders must lie inside what they stand for: a sphere is replaced by the
+// octagon inscribed in its great circle facing the camera, a mesh by its own
+// triangles. Triangles crossing the near plane are left out, and a texel
+// only counts as covered when the occluder covers all of it, at the
+// farthest depth it has over it; mesh triangles are treated one by one, so
+// a mesh loses a texel along its inner edges. No GL, no GPU round trip.
+class OcclusionCuller
+{
+public:
+    static constexpr int WIDTH = 256;
+    static constexpr int HEIGHT = 128;
+    static constexpr int BAND_ROWS = 16;    // rows per raster job
+    static constexpr int LEVELS = 8;        // 256x128 down to 2x1
+    static constexpr int LOOKUP = 4;        // texels read per axis and test, at most
+
+    explicit OcclusionCuller(JobSystem& jobs);
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // Starts a frame: drops the occluders and clears the buffer. projection
+    // must be a symmetric perspective projection.
+    void Begin(const glm::mat4& view, const glm::mat4& projection);
+
+    void AddSphereOccluder(const glm::vec3& center, float radius);
+
+    // positions[index * stride + 0..2], placed by model
+    void AddMeshOccluder(const float* positions, size_t stride, const unsigned int* indices, size_t indexCount,
+        const Affine3x4& model);
+
+    // rasterizes the occluders and builds the pyramid
+    void Rasterize();
+
+    // false when the sphere is certainly behind the occluders; thread safe
+    bool SphereVisible(const glm::vec3& center, float radius) const;
+
+    // level 0 is WIDTH x HEIGHT, row 0 at the bottom of the screen
+    const float* level(int l) const { return pyramid[l].data(); }
+    size_t triangleCount() const { return triangles.size(); }
+
+private:
+    // screen-space triangle: edge functions and 1 / w as planes a*x + b*y + c
+    struct Triangle
+    {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float depthA, depthB, depthC;
+        int minX, maxX, minY, maxY;
+    };
+
+    // edge k runs from vertex k to k + 1
+    enum { EDGE_0 = 1, EDGE_1 = 2, EDGE_2 = 4 };
+
+    // Only the outer edges are pulled in by half a texel; an edge shared
+    // with a triangle in the same plane keeps plain centre sampling, so
+    // the pair leaves no gap along it.
+    void AddTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, unsigned int outerEdges);
+    void RasterizeBand(int band);
+    void BuildPyramid();
+
+    JobSystem& jobs;
+    glm::mat4 viewMatrix;
+    glm::mat4 viewProj;
+    glm::vec3 eye;
+    float scaleX = 1.0f, scaleY = 1.0f;     // projection[0][0], [1][1]
+    float nearPlane = 0.1f;
+
+    std::vector<Triangle> triangles;
+    std::vector<float> pyramid[LEVELS];
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "OcclusionQueries.h"
+
+#include <algorithm>
+
+// corners of [-1, 1]^3 and its 12 triangles
+static const float CUBE_VERTICES[] = {
+    -1, -1, -1,   1, -1, -1,   1,  1, -1,  -1,  1, -1,
+    -1, -1,  1,   1, -1,  1,   1,  1,  1,  -1,  1,  1,
+};
+static const unsigned short CUBE_INDICES[] = {
+    0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,
+    0, 1, 5, 0, 5, 4,   3, 6, 2, 3, 7, 6,
+    0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+};
+
+// the camera this close to a box (near plane included) could be inside it,
+// where the box's own faces get clipped and the query says hidden
+static const float NEAR_MARGIN = 0.25f;
+
+OcclusionQueries::OcclusionQueries(size_t objectCount, const Vfs& files)
+    : shader(files, "bbox.vert", "depth.frag")
+{
+    viewProjLoc = glGetUniformLocation(shader.ID, "viewProj");
+    boxLoc = glGetUniformLocation(shader.ID, "uBox");
+
+    glGenVertexArrays(1, &cubeVao);
+    glGenBuffers(1, &cubeVbo);
+    glGenBuffers(1, &cubeEbo);
+    glBindVertexArray(cubeVao);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(CUBE_INDICES), CUBE_INDICES, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    for (QuerySet& set : sets)
+    {
+        set.queries.resize(objectCount);
+        set.tested.assign(objectCount, 0);
+        if (objectCount)
+            glGenQueries((GLsizei)objectCount, set.queries.data());
+    }
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+    for (QuerySet& set : sets)
+        if (!set.queries.empty())
+            glDeleteQueries((GLsizei)set.queries.size(), set.queries.data());
+    glDeleteBuffers(1, &cubeVbo);
+    glDeleteBuffers(1, &cubeEbo);
+    glDeleteVertexArrays(1, &cubeVao);
+    glDeleteProgram(shader.ID);
+}
+
+void OcclusionQueries::BeginFrame()
+{
+    current ^= 1;
+    // this set was issued two frames ago; read what is ready before reusing it
+    if (collectStats)
+        Collect(sets[current]);
+    std::fill(sets[current].tested.begin(), sets[current].tested.end(), 0);
+    sets[current].lastIssued = 0;
+}
+
+void OcclusionQueries::Issue(const PacketStream& packets, const Scene& scene, const glm::mat4& viewProj, const glm::vec3& eye)
+{
+    QuerySet& set = sets[current];
+    shader.use();
+    glUniformMatrix4fv(viewProjLoc, 1, GL_FALSE, &viewProj[0][0]);
+    glBindVertexArray(cubeVao);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    for (const DrawPacket* p : packets)
+    {
+        const SceneObject& obj = scene.objects[p->object];
+        glm::vec3 d = glm::abs(eye - obj.position);
+        float reach = obj.boundingRadius + NEAR_MARGIN;
+        if (d.x < reach && d.y < reach && d.z < reach)
+            continue;
+
+        glUniform4f(boxLoc, obj.position.x, obj.position.y, obj.position.z, obj.boundingRadius);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, set.queries[p->object]);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        set.tested[p->object] = set.lastIssued = set.queries[p->object];
+    }
+
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// a frame whose last query is not ready yet is skipped rather than waited for
+void OcclusionQueries::Collect(const QuerySet& set)
+{
+    if (!set.lastIssued)
+        return;
+    GLuint ready = 0;
+    glGetQueryObjectuiv(set.lastIssued, GL_QUERY_RESULT_AVAILABLE, &ready);
+    if (!ready)
+        return;
+
+    ++totals.frames;
+    for (GLuint q : set.tested)
+    {
+        if (!q)
+            continue;
+        GLuint visible = 0;
+        glGetQueryObjectuiv(q, GL_QUERY_RESULT, &visible);
+        ++totals.tested;
+        totals.occluded += visible ? 0 : 1;
+    }
+}
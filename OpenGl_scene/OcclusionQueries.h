@@ -0,0 +1,76 @@
+#ifndef OCCLUSION_QUERIES_H
+#define OCCLUSION_QUERIES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+// ---------- hardware occlusion culling ----------
+// After the scene has been drawn, every drawn object's bounding box is
+// rasterized against the depth buffer inside a GL_ANY_SAMPLES_PASSED query
+// (no colour or depth writes). The next frame draws each object inside
+// glBeginConditionalRender on that query with GL_QUERY_NO_WAIT, so the GPU
+// skips the objects it found hidden and the CPU never reads a result back;
+// a result that is not ready yet just means the object is drawn. Two query
+// sets alternate so a frame never re-issues the queries it is drawing on.
+// Objects hidden for one frame are still tested, against the depth of what
+// was drawn, so they come back one frame late at worst.
+class OcclusionQueries
+{
+public:
+    // needs a current GL 3.3 context; bbox.vert / depth.frag looked up in `files`
+    explicit OcclusionQueries(size_t objectCount, const Vfs& files = Vfs());
+    ~OcclusionQueries();
+
+    OcclusionQueries(const OcclusionQueries&) = delete;
+    OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+    // switches to the other query set; call once per frame before drawing
+    void BeginFrame();
+
+    // per Scene::objects index: the last frame's query to draw on, 0 = draw anyway
+    const GLuint* conditions() const { return sets[current ^ 1].tested.data(); }
+
+    // Tests the bounding box of every packet's object against the bound
+    // depth buffer. Boxes the camera may be inside are not tested (drawn
+    // unconditionally next frame).
+    void Issue(const PacketStream& packets, const Scene& scene, const glm::mat4& viewProj, const glm::vec3& eye);
+
+    // non-blocking readback of the results, two frames late, for reporting
+    void SetCollectStats(bool enabled) { collectStats = enabled; }
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t tested = 0;
+        uint64_t occluded = 0;
+    };
+    const Stats& stats() const { return totals; }
+
+private:
+    struct QuerySet
+    {
+        std::vector<GLuint> queries;    // one per object
+        std::vector<GLuint> tested;     // queries[i] if issued this frame, else 0
+        GLuint lastIssued = 0;          // results arrive in order: ready means all are
+    };
+
+    void Collect(const QuerySet& set);
+
+    Shader shader;
+    GLint viewProjLoc = -1;
+    GLint boxLoc = -1;
+    GLuint cubeVao = 0, cubeVbo = 0, cubeEbo = 0;
+
+    QuerySet sets[2];
+    int current = 0;
+    bool collectStats = false;
+    Stats totals;
+};
+
+#endif
@@ -1,93 +1,303 @@
 #include <glad/glad.h>
+#ifndef SCENE_NO_GLFW
 #include <glfw3.h>
+#endif
 
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
-#include "Shader.h"
+#include "FrameProfiler.h"
+#include "HeadlessContext.h"
+#include "ImageWrite.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+#include "SoftwareRenderer.h"
+#include "TextureStreamer.h"
 
 #include <iostream>
+#include <memory>
 #include <vector>
-#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-// ---------- Sphere generation: outputs interleaved pos(3) + normal(3) ----------
-static void GenerateSpherePN(
-    float radius,
-    int stacks,
-    int sectors,
-    std::vector<float>& outInterleavedPN,   // [px,py,pz,nx,ny,nz]...
-    std::vector<unsigned int>& outIndices
-)
+struct Options
 {
-    outInterleavedPN.clear();
-    outIndices.clear();
-
-    const float PI = 3.14159265358979323846f;
+    size_t extraObjects = 0;
+    size_t layeredObjects = 0;
+    size_t lights = 0;
+    unsigned int workerThreads = 0;
+    const char* profilePath = NULL;
+    std::vector<const char*> streamPaths;
+    Vfs assets;     // shaders and streamed files; the working directory unless --assets
+    bool compressTextures = false;
+    bool cpuMvp = false;
+    bool deferred = false;
+    bool depthPrepass = false;
+    bool frontToBack = false;
+    bool overdraw = false;
+    bool countFragments = false;
+    bool occlusionQueries = false;
+    bool cpuOcclusion = false;
+    bool shadows = false;
+    bool sun = false;
+    int cascades = 4;
+    bool shadowCache = false;
+    float lightTime = -1.0f;
+
+    // headless
+    bool headless = false;
+    bool software = false;
+    int frames = 100;
+    float startTime = 0.0f;
+    float timeStep = 1.0f / 60.0f;
+    int width = SCR_WIDTH;
+    int height = SCR_HEIGHT;
+    const char* dumpPath = NULL;
+    const char* timingsPath = NULL;
+};
+
+// --objects N  : add N objects behind the default scene
+// --layered N  : add N objects in layers straight behind it, mostly hidden (instead of --objects)
+// --lights N   : add N clustered point lights around the objects
+// --threads N  : job system worker threads (default: cores - 1)
+// --profile F  : CPU/GPU scope timings, written as a Chrome trace to F
+// --stream F   : stream image or cooked .tex file F into a texture while rendering (repeatable)
+// --assets D   : look shaders and streamed files up in directory D (repeatable, first match wins)
+// --bc         : BC1/BC3-compress streamed images in the decode jobs (needs S3TC)
+// --cpu-mvp    : compute per-object MVPs on the job threads instead of in the vertex shader
+// --deferred   : G-buffer pass plus one full-screen lighting pass instead of forward shading
+// --depth-prepass : lay down depth with a position-only pass, then shade with GL_EQUAL
+// --front-to-back : sort draws by view depth instead of by material / mesh
+// --overdraw   : show how many fragments each pixel shaded instead of the lit scene
+// --fragments  : count the geometry passes' fragments (and, with --occlusion, hidden objects)
+// --occlusion  : skip objects whose bounding box was hidden last frame (conditional rendering)
+// --cpu-occlusion : skip objects hidden behind the largest ones, tested on the CPU before drawing
+// --shadows    : shadow map for the orbiting light (PCF), casters culled per map
+// --sun        : light the scene as a directional light from the orbiting light's side
+// --cascades N : shadow cascades with --sun, 1 to 4 (4)
+// --shadow-cache : keep the static casters' shadows, redraw only the moving ones
+// --light-time T : hold the light where it is at time T instead of orbiting
+// --headless   : render offscreen through EGL instead of opening a window
+// --software   : headless, but through the CPU rasterizer (no GL at all)
+//   --frames N   number of frames to render (100)
+//   --time T     simulated time of the first frame, replaces glfwGetTime() (0)
+//   --dt D       simulated time step per frame (1/60)
+//   --width W / --height H   framebuffer size (800 x 600)
+//   --dump F     write the last frame to F as PNG
+//   --timings F  write per-frame times to F as CSV
+static Options ParseOptions(int argc, char** argv)
+{
+    Options o;
+    unsigned int cores = std::thread::hardware_concurrency();
+    o.workerThreads = cores > 1 ? cores - 1 : 0;
 
-    // vertices
-    for (int i = 0; i <= stacks; ++i)
+    for (int i = 1; i < argc; ++i)
     {
-        float v = (float)i / (float)stacks;
-        float theta = v * PI; // 0..pi
-
-        float y = radius * std::cos(theta);
-        float r = radius * std::sin(theta);
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
 
-        for (int j = 0; j <= sectors; ++j)
+        if (std::strcmp(arg, "--headless") == 0)
         {
-            float u = (float)j / (float)sectors;
-            float phi = u * 2.0f * PI; // 0..2pi
-
-            float x = r * std::cos(phi);
-            float z = r * std::sin(phi);
-
-            glm::vec3 pos(x, y, z);
-            glm::vec3 nrm = glm::normalize(pos); // for a sphere centered at origin
-
-            outInterleavedPN.push_back(pos.x);
-            outInterleavedPN.push_back(pos.y);
-            outInterleavedPN.push_back(pos.z);
-
-            outInterleavedPN.push_back(nrm.x);
-            outInterleavedPN.push_back(nrm.y);
-            outInterleavedPN.push_back(nrm.z);
+            o.headless = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--software") == 0)
+        {
+            o.headless = o.software = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--bc") == 0)
+        {
+            o.compressTextures = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--cpu-mvp") == 0)
+        {
+            o.cpuMvp = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--deferred") == 0)
+        {
+            o.deferred = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--depth-prepass") == 0)
+        {
+            o.depthPrepass = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--front-to-back") == 0)
+        {
+            o.frontToBack = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--overdraw") == 0)
+        {
+            o.overdraw = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--fragments") == 0)
+        {
+            o.countFragments = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--occlusion") == 0)
+        {
+            o.occlusionQueries = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--cpu-occlusion") == 0)
+        {
+            o.cpuOcclusion = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--shadows") == 0)
+        {
+            o.shadows = true;
+            continue;
         }
+        if (std::strcmp(arg, "--sun") == 0)
+        {
+            o.sun = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--shadow-cache") == 0)
+        {
+            o.shadowCache = true;
+            continue;
+        }
+        if (!value)
+        {
+            std::cout << "Missing value for " << arg << "\n";
+            break;
+        }
+        ++i;
+
+        if (std::strcmp(arg, "--objects") == 0)
+            o.extraObjects = (size_t)std::strtoul(value, NULL, 10);
+        else if (std::strcmp(arg, "--layered") == 0)
+            o.layeredObjects = (size_t)std::strtoul(value, NULL, 10);
+        else if (std::strcmp(arg, "--lights") == 0)
+            o.lights = (size_t)std::strtoul(value, NULL, 10);
+        else if (std::strcmp(arg, "--cascades") == 0)
+            o.cascades = std::atoi(value);
+        else if (std::strcmp(arg, "--light-time") == 0)
+            o.lightTime = (float)std::atof(value);
+        else if (std::strcmp(arg, "--threads") == 0)
+            o.workerThreads = (unsigned int)std::strtoul(value, NULL, 10);
+        else if (std::strcmp(arg, "--profile") == 0)
+            o.profilePath = value;
+        else if (std::strcmp(arg, "--stream") == 0)
+            o.streamPaths.push_back(value);
+        else if (std::strcmp(arg, "--assets") == 0)
+            o.assets.Mount(value);
+        else if (std::strcmp(arg, "--frames") == 0)
+            o.frames = std::max(1, std::atoi(value));
+        else if (std::strcmp(arg, "--time") == 0)
+            o.startTime = (float)std::atof(value);
+        else if (std::strcmp(arg, "--dt") == 0)
+            o.timeStep = (float)std::atof(value);
+        else if (std::strcmp(arg, "--width") == 0)
+            o.width = std::max(1, std::atoi(value));
+        else if (std::strcmp(arg, "--height") == 0)
+            o.height = std::max(1, std::atoi(value));
+        else if (std::strcmp(arg, "--dump") == 0)
+            o.dumpPath = value;
+        else if (std::strcmp(arg, "--timings") == 0)
+            o.timingsPath = value;
+        else
+            std::cout << "Unknown option " << arg << "\n";
     }
+    return o;
+}
 
-    // indices
-    int ring = sectors + 1;
-    for (int i = 0; i < stacks; ++i)
+static void ConfigureRenderer(SceneRenderer& renderer, const Options& opts)
+{
+    renderer.SetCpuMvp(opts.cpuMvp);
+    renderer.SetShadingMode(opts.overdraw ? SHADING_OVERDRAW : opts.deferred ? SHADING_DEFERRED : SHADING_FORWARD);
+    renderer.SetDepthPrepass(opts.depthPrepass);
+    renderer.SetFrontToBack(opts.frontToBack);
+    renderer.SetCountFragments(opts.countFragments);
+    renderer.SetOcclusionQueries(opts.occlusionQueries);
+    renderer.SetCpuOcclusion(opts.cpuOcclusion);
+    renderer.SetDirectionalLight(opts.sun);
+    renderer.SetShadows(opts.shadows, opts.cascades);
+    renderer.SetShadowCaching(opts.shadowCache);
+    renderer.SetFixedLightTime(opts.lightTime);
+}
+
+static void PrintFragments(const SceneRenderer& renderer, const Options& opts, int width, int height)
+{
+    if (opts.cpuOcclusion)
+        std::printf("last frame: %zu objects hidden by the CPU occluders\n", renderer.cpuOccludedCount());
+    if (opts.shadows)
+        std::printf("last frame: %zu shadow caster draws\n", renderer.shadowDraws());
+    if (opts.shadows && opts.shadowCache)
+        std::printf("shadow cache redrawn %zu times\n", renderer.shadowCacheUpdates());
+    const FragmentStats& f = renderer.fragmentStats();
+    if (!opts.countFragments)
+        return;
+    if (f.frames)
     {
-        for (int j = 0; j < sectors; ++j)
-        {
-            unsigned int k1 = i * ring + j;
-            unsigned int k2 = (i + 1) * ring + j;
+        double pixels = (double)width * height * f.frames;
+        std::printf("fragments/frame over %llu frames: depth pre-pass %.0f, colour pass %.0f (%.3f per pixel)\n",
+            (unsigned long long)f.frames, (double)f.depthFragments / f.frames, (double)f.colorFragments / f.frames,
+            f.colorFragments / pixels);
+    }
+    const OcclusionQueries* occlusion = renderer.occlusionQueries();
+    if (occlusion && occlusion->stats().frames)
+    {
+        const OcclusionQueries::Stats& o = occlusion->stats();
+        std::printf("objects/frame over %llu frames: %.1f box-tested, %.1f hidden (not drawn the next frame)\n",
+            (unsigned long long)o.frames, (double)o.tested / o.frames, (double)o.occluded / o.frames);
+    }
+}
 
-            outIndices.push_back(k1);
-            outIndices.push_back(k2);
-            outIndices.push_back(k1 + 1);
+static void FinishProfile(std::unique_ptr<FrameProfiler>& profiler, const char* path)
+{
+    if (!profiler)
+        return;
+    profiler->Flush();
+    profiler->PrintSummary(std::cout);
+    if (!profiler->WriteChromeTrace(path))
+        std::cout << "Failed to write profile to " << path << "\n";
+    profiler.reset();
+}
 
-            outIndices.push_back(k1 + 1);
-            outIndices.push_back(k2);
-            outIndices.push_back(k2 + 1);
-        }
-    }
+// nothing samples the streamed textures yet; this exercises the streamer
+// next to a real frame loop and reports its throughput
+static std::unique_ptr<TextureStreamer> StartStreaming(const Options& opts, JobSystem& jobs, const SceneRenderer& renderer)
+{
+    std::unique_ptr<TextureStreamer> streamer;
+    if (opts.streamPaths.empty())
+        return streamer;
+    streamer.reset(new TextureStreamer(jobs, 4 << 20, 3, opts.compressTextures, renderer.assets()));
+    for (const char* path : opts.streamPaths)
+        streamer->Request(path);
+    return streamer;
 }
 
-static glm::mat4 RotatingModel()
+static void FinishStreaming(std::unique_ptr<TextureStreamer>& streamer)
 {
-    float t = (float)glfwGetTime();
-    return glm::rotate(glm::mat4(1.0f),
-        t * glm::radians(40.0f),
-        glm::vec3(0.5f, 1.0f, 0.0f));
+    if (!streamer)
+        return;
+    TextureStreamer::Stats s = streamer->stats();
+    std::printf("textures: %zu requested, %zu resident, %zu failed; decoded %.1f MB (%.1f MB/s), uploaded %.1f MB (%.1f MB/s)\n",
+        s.requested, s.resident, s.failed,
+        s.decodedBytes * 1e-6, s.decodeMBps(), s.uploadedBytes * 1e-6, s.uploadMBps());
+    streamer.reset();
 }
 
-int main()
+#ifndef SCENE_NO_GLFW
+static int RunWindowed(const Options& opts, JobSystem& jobs, const Scene& scene)
 {
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -113,96 +323,13 @@ int main()
         return -1;
     }
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-
-    // ONE shader for everything
-    Shader shader("vertex.vert", "fragment.frag");
-
-    // ===================== SPHERE (pos+normal) =====================
-    std::vector<float> spherePN;
-    std::vector<unsigned int> sphereIndices;
-
-    float radius = 1.5f;
-    int stacks = 32;
-    int sectors = 64;
-    GenerateSpherePN(radius, stacks, sectors, spherePN, sphereIndices);
-
-    unsigned int sphereVAO, sphereVBO, sphereEBO;
-    glGenVertexArrays(1, &sphereVAO);
-    glGenBuffers(1, &sphereVBO);
-    glGenBuffers(1, &sphereEBO);
-
-    glBindVertexArray(sphereVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
-    glBufferData(GL_ARRAY_BUFFER, spherePN.size() * sizeof(float), spherePN.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(unsigned int), sphereIndices.data(), GL_STATIC_DRAW);
-
-    // location 0: position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // location 1: "attr" = normal for sphere
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs, opts.assets));
+    ConfigureRenderer(*renderer, opts);
+    std::unique_ptr<TextureStreamer> streamer = StartStreaming(opts, jobs, *renderer);
 
-    glBindVertexArray(0);
-
-    // sphere transforms
-    glm::mat4 modelLeft = glm::translate(glm::mat4(1.0f), glm::vec3(-5.0f, 0.0f, -10.0f));
-    glm::mat4 modelRight = glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, -10.0f));
-
-    // ===================== TETRAHEDRON (pos+color) =====================
-    float tetraVertices[] = {
-        // positions           // colors
-         1.0f,  1.0f,  1.0f,    1.0f, 0.0f, 0.0f, // v0
-        -1.0f, -1.0f,  1.0f,    0.0f, 1.0f, 0.0f, // v1
-        -1.0f,  1.0f, -1.0f,    0.0f, 0.0f, 1.0f, // v2
-         1.0f, -1.0f, -1.0f,    1.0f, 1.0f, 0.0f  // v3
-    };
-
-    unsigned int tetraIndices[] = {
-        0, 1, 2,
-        0, 3, 1,
-        0, 2, 3,
-        1, 3, 2
-    };
-
-    unsigned int tetraVAO, tetraVBO, tetraEBO;
-    glGenVertexArrays(1, &tetraVAO);
-    glGenBuffers(1, &tetraVBO);
-    glGenBuffers(1, &tetraEBO);
-
-    glBindVertexArray(tetraVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, tetraVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(tetraVertices), tetraVertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tetraEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(tetraIndices), tetraIndices, GL_STATIC_DRAW);
-
-    // location 0: position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // location 1: "attr" = color for tetra
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glBindVertexArray(0);
-
-    // ===================== VIEW (shared) =====================
-    glm::mat4 view = glm::lookAt(
-        glm::vec3(0.0f, 0.0f, 8.0f),
-        glm::vec3(0.0f, 0.0f, -10.0f),
-        glm::vec3(0.0f, 1.0f, 0.0f)
-    );
-
-    // simple light/camera settings
-    glm::vec3 lightPos(0.0f, 5.0f, 5.0f);
+    std::unique_ptr<FrameProfiler> profiler;
+    if (opts.profilePath)
+        profiler.reset(new FrameProfiler());
 
     while (!glfwWindowShouldClose(window))
     {
@@ -211,84 +338,192 @@ int main()
         if (fbW <= 0) fbW = SCR_WIDTH;
         if (fbH <= 0) fbH = SCR_HEIGHT;
 
-        glViewport(0, 0, fbW, fbH);
+        int frameScope = -1;
+        if (profiler)
+        {
+            profiler->BeginFrame();
+            frameScope = profiler->BeginScope("frame");
+        }
 
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f),
-            (float)fbW / (float)fbH,
-            0.1f, 200.0f);
+        renderer->Render((float)glfwGetTime(), fbW, fbH, profiler.get());
+        if (streamer)
+            streamer->Update();
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (profiler)
+        {
+            profiler->EndScope(frameScope);
+            profiler->EndFrame();
+        }
 
-        shader.use();
-        float t = (float)glfwGetTime();
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
 
-        // wiato kry po okrgu nad scen
-        glm::vec3 lightPos;
-        lightPos.x = 6.0f * cos(t);
-        lightPos.y = 4.0f;          // wysoko
-        lightPos.z = 6.0f * sin(t) - 10.0f; // przesunicie w gb sceny (bo obiekty s przy z=-10)
+    int fbW, fbH;
+    glfwGetFramebufferSize(window, &fbW, &fbH);
+    PrintFragments(*renderer, opts, std::max(fbW, 1), std::max(fbH, 1));
+    FinishProfile(profiler, opts.profilePath);
+    FinishStreaming(streamer);
 
-        shader.setVec3("lightPos", lightPos);
-        shader.setVec3("lightPos", glm::vec3(0.0f, 5.0f, 5.0f));
-        shader.setVec3("viewPos", glm::vec3(0.0f, 0.0f, 8.0f)); // kamera jak w lookAt()
+    // cleanup
+    renderer.reset();
+    glfwTerminate();
+    return 0;
+}
+#else
+// built without GLFW (e.g. CI hosts): only --headless is available
+static int RunWindowed(const Options&, JobSystem&, const Scene&)
+{
+    std::cout << "This build has no window support, run with --headless\n";
+    return -1;
+}
+#endif
 
-        shader.setFloat("ambientStrength", 0.20f);
-        shader.setFloat("diffuseStrength", 0.80f);
-        shader.setFloat("specularStrength", 0.50f);
-        shader.setFloat("shininess", 32.0f);
+// Fixed frame count, simulated time and resolution, no window: every frame
+// ends with glFinish() so the measured time covers the GPU work too.
+static int RunHeadless(const Options& opts, JobSystem& jobs, const Scene& scene)
+{
+    HeadlessContext context;
+    std::unique_ptr<SceneRenderer> renderer;
+    std::unique_ptr<SoftwareRenderer> software;
+    std::unique_ptr<FrameProfiler> profiler;
+    std::unique_ptr<TextureStreamer> streamer;
 
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
+    if (opts.software)
+    {
+        std::cout << "Renderer: software, " << jobs.threadCount() << " thread(s)\n";
+        software.reset(new SoftwareRenderer(scene, jobs));
+        if (opts.profilePath)
+            std::cout << "--profile needs GL timer queries, ignored with --software\n";
+        if (!opts.streamPaths.empty())
+            std::cout << "--stream needs GL, ignored with --software\n";
+        if (!scene.lights.empty())
+            std::cout << "--lights is GL only, ignored with --software\n";
+        if (opts.deferred || opts.depthPrepass || opts.overdraw || opts.countFragments)
+            std::cout << "--deferred, --depth-prepass, --overdraw and --fragments are GL only, ignored with --software\n";
+        if (opts.shadows || opts.sun)
+            std::cout << "--shadows and --sun are GL only, ignored with --software\n";
+    }
+    else
+    {
+        if (!context.Create(opts.width, opts.height))
+            return -1;
 
-        // uniforms for Phong (used only by left sphere)
-        shader.setVec3("lightPos", lightPos);
-        shader.setVec3("lightColor", glm::vec3(1.0f));
-        shader.setVec3("viewPos", glm::vec3(0.0f, 0.0f, 8.0f)); // camera position from lookAt
-        shader.setFloat("ambientStrength", 0.20f);
-        shader.setFloat("diffuseStrength", 1.00f);
+        std::cout << "Renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")\n";
+        renderer.reset(new SceneRenderer(scene, jobs, opts.assets));
+        ConfigureRenderer(*renderer, opts);
 
-        // ---------- LEFT SPHERE: Phong (ambient+diffuse only) ----------
-        shader.setInt("uObjectType", 0);
-        shader.setMat4("model", modelLeft);
+        if (opts.profilePath)
+            profiler.reset(new FrameProfiler());
+        streamer = StartStreaming(opts, jobs, *renderer);
+    }
 
-        glBindVertexArray(sphereVAO);
-        glDrawElements(GL_TRIANGLES, (GLsizei)sphereIndices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    std::vector<double> frameMs(opts.frames);
+    for (int i = 0; i < opts.frames; ++i)
+    {
+        float t = opts.startTime + i * opts.timeStep;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        // ---------- RIGHT SPHERE: color from coordinates ----------
-        shader.setInt("uObjectType", 2);
-        shader.setMat4("model", modelRight);
+        if (software)
+        {
+            software->Render(t, opts.width, opts.height);
+            frameMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            continue;
+        }
 
-        glBindVertexArray(sphereVAO);
-        glDrawElements(GL_TRIANGLES, (GLsizei)sphereIndices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        int frameScope = -1;
+        if (profiler)
+        {
+            profiler->BeginFrame();
+            frameScope = profiler->BeginScope("frame");
+        }
 
-        // ---------- TETRAHEDRON: unchanged (vertex colors), rotating ----------
-        shader.setInt("uObjectType", 1);
-        glm::mat4 modelTetra =
-            glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f)) *
-            RotatingModel();
+        renderer->Render(t, opts.width, opts.height, profiler.get());
+        if (streamer)
+            streamer->Update();
 
-        shader.setMat4("model", modelTetra);
+        if (profiler)
+        {
+            profiler->EndScope(frameScope);
+            profiler->EndFrame();
+        }
+        glFinish();
 
-        glBindVertexArray(tetraVAO);
-        glDrawElements(GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        frameMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    // ---------- report ----------
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double ms : sorted)
+        sum += ms;
+    double avg = sum / sorted.size();
+    size_t p95 = std::min(sorted.size() - 1, sorted.size() * 95 / 100);
+
+    std::printf("%d frames at %dx%d, t = %.4f + i * %.4f\n", opts.frames, opts.width, opts.height, opts.startTime, opts.timeStep);
+    std::printf("frame ms: min %.3f  avg %.3f  median %.3f  p95 %.3f  max %.3f  (%.1f fps)\n",
+        sorted.front(), avg, sorted[sorted.size() / 2], sorted[p95], sorted.back(), 1000.0 / avg);
+    if (software)
+    {
+        const SoftwareRenderer::Stats& s = software->stats();
+        std::printf("triangles/frame: %zu submitted, %zu back-face culled, %zu binned into %zu tile entries (%.1f Mtri/s)\n",
+            s.submittedTriangles, s.backfaceCulled, s.binnedTriangles, s.binEntries,
+            s.submittedTriangles / (avg * 1000.0));
     }
+    else
+        PrintFragments(*renderer, opts, opts.width, opts.height);
 
-    // cleanup
-    glDeleteBuffers(1, &sphereVBO);
-    glDeleteBuffers(1, &sphereEBO);
-    glDeleteVertexArrays(1, &sphereVAO);
+    if (opts.timingsPath)
+    {
+        FILE* f = std::fopen(opts.timingsPath, "w");
+        if (f)
+        {
+            std::fprintf(f, "frame,time,ms\n");
+            for (int i = 0; i < opts.frames; ++i)
+                std::fprintf(f, "%d,%.6f,%.6f\n", i, opts.startTime + i * opts.timeStep, frameMs[i]);
+            std::fclose(f);
+        }
+        else
+            std::cout << "Failed to write timings to " << opts.timingsPath << "\n";
+    }
 
-    glDeleteBuffers(1, &tetraVBO);
-    glDeleteBuffers(1, &tetraEBO);
-    glDeleteVertexArrays(1, &tetraVAO);
+    int result = 0;
+    if (opts.dumpPath)
+    {
+        std::vector<unsigned char> pixels;
+        if (software)
+            software->ReadPixels(pixels);
+        else
+            context.ReadPixels(pixels);
+        if (WritePng(opts.dumpPath, opts.width, opts.height, 4, pixels.data()))
+            std::cout << "Wrote " << opts.dumpPath << "\n";
+        else
+        {
+            std::cout << "Failed to write " << opts.dumpPath << "\n";
+            result = -1;
+        }
+    }
 
-    glfwTerminate();
-    return 0;
+    FinishProfile(profiler, opts.profilePath);
+    FinishStreaming(streamer);
+    renderer.reset();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    Options opts = ParseOptions(argc, argv);
+
+    // main thread is job thread 0 and helps out whenever it waits
+    JobSystem jobs(opts.workerThreads);
+
+    // object transforms are composed by the pipeline workers each frame
+    Scene scene = opts.layeredObjects > 0 ? BuildLayeredScene(opts.layeredObjects)
+        : opts.extraObjects > 0 ? BuildStressScene(opts.extraObjects) : BuildDefaultScene();
+    AddLightField(scene, opts.lights);
+
+    if (opts.headless)
+        return RunHeadless(opts, jobs, scene);
+    return RunWindowed(opts, jobs, scene);
 }
@@ -0,0 +1,75 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "Affine3x4.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// ---------- API-agnostic draw commands ----------
+// Workers only produce these packets; the GL thread maps mesh/material ids
+// to VAOs and shader modes when it replays the stream.
+
+enum MeshId : uint8_t
+{
+    MESH_SPHERE_LOD0 = 0,   // 32 x 64, as before
+    MESH_SPHERE_LOD1,       // 16 x 32
+    MESH_SPHERE_LOD2,       //  8 x 16
+    MESH_TETRA,
+    MESH_COUNT
+};
+
+// values match uObjectType in fragment.frag
+enum Material : uint8_t
+{
+    MAT_PHONG = 0,
+    MAT_VERTEX_COLOR = 1,
+    MAT_COORD = 2
+};
+
+struct DrawPacket
+{
+    uint64_t sortKey;
+    Affine3x4 model;        // uploaded as the shader's mat3x4
+    uint8_t mesh;
+    uint8_t material;
+    uint32_t object;        // index into Scene::objects
+};
+
+// material | mesh | view depth, so replay batches state changes and draws
+// each batch front to back (positive float bits sort like the float itself)
+inline uint64_t MakeSortKey(uint8_t material, uint8_t mesh, float viewDepth)
+{
+    if (viewDepth < 0.0f) viewDepth = 0.0f;
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+    return ((uint64_t)material << 56) | ((uint64_t)mesh << 48) | (uint64_t)depthBits;
+}
+
+// view depth | material | mesh: the whole stream front to back, for the
+// depth pre-pass and early-Z; state changes only break ties
+inline uint64_t MakeDepthSortKey(uint8_t material, uint8_t mesh, float viewDepth)
+{
+    if (viewDepth < 0.0f) viewDepth = 0.0f;
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+    return ((uint64_t)depthBits << 16) | ((uint64_t)material << 8) | (uint64_t)mesh;
+}
+
+// merged, sorted output of one recorded frame
+struct PacketStream
+{
+    const DrawPacket* const* packets = nullptr;
+    size_t count = 0;
+
+    // viewProj * model of every packet, in stream order; only when the frame
+    // asked for it (FrameParams::computeMvp)
+    const glm::mat4* mvps = nullptr;
+
+    const DrawPacket* const* begin() const { return packets; }
+    const DrawPacket* const* end() const { return packets + count; }
+    size_t size() const { return count; }
+};
+
+#endif
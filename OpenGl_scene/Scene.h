@@ -0,0 +1,154 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "RenderQueue.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+enum ObjectShape : uint8_t
+{
+    SHAPE_SPHERE = 0,   // LOD picked per frame
+    SHAPE_TETRA
+};
+
+struct SceneObject
+{
+    glm::vec3 position;
+    float boundingRadius;
+    uint8_t shape;
+    uint8_t material;
+    bool rotating;      // spins like the tetra (RotatingModel)
+};
+
+// point light drifting on a unit circle around `center`
+struct SceneLight
+{
+    glm::vec3 center;
+    float range;            // influence radius
+    glm::vec3 color;
+    float phase;            // start angle, also varies the speed
+};
+
+struct Scene
+{
+    std::vector<SceneObject> objects;
+    std::vector<SceneLight> lights;     // on top of the orbiting key light
+};
+
+const float SPHERE_RADIUS = 1.5f;
+const float TETRA_RADIUS = 1.7320508f;   // |(1,1,1)|
+
+// Phong sphere + coord sphere + rotating tetra
+inline Scene BuildDefaultScene()
+{
+    Scene scene;
+    scene.objects.push_back({ glm::vec3(-5.0f, 0.0f, -10.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_PHONG, false });
+    scene.objects.push_back({ glm::vec3(5.0f, 0.0f, -10.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_COORD, false });
+    scene.objects.push_back({ glm::vec3(0.0f, 0.0f, -10.0f), TETRA_RADIUS, SHAPE_TETRA, MAT_VERTEX_COLOR, true });
+    return scene;
+}
+
+// default scene plus `extra` objects on a grid receding behind it,
+// for measuring the pipeline with 100k+ objects
+inline Scene BuildStressScene(size_t extra)
+{
+    Scene scene = BuildDefaultScene();
+    int side = (int)std::ceil(std::sqrt((double)extra));
+    if (side < 1) side = 1;
+    for (size_t i = 0; i < extra; ++i)
+    {
+        int gx = (int)(i % side);
+        int gz = (int)(i / side);
+        glm::vec3 pos(
+            (gx - side * 0.5f) * 4.0f,
+            -4.0f,
+            -14.0f - gz * 4.0f);
+
+        if (i % 3 == 2)
+            scene.objects.push_back({ pos, TETRA_RADIUS, SHAPE_TETRA, MAT_VERTEX_COLOR, true });
+        else
+            scene.objects.push_back({ pos, SPHERE_RADIUS, SHAPE_SPHERE, (uint8_t)(i % 3 == 0 ? MAT_PHONG : MAT_COORD), false });
+    }
+    return scene;
+}
+
+// default scene plus `extra` objects in layers straight behind it, a 5 x 3
+// grid per layer, so most of them are hidden by the ones in front: the
+// overdraw and occlusion case BuildStressScene's open grid does not have
+inline Scene BuildLayeredScene(size_t extra)
+{
+    Scene scene = BuildDefaultScene();
+    for (size_t i = 0; i < extra; ++i)
+    {
+        int cell = (int)(i % 15);
+        int layer = (int)(i / 15);
+        glm::vec3 pos(
+            (cell % 5 - 2) * 4.0f,
+            (cell / 5 - 1) * 3.0f,
+            -14.0f - layer * 3.0f);
+
+        if (i % 3 == 2)
+            scene.objects.push_back({ pos, TETRA_RADIUS, SHAPE_TETRA, MAT_VERTEX_COLOR, true });
+        else
+            scene.objects.push_back({ pos, SPHERE_RADIUS, SHAPE_SPHERE, (uint8_t)(i % 3 == 0 ? MAT_PHONG : MAT_COORD), false });
+    }
+    return scene;
+}
+
+// `count` colored point lights scattered over the box around the objects,
+// a little above and below them
+inline void AddLightField(Scene& scene, size_t count)
+{
+    glm::vec3 lo(-6.0f, -5.0f, -12.0f), hi(6.0f, 3.0f, -8.0f);
+    for (const SceneObject& o : scene.objects)
+    {
+        lo = glm::min(lo, o.position - glm::vec3(2.0f));
+        hi = glm::max(hi, o.position + glm::vec3(2.0f));
+    }
+
+    uint32_t noise = 1234567u;
+    auto random = [&noise](float a, float b)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        return a + (b - a) * (float)(noise >> 8) / 16777216.0f;
+    };
+    for (size_t i = 0; i < count; ++i)
+    {
+        SceneLight light;
+        light.center = glm::vec3(random(lo.x, hi.x), random(lo.y, hi.y), random(lo.z, hi.z));
+        light.range = random(0.6f, 1.4f);
+        light.color = glm::vec3(random(0.2f, 1.0f), random(0.2f, 1.0f), random(0.2f, 1.0f));
+        light.phase = random(0.0f, 6.2831853f);
+        scene.lights.push_back(light);
+    }
+}
+
+// a sphere around every object's bounding sphere (centred on their box)
+inline void SceneBounds(const Scene& scene, glm::vec3& center, float& radius)
+{
+    glm::vec3 lo(0.0f), hi(0.0f);
+    for (size_t i = 0; i < scene.objects.size(); ++i)
+    {
+        const SceneObject& o = scene.objects[i];
+        glm::vec3 r(o.boundingRadius);
+        lo = i ? glm::min(lo, o.position - r) : o.position - r;
+        hi = i ? glm::max(hi, o.position + r) : o.position + r;
+    }
+    center = (lo + hi) * 0.5f;
+    radius = 0.0f;
+    for (const SceneObject& o : scene.objects)
+        radius = std::max(radius, glm::length(o.position - center) + o.boundingRadius);
+}
+
+inline glm::vec3 LightPosition(const SceneLight& light, float t)
+{
+    float angle = light.phase + t * (0.5f + 0.1f * light.phase);
+    return light.center + glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+}
+
+#endif
@@ -0,0 +1,778 @@
+#include "SceneRenderer.h"
+#include "Mesh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// uploads interleaved pos(3) + attr(3) with the layout vertex.vert expects
+static GpuMesh UploadMeshPN(const float* vertices, size_t vertexFloats, const unsigned int* indices, size_t indexCount)
+{
+    GpuMesh mesh;
+    mesh.indexCount = (GLsizei)indexCount;
+    glGenVertexArrays(1, &mesh.VAO);
+    glGenBuffers(1, &mesh.VBO);
+    glGenBuffers(1, &mesh.EBO);
+
+    glBindVertexArray(mesh.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexFloats * sizeof(float), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+    // location 0: position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // location 1: "attr" = normal for sphere, color for tetra
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // the depth pre-pass's stream: tightly packed positions over the same indices
+    std::vector<float> positions(vertexFloats / 6 * 3);
+    for (size_t v = 0; v < vertexFloats / 6; ++v)
+        for (int c = 0; c < 3; ++c)
+            positions[v * 3 + c] = vertices[v * 6 + c];
+    glGenVertexArrays(1, &mesh.depthVAO);
+    glGenBuffers(1, &mesh.depthVBO);
+    glBindVertexArray(mesh.depthVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.depthVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+    return mesh;
+}
+
+static void DeleteMesh(GpuMesh& mesh)
+{
+    glDeleteBuffers(1, &mesh.VBO);
+    glDeleteBuffers(1, &mesh.depthVBO);
+    glDeleteBuffers(1, &mesh.EBO);
+    glDeleteVertexArrays(1, &mesh.VAO);
+    glDeleteVertexArrays(1, &mesh.depthVAO);
+}
+
+// GL thread: replay the merged, sorted packet stream; with CPU MVPs each
+// draw also gets its own in place of the shader's viewProj * model.
+// positionOnly draws from the meshes' depth pre-pass stream; a non-zero
+// conditions[object] query makes that object's draw conditional on it.
+static void ReplayPackets(const PacketStream& packets, const GpuMesh meshes[MESH_COUNT],
+    GLint objectTypeLoc, GLint modelLoc, GLint mvpLoc, bool positionOnly, const GLuint* conditions)
+{
+    int boundMaterial = -1;
+    int boundMesh = -1;
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        const DrawPacket* p = packets.packets[i];
+        if (p->material != boundMaterial)
+        {
+            boundMaterial = p->material;
+            glUniform1i(objectTypeLoc, boundMaterial);
+        }
+        if (p->mesh != boundMesh)
+        {
+            boundMesh = p->mesh;
+            glBindVertexArray(positionOnly ? meshes[boundMesh].depthVAO : meshes[boundMesh].VAO);
+        }
+        glUniformMatrix3x4fv(modelLoc, 1, GL_FALSE, &p->model.rows[0][0]);
+        if (packets.mvps)
+            glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, &packets.mvps[i][0][0]);
+        GLuint condition = conditions ? conditions[p->object] : 0;
+        if (condition)
+            glBeginConditionalRender(condition, GL_QUERY_NO_WAIT);
+        glDrawElements(GL_TRIANGLES, meshes[boundMesh].indexCount, GL_UNSIGNED_INT, 0);
+        if (condition)
+            glEndConditionalRender();
+    }
+    glBindVertexArray(0);
+}
+
+static size_t MaxTextureBufferTexels()
+{
+    GLint texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &texels);
+    return texels > 0 ? (size_t)texels : 65536;
+}
+
+// streams a frame's worth of data into a texture buffer (orphaning the old)
+static void UploadTextureBuffer(GLuint buffer, const void* data, size_t bytes)
+{
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max(bytes, (size_t)16), nullptr, GL_STREAM_DRAW);
+    if (bytes)
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+}
+
+// what fragment.frag and deferred.frag share
+static const char* const LIGHTING_LIBRARY = "lighting.glsl";
+
+// #define lines of the shader variants: SHADOWS adds the shadow map lookup
+// to the lighting, CPU_MVP takes gl_Position from the per-draw MVP
+static const char* Defines(bool shadows, bool cpuMvp)
+{
+    static const char* const DEFINES[2][2] = {
+        { nullptr, "#define CPU_MVP\n" },
+        { "#define SHADOWS\n", "#define SHADOWS\n#define CPU_MVP\n" },
+    };
+    return DEFINES[shadows][cpuMvp];
+}
+
+// ---------- SceneRenderer ----------
+
+SceneRenderer::SceneRenderer(const Scene& scene, JobSystem& jobs, const Vfs& files)
+    // ONE shader for everything
+    : scene(scene), files(files), shader(files, "vertex.vert", "fragment.frag", nullptr, LIGHTING_LIBRARY), pipeline(scene, jobs),
+      clusters(jobs, MaxTextureBufferTexels())
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    // ===================== SPHERE LODs (pos+normal) =====================
+    // generated on job threads, uploaded here once all are done
+    std::vector<float> spherePN[3];
+    std::vector<unsigned int> sphereIndices[3];
+    JobCounter sphereJobs;
+    for (int lod = 0; lod < 3; ++lod)
+    {
+        std::vector<float>* vertices = &spherePN[lod];
+        std::vector<unsigned int>* indices = &sphereIndices[lod];
+        const int* dims = SPHERE_LODS[lod];
+        jobs.Run(sphereJobs, [vertices, indices, dims]
+        {
+            GenerateSpherePN(SPHERE_RADIUS, dims[0], dims[1], *vertices, *indices);
+        });
+    }
+    jobs.Wait(sphereJobs);
+
+    for (int lod = 0; lod < 3; ++lod)
+        meshes[MESH_SPHERE_LOD0 + lod] = UploadMeshPN(spherePN[lod].data(), spherePN[lod].size(), sphereIndices[lod].data(), sphereIndices[lod].size());
+
+    // ===================== TETRAHEDRON (pos+color) =====================
+    meshes[MESH_TETRA] = UploadMeshPN(TETRA_VERTICES, 24, TETRA_INDICES, 12);
+
+    // ===================== VIEW (shared) =====================
+    view = glm::lookAt(
+        glm::vec3(0.0f, 0.0f, 8.0f),
+        glm::vec3(0.0f, 0.0f, -10.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f)
+    );
+    eye = glm::vec3(glm::inverse(view)[3]);
+    SceneBounds(scene, boundsCenter, boundsRadius);
+
+    // constant uniforms are set once; Render() only updates what changes
+    // per frame (no per-frame uniform name strings that could hit the heap)
+    forwardDraw = FindDrawUniforms(shader);
+
+    // ===================== CLUSTERED LIGHTS =====================
+    static const GLenum formats[LIGHT_BUFFERS] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+    glGenBuffers(LIGHT_BUFFERS, lightBuffers);
+    glGenTextures(LIGHT_BUFFERS, lightTextures);
+    for (int i = 0; i < LIGHT_BUFFERS; ++i)
+    {
+        UploadTextureBuffer(lightBuffers[i], nullptr, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, lightTextures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], lightBuffers[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    frameLights.resize(std::min(scene.lights.size(), MAX_CLUSTERED_LIGHTS));
+
+    forwardLighting = SetupLighting(shader);
+}
+
+SceneRenderer::~SceneRenderer()
+{
+    for (int i = 0; i < MESH_COUNT; ++i)
+        DeleteMesh(meshes[i]);
+    glDeleteTextures(LIGHT_BUFFERS, lightTextures);
+    glDeleteBuffers(LIGHT_BUFFERS, lightBuffers);
+    glDeleteProgram(shader.ID);
+    if (depthShader)
+        glDeleteProgram(depthShader->ID);
+    if (overdrawShader)
+        glDeleteProgram(overdrawShader->ID);
+    for (FragmentQueries& frame : fragmentQueries)
+        glDeleteQueries(FRAGMENT_PASSES, frame.queries);
+    if (deferredShader)
+    {
+        glDeleteProgram(gbufferShader->ID);
+        glDeleteProgram(deferredShader->ID);
+        glDeleteFramebuffers(1, &gbufferFbo);
+        glDeleteTextures(GBUFFER_TARGETS, gbufferTextures);
+        glDeleteVertexArrays(1, &fullscreenVao);
+    }
+}
+
+SceneRenderer::DrawUniforms SceneRenderer::FindDrawUniforms(const Shader& program)
+{
+    DrawUniforms u;
+    u.objectType = glGetUniformLocation(program.ID, "uObjectType");
+    u.model = glGetUniformLocation(program.ID, "model");
+    u.viewProj = glGetUniformLocation(program.ID, "viewProj");
+    u.mvp = glGetUniformLocation(program.ID, "mvp");
+    return u;
+}
+
+// Phong constants and the light buffers' texture units (1..3, leaving unit
+// 0 to ordinary 2D textures) of a program running the lighting math; leaves
+// it bound.
+SceneRenderer::LightingUniforms SceneRenderer::SetupLighting(const Shader& program)
+{
+    program.use();
+    program.setVec3("viewPos", glm::vec3(0.0f, 0.0f, 8.0f)); // camera position from lookAt
+    program.setVec3("lightColor", glm::vec3(1.0f));
+    program.setFloat("ambientStrength", 0.20f);
+    program.setFloat("diffuseStrength", 1.00f);
+    program.setFloat("specularStrength", 0.50f);
+    program.setFloat("shininess", 32.0f);
+
+    static const char* samplers[LIGHT_BUFFERS] = { "uLightData", "uClusterRanges", "uLightIndices" };
+    for (int i = 0; i < LIGHT_BUFFERS; ++i)
+        program.setInt(samplers[i], 1 + i);
+    program.setBool("uClusteredLights", !frameLights.empty());
+
+    LightingUniforms u;
+    u.lightPos = glGetUniformLocation(program.ID, "lightPos");
+    u.tileScale = glGetUniformLocation(program.ID, "uClusterTileScale");
+    u.slice = glGetUniformLocation(program.ID, "uClusterSlice");
+    u.depthRow = glGetUniformLocation(program.ID, "uClusterDepthRow");
+    u.directional = glGetUniformLocation(program.ID, "uDirectionalLight");
+    u.lightDir = glGetUniformLocation(program.ID, "lightDir");
+    u.shadow = ShadowMaps::FindUniforms(program);
+    return u;
+}
+
+// on the bound program
+void SceneRenderer::SetLighting(const LightingUniforms& u, const glm::vec3& lightPos, int width, int height)
+{
+    glUniform3fv(u.lightPos, 1, &lightPos[0]);
+    glUniform1i(u.directional, directionalLight ? 1 : 0);
+    glUniform3fv(u.lightDir, 1, &lightDirection[0]);
+    glm::vec4 depthRow(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+    ShadowMaps::Apply(u.shadow, shadowFrusta, depthRow);
+    if (frameLights.empty())
+        return;
+    glUniform2f(u.tileScale, (float)CLUSTER_TILES_X / width, (float)CLUSTER_TILES_Y / height);
+    glUniform2f(u.slice, clusters.sliceScale(), clusters.sliceBias());
+    glUniform4fv(u.depthRow, 1, &clusters.depthRow()[0]);
+}
+
+// once per frame instead of projection * view in every vertex (unused by
+// the CPU_MVP variant)
+void SceneRenderer::SetDraw(const DrawUniforms& u)
+{
+    glUniformMatrix4fv(u.viewProj, 1, GL_FALSE, &pipeline.viewProjection()[0][0]);
+}
+
+// rebuilds whichever programs exist so far, in the new variant
+void SceneRenderer::SetCpuMvp(bool enabled)
+{
+    if (enabled == cpuMvp)
+        return;
+    cpuMvp = enabled;
+    BuildForwardShader();
+    if (overdrawShader)
+        CreateDrawShader(overdrawShader, overdrawDraw, "vertex.vert", "overdraw.frag");
+    if (gbufferShader)
+        CreateDrawShader(gbufferShader, gbufferDraw, "vertex.vert", "gbuffer.frag");
+    if (depthShader)
+        CreateDrawShader(depthShader, depthDraw, "depth.vert", "depth.frag");
+}
+
+// a program without lighting, in the current CPU_MVP variant
+void SceneRenderer::CreateDrawShader(std::unique_ptr<Shader>& program, DrawUniforms& draw, const char* vertexPath, const char* fragmentPath)
+{
+    if (program)
+        glDeleteProgram(program->ID);
+    program.reset(new Shader(files, vertexPath, fragmentPath, Defines(false, cpuMvp)));
+    draw = FindDrawUniforms(*program);
+}
+
+void SceneRenderer::SetShadingMode(ShadingMode mode)
+{
+    shading = mode;
+    if (mode == SHADING_OVERDRAW && !overdrawShader)
+        CreateDrawShader(overdrawShader, overdrawDraw, "vertex.vert", "overdraw.frag");
+    if (mode != SHADING_DEFERRED || deferredShader)
+        return;
+
+    CreateDrawShader(gbufferShader, gbufferDraw, "vertex.vert", "gbuffer.frag");
+
+    CreateDeferredLighting();
+
+    glGenFramebuffers(1, &gbufferFbo);
+    glGenTextures(GBUFFER_TARGETS, gbufferTextures);
+    glGenVertexArrays(1, &fullscreenVao);
+}
+
+// the full-screen lighting program, with shadows or without
+void SceneRenderer::CreateDeferredLighting()
+{
+    if (deferredShader)
+        glDeleteProgram(deferredShader->ID);
+    deferredShader.reset(new Shader(files, "fullscreen.vert", "deferred.frag", Defines(shadowsEnabled, false), LIGHTING_LIBRARY));
+    deferredLighting = SetupLighting(*deferredShader);
+    // G-buffer on units 4..6, after the light buffers
+    deferredShader->setInt("uGNormal", 4 + GBUFFER_NORMAL);
+    deferredShader->setInt("uGAlbedo", 4 + GBUFFER_ALBEDO);
+    deferredShader->setInt("uGDepth", 4 + GBUFFER_DEPTH);
+    invViewProjLoc = glGetUniformLocation(deferredShader->ID, "uInvViewProj");
+    invViewportLoc = glGetUniformLocation(deferredShader->ID, "uInvViewport");
+}
+
+// Swaps the lighting programs for the variant with or without the shadow
+// lookup: behind a uniform branch it would still cost wherever both sides
+// run under a mask (llvmpipe does).
+void SceneRenderer::BuildLightingShaders()
+{
+    BuildForwardShader();
+    if (deferredShader)
+        CreateDeferredLighting();
+}
+
+void SceneRenderer::BuildForwardShader()
+{
+    glDeleteProgram(shader.ID);
+    shader = Shader(files, "vertex.vert", "fragment.frag", Defines(shadowsEnabled, cpuMvp), LIGHTING_LIBRARY);
+    forwardDraw = FindDrawUniforms(shader);
+    forwardLighting = SetupLighting(shader);
+}
+
+// the depth pre-pass's and the shadow maps' program
+void SceneRenderer::UseDepthShader()
+{
+    if (!depthShader)
+        CreateDrawShader(depthShader, depthDraw, "depth.vert", "depth.frag");
+}
+
+void SceneRenderer::SetDepthPrepass(bool enabled)
+{
+    prepass = enabled;
+    if (enabled)
+        UseDepthShader();
+}
+
+void SceneRenderer::SetShadows(bool enabled, int cascades)
+{
+    shadowCascades = std::max(1, std::min(cascades, ShadowFrusta::MAX_CASCADES));
+    if (enabled && !shadowMaps)
+    {
+        UseDepthShader();
+        shadowMaps.reset(new ShadowMaps());
+    }
+    if (enabled != shadowsEnabled)
+    {
+        shadowsEnabled = enabled;
+        BuildLightingShaders();
+    }
+}
+
+void SceneRenderer::SetShadowCaching(bool enabled)
+{
+    shadowCaching = enabled;
+    shadowCacheValid = false;
+}
+
+void SceneRenderer::SetCountFragments(bool enabled)
+{
+    countFragments = enabled;
+    if (occlusion)
+        occlusion->SetCollectStats(enabled);
+}
+
+void SceneRenderer::SetOcclusionQueries(bool enabled)
+{
+    occlusionCulling = enabled;
+    if (enabled && !occlusion)
+    {
+        occlusion.reset(new OcclusionQueries(scene.objects.size(), files));
+        occlusion->SetCollectStats(countFragments);
+    }
+}
+
+void SceneRenderer::Render(float t, int width, int height, FrameProfiler* profiler)
+{
+    if (countFragments)
+    {
+        FragmentQueries& frame = fragmentQueries[frameIndex++ % FRAGMENT_QUERY_FRAMES];
+        if (!frame.queries[0])
+            glGenQueries(FRAGMENT_PASSES, frame.queries);
+        CollectFragments(frame);
+    }
+
+    glViewport(0, 0, width, height);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+        (float)width / (float)height,
+        0.1f, 200.0f);
+
+    {
+        ProfileScope scope(profiler, "clear");
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // wiato kry po okrgu nad scen
+    float lightTime = fixedLightTime >= 0.0f ? fixedLightTime : t;
+    glm::vec3 lightPos;
+    lightPos.x = 6.0f * cos(lightTime);
+    lightPos.y = 4.0f;          // wysoko
+    lightPos.z = 6.0f * sin(lightTime) - 10.0f; // przesunicie w gb sceny (bo obiekty s przy z=-10)
+    lightDirection = glm::normalize(lightPos - boundsCenter);
+
+    // ---------- objects: recorded on workers, replayed here ----------
+    FrameParams frame;
+    frame.view = view;
+    frame.projection = projection;
+    frame.time = t;
+    frame.viewportHeight = height;
+    frame.computeMvp = cpuMvp;
+    frame.frontToBack = frontToBack;
+    frame.occlusionCulling = cpuOcclusion;
+
+    PacketStream packets;
+    {
+        ProfileScope scope(profiler, "record");
+        packets = pipeline.Record(frame);
+    }
+
+    drawConditions = nullptr;
+    if (occlusionCulling)
+    {
+        occlusion->BeginFrame();
+        drawConditions = occlusion->conditions();
+    }
+
+    if (!frameLights.empty())
+    {
+        ProfileScope scope(profiler, "light clusters");
+        UploadLights(t, projection);
+    }
+
+    shadowFrusta = ShadowFrusta();
+    shadowDrawCount = 0;
+    if (shadowsEnabled)
+        RenderShadows(lightPos, projection, width, height, profiler);
+
+    if (shading == SHADING_DEFERRED)
+    {
+        RenderDeferred(packets, lightPos, width, height, profiler);
+        return;
+    }
+
+    if (prepass)
+        DepthPrepass(packets, profiler);
+
+    const DrawUniforms& draw = shading == SHADING_OVERDRAW ? overdrawDraw : forwardDraw;
+    if (shading == SHADING_OVERDRAW)
+    {
+        overdrawShader->use();
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+    }
+    else
+    {
+        shader.use();
+        SetLighting(forwardLighting, lightPos, width, height);
+    }
+    SetDraw(draw);
+    {
+        ProfileScope scope(profiler, "scene pass");
+        BeginFragmentQuery(FRAGMENTS_COLOR);
+        ReplayPackets(packets, meshes, draw.objectType, draw.model, draw.mvp, false, drawConditions);
+        EndFragmentQuery();
+    }
+    EndColorPass();
+    glDisable(GL_BLEND);
+    IssueOcclusionQueries(packets, profiler);
+}
+
+// against the depth buffer just drawn, for the next frame's conditional draws
+void SceneRenderer::IssueOcclusionQueries(const PacketStream& packets, FrameProfiler* profiler)
+{
+    if (!occlusionCulling)
+        return;
+    ProfileScope scope(profiler, "occlusion queries");
+    occlusion->Issue(packets, scene, pipeline.viewProjection(), eye);
+}
+
+// Depth only, from the position-only stream with colour writes off; leaves
+// the depth test at GL_EQUAL with writes off for the colour pass.
+void SceneRenderer::DepthPrepass(const PacketStream& packets, FrameProfiler* profiler)
+{
+    ProfileScope scope(profiler, "depth pre-pass");
+    depthShader->use();
+    SetDraw(depthDraw);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    BeginFragmentQuery(FRAGMENTS_DEPTH);
+    ReplayPackets(packets, meshes, -1, depthDraw.model, depthDraw.mvp, true, drawConditions);
+    EndFragmentQuery();
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+}
+
+// back to the ordinary depth state after a pass that may have followed the pre-pass
+void SceneRenderer::EndColorPass()
+{
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
+
+// ---------- shadows ----------
+
+// Fits the maps to this frame's light, has the job threads cull the casters
+// of every map, then draws each map's casters into it with the depth-only
+// program and leaves the maps bound for the lighting passes. With the cache
+// the casters are only the moving ones, drawn over a copy of the rest.
+void SceneRenderer::RenderShadows(const glm::vec3& lightPos, const glm::mat4& projection, int width, int height, FrameProfiler* profiler)
+{
+    static const char* const CASCADE_SCOPES[ShadowFrusta::MAX_CASCADES] = {
+        "shadow cascade 0", "shadow cascade 1", "shadow cascade 2", "shadow cascade 3" };
+
+    ProfileScope scope(profiler, "shadows");
+    if (directionalLight)
+        shadowFrusta = FitShadowCascades(lightDirection, view, projection, boundsCenter, boundsRadius, shadowCascades, ShadowMaps::SIZE);
+    else
+        shadowFrusta = FitPointShadow(lightPos, boundsCenter, boundsRadius, ShadowMaps::SIZE);
+
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    depthShader->use();
+    if (shadowCaching && !ShadowCacheMatches())
+        UpdateShadowCache(profiler);
+
+    PacketStream casters[ShadowFrusta::MAX_MAPS];
+    {
+        ProfileScope casterScope(profiler, "shadow casters");
+        pipeline.RecordCasters(shadowFrusta.lightViewProj, shadowFrusta.count,
+            shadowCaching ? CASTERS_MOVING : CASTERS_ALL, casters);
+    }
+
+    for (int i = 0; i < shadowFrusta.count; ++i)
+    {
+        ProfileScope mapScope(profiler, directionalLight ? CASCADE_SCOPES[i] : "shadow map");
+        bool moving = casters[i].size() > 0;
+        if (!shadowCaching)
+            shadowMaps->BeginMap(i);
+        else if (!moving && mapIsCache[i])
+            continue;   // already the cache and nothing to add
+        else
+            shadowMaps->BeginMapFromCache(i);
+        mapIsCache[i] = shadowCaching && !moving;
+        DrawShadowCasters(casters[i], shadowFrusta.lightViewProj[i]);
+    }
+    shadowMaps->End((GLuint)target, width, height);
+    shadowMaps->Bind();
+}
+
+// the cache is for exactly this frame's maps
+bool SceneRenderer::ShadowCacheMatches() const
+{
+    if (!shadowCacheValid || cachedFrusta.count != shadowFrusta.count)
+        return false;
+    for (int i = 0; i < shadowFrusta.count; ++i)
+        if (cachedFrusta.lightViewProj[i] != shadowFrusta.lightViewProj[i])
+            return false;
+    return true;
+}
+
+// the static casters of every map into the cache
+void SceneRenderer::UpdateShadowCache(FrameProfiler* profiler)
+{
+    ProfileScope scope(profiler, "shadow cache");
+    PacketStream casters[ShadowFrusta::MAX_MAPS];
+    pipeline.RecordCasters(shadowFrusta.lightViewProj, shadowFrusta.count, CASTERS_STATIC, casters);
+    for (int i = 0; i < shadowFrusta.count; ++i)
+    {
+        shadowMaps->BeginCacheMap(i);
+        DrawShadowCasters(casters[i], shadowFrusta.lightViewProj[i]);
+        mapIsCache[i] = false;
+    }
+    cachedFrusta = shadowFrusta;
+    shadowCacheValid = true;
+    ++cacheUpdates;
+}
+
+// on the depth program, into the bound map
+void SceneRenderer::DrawShadowCasters(const PacketStream& casters, const glm::mat4& lightViewProj)
+{
+    glUniformMatrix4fv(depthDraw.viewProj, 1, GL_FALSE, &lightViewProj[0][0]);
+    ReplayPackets(casters, meshes, -1, depthDraw.model, depthDraw.mvp, true, nullptr);
+    shadowDrawCount += casters.size();
+}
+
+// ---------- fragment counters ----------
+
+void SceneRenderer::BeginFragmentQuery(int pass)
+{
+    if (!countFragments)
+        return;
+    FragmentQueries& frame = fragmentQueries[(frameIndex - 1) % FRAGMENT_QUERY_FRAMES];
+    glBeginQuery(GL_SAMPLES_PASSED, frame.queries[pass]);
+    frame.used[pass] = true;
+}
+
+void SceneRenderer::EndFragmentQuery()
+{
+    if (countFragments)
+        glEndQuery(GL_SAMPLES_PASSED);
+}
+
+// adds a slot's counts from FRAGMENT_QUERY_FRAMES frames ago; a frame the GPU
+// has not finished yet is dropped rather than waited for
+void SceneRenderer::CollectFragments(FragmentQueries& frame)
+{
+    bool any = false, available = true;
+    for (int pass = 0; pass < FRAGMENT_PASSES; ++pass)
+    {
+        if (!frame.used[pass])
+            continue;
+        GLuint ready = 0;
+        glGetQueryObjectuiv(frame.queries[pass], GL_QUERY_RESULT_AVAILABLE, &ready);
+        any = true;
+        available = available && ready;
+    }
+    if (any && available)
+    {
+        GLuint64 counts[FRAGMENT_PASSES] = {};
+        for (int pass = 0; pass < FRAGMENT_PASSES; ++pass)
+            if (frame.used[pass])
+                glGetQueryObjectui64v(frame.queries[pass], GL_QUERY_RESULT, &counts[pass]);
+        ++fragments.frames;
+        fragments.depthFragments += counts[FRAGMENTS_DEPTH];
+        fragments.colorFragments += counts[FRAGMENTS_COLOR];
+    }
+    for (bool& used : frame.used)
+        used = false;
+}
+
+// Moves the scene lights to time t, assigns them to froxels on the job
+// threads and streams lights, ranges and indices into their texture buffers.
+void SceneRenderer::UploadLights(float t, const glm::mat4& projection)
+{
+    for (size_t i = 0; i < frameLights.size(); ++i)
+    {
+        const SceneLight& light = scene.lights[i];
+        frameLights[i].position = LightPosition(light, t);
+        frameLights[i].range = light.range;
+        frameLights[i].color = light.color;
+        frameLights[i].pad = 0.0f;
+    }
+    clusters.Build(view, projection, frameLights.data(), frameLights.size());
+
+    UploadTextureBuffer(lightBuffers[LIGHT_DATA], frameLights.data(), frameLights.size() * sizeof(PointLight));
+    UploadTextureBuffer(lightBuffers[CLUSTER_RANGES], clusters.ranges(), CLUSTER_COUNT * 2 * sizeof(uint32_t));
+    UploadTextureBuffer(lightBuffers[LIGHT_INDICES], clusters.indices(), clusters.indexCount() * sizeof(uint16_t));
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    for (int i = 0; i < LIGHT_BUFFERS; ++i)
+    {
+        glActiveTexture(GL_TEXTURE1 + i);
+        glBindTexture(GL_TEXTURE_BUFFER, lightTextures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ---------- deferred ----------
+
+// The depth target matches the depth / stencil format of `target`, so it
+// can be blitted there for the lighting pass's depth test.
+void SceneRenderer::ResizeGBuffer(int width, int height, GLuint target)
+{
+    if (width == gbufferWidth && height == gbufferHeight)
+        return;
+    gbufferWidth = width;
+    gbufferHeight = height;
+
+    GLint stencilBits = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, target ? GL_DEPTH_ATTACHMENT : GL_DEPTH,
+        GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencilBits);
+    gbufferStencil = stencilBits > 0;
+
+    struct Target { GLenum internalFormat, format, type, attachment; };
+    const Target targets[GBUFFER_TARGETS] = {
+        { GL_RG16, GL_RG, GL_UNSIGNED_SHORT, GL_COLOR_ATTACHMENT0 },
+        { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT1 },
+        gbufferStencil
+            ? Target{ GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT }
+            : Target{ GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, GL_DEPTH_ATTACHMENT },
+    };
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+    for (int i = 0; i < GBUFFER_TARGETS; ++i)
+    {
+        glBindTexture(GL_TEXTURE_2D, gbufferTextures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, targets[i].internalFormat, width, height, 0, targets[i].format, targets[i].type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, targets[i].attachment, GL_TEXTURE_2D, gbufferTextures[i], 0);
+    }
+    static const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "G-buffer framebuffer incomplete\n";
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Geometry into the G-buffer, then the lights over it into whatever
+// framebuffer was bound. The G-buffer depth is copied there first: the
+// full-screen triangle sits on the far plane and passes GL_GREATER only where
+// something was drawn, so the background is never shaded and the target
+// keeps a valid depth buffer.
+void SceneRenderer::RenderDeferred(const PacketStream& packets, const glm::vec3& lightPos, int width, int height, FrameProfiler* profiler)
+{
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    ResizeGBuffer(width, height, (GLuint)target);
+
+    {
+        ProfileScope scope(profiler, "gbuffer pass");
+        glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (prepass)
+            DepthPrepass(packets, profiler);
+        gbufferShader->use();
+        SetDraw(gbufferDraw);
+        BeginFragmentQuery(FRAGMENTS_COLOR);
+        ReplayPackets(packets, meshes, gbufferDraw.objectType, gbufferDraw.model, gbufferDraw.mvp, false, drawConditions);
+        EndFragmentQuery();
+        EndColorPass();
+    }
+    IssueOcclusionQueries(packets, profiler);
+
+    {
+        ProfileScope scope(profiler, "lighting pass");
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)target);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)target);
+        deferredShader->use();
+        SetLighting(deferredLighting, lightPos, width, height);
+        glm::mat4 invViewProj = glm::inverse(pipeline.viewProjection());
+        glUniformMatrix4fv(invViewProjLoc, 1, GL_FALSE, &invViewProj[0][0]);
+        glUniform2f(invViewportLoc, 1.0f / width, 1.0f / height);
+        for (int i = 0; i < GBUFFER_TARGETS; ++i)
+        {
+            glActiveTexture(GL_TEXTURE4 + i);
+            glBindTexture(GL_TEXTURE_2D, gbufferTextures[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        glDepthFunc(GL_GREATER);
+        glDepthMask(GL_FALSE);
+        glBindVertexArray(fullscreenVao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+}
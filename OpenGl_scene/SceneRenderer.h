@@ -0,0 +1,262 @@
+#ifndef SCENE_RENDERER_H
+#define SCENE_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "FramePipeline.h"
+#include "FrameProfiler.h"
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "OcclusionQueries.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "Shader.h"
+#include "ShadowMaps.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// GL side of a MeshId
+struct GpuMesh
+{
+    unsigned int VAO, VBO, EBO;
+    GLsizei indexCount;
+    unsigned int depthVAO, depthVBO;    // positions only, same EBO, for the depth pre-pass
+};
+
+enum ShadingMode
+{
+    SHADING_FORWARD = 0,    // fragment.frag lights every fragment it draws
+    SHADING_DEFERRED,       // G-buffer pass, then one lighting pass per pixel
+    SHADING_OVERDRAW        // forward geometry, brighter the more fragments a pixel shaded
+};
+
+// GL_SAMPLES_PASSED totals over the frames read back so far (one or two
+// frames behind Render)
+struct FragmentStats
+{
+    uint64_t frames = 0;
+    uint64_t depthFragments = 0;    // depth pre-pass
+    uint64_t colorFragments = 0;    // forward / overdraw colour pass or G-buffer pass
+};
+
+// Everything the scene needs on the GL side: the shaders, uploaded meshes,
+// the recording pipeline and the clustered point lights. Independent of how
+// the context was created, so the GLFW window and the headless EGL path draw
+// exactly the same frame.
+class SceneRenderer
+{
+public:
+    // needs a current GL 3.3 context; every shader is looked up in `files`,
+    // which the renderer keeps (the working directory by default)
+    SceneRenderer(const Scene& scene, JobSystem& jobs, const Vfs& files = Vfs());
+    ~SceneRenderer();
+
+    SceneRenderer(const SceneRenderer&) = delete;
+    SceneRenderer& operator=(const SceneRenderer&) = delete;
+
+    // draws the scene at simulated time t into the bound framebuffer
+    void Render(float t, int width, int height, FrameProfiler* profiler);
+
+    // froxel assignment of the last frame with scene lights
+    const LightClusters& lightClusters() const { return clusters; }
+
+    // Have the pipeline compute each object's and each shadow caster's MVP on
+    // the job threads (batched SIMD) and upload it per draw, and switch the
+    // vertex shaders to their CPU_MVP variant: gl_Position is then a single
+    // matrix product. Pays off in the position-only passes (pre-pass, shadow
+    // maps); off by default, as the colour passes still need the world
+    // position for lighting.
+    void SetCpuMvp(bool enabled);
+
+    // Deferred: octahedral normals (RG16) and albedo (RGBA8) plus depth, lit
+    // by one full-screen pass with the same lights. Shaders and targets are
+    // created on first use.
+    void SetShadingMode(ShadingMode mode);
+    ShadingMode shadingMode() const { return shading; }
+
+    // G-buffer bytes per pixel: normal, albedo and 32-bit depth
+    static const int GBUFFER_BYTES_PER_PIXEL = 12;
+
+    // Lay down depth first with a position-only stream and no fragment
+    // work, then shade with GL_EQUAL so each pixel is shaded once.
+    void SetDepthPrepass(bool enabled);
+    bool depthPrepass() const { return prepass; }
+
+    // Sort the draws front to back by view depth instead of by material and
+    // mesh, so GL_LESS rejects hidden fragments early.
+    void SetFrontToBack(bool enabled) { frontToBack = enabled; }
+
+    // counts the fragments of the geometry passes with occlusion queries,
+    // and the objects SetOcclusionQueries hid
+    void SetCountFragments(bool enabled);
+    const FragmentStats& fragmentStats() const { return fragments; }
+
+    // Skip objects whose bounding box was hidden last frame, on the GPU
+    // (OcclusionQueries.h); the queries are created on first use.
+    void SetOcclusionQueries(bool enabled);
+    const OcclusionQueries* occlusionQueries() const { return occlusion.get(); }
+
+    // where the shaders came from, for the other loaders of the same assets
+    const Vfs& assets() const { return files; }
+
+    // Skip objects hidden behind the largest ones in view, decided on the
+    // job threads before anything is drawn (OcclusionCuller.h).
+    void SetCpuOcclusion(bool enabled) { cpuOcclusion = enabled; }
+    size_t cpuOccludedCount() const { return pipeline.occludedCount(); }
+
+    // Shadows of the key light (ShadowMaps.h): one map for the point light,
+    // or a cube of six when it is close to or among the objects, and
+    // `cascades` of them for the directional one, each drawing only the
+    // casters inside its light frustum (culled on the job threads). Created
+    // on first use.
+    void SetShadows(bool enabled, int cascades = ShadowFrusta::MAX_CASCADES);
+    bool shadows() const { return shadowsEnabled; }
+    // caster draws of the last frame's shadow maps, all maps together
+    size_t shadowDraws() const { return shadowDrawCount; }
+
+    // Light the scene like a sun from where the orbiting light is, toward
+    // the middle of the scene, in place of the point light.
+    void SetDirectionalLight(bool enabled) { directionalLight = enabled; }
+
+    // Keep the static casters (the objects that do not rotate) in a cached
+    // copy of the maps, redrawn only when the maps move with the light or
+    // InvalidateShadowCache() is called; each frame then only draws the
+    // moving casters over it, and leaves a map alone that has none.
+    void SetShadowCaching(bool enabled);
+    // call after moving a static object
+    void InvalidateShadowCache() { shadowCacheValid = false; }
+    // times the cache was redrawn
+    size_t shadowCacheUpdates() const { return cacheUpdates; }
+
+    // Hold the key light where it is at time t while the rest of the scene
+    // moves on with the frame time; negative: it orbits (the default).
+    void SetFixedLightTime(float t) { fixedLightTime = t; }
+
+private:
+    // uniforms the scene's vertex shader takes per frame and per draw
+    struct DrawUniforms
+    {
+        GLint objectType, model, viewProj, mvp;
+    };
+
+    // per-frame uniforms of a program that runs the lighting math
+    struct LightingUniforms
+    {
+        GLint lightPos, tileScale, slice, depthRow;
+        GLint directional, lightDir;
+        ShadowMaps::Uniforms shadow;
+    };
+
+    enum { GBUFFER_NORMAL = 0, GBUFFER_ALBEDO, GBUFFER_DEPTH, GBUFFER_TARGETS };
+
+    enum { FRAGMENTS_DEPTH = 0, FRAGMENTS_COLOR, FRAGMENT_PASSES };
+
+    // GL_SAMPLES_PASSED queries of one frame, read back FRAGMENT_QUERY_FRAMES later
+    static const int FRAGMENT_QUERY_FRAMES = 3;
+    struct FragmentQueries
+    {
+        GLuint queries[FRAGMENT_PASSES] = {};
+        bool used[FRAGMENT_PASSES] = {};
+    };
+
+    // light data, froxel ranges and light indices, as texture buffers
+    enum { LIGHT_DATA = 0, CLUSTER_RANGES, LIGHT_INDICES, LIGHT_BUFFERS };
+
+    static DrawUniforms FindDrawUniforms(const Shader& program);
+    LightingUniforms SetupLighting(const Shader& program);
+    void SetLighting(const LightingUniforms& u, const glm::vec3& lightPos, int width, int height);
+    void SetDraw(const DrawUniforms& u);
+
+    void UploadLights(float t, const glm::mat4& projection);
+    void UseDepthShader();
+    void CreateDrawShader(std::unique_ptr<Shader>& program, DrawUniforms& draw, const char* vertexPath, const char* fragmentPath);
+    void BuildForwardShader();
+    void BuildLightingShaders();
+    void CreateDeferredLighting();
+    void RenderShadows(const glm::vec3& lightPos, const glm::mat4& projection, int width, int height, FrameProfiler* profiler);
+    bool ShadowCacheMatches() const;
+    void UpdateShadowCache(FrameProfiler* profiler);
+    void DrawShadowCasters(const PacketStream& casters, const glm::mat4& lightViewProj);
+    void DepthPrepass(const PacketStream& packets, FrameProfiler* profiler);
+    void IssueOcclusionQueries(const PacketStream& packets, FrameProfiler* profiler);
+    void EndColorPass();
+    void BeginFragmentQuery(int pass);
+    void EndFragmentQuery();
+    void CollectFragments(FragmentQueries& frame);
+    void ResizeGBuffer(int width, int height, GLuint target);
+    void RenderDeferred(const PacketStream& packets, const glm::vec3& lightPos, int width, int height, FrameProfiler* profiler);
+
+    const Scene& scene;
+    Vfs files;
+    Shader shader;
+    GpuMesh meshes[MESH_COUNT];
+    FramePipeline pipeline;
+    glm::mat4 view;
+    glm::vec3 eye;
+    bool cpuMvp = false;
+    bool frontToBack = false;
+    bool cpuOcclusion = false;
+    bool prepass = false;
+    bool countFragments = false;
+    ShadingMode shading = SHADING_FORWARD;
+
+    LightClusters clusters;
+    std::vector<PointLight> frameLights;
+    GLuint lightBuffers[LIGHT_BUFFERS];
+    GLuint lightTextures[LIGHT_BUFFERS];
+
+    DrawUniforms forwardDraw;
+    LightingUniforms forwardLighting;
+
+    // deferred
+    std::unique_ptr<Shader> gbufferShader;
+    std::unique_ptr<Shader> deferredShader;
+    DrawUniforms gbufferDraw;
+    LightingUniforms deferredLighting;
+    GLint invViewProjLoc = -1;
+    GLint invViewportLoc = -1;
+    GLuint gbufferFbo = 0;
+    GLuint gbufferTextures[GBUFFER_TARGETS] = {};
+    GLuint fullscreenVao = 0;
+    int gbufferWidth = 0;
+    int gbufferHeight = 0;
+    bool gbufferStencil = false;    // D24S8 depth, to blit into a target that has stencil
+
+    // depth pre-pass, overdraw view
+    std::unique_ptr<Shader> depthShader;
+    std::unique_ptr<Shader> overdrawShader;
+    DrawUniforms depthDraw;
+    DrawUniforms overdrawDraw;
+
+    FragmentQueries fragmentQueries[FRAGMENT_QUERY_FRAMES];
+    unsigned int frameIndex = 0;
+    FragmentStats fragments;
+
+    std::unique_ptr<OcclusionQueries> occlusion;
+    bool occlusionCulling = false;
+    const GLuint* drawConditions = nullptr;     // this frame's, per object
+
+    // key light shadows
+    std::unique_ptr<ShadowMaps> shadowMaps;
+    ShadowFrusta shadowFrusta;                  // this frame's; count 0 = off
+    bool shadowsEnabled = false;
+    int shadowCascades = ShadowFrusta::MAX_CASCADES;
+    bool directionalLight = false;
+    glm::vec3 lightDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+    size_t shadowDrawCount = 0;
+    float fixedLightTime = -1.0f;
+
+    // static shadow cache
+    bool shadowCaching = false;
+    bool shadowCacheValid = false;
+    ShadowFrusta cachedFrusta;                  // the maps the cache was drawn for
+    bool mapIsCache[ShadowFrusta::MAX_MAPS] = {};  // live map holds just the cache's casters
+    size_t cacheUpdates = 0;
+};
+
+#endif
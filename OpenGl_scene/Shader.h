@@ -4,9 +4,9 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "FileView.h"
+
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
 
 class Shader
@@ -15,48 +15,45 @@ public:
     unsigned int ID;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
-    {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
+    // `defines` ("#define X\n" lines), if any, go right after each stage's
+    // #version line, for variants of one source; then, in the fragment stage
+    // only, the functions of `fragmentLibrary` several shaders share
+    Shader(const char* vertexPath, const char* fragmentPath, const char* defines = nullptr,
+        const char* fragmentLibrary = nullptr)
+        : Shader(Vfs(), vertexPath, fragmentPath, defines, fragmentLibrary)
+    {
+    }
+    // the same, with every path looked up in `files`
+    // ------------------------------------------------------------------------
+    Shader(const Vfs& files, const char* vertexPath, const char* fragmentPath, const char* defines = nullptr,
+        const char* fragmentLibrary = nullptr)
+        : Shader(files.Open(vertexPath), files.Open(fragmentPath), defines,
+            fragmentLibrary ? files.Open(fragmentLibrary) : FileView())
+    {
+    }
+    // sources read in place from mapped files, no copies
+    // ------------------------------------------------------------------------
+    Shader(const FileView& vertexFile, const FileView& fragmentFile, const char* defines = nullptr,
+        const FileView& fragmentLibrary = FileView())
+    {
+        // 1. point GL at the mapped source; the views are not NUL-terminated,
+        //    so the lengths go along with them
+        if (!vertexFile.valid() || !fragmentFile.valid())
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        const char* vShaderCode = vertexFile.data() ? (const char*)vertexFile.data() : "";
+        const char* fShaderCode = fragmentFile.data() ? (const char*)fragmentFile.data() : "";
+        GLint vShaderLength = (GLint)vertexFile.size();
+        GLint fShaderLength = (GLint)fragmentFile.size();
         // 2. compile shaders
         unsigned int vertex, fragment;
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        setSource(vertex, vShaderCode, vShaderLength, defines, FileView());
         glCompileShader(vertex);
         checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        setSource(fragment, fShaderCode, fShaderLength, defines, fragmentLibrary);
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
         // shader Program
@@ -136,6 +133,24 @@ public:
     }
 
 private:
+    // the source as up to four strings: the #version line, the defines, the
+    // library, the rest
+    // ------------------------------------------------------------------------
+    static void setSource(GLuint shader, const char* code, GLint length, const char* defines, const FileView& library)
+    {
+        if (!defines && !library.valid())
+        {
+            glShaderSource(shader, 1, &code, &length);
+            return;
+        }
+        GLint versionLength = 0;
+        while (versionLength < length && code[versionLength++] != '\n')
+            ;
+        const char* strings[4] = { code, defines ? defines : "",
+            library.data() ? (const char*)library.data() : "", code + versionLength };
+        GLint lengths[4] = { versionLength, -1, (GLint)library.size(), length - versionLength };
+        glShaderSource(shader, 4, strings, lengths);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,245 @@
+#include "ShadowMaps.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// a wider spot would spread the map too thin: the cube faces take over
+static const float MAX_SPOT_HALF_ANGLE = 1.3089969f;   // 75 degrees
+
+// tan of a cube face's half angle: 45 degrees plus a margin of a few texels
+// on each side for the PCF kernel
+static const float CUBE_FACE_TAN = 1.0f + 8.0f / 1024.0f;
+
+// share of the logarithmic split in the cascades' practical split scheme
+static const float CASCADE_LOG_WEIGHT = 0.75f;
+
+// receivers are looked up this many map texels out along their normal, so
+// a lit surface never compares against its own texel
+static const float NORMAL_OFFSET_TEXELS = 1.5f;
+
+// glPolygonOffset of the depth passes, on top of the normal offset
+static const float OFFSET_SLOPE = 2.0f;
+static const float OFFSET_UNITS = 4.0f;
+
+static glm::vec3 UpFor(const glm::vec3& direction)
+{
+    return std::fabs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+// ---------- fitting ----------
+
+ShadowFrusta FitPointShadow(const glm::vec3& lightPos, const glm::vec3& center, float radius, int mapSize)
+{
+    static const glm::vec3 CUBE_AXES[ShadowFrusta::CUBE_FACES] = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+
+    ShadowFrusta frusta;
+
+    glm::vec3 toCenter = center - lightPos;
+    float distance = glm::length(toCenter);
+    float farPlane = distance + radius;
+
+    if (distance > radius && std::asin(radius / distance) <= MAX_SPOT_HALF_ANGLE)
+    {
+        float halfAngle = std::asin(radius / distance);
+        glm::vec3 forward = toCenter / distance;
+        glm::mat4 view = glm::lookAt(lightPos, lightPos + forward, UpFor(forward));
+        glm::mat4 projection = glm::perspective(2.0f * halfAngle, 1.0f, std::max(0.1f, distance - radius), farPlane);
+        frusta.count = 1;
+        frusta.lightViewProj[0] = projection * view;
+        // a texel's world size grows with the distance from the light
+        frusta.normalOffset.x = NORMAL_OFFSET_TEXELS * 2.0f * std::tan(halfAngle) / (float)mapSize;
+        return frusta;
+    }
+
+    glm::mat4 projection = glm::perspective(2.0f * std::atan(CUBE_FACE_TAN), 1.0f, 0.1f, farPlane);
+    frusta.count = ShadowFrusta::CUBE_FACES;
+    for (int i = 0; i < ShadowFrusta::CUBE_FACES; ++i)
+        frusta.lightViewProj[i] = projection * glm::lookAt(lightPos, lightPos + CUBE_AXES[i], UpFor(CUBE_AXES[i]));
+    frusta.normalOffset.x = NORMAL_OFFSET_TEXELS * 2.0f * CUBE_FACE_TAN / (float)mapSize;
+    return frusta;
+}
+
+ShadowFrusta FitShadowCascades(const glm::vec3& lightDir, const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& center, float radius, int cascades, int mapSize)
+{
+    ShadowFrusta frusta;
+    frusta.directional = true;
+
+    // the camera's depth range, narrowed to the scene's
+    glm::vec4 depthRow(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+    float centerDepth = glm::dot(depthRow, glm::vec4(center, 1.0f));
+    float cameraNear = projection[3][2] / (projection[2][2] - 1.0f);
+    float cameraFar = projection[3][2] / (projection[2][2] + 1.0f);
+    float first = std::max(cameraNear, centerDepth - radius);
+    float last = std::min(cameraFar, centerDepth + radius);
+    if (last <= first)
+        return frusta;
+
+    cascades = std::max(1, std::min(cascades, ShadowFrusta::MAX_CASCADES));
+    frusta.count = cascades;
+
+    // corners of the slice at depth d are (+-d tanX, +-d tanY, -d)
+    float tanX = 1.0f / projection[0][0], tanY = 1.0f / projection[1][1];
+    float spread2 = tanX * tanX + tanY * tanY;
+    glm::mat4 invView = glm::inverse(view);
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -lightDir, UpFor(lightDir));
+
+    float begin = first;
+    for (int i = 0; i < cascades; ++i)
+    {
+        float k = (float)(i + 1) / (float)cascades;
+        float end = CASCADE_LOG_WEIGHT * first * std::pow(last / first, k)
+            + (1.0f - CASCADE_LOG_WEIGHT) * (first + (last - first) * k);
+
+        // the smallest sphere around the slice's 8 corners, centred on the
+        // view axis; its radius rounded up so the texel size stays put
+        float middle = std::min(0.5f * (begin + end) * (1.0f + spread2), end);
+        float sliceRadius = std::sqrt((end - middle) * (end - middle) + end * end * spread2);
+        sliceRadius = std::ceil(sliceRadius * 16.0f) / 16.0f;
+        glm::vec3 sliceCenter = glm::vec3(invView * glm::vec4(0.0f, 0.0f, -middle, 1.0f));
+
+        float texel = 2.0f * sliceRadius / (float)mapSize;
+        glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(sliceCenter, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+        lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+        // toward the light as far as anything in the scene could cast from
+        float back = std::max(sliceRadius, glm::dot(center - sliceCenter, lightDir) + radius);
+        float depth = -lightCenter.z;
+        glm::mat4 ortho = glm::ortho(lightCenter.x - sliceRadius, lightCenter.x + sliceRadius,
+            lightCenter.y - sliceRadius, lightCenter.y + sliceRadius, depth - back, depth + sliceRadius);
+
+        frusta.lightViewProj[i] = ortho * lightRotation;
+        frusta.cascadeEnds[i] = end;
+        frusta.normalOffset[i] = NORMAL_OFFSET_TEXELS * texel;
+        begin = end;
+    }
+    for (int i = cascades; i < ShadowFrusta::MAX_CASCADES; ++i)
+        frusta.cascadeEnds[i] = last;
+    return frusta;
+}
+
+// ---------- ShadowMaps ----------
+
+ShadowMaps::ShadowMaps()
+{
+    Create(LIVE);
+}
+
+ShadowMaps::~ShadowMaps()
+{
+    for (int set = 0; set < LAYER_SETS; ++set)
+    {
+        if (!textures[set])
+            continue;
+        glDeleteFramebuffers(1, &fbos[set]);
+        glDeleteTextures(1, &textures[set]);
+    }
+}
+
+void ShadowMaps::Create(int set)
+{
+    glGenTextures(1, &textures[set]);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textures[set]);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, SIZE, SIZE, ShadowFrusta::MAX_MAPS, 0,
+        GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    // linear + compare: each tap is already a 2x2 bilinear PCF
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    GLint previous = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    glGenFramebuffers(1, &fbos[set]);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[set]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[set], 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "shadow map framebuffer incomplete\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previous);
+}
+
+void ShadowMaps::BeginLayer(int set, int map)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[set]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[set], 0, map);
+    glViewport(0, 0, SIZE, SIZE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(OFFSET_SLOPE, OFFSET_UNITS);
+}
+
+void ShadowMaps::BeginMap(int map)
+{
+    BeginLayer(LIVE, map);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowMaps::BeginCacheMap(int map)
+{
+    if (!textures[CACHE])
+        Create(CACHE);
+    BeginLayer(CACHE, map);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowMaps::BeginMapFromCache(int map)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[CACHE]);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[CACHE], 0, map);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[LIVE]);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[LIVE], 0, map);
+    glBlitFramebuffer(0, 0, SIZE, SIZE, 0, 0, SIZE, SIZE, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    BeginLayer(LIVE, map);
+}
+
+void ShadowMaps::End(GLuint target, int width, int height)
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, width, height);
+}
+
+void ShadowMaps::Bind() const
+{
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textures[LIVE]);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+ShadowMaps::Uniforms ShadowMaps::FindUniforms(const Shader& program)
+{
+    program.use();
+    program.setInt("uShadowMap", TEXTURE_UNIT);
+    program.setInt("uShadowMaps", 0);
+    program.setFloat("uShadowTexel", 1.0f / (float)SIZE);
+
+    Uniforms u;
+    u.maps = glGetUniformLocation(program.ID, "uShadowMaps");
+    u.matrices = glGetUniformLocation(program.ID, "uShadowMatrices");
+    u.cascadeEnds = glGetUniformLocation(program.ID, "uCascadeEnds");
+    u.depthRow = glGetUniformLocation(program.ID, "uShadowDepthRow");
+    u.normalOffset = glGetUniformLocation(program.ID, "uShadowNormalOffset");
+    return u;
+}
+
+void ShadowMaps::Apply(const Uniforms& u, const ShadowFrusta& frusta, const glm::vec4& depthRow)
+{
+    glUniform1i(u.maps, frusta.count);
+    if (frusta.count == 0)
+        return;
+    glUniformMatrix4fv(u.matrices, frusta.count, GL_FALSE, &frusta.lightViewProj[0][0][0]);
+    glUniform4fv(u.cascadeEnds, 1, &frusta.cascadeEnds[0]);
+    glUniform4fv(u.depthRow, 1, &depthRow[0]);
+    glUniform4fv(u.normalOffset, 1, &frusta.normalOffset[0]);
+}
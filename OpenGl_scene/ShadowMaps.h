@@ -0,0 +1,105 @@
+#ifndef SHADOW_MAPS_H
+#define SHADOW_MAPS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+// ---------- shadow maps ----------
+// Light-space depth maps for the key light, as layers of one
+// GL_DEPTH_COMPONENT24 texture array sampled with hardware depth compare
+// (sampler2DArrayShadow) and a 3x3 PCF kernel in the lighting shaders.
+//
+// A point light well outside the scene's bounding sphere gets one
+// perspective map looking from the light at it. Closer in, or inside it, no
+// single spot covers the scene and the light gets CUBE_FACES maps instead,
+// one per axis direction, each a little wider than 90 degrees so the PCF
+// taps at a face's edge stay on it. A directional light gets up to MAX_CASCADES
+// orthographic cascades, each covering one slice of the camera's view depth
+// (practical split: log and linear blended) with its bounding sphere, so a
+// cascade's extent does not change as the camera turns; their origin is
+// snapped to whole texels so the maps do not shimmer as it moves. Every
+// cascade reaches back to the scene bounds toward the light, so casters
+// outside the view still shade what is in it.
+//
+// The fitting is plain math (no GL), filled into a ShadowFrusta; ShadowMaps
+// owns the texture and the framebuffer the depth passes draw into, plus, on
+// first use, a second array of the same layers caching what does not move.
+struct ShadowFrusta
+{
+    static constexpr int MAX_CASCADES = 4;
+    static constexpr int CUBE_FACES = 6;    // +x, -x, +y, -y, +z, -z
+    static constexpr int MAX_MAPS = CUBE_FACES;
+
+    int count = 0;                          // 0 = no shadows
+    bool directional = false;
+    glm::mat4 lightViewProj[MAX_MAPS];
+    glm::vec4 cascadeEnds = glm::vec4(0.0f);    // camera view depth where each cascade ends
+    glm::vec4 normalOffset = glm::vec4(0.0f);   // world units; per unit of distance to a point light
+};
+
+// the maps of a point light at lightPos over the sphere (center, radius): one
+// spot, or the cube faces when the light is too close for one
+ShadowFrusta FitPointShadow(const glm::vec3& lightPos, const glm::vec3& center, float radius, int mapSize);
+
+// `cascades` maps for light arriving along -lightDir, over the part of the
+// camera's view (view, symmetric perspective projection) that holds the
+// sphere (center, radius)
+ShadowFrusta FitShadowCascades(const glm::vec3& lightDir, const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& center, float radius, int cascades, int mapSize);
+
+class ShadowMaps
+{
+public:
+    static constexpr int SIZE = 1024;
+    static constexpr int TEXTURE_UNIT = 7;  // after the light buffers and the G-buffer
+
+    // needs a current GL 3.3 context
+    ShadowMaps();
+    ~ShadowMaps();
+
+    ShadowMaps(const ShadowMaps&) = delete;
+    ShadowMaps& operator=(const ShadowMaps&) = delete;
+
+    // Renders into layer `map`: binds the framebuffer, sets the viewport,
+    // clears depth and turns on the slope-scaled depth offset.
+    void BeginMap(int map);
+
+    // BeginMap for layer `map` of the cache instead
+    void BeginCacheMap(int map);
+
+    // BeginMap, but the layer starts out as a copy of the cache's (a depth
+    // blit) instead of cleared
+    void BeginMapFromCache(int map);
+
+    // back to `target` and its viewport, offset off
+    void End(GLuint target, int width, int height);
+
+    // the maps on TEXTURE_UNIT
+    void Bind() const;
+
+    // the shadow uniforms of a lighting program built with SHADOWS defined
+    // (all -1 without), "uShadowMap" set to TEXTURE_UNIT; leaves it bound
+    struct Uniforms
+    {
+        GLint maps, matrices, cascadeEnds, depthRow, normalOffset;
+    };
+    static Uniforms FindUniforms(const Shader& program);
+
+    // on the bound program; depthRow gives camera view depth = dot(row, world)
+    static void Apply(const Uniforms& u, const ShadowFrusta& frusta, const glm::vec4& depthRow);
+
+    GLuint texture() const { return textures[LIVE]; }
+
+private:
+    enum { LIVE = 0, CACHE, LAYER_SETS };
+
+    void Create(int set);
+    void BeginLayer(int set, int map);
+
+    GLuint textures[LAYER_SETS] = {};
+    GLuint fbos[LAYER_SETS] = {};
+};
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef SIMD8_H
+#define SIMD8_H
+
+#include <cmath>
+#include <cstdint>
+
+// ---------- 8-wide int32 / float lanes ----------
+// AVX2 when the compiler targets it (-march=native, /arch:AVX2), otherwise
+// two SSE2 halves, otherwise plain loops. Only the handful of operations the
+// software rasterizer, the mip filters and the block compressor need; masks
+// come back as 8-bit lane masks.
+
+#if defined(__AVX2__)
+#define SIMD8_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD8_SSE2 1
+#include <emmintrin.h>
+#endif
+
+struct I32x8
+{
+#if SIMD8_AVX2
+    __m256i v;
+#elif SIMD8_SSE2
+    __m128i lo, hi;
+#else
+    int32_t v[8];
+#endif
+
+    static I32x8 Set(int32_t x)
+    {
+        I32x8 r;
+#if SIMD8_AVX2
+        r.v = _mm256_set1_epi32(x);
+#elif SIMD8_SSE2
+        r.lo = r.hi = _mm_set1_epi32(x);
+#else
+        for (int i = 0; i < 8; ++i) r.v[i] = x;
+#endif
+        return r;
+    }
+
+    // base, base + step, ..., base + 7 * step
+    static I32x8 Ramp(int32_t base, int32_t step)
+    {
+        I32x8 r;
+#if SIMD8_AVX2
+        r.v = _mm256_setr_epi32(base, base + step, base + 2 * step, base + 3 * step,
+            base + 4 * step, base + 5 * step, base + 6 * step, base + 7 * step);
+#elif SIMD8_SSE2
+        r.lo = _mm_setr_epi32(base, base + step, base + 2 * step, base + 3 * step);
+        r.hi = _mm_add_epi32(r.lo, _mm_set1_epi32(4 * step));
+#else
+        for (int i = 0; i < 8; ++i) r.v[i] = base + i * step;
+#endif
+        return r;
+    }
+
+    void Store(int32_t* p) const
+    {
+#if SIMD8_AVX2
+        _mm256_storeu_si256((__m256i*)p, v);
+#elif SIMD8_SSE2
+        _mm_storeu_si128((__m128i*)p, lo);
+        _mm_storeu_si128((__m128i*)(p + 4), hi);
+#else
+        for (int i = 0; i < 8; ++i) p[i] = v[i];
+#endif
+    }
+};
+
+inline I32x8 operator+(const I32x8& a, const I32x8& b)
+{
+    I32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_add_epi32(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_add_epi32(a.lo, b.lo);
+    r.hi = _mm_add_epi32(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] + b.v[i];
+#endif
+    return r;
+}
+
+inline I32x8 operator|(const I32x8& a, const I32x8& b)
+{
+    I32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_or_si256(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_or_si128(a.lo, b.lo);
+    r.hi = _mm_or_si128(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] | b.v[i];
+#endif
+    return r;
+}
+
+// bit i set when lane i is negative
+inline int SignMask(const I32x8& a)
+{
+#if SIMD8_AVX2
+    return _mm256_movemask_ps(_mm256_castsi256_ps(a.v));
+#elif SIMD8_SSE2
+    return _mm_movemask_ps(_mm_castsi128_ps(a.lo)) | (_mm_movemask_ps(_mm_castsi128_ps(a.hi)) << 4);
+#else
+    int m = 0;
+    for (int i = 0; i < 8; ++i) m |= (a.v[i] < 0) << i;
+    return m;
+#endif
+}
+
+struct F32x8
+{
+#if SIMD8_AVX2
+    __m256 v;
+#elif SIMD8_SSE2
+    __m128 lo, hi;
+#else
+    float v[8];
+#endif
+
+    static F32x8 Set(float x)
+    {
+        F32x8 r;
+#if SIMD8_AVX2
+        r.v = _mm256_set1_ps(x);
+#elif SIMD8_SSE2
+        r.lo = r.hi = _mm_set1_ps(x);
+#else
+        for (int i = 0; i < 8; ++i) r.v[i] = x;
+#endif
+        return r;
+    }
+
+    static F32x8 Ramp(float base, float step)
+    {
+        F32x8 r;
+#if SIMD8_AVX2
+        r.v = _mm256_add_ps(_mm256_set1_ps(base),
+            _mm256_mul_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(step)));
+#elif SIMD8_SSE2
+        __m128 s = _mm_set1_ps(step);
+        r.lo = _mm_add_ps(_mm_set1_ps(base), _mm_mul_ps(_mm_setr_ps(0, 1, 2, 3), s));
+        r.hi = _mm_add_ps(_mm_set1_ps(base), _mm_mul_ps(_mm_setr_ps(4, 5, 6, 7), s));
+#else
+        for (int i = 0; i < 8; ++i) r.v[i] = base + i * step;
+#endif
+        return r;
+    }
+
+    static F32x8 Load(const float* p)
+    {
+        F32x8 r;
+#if SIMD8_AVX2
+        r.v = _mm256_loadu_ps(p);
+#elif SIMD8_SSE2
+        r.lo = _mm_loadu_ps(p);
+        r.hi = _mm_loadu_ps(p + 4);
+#else
+        for (int i = 0; i < 8; ++i) r.v[i] = p[i];
+#endif
+        return r;
+    }
+
+    void Store(float* p) const
+    {
+#if SIMD8_AVX2
+        _mm256_storeu_ps(p, v);
+#elif SIMD8_SSE2
+        _mm_storeu_ps(p, lo);
+        _mm_storeu_ps(p + 4, hi);
+#else
+        for (int i = 0; i < 8; ++i) p[i] = v[i];
+#endif
+    }
+};
+
+inline F32x8 operator+(const F32x8& a, const F32x8& b)
+{
+    F32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_add_ps(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_add_ps(a.lo, b.lo);
+    r.hi = _mm_add_ps(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] + b.v[i];
+#endif
+    return r;
+}
+
+inline F32x8 operator-(const F32x8& a, const F32x8& b)
+{
+    F32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_sub_ps(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_sub_ps(a.lo, b.lo);
+    r.hi = _mm_sub_ps(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] - b.v[i];
+#endif
+    return r;
+}
+
+inline F32x8 operator*(const F32x8& a, const F32x8& b)
+{
+    F32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_mul_ps(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_mul_ps(a.lo, b.lo);
+    r.hi = _mm_mul_ps(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] * b.v[i];
+#endif
+    return r;
+}
+
+inline F32x8 operator/(const F32x8& a, const F32x8& b)
+{
+    F32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_div_ps(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_div_ps(a.lo, b.lo);
+    r.hi = _mm_div_ps(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] / b.v[i];
+#endif
+    return r;
+}
+
+// round to nearest, ties to even (the default MXCSR mode; std::nearbyint)
+inline I32x8 RoundToInt(const F32x8& a)
+{
+    I32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_cvtps_epi32(a.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_cvtps_epi32(a.lo);
+    r.hi = _mm_cvtps_epi32(a.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = (int32_t)std::nearbyint(a.v[i]);
+#endif
+    return r;
+}
+
+inline F32x8 Max(const F32x8& a, const F32x8& b)
+{
+    F32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_max_ps(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_max_ps(a.lo, b.lo);
+    r.hi = _mm_max_ps(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+#endif
+    return r;
+}
+
+inline F32x8 Min(const F32x8& a, const F32x8& b)
+{
+    F32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_min_ps(a.v, b.v);
+#elif SIMD8_SSE2
+    r.lo = _mm_min_ps(a.lo, b.lo);
+    r.hi = _mm_min_ps(a.hi, b.hi);
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+#endif
+    return r;
+}
+
+// lane i: a[i] < b[i] ? x[i] : y[i]
+inline F32x8 SelectLess(const F32x8& a, const F32x8& b, const F32x8& x, const F32x8& y)
+{
+    F32x8 r;
+#if SIMD8_AVX2
+    r.v = _mm256_blendv_ps(y.v, x.v, _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ));
+#elif SIMD8_SSE2
+    __m128 lo = _mm_cmplt_ps(a.lo, b.lo), hi = _mm_cmplt_ps(a.hi, b.hi);
+    r.lo = _mm_or_ps(_mm_and_ps(lo, x.lo), _mm_andnot_ps(lo, y.lo));
+    r.hi = _mm_or_ps(_mm_and_ps(hi, x.hi), _mm_andnot_ps(hi, y.hi));
+#else
+    for (int i = 0; i < 8; ++i) r.v[i] = a.v[i] < b.v[i] ? x.v[i] : y.v[i];
+#endif
+    return r;
+}
+
+// bit i set when a[i] < b[i]
+inline int LessMask(const F32x8& a, const F32x8& b)
+{
+#if SIMD8_AVX2
+    return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ));
+#elif SIMD8_SSE2
+    return _mm_movemask_ps(_mm_cmplt_ps(a.lo, b.lo)) | (_mm_movemask_ps(_mm_cmplt_ps(a.hi, b.hi)) << 4);
+#else
+    int m = 0;
+    for (int i = 0; i < 8; ++i) m |= (a.v[i] < b.v[i]) << i;
+    return m;
+#endif
+}
+
+// p[i] = a[i] + a[i + 4]: folds two RGBA pixels into one
+inline void StoreHalfSum(const F32x8& a, float* p)
+{
+#if SIMD8_AVX2
+    _mm_storeu_ps(p, _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1)));
+#elif SIMD8_SSE2
+    _mm_storeu_ps(p, _mm_add_ps(a.lo, a.hi));
+#else
+    for (int i = 0; i < 4; ++i) p[i] = a.v[i] + a.v[i + 4];
+#endif
+}
+
+inline float HorizontalMax(const F32x8& a)
+{
+    float lanes[8];
+    a.Store(lanes);
+    float m = lanes[0];
+    for (int i = 1; i < 8; ++i)
+        m = lanes[i] > m ? lanes[i] : m;
+    return m;
+}
+
+#endif
@@ -0,0 +1,689 @@
+#include "SoftwareRenderer.h"
+#include "Mesh.h"
+#include "Simd8.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+static const int SUBPIXEL_BITS = 4;
+static const int SUBPIXEL = 1 << SUBPIXEL_BITS;
+
+// Vertices are clipped to +-GUARD_BAND pixels around the screen centre, which
+// keeps snapped coordinates under 2^18 and partial-block edge values in int32.
+static const float GUARD_BAND = 8192.0f;
+
+// clip planes, as outcode bits
+enum ClipPlane
+{
+    CLIP_RIGHT = 0, CLIP_LEFT, CLIP_TOP, CLIP_BOTTOM, CLIP_NEAR, CLIP_FAR,
+    CLIP_PLANE_COUNT
+};
+
+// a clipped triangle has at most 3 + one vertex per plane
+static const int MAX_CLIP_VERTICES = 3 + CLIP_PLANE_COUNT;
+
+// chunks per job thread: enough slack for stealing to even out LOD0 vs LOD2 draws
+static const unsigned int CHUNKS_PER_THREAD = 4;
+static const size_t MAX_CHUNKS = 256;
+
+// keeps ParallelFor well inside the job ring
+static size_t GrainFor(size_t count)
+{
+    const size_t MAX_JOBS = 1024;
+    return count > MAX_JOBS ? (count + MAX_JOBS - 1) / MAX_JOBS : 1;
+}
+
+// >= 0 inside
+static float PlaneDistance(const glm::vec4& c, int plane, float gx, float gy)
+{
+    switch (plane)
+    {
+    case CLIP_RIGHT:  return gx * c.w - c.x;
+    case CLIP_LEFT:   return gx * c.w + c.x;
+    case CLIP_TOP:    return gy * c.w - c.y;
+    case CLIP_BOTTOM: return gy * c.w + c.y;
+    case CLIP_NEAR:   return c.w + c.z;
+    default:          return c.w - c.z;
+    }
+}
+
+// floor(a / b) for b > 0
+static int32_t FloorDiv(int32_t a, int32_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static void ToStructureOfArrays(const float* interleaved, size_t vertexCount, std::vector<float>* out[6])
+{
+    size_t padded = (vertexCount + 7) & ~(size_t)7;
+    for (int c = 0; c < 6; ++c)
+    {
+        out[c]->assign(padded, 0.0f);
+        for (size_t v = 0; v < vertexCount; ++v)
+            (*out[c])[v] = interleaved[v * 6 + c];
+    }
+}
+
+static uint32_t PackColor(const glm::vec3& c)
+{
+    glm::vec3 v = glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return (uint32_t)v.r | ((uint32_t)v.g << 8) | ((uint32_t)v.b << 16) | 0xFF000000u;
+}
+
+// ---------- SoftwareRenderer ----------
+
+SoftwareRenderer::SoftwareRenderer(const Scene& scene, JobSystem& jobs)
+    : jobs(jobs), pipeline(scene, jobs), caches(jobs.threadCount())
+{
+    std::vector<float> interleaved;
+    std::vector<unsigned int> indices;
+    for (int id = 0; id < MESH_COUNT; ++id)
+    {
+        MeshData& mesh = meshes[id];
+        if (id == MESH_TETRA)
+        {
+            interleaved.assign(TETRA_VERTICES, TETRA_VERTICES + 24);
+            indices.assign(TETRA_INDICES, TETRA_INDICES + 12);
+        }
+        else
+        {
+            const int* dims = SPHERE_LODS[id - MESH_SPHERE_LOD0];
+            GenerateSpherePN(SPHERE_RADIUS, dims[0], dims[1], interleaved, indices);
+        }
+
+        std::vector<float>* columns[6] = { &mesh.px, &mesh.py, &mesh.pz, &mesh.ax, &mesh.ay, &mesh.az };
+        mesh.vertexCount = interleaved.size() / 6;
+        ToStructureOfArrays(interleaved.data(), mesh.vertexCount, columns);
+        mesh.indices = indices;
+    }
+
+    // same camera as SceneRenderer
+    view = glm::lookAt(
+        glm::vec3(0.0f, 0.0f, 8.0f),
+        glm::vec3(0.0f, 0.0f, -10.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f)
+    );
+}
+
+void SoftwareRenderer::Resize(int width, int height)
+{
+    if (width == fbWidth && height == fbHeight)
+        return;
+
+    fbWidth = width;
+    fbHeight = height;
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    stride = tilesX * TILE_SIZE;
+
+    size_t pixels = (size_t)stride * tilesY * TILE_SIZE;
+    color.assign(pixels, 0);
+    depth.assign(pixels, 1.0f);
+    blockMaxZ.assign(pixels / (BLOCK_SIZE * BLOCK_SIZE), 1.0f);
+
+    guardX = std::max(1.0f, GUARD_BAND / (0.5f * width));
+    guardY = std::max(1.0f, GUARD_BAND / (0.5f * height));
+}
+
+void SoftwareRenderer::Render(float t, int width, int height)
+{
+    Resize(width, height);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+        (float)width / (float)height,
+        0.1f, 200.0f);
+
+    // the orbit SceneRenderer feeds to lightPos
+    lightPos = glm::vec3(6.0f * std::cos(t), 4.0f, 6.0f * std::sin(t) - 10.0f);
+
+    FrameParams frame;
+    frame.view = view;
+    frame.projection = projection;
+    frame.time = t;
+    frame.viewportHeight = height;
+    frame.computeMvp = true;
+    packets = pipeline.Record(frame);
+
+    // ---------- front-end: one job per chunk of draws ----------
+    size_t drawCount = packets.size();
+    draws.resize(drawCount);
+    chunkCount = std::min(drawCount, std::min((size_t)jobs.threadCount() * CHUNKS_PER_THREAD, MAX_CHUNKS));
+    if (chunks.size() < chunkCount)
+        chunks.resize(chunkCount);
+    for (size_t c = 0; c < chunkCount; ++c)
+    {
+        chunks[c].firstDraw = drawCount * c / chunkCount;
+        chunks[c].endDraw = drawCount * (c + 1) / chunkCount;
+    }
+
+    auto setup = [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            SetupChunk(chunks[i]);
+    };
+    JobCounter frontEnd;
+    jobs.ParallelFor(frontEnd, chunkCount, 1, setup);
+    jobs.Wait(frontEnd);
+
+    frameStats = Stats();
+    for (size_t c = 0; c < chunkCount; ++c)
+    {
+        const Stats& s = chunks[c].stats;
+        frameStats.submittedTriangles += s.submittedTriangles;
+        frameStats.backfaceCulled += s.backfaceCulled;
+        frameStats.binnedTriangles += s.binnedTriangles;
+        frameStats.binEntries += s.binEntries;
+    }
+
+    // ---------- back-end: one job per tile ----------
+    auto raster = [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            RasterTile((int)i);
+    };
+    size_t tileCount = (size_t)tilesX * tilesY;
+    JobCounter tiles;
+    jobs.ParallelFor(tiles, tileCount, GrainFor(tileCount), raster);
+    jobs.Wait(tiles);
+}
+
+void SoftwareRenderer::SetupChunk(Chunk& chunk)
+{
+    chunk.triangles.clear();
+    chunk.entryTile.clear();
+    chunk.entryTriangle.clear();
+    chunk.stats = Stats();
+
+    VertexCache& cache = caches[JobSystem::ThreadIndex()];
+    for (size_t d = chunk.firstDraw; d < chunk.endDraw; ++d)
+    {
+        const DrawPacket& p = *packets.packets[d];
+        DrawInfo& info = draws[d];
+        info.material = p.material;
+        info.normalMatrix = NormalMatrix(p.model);
+
+        const MeshData& mesh = meshes[p.mesh];
+        TransformVertices(mesh, p.model, packets.mvps[d], cache);
+        chunk.stats.submittedTriangles += mesh.indices.size() / 3;
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            unsigned int idx[3] = { mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] };
+            int oa = cache.outcode[idx[0]];
+            int ob = cache.outcode[idx[1]];
+            int oc = cache.outcode[idx[2]];
+            if (oa & ob & oc)
+                continue;   // entirely outside one plane
+
+            if (oa | ob | oc)
+            {
+                ClipVertex v[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    unsigned int j = idx[k];
+                    v[k].clip = glm::vec4(cache.cx[j], cache.cy[j], cache.cz[j], cache.cw[j]);
+                    v[k].world = glm::vec3(cache.wx[j], cache.wy[j], cache.wz[j]);
+                    v[k].attr = glm::vec3(mesh.ax[j], mesh.ay[j], mesh.az[j]);
+                }
+                ClipTriangle(chunk, (uint32_t)d, v, oa | ob | oc);
+                continue;
+            }
+
+            // cull before gathering the rest of the vertex
+            int64_t area = (int64_t)(cache.sx[idx[1]] - cache.sx[idx[0]]) * (cache.sy[idx[2]] - cache.sy[idx[0]])
+                         - (int64_t)(cache.sy[idx[1]] - cache.sy[idx[0]]) * (cache.sx[idx[2]] - cache.sx[idx[0]]);
+            if (area <= 0)
+            {
+                chunk.stats.backfaceCulled += area < 0;
+                continue;
+            }
+
+            ScreenVertex s[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int j = idx[k];
+                s[k].sx = cache.sx[j];
+                s[k].sy = cache.sy[j];
+                s[k].z = cache.z[j];
+                s[k].invW = cache.invW[j];
+                s[k].world = glm::vec3(cache.wx[j], cache.wy[j], cache.wz[j]);
+                s[k].attr = glm::vec3(mesh.ax[j], mesh.ay[j], mesh.az[j]);
+            }
+            EmitTriangle(chunk, (uint32_t)d, s[0], s[1], s[2]);
+        }
+    }
+
+    // counting sort of the bin entries by tile; stable, so each tile sees
+    // its triangles in emission (= draw) order
+    size_t tileCount = (size_t)tilesX * tilesY;
+    size_t entries = chunk.entryTile.size();
+    chunk.tileStart.assign(tileCount + 1, 0);
+    for (size_t e = 0; e < entries; ++e)
+        ++chunk.tileStart[chunk.entryTile[e] + 1];
+    for (size_t t = 1; t <= tileCount; ++t)
+        chunk.tileStart[t] += chunk.tileStart[t - 1];
+
+    chunk.binned.resize(entries);
+    for (size_t e = 0; e < entries; ++e)
+        chunk.binned[chunk.tileStart[chunk.entryTile[e]]++] = chunk.entryTriangle[e];
+    for (size_t t = tileCount; t > 0; --t)
+        chunk.tileStart[t] = chunk.tileStart[t - 1];
+    chunk.tileStart[0] = 0;
+
+    chunk.stats.binEntries = entries;
+}
+
+// vertex stage, 8 vertices at a time
+void SoftwareRenderer::TransformVertices(const MeshData& mesh, const Affine3x4& model, const glm::mat4& mvp, VertexCache& cache) const
+{
+    size_t padded = mesh.px.size();
+    if (cache.cx.size() < padded)
+    {
+        for (std::vector<float>* v : { &cache.cx, &cache.cy, &cache.cz, &cache.cw, &cache.wx, &cache.wy, &cache.wz, &cache.z, &cache.invW })
+            v->resize(padded);
+        cache.sx.resize(padded);
+        cache.sy.resize(padded);
+        cache.outcode.resize(padded);
+    }
+
+    F32x8 m[4][4], w[4][3];
+    for (int c = 0; c < 4; ++c)
+    {
+        for (int r = 0; r < 4; ++r)
+            m[c][r] = F32x8::Set(mvp[c][r]);
+        for (int r = 0; r < 3; ++r)
+            w[c][r] = F32x8::Set(model.rows[r][c]);
+    }
+
+    const F32x8 half = F32x8::Set(0.5f);
+    const F32x8 one = F32x8::Set(1.0f);
+    const F32x8 zero = F32x8::Set(0.0f);
+    const F32x8 scaleX = F32x8::Set((float)(fbWidth * SUBPIXEL));
+    const F32x8 scaleY = F32x8::Set((float)(fbHeight * SUBPIXEL));
+    const F32x8 gx = F32x8::Set(guardX);
+    const F32x8 gy = F32x8::Set(guardY);
+
+    for (size_t v = 0; v < padded; v += 8)
+    {
+        F32x8 x = F32x8::Load(&mesh.px[v]);
+        F32x8 y = F32x8::Load(&mesh.py[v]);
+        F32x8 z = F32x8::Load(&mesh.pz[v]);
+
+        F32x8 cx = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+        F32x8 cy = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+        F32x8 cz = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+        F32x8 cw = m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3];
+        cx.Store(&cache.cx[v]);
+        cy.Store(&cache.cy[v]);
+        cz.Store(&cache.cz[v]);
+        cw.Store(&cache.cw[v]);
+
+        (w[0][0] * x + w[1][0] * y + w[2][0] * z + w[3][0]).Store(&cache.wx[v]);
+        (w[0][1] * x + w[1][1] * y + w[2][1] * z + w[3][1]).Store(&cache.wy[v]);
+        (w[0][2] * x + w[1][2] * y + w[2][2] * z + w[3][2]).Store(&cache.wz[v]);
+
+        // same operation order as Project(), so shared vertices snap identically
+        F32x8 iw = one / cw;
+        RoundToInt(((cx * iw) * half + half) * scaleX).Store(&cache.sx[v]);
+        RoundToInt((half - (cy * iw) * half) * scaleY).Store(&cache.sy[v]);
+        ((cz * iw) * half + half).Store(&cache.z[v]);
+        iw.Store(&cache.invW[v]);
+
+        // outcodes: one lane mask per plane, transposed to a bit per plane
+        int masks[CLIP_PLANE_COUNT] = {
+            LessMask(gx * cw - cx, zero),
+            LessMask(gx * cw + cx, zero),
+            LessMask(gy * cw - cy, zero),
+            LessMask(gy * cw + cy, zero),
+            LessMask(cw + cz, zero),
+            LessMask(cw - cz, zero),
+        };
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            int code = 0;
+            for (int plane = 0; plane < CLIP_PLANE_COUNT; ++plane)
+                code |= ((masks[plane] >> lane) & 1) << plane;
+            cache.outcode[v + lane] = code;
+        }
+    }
+}
+
+// Sutherland-Hodgman against the planes the triangle crosses, then a fan
+void SoftwareRenderer::ClipTriangle(Chunk& chunk, uint32_t draw, const ClipVertex (&v)[3], int planes) const
+{
+    ClipVertex buffers[2][MAX_CLIP_VERTICES];
+    ClipVertex* in = buffers[0];
+    ClipVertex* out = buffers[1];
+    in[0] = v[0]; in[1] = v[1]; in[2] = v[2];
+    int count = 3;
+    for (int plane = 0; plane < CLIP_PLANE_COUNT && count >= 3; ++plane)
+    {
+        if (!(planes & (1 << plane)))
+            continue;
+
+        int outCount = 0;
+        for (int k = 0; k < count; ++k)
+        {
+            const ClipVertex& v0 = in[k];
+            const ClipVertex& v1 = in[(k + 1) % count];
+            float d0 = PlaneDistance(v0.clip, plane, guardX, guardY);
+            float d1 = PlaneDistance(v1.clip, plane, guardX, guardY);
+            if (d0 >= 0.0f)
+                out[outCount++] = v0;
+            if ((d0 >= 0.0f) != (d1 >= 0.0f))
+            {
+                float s = d0 / (d0 - d1);
+                ClipVertex& c = out[outCount++];
+                c.clip = glm::mix(v0.clip, v1.clip, s);
+                c.world = glm::mix(v0.world, v1.world, s);
+                c.attr = glm::mix(v0.attr, v1.attr, s);
+            }
+        }
+        std::swap(in, out);
+        count = outCount;
+    }
+    if (count < 3)
+        return;
+
+    ScreenVertex s[MAX_CLIP_VERTICES];
+    for (int k = 0; k < count; ++k)
+        s[k] = Project(in[k]);
+    for (int k = 1; k + 1 < count; ++k)
+        EmitTriangle(chunk, draw, s[0], s[k], s[k + 1]);
+}
+
+SoftwareRenderer::ScreenVertex SoftwareRenderer::Project(const ClipVertex& v) const
+{
+    ScreenVertex s;
+    float iw = 1.0f / v.clip.w;
+    // window coordinates with y down, snapped to the subpixel grid
+    s.sx = (int32_t)std::nearbyint(((v.clip.x * iw) * 0.5f + 0.5f) * (float)(fbWidth * SUBPIXEL));
+    s.sy = (int32_t)std::nearbyint((0.5f - (v.clip.y * iw) * 0.5f) * (float)(fbHeight * SUBPIXEL));
+    s.z = (v.clip.z * iw) * 0.5f + 0.5f;
+    s.invW = iw;
+    s.world = v.world;
+    s.attr = v.attr;
+    return s;
+}
+
+void SoftwareRenderer::EmitTriangle(Chunk& chunk, uint32_t draw, const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c) const
+{
+    const ScreenVertex* v[3] = { &a, &b, &c };
+
+    // Both meshes wind their outside faces clockwise (GL_CW), which is a
+    // positive area with y down; the GL path draws the hidden back faces
+    // anyway but they never survive the depth test on closed meshes.
+    int64_t area = (int64_t)(b.sx - a.sx) * (c.sy - a.sy) - (int64_t)(b.sy - a.sy) * (c.sx - a.sx);
+    if (area <= 0)
+    {
+        chunk.stats.backfaceCulled += area < 0;
+        return;
+    }
+
+    Triangle tri;
+    int32_t minSx = std::min(a.sx, std::min(b.sx, c.sx));
+    int32_t maxSx = std::max(a.sx, std::max(b.sx, c.sx));
+    int32_t minSy = std::min(a.sy, std::min(b.sy, c.sy));
+    int32_t maxSy = std::max(a.sy, std::max(b.sy, c.sy));
+    tri.minX = std::max(0, FloorDiv(minSx - SUBPIXEL / 2, SUBPIXEL));
+    tri.minY = std::max(0, FloorDiv(minSy - SUBPIXEL / 2, SUBPIXEL));
+    tri.maxX = std::min(fbWidth - 1, FloorDiv(maxSx - SUBPIXEL / 2, SUBPIXEL));
+    tri.maxY = std::min(fbHeight - 1, FloorDiv(maxSy - SUBPIXEL / 2, SUBPIXEL));
+    if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+        return;     // misses every pixel centre
+
+    double invArea = 1.0 / (double)area;
+    for (int k = 0; k < 3; ++k)
+    {
+        // edge opposite vertex k
+        const ScreenVertex& vi = *v[(k + 1) % 3];
+        const ScreenVertex& vj = *v[(k + 2) % 3];
+        int32_t A = vi.sy - vj.sy;
+        int32_t B = vj.sx - vi.sx;
+        int64_t C = (int64_t)vi.sx * vj.sy - (int64_t)vi.sy * vj.sx;
+
+        if (k > 0)
+        {
+            // barycentric plane over pixel indices: centre = 16 * p + 8
+            double* plane = tri.bary[k - 1];
+            plane[0] = (double)A * SUBPIXEL * invArea;
+            plane[1] = (double)B * SUBPIXEL * invArea;
+            plane[2] = ((double)A * (SUBPIXEL / 2) + (double)B * (SUBPIXEL / 2) + (double)C) * invArea;
+        }
+
+        // top-left fill rule: pixels exactly on other edges belong to the neighbour
+        bool topLeft = A > 0 || (A == 0 && B > 0);
+        tri.edgeA[k] = A;
+        tri.edgeB[k] = B;
+        tri.edgeC[k] = topLeft ? C : C - 1;
+
+        tri.z[k] = v[k]->z;
+        tri.invW[k] = v[k]->invW;
+        tri.world[k] = v[k]->world;
+        tri.attr[k] = v[k]->attr;
+    }
+    tri.minZ = std::min(a.z, std::min(b.z, c.z));
+    tri.draw = draw;
+
+    uint32_t index = (uint32_t)chunk.triangles.size();
+    chunk.triangles.push_back(tri);
+    ++chunk.stats.binnedTriangles;
+
+    // ---------- binning ----------
+    int tx0 = tri.minX / TILE_SIZE, tx1 = tri.maxX / TILE_SIZE;
+    int ty0 = tri.minY / TILE_SIZE, ty1 = tri.maxY / TILE_SIZE;
+    for (int ty = ty0; ty <= ty1; ++ty)
+    {
+        for (int tx = tx0; tx <= tx1; ++tx)
+        {
+            // bigger triangles: drop tiles entirely outside one edge
+            bool outside = false;
+            if (tx0 != tx1 || ty0 != ty1)
+            {
+                for (int k = 0; k < 3 && !outside; ++k)
+                {
+                    int64_t dx = (int64_t)tri.edgeA[k] * SUBPIXEL * (TILE_SIZE - 1);
+                    int64_t dy = (int64_t)tri.edgeB[k] * SUBPIXEL * (TILE_SIZE - 1);
+                    int64_t e = tri.edgeA[k] * (int64_t)(tx * TILE_SIZE * SUBPIXEL + SUBPIXEL / 2)
+                              + tri.edgeB[k] * (int64_t)(ty * TILE_SIZE * SUBPIXEL + SUBPIXEL / 2) + tri.edgeC[k];
+                    outside = e + std::max<int64_t>(0, dx) + std::max<int64_t>(0, dy) < 0;
+                }
+            }
+            if (outside)
+                continue;
+            chunk.entryTile.push_back((uint32_t)(ty * tilesX + tx));
+            chunk.entryTriangle.push_back(index);
+        }
+    }
+}
+
+void SoftwareRenderer::RasterTile(int tile)
+{
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int x1 = x0 + TILE_SIZE - 1;
+    int y1 = y0 + TILE_SIZE - 1;
+
+    // clear, while the tile is in this core's cache anyway
+    for (int y = y0; y <= y1; ++y)
+    {
+        std::fill_n(&color[(size_t)y * stride + x0], TILE_SIZE, 0xFF000000u);
+        std::fill_n(&depth[(size_t)y * stride + x0], TILE_SIZE, 1.0f);
+    }
+    int blockStride = stride / BLOCK_SIZE;
+    for (int by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; ++by)
+        std::fill_n(&blockMaxZ[(size_t)by * blockStride + x0 / BLOCK_SIZE], TILE_SIZE / BLOCK_SIZE, 1.0f);
+
+    // chunks in order, each bin in order: packet order overall
+    for (size_t c = 0; c < chunkCount; ++c)
+    {
+        const Chunk& chunk = chunks[c];
+        for (uint32_t i = chunk.tileStart[tile]; i < chunk.tileStart[tile + 1]; ++i)
+        {
+            const Triangle& tri = chunk.triangles[chunk.binned[i]];
+            RasterTriangle(tri,
+                std::max(x0, tri.minX), std::max(y0, tri.minY),
+                std::min(x1, tri.maxX), std::min(y1, tri.maxY));
+        }
+    }
+}
+
+void SoftwareRenderer::RasterTriangle(const Triangle& tri, int x0, int y0, int x1, int y1)
+{
+    const int B = BLOCK_SIZE;
+    int blockStride = stride / B;
+    float dz1 = tri.z[1] - tri.z[0];
+    float dz2 = tri.z[2] - tri.z[0];
+
+    for (int by = y0 & ~(B - 1); by <= y1; by += B)
+    {
+        for (int bx = x0 & ~(B - 1); bx <= x1; bx += B)
+        {
+            // hierarchical Z: the whole triangle is behind this block
+            float& maxZ = blockMaxZ[(size_t)(by / B) * blockStride + bx / B];
+            if (tri.minZ >= maxZ)
+                continue;
+
+            // classify the block against each edge from its corner values
+            I32x8 rowE[3];
+            int32_t stepY[3];
+            bool rejected = false;
+            for (int k = 0; k < 3 && !rejected; ++k)
+            {
+                int64_t dx = (int64_t)tri.edgeA[k] * SUBPIXEL;
+                int64_t dy = (int64_t)tri.edgeB[k] * SUBPIXEL;
+                int64_t e = tri.edgeA[k] * (int64_t)(bx * SUBPIXEL + SUBPIXEL / 2)
+                          + tri.edgeB[k] * (int64_t)(by * SUBPIXEL + SUBPIXEL / 2) + tri.edgeC[k];
+                int64_t lo = e + std::min<int64_t>(0, dx * (B - 1)) + std::min<int64_t>(0, dy * (B - 1));
+                int64_t hi = e + std::max<int64_t>(0, dx * (B - 1)) + std::max<int64_t>(0, dy * (B - 1));
+                if (hi < 0)
+                    rejected = true;
+                else if (lo >= 0)
+                {
+                    // covers the block: never negative, no need to step it
+                    rowE[k] = I32x8::Set(0);
+                    stepY[k] = 0;
+                }
+                else
+                {
+                    // straddles the block, so every value here fits in int32
+                    rowE[k] = I32x8::Ramp((int32_t)e, (int32_t)dx);
+                    stepY[k] = (int32_t)dy;
+                }
+            }
+            if (rejected)
+                continue;
+
+            double b1 = tri.bary[0][0] * bx + tri.bary[0][1] * by + tri.bary[0][2];
+            double b2 = tri.bary[1][0] * bx + tri.bary[1][1] * by + tri.bary[1][2];
+            float b1dx = (float)tri.bary[0][0], b1dy = (float)tri.bary[0][1];
+            float b2dx = (float)tri.bary[1][0], b2dy = (float)tri.bary[1][1];
+            float zRow = (float)(tri.z[0] + dz1 * b1 + dz2 * b2);
+            float zdx = dz1 * b1dx + dz2 * b2dx;
+            float zdy = dz1 * b1dy + dz2 * b2dy;
+            float b1Row = (float)b1;
+            float b2Row = (float)b2;
+
+            bool wrote = false;
+            for (int r = 0; r < B; ++r)
+            {
+                int cover = ~SignMask(rowE[0] | rowE[1] | rowE[2]) & 0xFF;
+                if (cover)
+                {
+                    size_t offset = (size_t)(by + r) * stride + bx;
+                    float* depthRow = &depth[offset];
+                    F32x8 z = F32x8::Ramp(zRow, zdx);
+                    int pass = cover & LessMask(z, F32x8::Load(depthRow));
+                    if (pass)
+                    {
+                        float zLanes[8];
+                        z.Store(zLanes);
+                        uint32_t* colorRow = &color[offset];
+                        for (int lane = 0; lane < 8; ++lane)
+                        {
+                            if (!(pass & (1 << lane)))
+                                continue;
+                            depthRow[lane] = zLanes[lane];
+                            colorRow[lane] = Shade(tri, b1Row + b1dx * lane, b2Row + b2dx * lane);
+                        }
+                        wrote = true;
+                    }
+                }
+
+                rowE[0] = rowE[0] + I32x8::Set(stepY[0]);
+                rowE[1] = rowE[1] + I32x8::Set(stepY[1]);
+                rowE[2] = rowE[2] + I32x8::Set(stepY[2]);
+                zRow += zdy;
+                b1Row += b1dy;
+                b2Row += b2dy;
+            }
+
+            if (wrote)
+            {
+                F32x8 m = F32x8::Load(&depth[(size_t)by * stride + bx]);
+                for (int r = 1; r < B; ++r)
+                    m = Max(m, F32x8::Load(&depth[(size_t)(by + r) * stride + bx]));
+                maxZ = HorizontalMax(m);
+            }
+        }
+    }
+}
+
+// fragment.frag, per pixel
+uint32_t SoftwareRenderer::Shade(const Triangle& tri, float b1, float b2) const
+{
+    const DrawInfo& draw = draws[tri.draw];
+
+    // perspective-correct interpolation of the varyings
+    float b0 = 1.0f - b1 - b2;
+    float q0 = b0 * tri.invW[0];
+    float q1 = b1 * tri.invW[1];
+    float q2 = b2 * tri.invW[2];
+    float s = 1.0f / (q0 + q1 + q2);
+    glm::vec3 attr = (q0 * tri.attr[0] + q1 * tri.attr[1] + q2 * tri.attr[2]) * s;
+    glm::vec3 world = (q0 * tri.world[0] + q1 * tri.world[1] + q2 * tri.world[2]) * s;
+
+    if (draw.material == MAT_VERTEX_COLOR)
+        return PackColor(attr);
+
+    if (draw.material == MAT_COORD)
+        return PackColor(0.5f + 0.5f * glm::normalize(world));
+
+    // Phong, with the constants SceneRenderer sets
+    const glm::vec3 viewPos(0.0f, 0.0f, 8.0f);
+    const float ambientStrength = 0.20f;
+    const float diffuseStrength = 1.00f;
+    const float specularStrength = 0.50f;
+    const float shininess = 32.0f;
+
+    glm::vec3 N = glm::normalize(draw.normalMatrix * attr);
+    glm::vec3 L = glm::normalize(lightPos - world);
+    glm::vec3 V = glm::normalize(viewPos - world);
+
+    float diff = std::max(glm::dot(N, L), 0.0f);
+    glm::vec3 R = glm::reflect(-L, N);
+    float spec = std::pow(std::max(glm::dot(R, V), 0.0f), shininess);
+
+    float light = ambientStrength + diffuseStrength * diff + specularStrength * spec;
+    return PackColor(glm::vec3(light));
+}
+
+void SoftwareRenderer::ReadPixels(std::vector<unsigned char>& rgba) const
+{
+    rgba.resize((size_t)fbWidth * fbHeight * 4);
+    unsigned char* out = rgba.data();
+    for (int y = 0; y < fbHeight; ++y)
+    {
+        const uint32_t* row = &color[(size_t)y * stride];
+        for (int x = 0; x < fbWidth; ++x)
+        {
+            uint32_t c = row[x];
+            *out++ = (unsigned char)(c & 0xFF);
+            *out++ = (unsigned char)((c >> 8) & 0xFF);
+            *out++ = (unsigned char)((c >> 16) & 0xFF);
+            *out++ = (unsigned char)(c >> 24);
+        }
+    }
+}
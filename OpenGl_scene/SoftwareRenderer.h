@@ -0,0 +1,163 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <glm/glm.hpp>
+
+#include "FramePipeline.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+
+#include <cstdint>
+#include <vector>
+
+// ---------- SoftwareRenderer ----------
+// CPU reference for SceneRenderer: same meshes (interleaved pos + attr with
+// an index buffer), same recorded packets and the three fragment.frag modes
+// evaluated with glm. Needs no GL context.
+//
+// Front-end: the packet stream is cut into contiguous chunks of draws, one
+// job each. A chunk transforms its vertices 8 at a time (Simd8.h), clips
+// triangles that cross near/far or the guard band, snaps to 1/16 pixel,
+// culls back faces and bins every triangle into the 64x64 tiles it touches.
+// Bins live in the chunk, so binning needs no locks.
+//
+// Back-end: one job per tile walks the chunks in order, so draws keep packet
+// order and the image does not depend on the thread count. A tile walks 8x8
+// blocks with integer edge functions, trivially rejecting or accepting
+// blocks, and evaluates partial blocks 8 pixels at a time. Each block keeps
+// its max depth, so triangles behind everything already drawn there skip the
+// block (hierarchical Z).
+class SoftwareRenderer
+{
+public:
+    static constexpr int TILE_SIZE = 64;
+    static constexpr int BLOCK_SIZE = 8;
+
+    struct Stats
+    {
+        size_t submittedTriangles = 0;  // index count / 3 over all draws
+        size_t backfaceCulled = 0;
+        size_t binnedTriangles = 0;     // reached the rasterizer
+        size_t binEntries = 0;          // triangle-tile pairs
+    };
+
+    SoftwareRenderer(const Scene& scene, JobSystem& jobs);
+
+    SoftwareRenderer(const SoftwareRenderer&) = delete;
+    SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+    // draws the scene at simulated time t; the framebuffer follows width/height
+    void Render(float t, int width, int height);
+
+    // RGBA8, rows top to bottom, like HeadlessContext::ReadPixels
+    void ReadPixels(std::vector<unsigned char>& rgba) const;
+
+    int width() const { return fbWidth; }
+    int height() const { return fbHeight; }
+
+    // last frame
+    const Stats& stats() const { return frameStats; }
+
+private:
+    // structure of arrays, padded to a multiple of 8 vertices
+    struct MeshData
+    {
+        std::vector<float> px, py, pz;
+        std::vector<float> ax, ay, az;     // sphere: normal, tetra: color
+        std::vector<unsigned int> indices;
+        size_t vertexCount = 0;
+    };
+
+    // one draw's transformed vertices, per job thread
+    struct VertexCache
+    {
+        std::vector<float> cx, cy, cz, cw;  // clip space
+        std::vector<float> wx, wy, wz;      // world space
+        std::vector<int32_t> sx, sy;        // snapped window position
+        std::vector<float> z, invW;
+        std::vector<int32_t> outcode;       // bit per clip plane the vertex is outside of
+    };
+
+    struct ClipVertex
+    {
+        glm::vec4 clip;
+        glm::vec3 world;
+        glm::vec3 attr;
+    };
+
+    struct ScreenVertex
+    {
+        int32_t sx, sy;
+        float z, invW;
+        glm::vec3 world;
+        glm::vec3 attr;
+    };
+
+    // screen-space triangle, edges oriented so inside is >= 0
+    struct Triangle
+    {
+        int32_t minX, minY, maxX, maxY;     // pixel bounds, clamped to the screen
+        int32_t edgeA[3], edgeB[3];         // E(x, y) = A * x + B * y + C in 1/16 pixels
+        int64_t edgeC[3];
+        double bary[2][3];                  // b1, b2 = [0] * px + [1] * py + [2]
+        float z[3];                         // window depth
+        float invW[3];
+        float minZ;
+        uint32_t draw;
+        glm::vec3 world[3];
+        glm::vec3 attr[3];
+    };
+
+    struct DrawInfo
+    {
+        glm::mat3 normalMatrix;
+        uint8_t material;
+    };
+
+    // draws [firstDraw, endDraw) and everything binned from them
+    struct Chunk
+    {
+        size_t firstDraw = 0, endDraw = 0;
+        std::vector<Triangle> triangles;
+        std::vector<uint32_t> entryTile;    // triangle-tile pairs in emission order
+        std::vector<uint32_t> entryTriangle;
+        std::vector<uint32_t> tileStart;    // tileCount + 1 offsets into binned
+        std::vector<uint32_t> binned;       // triangle indices grouped by tile
+        Stats stats;
+    };
+
+    void Resize(int width, int height);
+    void SetupChunk(Chunk& chunk);
+    void TransformVertices(const MeshData& mesh, const Affine3x4& model, const glm::mat4& mvp, VertexCache& cache) const;
+    void ClipTriangle(Chunk& chunk, uint32_t draw, const ClipVertex (&v)[3], int planes) const;
+    ScreenVertex Project(const ClipVertex& v) const;
+    void EmitTriangle(Chunk& chunk, uint32_t draw, const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c) const;
+    void RasterTile(int tile);
+    void RasterTriangle(const Triangle& tri, int x0, int y0, int x1, int y1);
+    uint32_t Shade(const Triangle& tri, float b1, float b2) const;
+
+    JobSystem& jobs;
+    FramePipeline pipeline;
+    MeshData meshes[MESH_COUNT];
+
+    glm::mat4 view;
+    glm::vec3 lightPos;
+    float guardX = 1.0f, guardY = 1.0f;
+
+    // padded to whole tiles; ReadPixels crops
+    int fbWidth = 0, fbHeight = 0;
+    int stride = 0, tilesX = 0, tilesY = 0;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+    std::vector<float> blockMaxZ;
+
+    PacketStream packets;
+    std::vector<DrawInfo> draws;
+    std::vector<Chunk> chunks;
+    size_t chunkCount = 0;
+    std::vector<VertexCache> caches;    // per job thread
+    Stats frameStats;
+};
+
+#endif
@@ -0,0 +1,559 @@
+#include "TextureFile.h"
+#include "BlockCompress.h"
+#include "FileView.h"
+#include "JobSystem.h"
+#include "Simd8.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// EXT_texture_compression_s3tc / EXT_texture_sRGB; not in the core profile header
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// ---------- container ----------
+
+size_t TextureLevelSize(uint32_t format, int width, int height)
+{
+    switch (format)
+    {
+    case TEXTURE_FORMAT_RGBA8:
+        return (size_t)width * height * 4;
+    case TEXTURE_FORMAT_BC1:
+        return BlockCompressedSize(BLOCK_BC1, width, height);
+    case TEXTURE_FORMAT_BC3:
+        return BlockCompressedSize(BLOCK_BC3, width, height);
+    default:
+        return 0;
+    }
+}
+
+int TextureLevelCount(int width, int height)
+{
+    int count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        ++count;
+    }
+    return count;
+}
+
+static size_t AlignUp(size_t value)
+{
+    return (value + TEXTURE_FILE_ALIGNMENT - 1) & ~(size_t)(TEXTURE_FILE_ALIGNMENT - 1);
+}
+
+bool ParseTextureFile(const unsigned char* data, size_t size, TextureFileView& out)
+{
+    if (!data || size < sizeof(TextureFileHeader))
+        return false;
+
+    const TextureFileHeader* header = (const TextureFileHeader*)data;
+    if (header->magic != TEXTURE_FILE_MAGIC || header->version != TEXTURE_FILE_VERSION)
+        return false;
+    if (header->width == 0 || header->height == 0 || header->width > 32768 || header->height > 32768
+        || TextureLevelSize(header->format, 1, 1) == 0)
+        return false;
+    if (header->levelCount == 0 || header->levelCount > (uint32_t)TextureLevelCount(header->width, header->height))
+        return false;
+
+    size_t indexEnd = sizeof(TextureFileHeader) + (size_t)header->levelCount * sizeof(TextureFileLevel);
+    if (size < indexEnd)
+        return false;
+
+    const TextureFileLevel* levels = (const TextureFileLevel*)(data + sizeof(TextureFileHeader));
+    size_t begin = size, end = 0;
+    int w = (int)header->width, h = (int)header->height;
+    for (uint32_t i = 0; i < header->levelCount; ++i)
+    {
+        const TextureFileLevel& level = levels[i];
+        if (level.size != TextureLevelSize(header->format, w, h) || level.offset < indexEnd
+            || level.offset > size || level.size > size - level.offset)
+            return false;
+        begin = std::min(begin, (size_t)level.offset);
+        end = std::max(end, (size_t)(level.offset + level.size));
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+
+    out.header = header;
+    out.levels = levels;
+    out.data = data;
+    out.dataBegin = begin;
+    out.dataEnd = end;
+    return true;
+}
+
+bool WriteTextureFile(const char* path, const CookedTexture& texture)
+{
+    if (texture.levels.empty())
+        return false;
+
+    TextureFileHeader header = {};
+    header.magic = TEXTURE_FILE_MAGIC;
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = texture.format;
+    header.flags = texture.flags;
+    header.width = (uint32_t)texture.widths[0];
+    header.height = (uint32_t)texture.heights[0];
+    header.levelCount = (uint32_t)texture.levels.size();
+
+    // smallest level first, like KTX2: a partial read already has a usable chain
+    std::vector<TextureFileLevel> index(texture.levels.size());
+    size_t offset = AlignUp(sizeof(header) + index.size() * sizeof(TextureFileLevel));
+    for (size_t i = index.size(); i-- > 0;)
+    {
+        index[i].offset = offset;
+        index[i].size = texture.levels[i].size();
+        offset = AlignUp(offset + texture.levels[i].size());
+    }
+
+    FILE* f = std::fopen(path, "wb");
+    if (!f)
+        return false;
+
+    static const unsigned char zeros[TEXTURE_FILE_ALIGNMENT] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+        && std::fwrite(index.data(), sizeof(TextureFileLevel), index.size(), f) == index.size();
+    size_t written = sizeof(header) + index.size() * sizeof(TextureFileLevel);
+    for (size_t i = index.size(); ok && i-- > 0;)
+    {
+        size_t pad = (size_t)index[i].offset - written;
+        ok = std::fwrite(zeros, 1, pad, f) == pad
+            && std::fwrite(texture.levels[i].data(), 1, texture.levels[i].size(), f) == texture.levels[i].size();
+        written = (size_t)(index[i].offset + index[i].size);
+    }
+    return std::fclose(f) == 0 && ok;
+}
+
+// ---------- mip filtering ----------
+// Each level is filtered from the previous one: rows are widened to linear
+// floats, filtered horizontally (two taps per F32x8: the lanes hold two
+// neighbouring RGBA pixels), filtered vertically (8 floats of one row at a
+// time), then re-encoded. Edges clamp, like the streamer's box filter.
+
+static const int ENCODE_STEPS = 65536;
+
+struct MipTables
+{
+    float srgbToLinear[256];
+    unsigned char linearToSrgb[ENCODE_STEPS];
+    unsigned char linearToUnorm[ENCODE_STEPS];
+
+    MipTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < ENCODE_STEPS; ++i)
+        {
+            float l = (float)i / (ENCODE_STEPS - 1);
+            float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            linearToSrgb[i] = (unsigned char)std::lround(s * 255.0f);
+            linearToUnorm[i] = (unsigned char)std::lround(l * 255.0f);
+        }
+    }
+};
+
+static const MipTables& Tables()
+{
+    static const MipTables tables;
+    return tables;
+}
+
+// source pixel 2x + first + k feeds destination pixel x with weights[k]
+struct MipKernel
+{
+    int taps;
+    int first;
+    float weights[8];
+    F32x8 pairs[4];     // weights[2j] in lanes 0-3, weights[2j + 1] in lanes 4-7
+};
+
+static double BesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 30; ++k)
+    {
+        term *= (x * 0.5 / k) * (x * 0.5 / k);
+        sum += term;
+    }
+    return sum;
+}
+
+static MipKernel MakeKernel(MipFilter filter)
+{
+    MipKernel k = {};
+    if (filter == MIP_FILTER_BOX)
+    {
+        k.taps = 2;
+        k.first = 0;
+        k.weights[0] = k.weights[1] = 0.5f;
+    }
+    else
+    {
+        // sinc windowed by a Kaiser window (alpha 4) two destination pixels wide
+        // on either side; the source centres sit at +-0.25, +-0.75, ... of those
+        const double alpha = 4.0, radius = 2.0, pi = 3.14159265358979323846;
+        k.taps = 8;
+        k.first = -3;
+        double w[8], sum = 0.0;
+        for (int i = 0; i < 8; ++i)
+        {
+            double t = (i - 3.5) * 0.5;
+            double r = t / radius;
+            double window = BesselI0(alpha * std::sqrt(std::max(0.0, 1.0 - r * r))) / BesselI0(alpha);
+            w[i] = std::sin(pi * t) / (pi * t) * window;
+            sum += w[i];
+        }
+        for (int i = 0; i < 8; ++i)
+            k.weights[i] = (float)(w[i] / sum);
+    }
+
+    for (int j = 0; j < k.taps / 2; ++j)
+    {
+        float lanes[8];
+        for (int i = 0; i < 4; ++i)
+        {
+            lanes[i] = k.weights[2 * j];
+            lanes[i + 4] = k.weights[2 * j + 1];
+        }
+        k.pairs[j] = F32x8::Load(lanes);
+    }
+    return k;
+}
+
+static void DecodeRow(const unsigned char* src, int width, bool srgb, float* dst)
+{
+    const MipTables& t = Tables();
+    for (int x = 0; x < width * 4; x += 4)
+    {
+        for (int c = 0; c < 3; ++c)
+            dst[x + c] = srgb ? t.srgbToLinear[src[x + c]] : src[x + c] * (1.0f / 255.0f);
+        dst[x + 3] = src[x + 3] * (1.0f / 255.0f);
+    }
+}
+
+static void FilterRowH(const MipKernel& k, const float* src, int srcW, float* dst, int dstW)
+{
+    for (int x = 0; x < dstW; ++x)
+    {
+        int s0 = 2 * x + k.first;
+        if (s0 >= 0 && s0 + k.taps <= srcW)
+        {
+            F32x8 acc = F32x8::Load(src + s0 * 4) * k.pairs[0];
+            for (int j = 1; j < k.taps / 2; ++j)
+                acc = acc + F32x8::Load(src + (s0 + 2 * j) * 4) * k.pairs[j];
+            StoreHalfSum(acc, dst + x * 4);
+            continue;
+        }
+        float sum[4] = {};
+        for (int i = 0; i < k.taps; ++i)
+        {
+            const float* p = src + std::min(std::max(s0 + i, 0), srcW - 1) * 4;
+            for (int c = 0; c < 4; ++c)
+                sum[c] += p[c] * k.weights[i];
+        }
+        std::memcpy(dst + x * 4, sum, sizeof(sum));
+    }
+}
+
+static void FilterRowV(const MipKernel& k, const float* const* rows, int count, float* dst)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        F32x8 acc = F32x8::Load(rows[0] + i) * F32x8::Set(k.weights[0]);
+        for (int t = 1; t < k.taps; ++t)
+            acc = acc + F32x8::Load(rows[t] + i) * F32x8::Set(k.weights[t]);
+        acc.Store(dst + i);
+    }
+    for (; i < count; ++i)
+    {
+        float sum = 0.0f;
+        for (int t = 0; t < k.taps; ++t)
+            sum += rows[t][i] * k.weights[t];
+        dst[i] = sum;
+    }
+}
+
+// two pixels per F32x8; lanes 3 and 7 are alpha, which is never sRGB
+static void EncodeRow(const float* src, int width, bool srgb, unsigned char* dst)
+{
+    const MipTables& t = Tables();
+    const unsigned char* color = srgb ? t.linearToSrgb : t.linearToUnorm;
+    const F32x8 scale = F32x8::Set((float)(ENCODE_STEPS - 1));
+    int count = width * 4;
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        int32_t index[8];
+        RoundToInt(Max(F32x8::Load(src + i), F32x8::Set(0.0f)) * scale).Store(index);
+        for (int l = 0; l < 8; ++l)
+        {
+            int v = std::min(index[l], ENCODE_STEPS - 1);
+            dst[i + l] = (l & 3) == 3 ? t.linearToUnorm[v] : color[v];
+        }
+    }
+    for (; i < count; ++i)
+    {
+        float f = std::min(std::max(src[i], 0.0f), 1.0f);
+        int v = (int)std::lround(f * (ENCODE_STEPS - 1));
+        dst[i] = (i & 3) == 3 ? t.linearToUnorm[v] : color[v];
+    }
+}
+
+struct MipJob
+{
+    const MipKernel* kernel;
+    const unsigned char* src;
+    int srcW, srcH;
+    unsigned char* dst;
+    int dstW;
+    bool srgb;
+};
+
+// destination rows [y0, y1)
+static void FilterRows(const MipJob& job, int y0, int y1)
+{
+    const MipKernel& k = *job.kernel;
+    int lo = std::max(0, 2 * y0 + k.first);
+    int hi = std::min(job.srcH - 1, 2 * (y1 - 1) + k.first + k.taps - 1);
+
+    std::vector<float> wide((size_t)job.srcW * 4);
+    std::vector<float> narrow((size_t)(hi - lo + 1) * job.dstW * 4);
+    for (int y = lo; y <= hi; ++y)
+    {
+        DecodeRow(job.src + (size_t)y * job.srcW * 4, job.srcW, job.srgb, wide.data());
+        FilterRowH(k, wide.data(), job.srcW, &narrow[(size_t)(y - lo) * job.dstW * 4], job.dstW);
+    }
+
+    std::vector<float> out((size_t)job.dstW * 4);
+    const float* rows[8];
+    for (int y = y0; y < y1; ++y)
+    {
+        for (int t = 0; t < k.taps; ++t)
+        {
+            int s = std::min(std::max(2 * y + k.first + t, 0), job.srcH - 1);
+            rows[t] = &narrow[(size_t)(s - lo) * job.dstW * 4];
+        }
+        FilterRowV(k, rows, job.dstW * 4, out.data());
+        EncodeRow(out.data(), job.dstW, job.srgb, job.dst + (size_t)y * job.dstW * 4);
+    }
+}
+
+void CookTexture(JobSystem* jobs, const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb, CookedTexture& out)
+{
+    const MipKernel kernel = MakeKernel(filter);
+    Tables();   // built once, before any job needs them
+
+    out.format = TEXTURE_FORMAT_RGBA8;
+    out.flags = srgb ? (uint32_t)TEXTURE_FILE_SRGB : 0u;
+    int count = TextureLevelCount(width, height);
+    out.levels.assign(count, std::vector<unsigned char>());
+    out.widths.resize(count);
+    out.heights.resize(count);
+
+    out.widths[0] = width;
+    out.heights[0] = height;
+    out.levels[0].assign(rgba, rgba + (size_t)width * height * 4);
+    for (int i = 1; i < count; ++i)
+    {
+        int w = std::max(1, out.widths[i - 1] / 2);
+        int h = std::max(1, out.heights[i - 1] / 2);
+        out.widths[i] = w;
+        out.heights[i] = h;
+        out.levels[i].resize((size_t)w * h * 4);
+
+        MipJob job = { &kernel, out.levels[i - 1].data(), out.widths[i - 1], out.heights[i - 1], out.levels[i].data(), w, srgb };
+        if (jobs && jobs->threadCount() > 1 && h >= 32)
+        {
+            JobCounter counter;
+            size_t grain = std::max<size_t>(8, (size_t)(h + 255) / 256);
+            auto rows = [&job](size_t begin, size_t end) { FilterRows(job, (int)begin, (int)end); };
+            jobs->ParallelFor(counter, (size_t)h, grain, rows);
+            jobs->Wait(counter);
+        }
+        else
+            FilterRows(job, 0, h);
+    }
+}
+
+void CompressTexture(JobSystem* jobs, uint32_t format, CookedTexture& texture)
+{
+    if (texture.format != TEXTURE_FORMAT_RGBA8 || (format != TEXTURE_FORMAT_BC1 && format != TEXTURE_FORMAT_BC3))
+        return;
+    BlockFormat blocks = format == TEXTURE_FORMAT_BC1 ? BLOCK_BC1 : BLOCK_BC3;
+    for (size_t i = 0; i < texture.levels.size(); ++i)
+    {
+        std::vector<unsigned char> encoded(BlockCompressedSize(blocks, texture.widths[i], texture.heights[i]));
+        CompressBlocks(jobs, blocks, texture.levels[i].data(), texture.widths[i], texture.heights[i], encoded.data());
+        texture.levels[i].swap(encoded);
+    }
+    texture.format = format;
+}
+
+// ---------- loading ----------
+
+GLenum TextureInternalFormat(uint32_t format, uint32_t flags)
+{
+    bool srgb = (flags & TEXTURE_FILE_SRGB) != 0;
+    switch (format)
+    {
+    case TEXTURE_FORMAT_BC1:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case TEXTURE_FORMAT_BC3:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:
+        return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    }
+}
+
+static bool HasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool TextureFormatSupported(uint32_t format, uint32_t flags)
+{
+    if (format == TEXTURE_FORMAT_RGBA8)
+        return true;
+    if (format != TEXTURE_FORMAT_BC1 && format != TEXTURE_FORMAT_BC3)
+        return false;
+    return HasExtension("GL_EXT_texture_compression_s3tc")
+        && (!(flags & TEXTURE_FILE_SRGB) || HasExtension("GL_EXT_texture_sRGB"));
+}
+
+// the RGBA8 fallback: expand the blocks on the CPU, specify from client memory
+static void UploadExpanded(const TextureFileView& view)
+{
+    const TextureFileHeader& header = *view.header;
+    BlockFormat blocks = header.format == TEXTURE_FORMAT_BC1 ? BLOCK_BC1 : BLOCK_BC3;
+    GLenum internalFormat = TextureInternalFormat(TEXTURE_FORMAT_RGBA8, header.flags);
+    std::vector<unsigned char> rgba((size_t)header.width * header.height * 4);
+    int w = (int)header.width, h = (int)header.height;
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        DecompressBlocks(blocks, view.data + view.levels[i].offset, w, h, rgba.data());
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+}
+
+GLuint LoadTextureFile(const char* path, TextureLoadStats* stats, const Vfs& files)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    FileView file = files.Open(path);
+    TextureFileView view;
+    if (!file.valid() || !ParseTextureFile(file.data(), file.size(), view))
+    {
+        std::printf("Failed to load cooked texture %s\n", path);
+        return 0;
+    }
+    Clock::time_point mapped = Clock::now();
+
+    const TextureFileHeader& header = *view.header;
+    if (!TextureFormatSupported(header.format, header.flags))
+    {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        UploadExpanded(view);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)header.levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, header.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (stats)
+        {
+            *stats = TextureLoadStats();
+            stats->mapSeconds = std::chrono::duration<double>(mapped - start).count();
+            stats->uploadSeconds = std::chrono::duration<double>(Clock::now() - mapped).count();
+        }
+        return texture;
+    }
+
+    // one copy, straight from the page cache into GL's buffer
+    size_t bytes = view.dataEnd - view.dataBegin;
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes, NULL, GL_STREAM_DRAW);
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    const unsigned char* base = NULL;   // level offsets relative to the bound buffer
+    if (dst)
+    {
+        std::memcpy(dst, view.data + view.dataBegin, bytes);
+        if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+            dst = NULL;
+    }
+    if (!dst)
+    {
+        // no buffer after all: specify the levels from the mapping itself
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        base = view.data + view.dataBegin;
+    }
+    Clock::time_point copied = Clock::now();
+
+    GLenum internalFormat = TextureInternalFormat(header.format, header.flags);
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    int w = (int)header.width, h = (int)header.height;
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        size_t offset = (size_t)view.levels[i].offset - view.dataBegin;
+        const void* pixels = base ? (const void*)(base + offset) : (const void*)offset;
+        if (header.format == TEXTURE_FORMAT_RGBA8)
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        else
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, w, h, 0, (GLsizei)view.levels[i].size, pixels);
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)header.levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, header.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // the texture keeps what it needs; the buffer is freed once GL is done with it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+
+    if (stats)
+    {
+        Clock::time_point done = Clock::now();
+        stats->bytes = bytes;
+        stats->mapSeconds = std::chrono::duration<double>(mapped - start).count();
+        stats->copySeconds = std::chrono::duration<double>(copied - mapped).count();
+        stats->uploadSeconds = std::chrono::duration<double>(done - copied).count();
+    }
+    return texture;
+}
@@ -0,0 +1,124 @@
+#ifndef TEXTURE_FILE_H
+#define TEXTURE_FILE_H
+
+#include <glad/glad.h>
+
+#include "FileView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// ---------- cooked textures ----------
+// GPU-ready texture container written by the texcook tool, laid out like a
+// cut-down KTX2: header, one index entry per mip level (level 0 first), then
+// the level data smallest level first, in the exact layout glTexImage2D or
+// glCompressedTexImage2D takes (RGBA8 rows or S3TC blocks). Loading is a
+// mapping plus a memcpy into a pixel unpack buffer; nothing is decoded or
+// filtered at run time.
+const uint32_t TEXTURE_FILE_MAGIC = 0x43584554;    // "TEXC"
+const uint32_t TEXTURE_FILE_VERSION = 1;
+const uint32_t TEXTURE_FILE_ALIGNMENT = 16;         // every level starts on this
+
+enum TextureFileFormat : uint32_t
+{
+    TEXTURE_FORMAT_RGBA8 = 1,
+    TEXTURE_FORMAT_BC1 = 2,     // BlockCompress.h, opaque
+    TEXTURE_FORMAT_BC3 = 3,
+};
+
+enum TextureFileFlags : uint32_t
+{
+    TEXTURE_FILE_SRGB = 1,      // color channels are sRGB encoded; sample as GL_SRGB8_ALPHA8
+};
+
+struct TextureFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;        // TextureFileFormat
+    uint32_t flags;         // TextureFileFlags
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct TextureFileLevel
+{
+    uint64_t offset;        // from the start of the file
+    uint64_t size;
+};
+
+struct TextureFileView
+{
+    const TextureFileHeader* header = nullptr;
+    const TextureFileLevel* levels = nullptr;   // levelCount entries, level 0 first
+    const unsigned char* data = nullptr;        // the whole file
+
+    // every level's bytes sit in [dataBegin, dataEnd), one contiguous block
+    size_t dataBegin = 0, dataEnd = 0;
+};
+
+// bytes of one level of `format` at the given size; 0 for an unknown format
+size_t TextureLevelSize(uint32_t format, int width, int height);
+
+// full chain down to 1x1
+int TextureLevelCount(int width, int height);
+
+// points `out` into data; false on a bad header, an unknown format or a
+// level that is missing, misplaced or the wrong size
+bool ParseTextureFile(const unsigned char* data, size_t size, TextureFileView& out);
+
+// ---------- cooking ----------
+enum MipFilter
+{
+    MIP_FILTER_BOX,         // 2x2 average
+    MIP_FILTER_KAISER,      // 8x8 Kaiser-windowed sinc, sharper minification
+};
+
+struct CookedTexture
+{
+    uint32_t format = TEXTURE_FORMAT_RGBA8;
+    uint32_t flags = 0;
+    std::vector<std::vector<unsigned char>> levels;     // level 0 first, in `format`
+    std::vector<int> widths, heights;
+};
+
+// Builds the mip chain of an RGBA8 image. Filtering happens in linear light
+// (sRGB images are decoded first and re-encoded after), on 8 floats at a time;
+// each level's rows are split over the job threads when `jobs` is given.
+// Must then be called from a job thread.
+void CookTexture(JobSystem* jobs, const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb, CookedTexture& out);
+
+// Re-encodes every RGBA8 level as BC1 or BC3 blocks (see BlockCompress.h);
+// same threading rules as CookTexture
+void CompressTexture(JobSystem* jobs, uint32_t format, CookedTexture& texture);
+
+bool WriteTextureFile(const char* path, const CookedTexture& texture);
+
+// ---------- loading ----------
+struct TextureLoadStats
+{
+    uint64_t bytes = 0;
+    double mapSeconds = 0.0;        // open + map + parse
+    double copySeconds = 0.0;       // memcpy into the unpack buffer
+    double uploadSeconds = 0.0;     // gl(Compressed)TexImage2D calls sourcing from it
+};
+
+GLenum TextureInternalFormat(uint32_t format, uint32_t flags);
+
+// whether the current context samples `format` directly: BC formats need
+// EXT_texture_compression_s3tc (and EXT_texture_sRGB with the sRGB flag)
+bool TextureFormatSupported(uint32_t format, uint32_t flags);
+
+// Creates a mipmapped texture from a cooked file (looked up in `files`):
+// the level data is copied into a pixel unpack buffer with one memcpy
+// straight out of the mapping and every level is specified from it. Block-compressed files the context
+// cannot sample are expanded to RGBA8 on the CPU instead. 0 (and a message)
+// on failure. Leaves GL_TEXTURE_2D and GL_PIXEL_UNPACK_BUFFER unbound.
+GLuint LoadTextureFile(const char* path, TextureLoadStats* stats = nullptr, const Vfs& files = Vfs());
+
+#endif
@@ -0,0 +1,441 @@
+#include "TextureStreamer.h"
+#include "BlockCompress.h"
+#include "TextureFile.h"
+
+// declarations only, the implementation lives in ImageDecode.cpp
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+static const unsigned char PLACEHOLDER[4] = { 128, 128, 128, 255 };
+
+// 2x2 box filter, odd edges clamp (the last row / column is reused)
+static void Downsample(const unsigned char* src, int srcW, int srcH, unsigned char* dst, int dstW, int dstH)
+{
+    for (int y = 0; y < dstH; ++y)
+    {
+        const unsigned char* row0 = src + (size_t)std::min(2 * y, srcH - 1) * srcW * 4;
+        const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, srcH - 1) * srcW * 4;
+        for (int x = 0; x < dstW; ++x)
+        {
+            int x0 = std::min(2 * x, srcW - 1) * 4;
+            int x1 = std::min(2 * x + 1, srcW - 1) * 4;
+            for (int c = 0; c < 4; ++c)
+                dst[((size_t)y * dstW + x) * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+// RGBA8 levels upload in pixel rows, block-compressed ones in rows of 4x4 blocks
+TextureStreamer::Level TextureStreamer::MakeLevel(int width, int height, size_t offset, int blockBytes)
+{
+    Level level = { width, height, offset, (size_t)width * 4, height };
+    if (blockBytes)
+    {
+        level.rowBytes = (size_t)((width + 3) / 4) * blockBytes;
+        level.rows = (height + 3) / 4;
+    }
+    return level;
+}
+
+// ---------- TextureStreamer ----------
+
+TextureStreamer::TextureStreamer(JobSystem& jobs, size_t bufferSize, int bufferCount, bool compress, const Vfs& files)
+    : staging(std::max(1, bufferCount)), stagingSize(bufferSize), files(files), jobs(jobs)
+{
+    s3tc = TextureFormatSupported(TEXTURE_FORMAT_BC3, 0);
+    s3tcSrgb = TextureFormatSupported(TEXTURE_FORMAT_BC3, TEXTURE_FILE_SRGB);
+    compressImages = compress && s3tc;
+
+    for (Staging& s : staging)
+    {
+        glGenBuffers(1, &s.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)stagingSize, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // queued decodes return at once now; without workers they run here
+    closing.store(true, std::memory_order_relaxed);
+    while (!decodeJobs.done())
+    {
+        if (!jobs.RunBackgroundJob())
+            std::this_thread::yield();
+    }
+
+    for (Staging& s : staging)
+    {
+        if (s.fence)
+            glDeleteSync(s.fence);
+        glDeleteBuffers(1, &s.buffer);
+    }
+    for (std::unique_ptr<Entry>& e : entries)
+        glDeleteTextures(1, &e->texture);
+}
+
+GLuint TextureStreamer::Request(const char* path)
+{
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->path = path;
+
+    GLint previous = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    glGenTextures(1, &entry->texture);
+    glBindTexture(GL_TEXTURE_2D, entry->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+
+    Entry* queued = entry.get();
+    decoding.push_back(queued);
+    entries.push_back(std::move(entry));
+    jobs.RunInBackground(decodeJobs, [this, queued] { DecodeJob(*queued); });
+    return queued->texture;
+}
+
+void TextureStreamer::DecodeJob(Entry& entry)
+{
+    if (closing.load(std::memory_order_relaxed))
+    {
+        entry.state.store(STATE_FAILED, std::memory_order_release);
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = Decode(entry);
+    if (ok)
+    {
+        decodeNanoseconds.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        size_t bytes = 0;
+        for (const Level& level : entry.levels)
+            bytes += level.rowBytes * level.rows;
+        decodedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    entry.state.store(ok ? STATE_DECODED : STATE_FAILED, std::memory_order_release);
+}
+
+bool TextureStreamer::Decode(Entry& entry) const
+{
+    FileView file = files.Open(entry.path.c_str());
+    if (!file.valid() || file.size() == 0 || file.size() > 0x7FFFFFFF)
+    {
+        std::printf("Failed to read texture %s\n", entry.path.c_str());
+        return false;
+    }
+    if (file.size() >= sizeof(uint32_t) && *(const uint32_t*)file.data() == TEXTURE_FILE_MAGIC)
+    {
+        entry.file = std::move(file);
+        return MapCooked(entry);
+    }
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char* rgba = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 4);
+    if (!rgba)
+    {
+        std::printf("Failed to decode texture %s: %s\n", entry.path.c_str(), stbi_failure_reason());
+        return false;
+    }
+
+    // full chain down to 1x1, level 0 first
+    size_t total = 0;
+    for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+    {
+        entry.levels.push_back(MakeLevel(w, h, total, 0));
+        total += (size_t)w * h * 4;
+        if (w == 1 && h == 1)
+            break;
+    }
+
+    entry.pixels.resize(total);
+    std::memcpy(entry.pixels.data(), rgba, (size_t)width * height * 4);
+    stbi_image_free(rgba);
+    for (size_t i = 1; i < entry.levels.size(); ++i)
+    {
+        const Level& src = entry.levels[i - 1];
+        const Level& dst = entry.levels[i];
+        Downsample(&entry.pixels[src.offset], src.width, src.height, &entry.pixels[dst.offset], dst.width, dst.height);
+    }
+    entry.source = entry.pixels.data();
+    if (compressImages)
+        Compress(entry);
+    return true;
+}
+
+// BC1 when every texel is opaque, BC3 otherwise; a quarter / half the bytes to upload
+void TextureStreamer::Compress(Entry& entry) const
+{
+    BlockFormat format = IsOpaque(entry.source, entry.levels[0].width, entry.levels[0].height) ? BLOCK_BC1 : BLOCK_BC3;
+    size_t total = 0;
+    for (const Level& level : entry.levels)
+        total += BlockCompressedSize(format, level.width, level.height);
+
+    std::vector<unsigned char> blocks(total);
+    size_t offset = 0;
+    for (Level& level : entry.levels)
+    {
+        CompressBlocks(nullptr, format, entry.source + level.offset, level.width, level.height, &blocks[offset]);
+        level = MakeLevel(level.width, level.height, offset, BlockBytes(format));
+        offset += level.rowBytes * level.rows;
+    }
+    entry.pixels.swap(blocks);
+    entry.source = entry.pixels.data();
+    entry.blockBytes = BlockBytes(format);
+    entry.internalFormat = TextureInternalFormat(format == BLOCK_BC1 ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_BC3, 0);
+}
+
+bool TextureStreamer::MapCooked(Entry& entry) const
+{
+    TextureFileView view;
+    if (!ParseTextureFile(entry.file.data(), entry.file.size(), view)
+        || view.header->levelCount != (uint32_t)TextureLevelCount(view.header->width, view.header->height))
+    {
+        std::printf("Failed to load cooked texture %s\n", entry.path.c_str());
+        return false;
+    }
+
+    const TextureFileHeader& header = *view.header;
+    bool srgb = (header.flags & TEXTURE_FILE_SRGB) != 0;
+    bool blocks = header.format != TEXTURE_FORMAT_RGBA8;
+    bool expand = blocks && !(srgb ? s3tcSrgb : s3tc);
+    BlockFormat blockFormat = header.format == TEXTURE_FORMAT_BC1 ? BLOCK_BC1 : BLOCK_BC3;
+
+    // the chain must reach 1x1: uploads start from the last level
+    int w = (int)header.width, h = (int)header.height;
+    size_t expanded = 0;
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        if (expand)
+        {
+            entry.levels.push_back(MakeLevel(w, h, expanded, 0));
+            expanded += (size_t)w * h * 4;
+        }
+        else
+            entry.levels.push_back(MakeLevel(w, h, (size_t)view.levels[i].offset, blocks ? BlockBytes(blockFormat) : 0));
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+
+    if (expand)
+    {
+        // no S3TC here: decode the blocks and stream RGBA8 like a decoded image
+        entry.pixels.resize(expanded);
+        for (uint32_t i = 0; i < header.levelCount; ++i)
+        {
+            const Level& level = entry.levels[i];
+            DecompressBlocks(blockFormat, view.data + view.levels[i].offset, level.width, level.height, &entry.pixels[level.offset]);
+        }
+        entry.file = FileView();
+        entry.source = entry.pixels.data();
+        entry.internalFormat = TextureInternalFormat(TEXTURE_FORMAT_RGBA8, header.flags);
+        return true;
+    }
+
+    entry.source = entry.file.data();
+    entry.blockBytes = blocks ? BlockBytes(blockFormat) : 0;
+    entry.internalFormat = TextureInternalFormat(header.format, header.flags);
+    return true;
+}
+
+void TextureStreamer::SpecifyLevel(const Entry& entry, int index, const unsigned char* pixels)
+{
+    const Level& level = entry.levels[index];
+    if (entry.blockBytes)
+        glCompressedTexImage2D(GL_TEXTURE_2D, index, entry.internalFormat, level.width, level.height, 0,
+            (GLsizei)(level.rowBytes * level.rows), pixels);
+    else
+        glTexImage2D(GL_TEXTURE_2D, index, entry.internalFormat, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+void TextureStreamer::Update(size_t budgetBytes)
+{
+    // no workers to take the decodes: one per frame here
+    if (jobs.threadCount() == 1)
+        jobs.RunBackgroundJob();
+
+    // pick up finished decodes, in whatever order the jobs finished them
+    for (size_t i = 0; i < decoding.size();)
+    {
+        Entry* e = decoding[i];
+        int state = e->state.load(std::memory_order_acquire);
+        if (state == STATE_QUEUED)
+        {
+            ++i;
+            continue;
+        }
+        if (state == STATE_DECODED)
+        {
+            e->level = (int)e->levels.size() - 1;
+            e->row = 0;
+            e->state.store(STATE_UPLOADING, std::memory_order_relaxed);
+            uploadQueue.push_back(e);
+        }
+        else
+            ++failedCount;  // keeps the placeholder
+        decoding[i] = decoding.back();
+        decoding.pop_back();
+    }
+
+    if (uploadQueue.empty())
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GLint previous = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+
+    size_t budget = budgetBytes;
+    while (!uploadQueue.empty() && budget > 0)
+    {
+        if (!UploadRows(*uploadQueue.front(), budget))
+            break;
+        uploadQueue.pop_front();
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+    // fences are polled without GL_SYNC_FLUSH_COMMANDS_BIT, so submit them here
+    glFlush();
+    uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// true once the whole entry is uploaded; false when out of budget or staging
+bool TextureStreamer::UploadRows(Entry& entry, size_t& budget)
+{
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    int last = (int)entry.levels.size() - 1;
+    if (entry.level == last && entry.row == 0)
+    {
+        // Allocate the whole chain in order (defining levels one by one,
+        // smallest first, loses data on Mesa) and fill the 1x1 level right
+        // away, so base..max is complete from the start.
+        for (int i = 0; i <= last; ++i)
+            SpecifyLevel(entry, i, i == last ? entry.source + entry.levels[i].offset : NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+        size_t bytes = entry.levels[last].rowBytes;
+        uploadedBytes += bytes;
+        budget -= std::min(budget, bytes);
+        entry.row = 1;
+    }
+
+    while (budget > 0)
+    {
+        const Level& level = entry.levels[entry.level];
+        if (entry.row == level.rows)
+        {
+            // level complete: sample from it from now on
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.level);
+            if (entry.level == 0)
+            {
+                std::vector<unsigned char>().swap(entry.pixels);
+                entry.file = FileView();
+                entry.source = nullptr;
+                entry.state.store(STATE_RESIDENT, std::memory_order_relaxed);
+                ++residentCount;
+                return true;
+            }
+            --entry.level;
+            entry.row = 0;
+            continue;
+        }
+
+        size_t rowBytes = level.rowBytes;
+        int rows = std::min(level.rows - entry.row, (int)std::max<size_t>(1, stagingSize / rowBytes));
+        size_t bytes = rowBytes * rows;
+        const unsigned char* src = entry.source + level.offset + rowBytes * entry.row;
+
+        Staging* slot = nullptr;
+        if (rowBytes <= stagingSize && !AcquireStaging(slot))
+            return false;
+
+        if (slot)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+            // the fence has signalled, so nothing reads this buffer any more
+            void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (dst)
+            {
+                std::memcpy(dst, src, bytes);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                src = NULL;     // offset 0 into the bound buffer
+            }
+            else
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        // rows wider than a staging buffer (or a failed map) go straight from client memory
+        if (entry.blockBytes)
+        {
+            int y = entry.row * 4;
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, entry.level, 0, y, level.width, std::min(rows * 4, level.height - y),
+                entry.internalFormat, (GLsizei)bytes, src);
+        }
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, entry.level, 0, entry.row, level.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, src);
+        if (slot)
+        {
+            slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        uploadedBytes += bytes;
+        budget -= std::min(budget, bytes);
+        entry.row += rows;
+    }
+    return false;
+}
+
+bool TextureStreamer::AcquireStaging(Staging*& slot)
+{
+    Staging& s = staging[nextStaging];
+    if (s.fence)
+    {
+        GLenum status = glClientWaitSync(s.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return false;   // GPU still reading it; try again next frame
+        glDeleteSync(s.fence);
+        s.fence = 0;
+    }
+    nextStaging = (nextStaging + 1) % staging.size();
+    slot = &s;
+    return true;
+}
+
+bool TextureStreamer::IsResident(GLuint texture) const
+{
+    for (const std::unique_ptr<Entry>& e : entries)
+    {
+        if (e->texture == texture)
+            return e->state.load(std::memory_order_relaxed) == STATE_RESIDENT;
+    }
+    return false;
+}
+
+bool TextureStreamer::Idle() const
+{
+    return decoding.empty() && uploadQueue.empty();
+}
+
+TextureStreamer::Stats TextureStreamer::stats() const
+{
+    Stats s;
+    s.requested = entries.size();
+    s.resident = residentCount;
+    s.failed = failedCount;
+    s.decodedBytes = decodedBytes.load(std::memory_order_relaxed);
+    s.decodeSeconds = decodeNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+    s.uploadedBytes = uploadedBytes;
+    s.uploadSeconds = uploadSeconds;
+    return s;
+}
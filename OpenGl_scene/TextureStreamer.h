@@ -0,0 +1,148 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "FileView.h"
+#include "JobSystem.h"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ---------- TextureStreamer ----------
+// Loads RGBA8 textures without stalling the frame. Request() hands out a
+// texture name at once, holding a 1x1 grey placeholder. A decode job then
+// maps the file, runs stbi_load_from_memory and builds the box-filtered mip
+// chain. Decodes are JobSystem background jobs: the frame thread runs jobs
+// while it waits on a ParallelFor, and it must never pick up a
+// multi-millisecond decode, so only idle workers take them (with no workers,
+// Update() runs one per frame). Cooked files (TextureFile.h) skip all of
+// that: the job only maps and validates them, and the levels are copied out
+// of the mapping. With `compress`, decoded images are also encoded to BC1
+// (opaque) or BC3 in the decode job when the context has S3TC.
+//
+// Update() on the GL thread copies decoded levels into a ring of pixel
+// unpack buffers (mapped unsynchronized) and issues glTexSubImage2D from
+// them. A buffer is reused only after its fence has signalled, polled with
+// a zero timeout, so the GL thread never waits on the GPU either. Levels go
+// up smallest first and GL_TEXTURE_BASE_LEVEL follows them down, so the
+// texture sharpens over a few frames instead of popping in when complete.
+class TextureStreamer
+{
+public:
+    struct Stats
+    {
+        size_t requested = 0, resident = 0, failed = 0;
+        uint64_t decodedBytes = 0;      // level data made ready, all mip levels
+        double decodeSeconds = 0.0;     // summed over decode jobs
+        uint64_t uploadedBytes = 0;
+        double uploadSeconds = 0.0;     // GL thread time spent in uploads
+
+        double decodeMBps() const { return decodeSeconds > 0.0 ? decodedBytes / decodeSeconds * 1e-6 : 0.0; }
+        double uploadMBps() const { return uploadSeconds > 0.0 ? uploadedBytes / uploadSeconds * 1e-6 : 0.0; }
+    };
+
+    // needs a current GL 3.3 context on a thread of `jobs` (normally the one
+    // that created it); staging is bufferCount PBOs of bufferSize bytes.
+    // Request() paths are looked up in `files`.
+    explicit TextureStreamer(JobSystem& jobs, size_t bufferSize = 4 << 20, int bufferCount = 3,
+        bool compress = false, const Vfs& files = Vfs());
+    // skips the decodes not started yet and waits for the rest; deletes
+    // every texture it handed out, so the context must still be current
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    GLuint Request(const char* path);
+
+    // GL thread, once per frame; copies at most about budgetBytes
+    void Update(size_t budgetBytes = 4 << 20);
+
+    // every level uploaded (the last copy may still be in flight on the GPU)
+    bool IsResident(GLuint texture) const;
+    // nothing left to decode or upload
+    bool Idle() const;
+
+    Stats stats() const;
+
+private:
+    enum State
+    {
+        STATE_QUEUED, STATE_DECODED, STATE_FAILED, STATE_UPLOADING, STATE_RESIDENT
+    };
+
+    struct Level
+    {
+        int width, height;
+        size_t offset;      // from Entry::source
+        size_t rowBytes;    // one row of pixels, or of 4x4 blocks
+        int rows;
+    };
+
+    struct Entry
+    {
+        GLuint texture = 0;
+        std::string path;
+        std::atomic<int> state{ STATE_QUEUED };
+
+        // written by the decode job before state becomes STATE_DECODED
+        std::vector<unsigned char> pixels;  // decoded images
+        FileView file;                      // cooked files stay mapped instead
+        const unsigned char* source = nullptr;
+        std::vector<Level> levels;
+        GLenum internalFormat = GL_RGBA8;
+        int blockBytes = 0;                 // 0: RGBA8 rows
+
+        // upload progress, GL thread only
+        int level = -1;     // level being uploaded, counts down to 0
+        int row = 0;        // first row not yet copied
+    };
+
+    struct Staging
+    {
+        GLuint buffer = 0;
+        GLsync fence = 0;
+    };
+
+    void DecodeJob(Entry& entry);
+    static Level MakeLevel(int width, int height, size_t offset, int blockBytes);
+    bool Decode(Entry& entry) const;
+    bool MapCooked(Entry& entry) const;
+    void Compress(Entry& entry) const;
+    static void SpecifyLevel(const Entry& entry, int index, const unsigned char* pixels);
+    bool UploadRows(Entry& entry, size_t& budget);
+    bool AcquireStaging(Staging*& staging);
+
+    // GL thread
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::vector<Entry*> decoding;       // requested, not yet seen decoded
+    std::deque<Entry*> uploadQueue;     // decoded, uploaded in this order
+
+    // what the context samples directly; fixed at construction
+    bool s3tc = false, s3tcSrgb = false;
+    bool compressImages = false;
+
+    std::vector<Staging> staging;
+    size_t stagingSize;
+    size_t nextStaging = 0;
+
+    Vfs files;
+    JobSystem& jobs;
+    JobCounter decodeJobs;
+    std::atomic<bool> closing{ false };
+
+    std::atomic<uint64_t> decodedBytes{ 0 };
+    std::atomic<uint64_t> decodeNanoseconds{ 0 };
+    uint64_t uploadedBytes = 0;
+    double uploadSeconds = 0.0;
+    size_t residentCount = 0;
+    size_t failedCount = 0;
+};
+
+#endif
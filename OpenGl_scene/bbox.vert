@@ -0,0 +1,11 @@
+#version 330 core
+// Occlusion query proxy: the unit cube scaled to an object's bounding box.
+layout (location = 0) in vec3 aPos;    // corner of [-1, 1]^3
+
+uniform mat4 viewProj;
+uniform vec4 uBox;      // center, half extent
+
+void main()
+{
+    gl_Position = viewProj * vec4(uBox.xyz + aPos * uBox.w, 1.0);
+}
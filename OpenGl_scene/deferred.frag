@@ -0,0 +1,58 @@
+#version 330 core
+// Deferred lighting: one full-screen pass over the G-buffer (gbuffer.frag)
+// with the key light and the clustered point lights of fragment.frag, so
+// each visible pixel is lit once however much geometry was drawn over it.
+out vec4 FragColor;
+
+uniform sampler2D uGNormal;
+uniform sampler2D uGAlbedo;
+uniform sampler2D uGDepth;
+uniform mat4 uInvViewProj;
+uniform vec2 uInvViewport;
+
+uniform vec3 viewPos;
+
+// lightPos, the Phong parameters, the sun, Shadow() and ClusteredLighting():
+// lighting.glsl
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(uGDepth, pixel, 0).r;
+    vec4 albedo = texelFetch(uGAlbedo, pixel, 0);
+    if (albedo.a == 0.0)
+    {
+        FragColor = vec4(albedo.rgb, 1.0);
+        return;
+    }
+
+    vec4 h = uInvViewProj * vec4(gl_FragCoord.xy * uInvViewport * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec3 worldPos = h.xyz / h.w;
+    vec3 N = DecodeOctahedral(texelFetch(uGNormal, pixel, 0).rg);
+    vec3 V = normalize(viewPos - worldPos);
+    vec3 L = uDirectionalLight ? lightDir : normalize(lightPos - worldPos);
+    vec3 lightColor = vec3(1.0);
+
+    vec3 ambient = ambientStrength * lightColor;
+    vec3 diffuse = diffuseStrength * max(dot(N, L), 0.0) * lightColor;
+    vec3 specular = specularStrength * pow(max(dot(reflect(-L, N), V), 0.0), shininess) * lightColor;
+
+    float shadow = 1.0;
+#ifdef SHADOWS
+    shadow = Shadow(worldPos, N);
+#endif
+    vec3 result = (ambient + diffuse * shadow + specular * shadow) * albedo.rgb;
+    if (uClusteredLights)
+        result += ClusteredLighting(worldPos, N, V) * albedo.rgb;
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,5 @@
+#version 330 core
+// depth only: no colour outputs, nothing to shade
+void main()
+{
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// Depth pre-pass and shadow maps: vertex.vert's gl_Position from the
+// position-only stream. Both are invariant so the colour pass's GL_EQUAL
+// test matches exactly, and both get the same CPU_MVP define.
+layout (location = 0) in vec3 aPos;
+
+invariant gl_Position;
+
+#ifdef CPU_MVP
+uniform mat4 mvp;          // viewProj * model, per draw
+#else
+uniform mat3x4 model;
+uniform mat4 viewProj;
+#endif
+
+void main()
+{
+#ifdef CPU_MVP
+    gl_Position = mvp * vec4(aPos, 1.0);
+#else
+    vec3 world = vec4(aPos, 1.0) * model;
+    gl_Position = viewProj * vec4(world, 1.0);
+#endif
+}
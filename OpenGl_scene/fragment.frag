@@ -1,20 +1,16 @@
 #version 330 core
 in vec3 vAttr;       // sphere: normal (object space), tetra: color
+in vec3 vNormal;     // sphere: normal (world space)
 in vec3 vWorldPos;
 
 out vec4 FragColor;
 
 uniform int uObjectType;   // 0 = left sphere (Phong), 1 = tetra, 2 = right sphere (coord)
 
-uniform vec3 lightPos;
 uniform vec3 viewPos;      // pozycja kamery w world space
-uniform mat4 model;
 
-// parametry Phonga
-uniform float ambientStrength;   // np. 0.20
-uniform float diffuseStrength;   // np. 0.80
-uniform float specularStrength;  // np. 0.50
-uniform float shininess;         // np. 32.0
+// lightPos, the Phong parameters, the sun, Shadow() and ClusteredLighting():
+// lighting.glsl
 
 void main()
 {
@@ -38,9 +34,9 @@ void main()
     vec3 lightColor = vec3(1.0); // biale swiatlo
 
     // normal do world space
-    vec3 N = normalize(mat3(transpose(inverse(model))) * vAttr);
+    vec3 N = normalize(vNormal);
 
-    vec3 L = normalize(lightPos - vWorldPos);
+    vec3 L = uDirectionalLight ? lightDir : normalize(lightPos - vWorldPos);
     vec3 V = normalize(viewPos  - vWorldPos);
 
     // ambient
@@ -55,6 +51,13 @@ void main()
     float spec = pow(max(dot(R, V), 0.0), shininess);
     vec3 specular = specularStrength * spec * lightColor;
 
-    vec3 result = (ambient + diffuse + specular) * baseColor;
+    // the key light only; the clustered lights cast no shadows
+    float shadow = 1.0;
+#ifdef SHADOWS
+    shadow = Shadow(vWorldPos, N);
+#endif
+    vec3 result = (ambient + diffuse * shadow + specular * shadow) * baseColor;
+    if (uClusteredLights)
+        result += ClusteredLighting(vWorldPos, N, V) * baseColor;
     FragColor = vec4(result, 1.0);
 }
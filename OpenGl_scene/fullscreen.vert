@@ -0,0 +1,8 @@
+#version 330 core
+// one triangle over the whole viewport on the far plane, from gl_VertexID
+// alone (no buffers)
+void main()
+{
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(p * 2.0 - 1.0, 1.0, 1.0);
+}
@@ -0,0 +1,39 @@
+#version 330 core
+in vec3 vAttr;       // sphere: normal (object space), tetra: color
+in vec3 vNormal;     // sphere: normal (world space)
+in vec3 vWorldPos;
+
+// deferred G-buffer; position is rebuilt from the depth buffer
+layout (location = 0) out vec2 gNormal;   // octahedral world normal, RG16
+layout (location = 1) out vec4 gAlbedo;   // RGBA8: color, a = 1 lit (Phong), 0 unlit
+
+uniform int uObjectType;   // as in fragment.frag
+
+// the unit sphere folded onto the |x| + |y| + |z| = 1 octahedron, its lower
+// half unfolded over the corners of the square
+vec2 EncodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+
+void main()
+{
+    if (uObjectType == 1)
+    {
+        gNormal = vec2(0.5);
+        gAlbedo = vec4(vAttr, 0.0);
+        return;
+    }
+    if (uObjectType == 2)
+    {
+        gNormal = vec2(0.5);
+        gAlbedo = vec4(0.5 + 0.5 * normalize(vWorldPos), 0.0);
+        return;
+    }
+    gNormal = EncodeOctahedral(normalize(vNormal));
+    gAlbedo = vec4(1.0);
+}
@@ -0,0 +1,116 @@
+// Lighting shared by fragment.frag (forward) and deferred.frag: Shader puts
+// it after the #version line and the defines of either. Declares the key
+// light's Phong uniforms as well, which both use, and its shadow lookup in
+// the SHADOWS variant.
+
+uniform vec3 lightPos;
+
+// parametry Phonga
+uniform float ambientStrength;   // np. 0.20
+uniform float diffuseStrength;   // np. 0.80
+uniform float specularStrength;  // np. 0.50
+uniform float shininess;         // np. 32.0
+
+// key light as a sun, and its shadow maps in the SHADOWS variant (ShadowMaps.h)
+uniform bool uDirectionalLight;        // light arrives along -lightDir instead of from lightPos
+uniform vec3 lightDir;                 // toward the light, normalized
+#ifdef SHADOWS
+const int MAX_CASCADES = 4;            // ShadowFrusta::MAX_CASCADES
+const int CUBE_FACES = 6;              // ShadowFrusta::CUBE_FACES
+uniform int uShadowMaps;               // 0 = none fitted, 1 = the point light's spot, CUBE_FACES its cube, else cascades
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMatrices[CUBE_FACES];  // world to each map's clip space
+uniform vec4 uCascadeEnds;             // camera view depth where each cascade ends
+uniform vec4 uShadowDepthRow;          // camera view depth = dot(row, world)
+uniform vec4 uShadowNormalOffset;      // per map; times the distance to a point light
+uniform float uShadowTexel;            // 1 / map size
+
+// 1 lit .. 0 shadowed: 3x3 depth-compare taps (each bilinear) of the
+// cube face the point lies in, or the first map whose cascade holds it,
+// looked up a little out along its normal; outside every map is lit
+float Shadow(vec3 worldPos, vec3 N)
+{
+    if (uShadowMaps == 0)
+        return 1.0;
+
+    int map = 0;
+    vec3 P;
+    if (uDirectionalLight)
+    {
+        float depth = dot(uShadowDepthRow, vec4(worldPos, 1.0));
+        while (map < min(uShadowMaps, MAX_CASCADES) - 1 && depth > uCascadeEnds[map])
+            ++map;
+        if (depth > uCascadeEnds[map])
+            return 1.0;
+        P = worldPos + N * uShadowNormalOffset[map];
+    }
+    else
+    {
+        P = worldPos + N * (uShadowNormalOffset.x * length(lightPos - worldPos));
+        if (uShadowMaps == CUBE_FACES)
+        {
+            vec3 d = P - lightPos;
+            vec3 a = abs(d);
+            if (a.x >= a.y && a.x >= a.z)
+                map = d.x < 0.0 ? 1 : 0;
+            else if (a.y >= a.z)
+                map = d.y < 0.0 ? 3 : 2;
+            else
+                map = d.z < 0.0 ? 5 : 4;
+        }
+    }
+
+    vec4 p = uShadowMatrices[map] * vec4(P, 1.0);
+    p.xyz = p.xyz / p.w * 0.5 + 0.5;
+    if (p.x < 0.0 || p.x > 1.0 || p.y < 0.0 || p.y > 1.0 || p.z > 1.0)
+        return 1.0;
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y)
+        for (int x = -1; x <= 1; ++x)
+            lit += texture(uShadowMap, vec4(p.xy + vec2(x, y) * uShadowTexel, float(map), p.z));
+    return lit / 9.0;
+}
+#endif
+
+// clustered point lights (LightClusters.h), on top of lightPos
+uniform bool uClusteredLights;
+uniform samplerBuffer uLightData;      // 2 texels per light: position, range; color
+uniform usamplerBuffer uClusterRanges; // per froxel: first index, count
+uniform usamplerBuffer uLightIndices;
+uniform vec2 uClusterTileScale;        // tiles per pixel, x and y
+uniform vec2 uClusterSlice;            // slice = log(depth) * x + y
+uniform vec4 uClusterDepthRow;         // view depth = dot(row, world)
+
+const ivec3 CLUSTER_DIMS = ivec3(16, 9, 24);   // CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES
+
+// Phong from the lights of this fragment's froxel only, each fading to
+// zero at its range
+vec3 ClusteredLighting(vec3 worldPos, vec3 N, vec3 V)
+{
+    float depth = dot(uClusterDepthRow, vec4(worldPos, 1.0));
+    ivec3 cell;
+    cell.xy = min(ivec2(gl_FragCoord.xy * uClusterTileScale), CLUSTER_DIMS.xy - 1);
+    cell.z = clamp(int(log(max(depth, 1e-4)) * uClusterSlice.x + uClusterSlice.y), 0, CLUSTER_DIMS.z - 1);
+    uvec2 range = texelFetch(uClusterRanges, (cell.z * CLUSTER_DIMS.y + cell.y) * CLUSTER_DIMS.x + cell.x).xy;
+
+    vec3 sum = vec3(0.0);
+    for (uint i = 0u; i < range.y; ++i)
+    {
+        int light = int(texelFetch(uLightIndices, int(range.x + i)).x);
+        vec4 positionRange = texelFetch(uLightData, light * 2);
+        vec3 color = texelFetch(uLightData, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRange.xyz - worldPos;
+        float distance2 = dot(toLight, toLight);
+        float window = clamp(1.0 - distance2 / (positionRange.w * positionRange.w), 0.0, 1.0);
+        if (window == 0.0)
+            continue;
+        vec3 L = toLight * inversesqrt(distance2);
+
+        float diff = max(dot(N, L), 0.0);
+        float spec = pow(max(dot(reflect(-L, N), V), 0.0), shininess);
+        sum += (diffuseStrength * diff + specularStrength * spec) * window * window * color;
+    }
+    return sum;
+}
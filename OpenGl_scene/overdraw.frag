@@ -0,0 +1,10 @@
+#version 330 core
+// Overdraw view: every fragment that passes the depth test adds a fixed
+// amount (additive blending), so one layer is dark red, 8 saturate red,
+// 16 yellow and 32 white.
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(0.125, 0.0625, 0.03125, 1.0);
+}
@@ -424,6 +424,18 @@ extern "C" {
     STBIDEF stbi_uc* stbi_load_from_memory(stbi_uc           const* buffer, int len, int* x, int* y, int* channels_in_file, int desired_channels);
     STBIDEF stbi_uc* stbi_load_from_callbacks(stbi_io_callbacks const* clbk, void* user, int* x, int* y, int* channels_in_file, int desired_channels);
 
+    // Local addition: JPEG decode split into tasks. stb_image creates no
+    // threads; parallel_for(user, count, task, task_data) must call
+    // task(task_data, i) for every i in [0, count) and return when all are
+    // done. Scans with restart intervals are entropy-decoded per interval,
+    // other baseline scans defer their IDCT, and IDCT, upsampling and color
+    // conversion run over block/pixel rows. Output is identical to
+    // stbi_load_from_memory; non-JPEG input simply goes through it.
+    typedef void (*stbi_parallel_task)(void* task_data, int index);
+    typedef void (*stbi_parallel_for)(void* user, int count, stbi_parallel_task task, void* task_data);
+    STBIDEF stbi_uc* stbi_load_from_memory_parallel(stbi_uc const* buffer, int len, int* x, int* y, int* channels_in_file, int desired_channels,
+        stbi_parallel_for parallel_for, void* user, int max_tasks);
+
 #ifndef STBI_NO_STDIO
     STBIDEF stbi_uc* stbi_load(char const* filename, int* x, int* y, int* channels_in_file, int desired_channels);
     STBIDEF stbi_uc* stbi_load_from_file(FILE* f, int* x, int* y, int* channels_in_file, int desired_channels);
@@ -518,6 +530,12 @@ extern "C" {
     // flip the image vertically, so the first pixel in the output array is the bottom left
     STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+    // Local addition: the JPEG decoder uses AVX2 kernels (IDCT two blocks at a
+    // time, 16-pixel color conversion and upsampling) when the CPU has AVX2;
+    // their output is identical to the SSE2 ones. Pass 0 to stay on SSE2, e.g.
+    // to compare the two. Returns whether the AVX2 kernels are now in use.
+    STBIDEF int stbi_set_jpeg_avx2(int flag_true_if_should_use_avx2);
+
     // as above, but only applies to images loaded on the thread that calls the function
     // this function is only available if your compiler supports thread-local variables;
     // calling it will fail to link if your compiler doesn't
@@ -775,6 +793,38 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// Local addition: AVX2 versions of the SSE2 JPEG kernels, chosen at run time.
+// GCC/Clang build just those functions for AVX2 with a target attribute, so
+// the rest of the file still only assumes SSE2. Define STBI_NO_AVX2 to drop them.
+#if defined(STBI_SSE2) && !defined(STBI_NO_JPEG) && !defined(STBI_NO_AVX2) && \
+    ((defined(_MSC_VER) && _MSC_VER >= 1800) || defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define STBI_AVX2
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#define STBI__AVX2_TARGET
+static int stbi__avx2_supported(void)
+{
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then the OS must save the YMM state
+    if ((info[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28)) return 0;
+    if ((_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 5) & 1;
+}
+#else
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+static int stbi__avx2_supported(void)
+{
+    // also checks that the OS saves the YMM registers
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -1114,6 +1164,21 @@ static stbi_uc* stbi__hdr_to_ldr(float* data, int x, int y, int comp);
 
 static int stbi__vertically_flip_on_load_global = 0;
 
+#ifdef STBI_AVX2
+static int stbi__jpeg_avx2 = 1;
+#endif
+
+STBIDEF int stbi_set_jpeg_avx2(int flag_true_if_should_use_avx2)
+{
+#ifdef STBI_AVX2
+    stbi__jpeg_avx2 = flag_true_if_should_use_avx2;
+    return flag_true_if_should_use_avx2 && stbi__avx2_supported();
+#else
+    STBI_NOTUSED(flag_true_if_should_use_avx2);
+    return 0;
+#endif
+}
+
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip)
 {
     stbi__vertically_flip_on_load_global = flag_true_if_should_flip;
@@ -1949,6 +2014,13 @@ typedef struct
     int    delta[17];   // old 'firstsymbol' - old 'firstcode'
 } stbi__huffman;
 
+typedef struct
+{
+    stbi_parallel_for run;
+    void* user;
+    int tasks;
+} stbi__jpeg_pool;
+
 typedef struct
 {
     stbi__context* s;
@@ -1997,8 +2069,11 @@ typedef struct
     int scan_n, order[4];
     int restart_interval, todo;
 
+    stbi__jpeg_pool* pool; // NULL unless decoding through stbi_load_from_memory_parallel
+
     // kernels
     void (*idct_block_kernel)(stbi_uc* out, int out_stride, short data[64]);
+    void (*idct_block2_kernel)(stbi_uc* out, int out_stride, short data[128]); // two adjacent blocks, or NULL
     void (*YCbCr_to_RGB_kernel)(stbi_uc* out, const stbi_uc* y, const stbi_uc* pcb, const stbi_uc* pcr, int count, int step);
     stbi_uc* (*resample_row_hv_2_kernel)(stbi_uc* out, stbi_uc* in_near, stbi_uc* in_far, int w, int hs);
 } stbi__jpeg;
@@ -2718,6 +2793,181 @@ static void stbi__idct_simd(stbi_uc* out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
+#ifdef STBI_AVX2
+// the sse2 IDCT on two horizontally adjacent blocks at once: data[0..63] goes
+// to out, data[64..127] to out + 8. Block 0 runs in the low 128-bit lane and
+// block 1 in the high one; every step below is the in-lane 256-bit form of
+// the sse2 instruction, so the output is bit-identical.
+static STBI__AVX2_TARGET void stbi__idct_avx2(stbi_uc* out, int out_stride, short data[128])
+{
+    __m256i row0, row1, row2, row3, row4, row5, row6, row7;
+    __m256i tmp;
+
+#define dct_const(x,y)  _mm256_broadcastsi128_si256(_mm_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y)))
+
+#define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##lo = _mm256_unpacklo_epi16((x),(y)); \
+      __m256i c0##hi = _mm256_unpackhi_epi16((x),(y)); \
+      __m256i out0##_l = _mm256_madd_epi16(c0##lo, c0); \
+      __m256i out0##_h = _mm256_madd_epi16(c0##hi, c0); \
+      __m256i out1##_l = _mm256_madd_epi16(c0##lo, c1); \
+      __m256i out1##_h = _mm256_madd_epi16(c0##hi, c1)
+
+#define dct_widen(out, in) \
+      __m256i out##_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), (in)), 4); \
+      __m256i out##_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), (in)), 4)
+
+#define dct_wadd(out, a, b) \
+      __m256i out##_l = _mm256_add_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_add_epi32(a##_h, b##_h)
+
+#define dct_wsub(out, a, b) \
+      __m256i out##_l = _mm256_sub_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_sub_epi32(a##_h, b##_h)
+
+#define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased_l = _mm256_add_epi32(a##_l, bias); \
+         __m256i abiased_h = _mm256_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm256_packs_epi32(_mm256_srai_epi32(sum_l, s), _mm256_srai_epi32(sum_h, s)); \
+         out1 = _mm256_packs_epi32(_mm256_srai_epi32(dif_l, s), _mm256_srai_epi32(dif_h, s)); \
+      }
+
+#define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi8(a, b); \
+      b = _mm256_unpackhi_epi8(tmp, b)
+
+#define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi16(a, b); \
+      b = _mm256_unpackhi_epi16(tmp, b)
+
+#define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m256i sum04 = _mm256_add_epi16(row0, row4); \
+         __m256i dif04 = _mm256_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m256i sum17 = _mm256_add_epi16(row1, row7); \
+         __m256i sum35 = _mm256_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+// row r of block 0 in the low lane, of block 1 in the high lane
+#define dct_load(r) \
+      _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (data + (r) * 8))), \
+                              _mm_loadu_si128((const __m128i*) (data + 64 + (r) * 8)), 1)
+
+// p holds rows r (64-bit element 0 per lane) and r+1 (element 1) of both blocks
+#define dct_store2(p) \
+      { \
+         __m256i rows = _mm256_permute4x64_epi64(p, 0xd8); \
+         _mm_storeu_si128((__m128i*) out, _mm256_castsi256_si128(rows)); out += out_stride; \
+         _mm_storeu_si128((__m128i*) out, _mm256_extracti128_si256(rows, 1)); out += out_stride; \
+      }
+
+    __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+    __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f(0.765366865f), stbi__f2f(0.5411961f));
+    __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+    __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+    __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f(0.298631336f), stbi__f2f(-1.961570560f));
+    __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f(3.072711026f));
+    __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f(2.053119869f), stbi__f2f(-0.390180644f));
+    __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f(1.501321110f));
+
+    __m256i bias_0 = _mm256_set1_epi32(512);
+    __m256i bias_1 = _mm256_set1_epi32(65536 + (128 << 17));
+
+    row0 = dct_load(0);
+    row1 = dct_load(1);
+    row2 = dct_load(2);
+    row3 = dct_load(3);
+    row4 = dct_load(4);
+    row5 = dct_load(5);
+    row6 = dct_load(6);
+    row7 = dct_load(7);
+
+    // column pass
+    dct_pass(bias_0, 10);
+
+    {
+        // 16bit 8x8 transposes, per lane
+        dct_interleave16(row0, row4);
+        dct_interleave16(row1, row5);
+        dct_interleave16(row2, row6);
+        dct_interleave16(row3, row7);
+
+        dct_interleave16(row0, row2);
+        dct_interleave16(row1, row3);
+        dct_interleave16(row4, row6);
+        dct_interleave16(row5, row7);
+
+        dct_interleave16(row0, row1);
+        dct_interleave16(row2, row3);
+        dct_interleave16(row4, row5);
+        dct_interleave16(row6, row7);
+    }
+
+    // row pass
+    dct_pass(bias_1, 17);
+
+    {
+        __m256i p0 = _mm256_packus_epi16(row0, row1);
+        __m256i p1 = _mm256_packus_epi16(row2, row3);
+        __m256i p2 = _mm256_packus_epi16(row4, row5);
+        __m256i p3 = _mm256_packus_epi16(row6, row7);
+
+        // 8bit 8x8 transposes, per lane
+        dct_interleave8(p0, p2);
+        dct_interleave8(p1, p3);
+
+        dct_interleave8(p0, p1);
+        dct_interleave8(p2, p3);
+
+        dct_interleave8(p0, p2);
+        dct_interleave8(p1, p3);
+
+        // same row order as the sse2 stores: p0, p2, p1, p3
+        dct_store2(p0);
+        dct_store2(p2);
+        dct_store2(p1);
+        dct_store2(p3);
+    }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_wadd
+#undef dct_wsub
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+#undef dct_load
+#undef dct_store2
+}
+#endif // STBI_AVX2
+
 #ifdef STBI_NEON
 
 // NEON integer IDCT. should produce bit-identical
@@ -2960,6 +3210,18 @@ static void stbi__jpeg_reset(stbi__jpeg* j)
     // since we don't even allow 1<<30 pixels
 }
 
+// idct `count` horizontally adjacent blocks with contiguous coefficients,
+// two at a time when there is a two-block kernel
+static void stbi__jpeg_idct_blocks(stbi__jpeg* z, stbi_uc* out, int out_stride, short* data, int count)
+{
+    int i = 0;
+    if (z->idct_block2_kernel)
+        for (; i + 1 < count; i += 2)
+            z->idct_block2_kernel(out + i * 8, out_stride, data + i * 64);
+    for (; i < count; ++i)
+        z->idct_block_kernel(out + i * 8, out_stride, data + i * 64);
+}
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg* z)
 {
     stbi__jpeg_reset(z);
@@ -2993,7 +3255,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg* z)
         }
         else { // interleaved
             int i, j, k, x, y;
-            STBI_SIMD_ALIGN(short, data[64]);
+            STBI_SIMD_ALIGN(short, data[4 * 64]);
             for (j = 0; j < z->img_mcu_y; ++j) {
                 for (i = 0; i < z->img_mcu_x; ++i) {
                     // scan an interleaved mcu... process scan_n components in order
@@ -3002,13 +3264,14 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg* z)
                         // scan out an mcu's worth of this component; that's just determined
                         // by the basic H and V specified for the component
                         for (y = 0; y < z->img_comp[n].v; ++y) {
+                            int x2 = i * z->img_comp[n].h * 8;
+                            int y2 = (j * z->img_comp[n].v + y) * 8;
+                            int ha = z->img_comp[n].ha;
+                            // decode the row of h blocks, then idct them together
                             for (x = 0; x < z->img_comp[n].h; ++x) {
-                                int x2 = (i * z->img_comp[n].h + x) * 8;
-                                int y2 = (j * z->img_comp[n].v + y) * 8;
-                                int ha = z->img_comp[n].ha;
-                                if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                                z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * y2 + x2, z->img_comp[n].w2, data);
+                                if (!stbi__jpeg_decode_block(z, data + 64 * x, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
                             }
+                            stbi__jpeg_idct_blocks(z, z->img_comp[n].data + z->img_comp[n].w2 * y2 + x2, z->img_comp[n].w2, data, z->img_comp[n].h);
                         }
                     }
                     // after all interleaved components, that's an interleaved MCU,
@@ -3104,16 +3367,243 @@ static void stbi__jpeg_finish(stbi__jpeg* z)
             int w = (z->img_comp[n].x + 7) >> 3;
             int h = (z->img_comp[n].y + 7) >> 3;
             for (j = 0; j < h; ++j) {
-                for (i = 0; i < w; ++i) {
-                    short* data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-                    stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * 8 + i * 8, z->img_comp[n].w2, data);
-                }
+                short* data = z->img_comp[n].coeff + 64 * j * z->img_comp[n].coeff_w;
+                for (i = 0; i < w; ++i)
+                    stbi__jpeg_dequantize(data + 64 * i, z->dequant[z->img_comp[n].tq]);
+                stbi__jpeg_idct_blocks(z, z->img_comp[n].data + z->img_comp[n].w2 * j * 8, z->img_comp[n].w2, data, w);
             }
         }
     }
 }
 
+// ---- parallel decode (local addition, see stbi_load_from_memory_parallel) ----
+
+static void stbi__jpeg_run(stbi__jpeg* z, int count, stbi_parallel_task task, void* task_data)
+{
+    if (count > 1)
+        z->pool->run(z->pool->user, count, task, task_data);
+    else if (count == 1)
+        task(task_data, 0);
+}
+
+// tasks for count items: at most pool->tasks, never more than there are items
+static int stbi__jpeg_task_count(stbi__jpeg* z, int count)
+{
+    return count < z->pool->tasks ? count : z->pool->tasks;
+}
+
+// MCUs in the current baseline scan (a single block per MCU when non-interleaved)
+static int stbi__jpeg_scan_mcus(stbi__jpeg* z)
+{
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        return ((z->img_comp[n].x + 7) >> 3) * ((z->img_comp[n].y + 7) >> 3);
+    }
+    return z->img_mcu_x * z->img_mcu_y;
+}
+
+// decode MCU m of a baseline scan, the same block order as
+// stbi__parse_entropy_coded_data; with defer the dequantized coefficients go
+// to the component's coeff plane instead of through the idct
+static int stbi__jpeg_decode_mcu(stbi__jpeg* z, int m, int defer)
+{
+    STBI_SIMD_ALIGN(short, data[4 * 64]);
+    int i, j, k, x, y;
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        int w = (z->img_comp[n].x + 7) >> 3;
+        int ha = z->img_comp[n].ha;
+        short* block;
+        i = m % w;
+        j = m / w;
+        block = defer ? z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w) : data;
+        if (!stbi__jpeg_decode_block(z, block, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+        if (!defer)
+            z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * 8 + i * 8, z->img_comp[n].w2, data);
+        return 1;
+    }
+    i = m % z->img_mcu_x;
+    j = m / z->img_mcu_x;
+    for (k = 0; k < z->scan_n; ++k) {
+        int n = z->order[k];
+        for (y = 0; y < z->img_comp[n].v; ++y) {
+            int y2 = j * z->img_comp[n].v + y;
+            int ha = z->img_comp[n].ha;
+            for (x = 0; x < z->img_comp[n].h; ++x) {
+                int x2 = i * z->img_comp[n].h + x;
+                short* block = defer ? z->img_comp[n].coeff + 64 * (x2 + y2 * z->img_comp[n].coeff_w) : data + 64 * x;
+                if (!stbi__jpeg_decode_block(z, block, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+            }
+            if (!defer)
+                stbi__jpeg_idct_blocks(z, z->img_comp[n].data + z->img_comp[n].w2 * y2 * 8 + i * z->img_comp[n].h * 8, z->img_comp[n].w2, data, z->img_comp[n].h);
+        }
+    }
+    return 1;
+}
+
+typedef struct
+{
+    stbi__jpeg* z;
+    stbi_uc** segment;   // segment_count + 1 bounds; each segment ends after its RSTn
+    int segment_count;
+    int mcu_count;
+    int tasks;
+    int* ok;             // one flag per task
+} stbi__jpeg_restart_job;
+
+// restart intervals are independent: each task decodes a run of them with
+// its own copy of the decoder state reading from its own slice of the stream
+static void stbi__jpeg_restart_task(void* task_data, int index)
+{
+    stbi__jpeg_restart_job* job = (stbi__jpeg_restart_job*)task_data;
+    int chunk = (job->segment_count + job->tasks - 1) / job->tasks;
+    int first = index * chunk;
+    int last = first + chunk < job->segment_count ? first + chunk : job->segment_count;
+    int k;
+    stbi__context ctx;
+    stbi__jpeg* local = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    job->ok[index] = local != NULL;
+    if (!local) return;
+    memcpy(local, job->z, sizeof(stbi__jpeg));
+    local->s = &ctx;
+    for (k = first; k < last && job->ok[index]; ++k) {
+        int m = k * local->restart_interval;
+        int end = m + local->restart_interval < job->mcu_count ? m + local->restart_interval : job->mcu_count;
+        stbi__start_mem(&ctx, job->segment[k], (int)(job->segment[k + 1] - job->segment[k]));
+        stbi__jpeg_reset(local);
+        for (; m < end; ++m) {
+            if (!stbi__jpeg_decode_mcu(local, m, 0)) { job->ok[index] = 0; break; }
+        }
+    }
+    STBI_FREE(local);
+}
+
+// split the entropy-coded data at its RSTn markers; 0 if the markers don't
+// line up with the restart interval (left to the serial decoder)
+static int stbi__jpeg_find_segments(stbi__jpeg* z, stbi_uc** segment, int expected)
+{
+    stbi_uc* p = z->s->img_buffer;
+    stbi_uc* e = z->s->img_buffer_end;
+    int count = 0;
+    segment[count++] = p;
+    for (;;) {
+        p = (stbi_uc*)memchr(p, 0xff, e - p);
+        if (!p || p + 1 >= e) return 0;
+        if (p[1] == 0x00) { p += 2; continue; } // stuffed zero
+        if (p[1] == 0xff) { ++p; continue; }    // fill byte
+        if (!STBI__RESTART(p[1])) break;        // marker ending the scan
+        if (count == expected) return 0;
+        p += 2;
+        segment[count++] = p;
+    }
+    if (count != expected) return 0;
+    segment[count] = p + 2;
+    // leave the stream on the marker, as the serial decoder would
+    z->s->img_buffer = p;
+    return 1;
+}
+
+static int stbi__jpeg_parse_restarts(stbi__jpeg* z)
+{
+    stbi__jpeg_restart_job job;
+    int ok = 1, t;
+    job.z = z;
+    job.mcu_count = stbi__jpeg_scan_mcus(z);
+    job.segment_count = (job.mcu_count + z->restart_interval - 1) / z->restart_interval;
+    job.segment = (stbi_uc**)stbi__malloc_mad2(job.segment_count + 1, (int)sizeof(stbi_uc*), 0);
+    if (!job.segment) return stbi__err("outofmem", "Out of memory");
+    if (!stbi__jpeg_find_segments(z, job.segment, job.segment_count)) {
+        STBI_FREE(job.segment);
+        return stbi__parse_entropy_coded_data(z);
+    }
+    job.tasks = stbi__jpeg_task_count(z, job.segment_count);
+    job.ok = (int*)stbi__malloc_mad2(job.tasks, (int)sizeof(int), 0);
+    if (!job.ok) { STBI_FREE(job.segment); return stbi__err("outofmem", "Out of memory"); }
+    stbi__jpeg_run(z, job.tasks, stbi__jpeg_restart_task, &job);
+    for (t = 0; t < job.tasks; ++t)
+        ok &= job.ok[t];
+    STBI_FREE(job.ok);
+    STBI_FREE(job.segment);
+    stbi__jpeg_reset(z);
+    if (!ok) return stbi__err("bad huffman code", "Corrupt JPEG");
+    return 1;
+}
+
+// no restart markers: the entropy decode has to stay serial, so keep the
+// coefficients (as progressive mode does) and idct them in parallel later
+static int stbi__jpeg_parse_deferred(stbi__jpeg* z)
+{
+    int k, m, count;
+    for (k = 0; k < z->scan_n; ++k) {
+        int n = z->order[k];
+        if (z->img_comp[n].raw_coeff) continue;
+        z->img_comp[n].coeff_w = z->img_comp[n].w2 / 8;
+        z->img_comp[n].coeff_h = z->img_comp[n].h2 / 8;
+        z->img_comp[n].raw_coeff = stbi__malloc_mad3(z->img_comp[n].w2, z->img_comp[n].h2, sizeof(short), 15);
+        if (z->img_comp[n].raw_coeff == NULL) return stbi__err("outofmem", "Out of memory");
+        z->img_comp[n].coeff = (short*)(((size_t)z->img_comp[n].raw_coeff + 15) & ~15);
+    }
+    stbi__jpeg_reset(z);
+    count = stbi__jpeg_scan_mcus(z);
+    for (m = 0; m < count; ++m) {
+        if (!stbi__jpeg_decode_mcu(z, m, 1)) return 0;
+    }
+    return 1;
+}
+
+static int stbi__parse_entropy_parallel(stbi__jpeg* z)
+{
+    if (z->progressive || z->pool->tasks <= 1)
+        return stbi__parse_entropy_coded_data(z);
+    if (z->restart_interval)
+        return stbi__jpeg_parse_restarts(z);
+    return stbi__jpeg_parse_deferred(z);
+}
+
+typedef struct
+{
+    stbi__jpeg* z;
+    int first_row[5];    // block rows of the components with coefficients, as prefix sums
+    int tasks;
+} stbi__jpeg_idct_job;
+
+static void stbi__jpeg_idct_task(void* task_data, int index)
+{
+    stbi__jpeg_idct_job* job = (stbi__jpeg_idct_job*)task_data;
+    stbi__jpeg* z = job->z;
+    int rows = job->first_row[z->s->img_n];
+    int chunk = (rows + job->tasks - 1) / job->tasks;
+    int r = index * chunk;
+    int end = r + chunk < rows ? r + chunk : rows;
+    int n = 0, i;
+    for (; r < end; ++r) {
+        int j, w;
+        short* data;
+        while (r >= job->first_row[n + 1]) ++n;
+        j = r - job->first_row[n];
+        w = (z->img_comp[n].x + 7) >> 3;
+        data = z->img_comp[n].coeff + 64 * j * z->img_comp[n].coeff_w;
+        if (z->progressive)
+            for (i = 0; i < w; ++i)
+                stbi__jpeg_dequantize(data + 64 * i, z->dequant[z->img_comp[n].tq]);
+        stbi__jpeg_idct_blocks(z, z->img_comp[n].data + z->img_comp[n].w2 * j * 8, z->img_comp[n].w2, data, w);
+    }
+}
+
+// stbi__jpeg_finish over block rows; also covers deferred baseline scans,
+// whose coefficients are already dequantized
+static void stbi__jpeg_finish_parallel(stbi__jpeg* z)
+{
+    stbi__jpeg_idct_job job;
+    int n;
+    job.z = z;
+    job.first_row[0] = 0;
+    for (n = 0; n < z->s->img_n; ++n)
+        job.first_row[n + 1] = job.first_row[n] + (z->img_comp[n].coeff ? (z->img_comp[n].y + 7) >> 3 : 0);
+    job.tasks = stbi__jpeg_task_count(z, job.first_row[z->s->img_n]);
+    stbi__jpeg_run(z, job.tasks, stbi__jpeg_idct_task, &job);
+}
+
 static int stbi__process_marker(stbi__jpeg* z, int m)
 {
     int L;
@@ -3443,7 +3933,7 @@ static int stbi__decode_jpeg_image(stbi__jpeg* j)
     while (!stbi__EOI(m)) {
         if (stbi__SOS(m)) {
             if (!stbi__process_scan_header(j)) return 0;
-            if (!stbi__parse_entropy_coded_data(j)) return 0;
+            if (!(j->pool ? stbi__parse_entropy_parallel(j) : stbi__parse_entropy_coded_data(j))) return 0;
             if (j->marker == STBI__MARKER_none) {
                 j->marker = stbi__skip_jpeg_junk_at_end(j);
                 // if we reach eof without hitting a marker, stbi__get_marker() below will fail and we'll eventually return 0
@@ -3464,7 +3954,9 @@ static int stbi__decode_jpeg_image(stbi__jpeg* j)
             m = stbi__get_marker(j);
         }
     }
-    if (j->progressive)
+    if (j->pool)
+        stbi__jpeg_finish_parallel(j);
+    else if (j->progressive)
         stbi__jpeg_finish(j);
     return 1;
 }
@@ -3666,6 +4158,72 @@ static stbi_uc* stbi__resample_row_hv_2_simd(stbi_uc* out, stbi_uc* in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// stbi__resample_row_hv_2_simd for 16 input pixels per iteration; same
+// arithmetic, and the scalar tail matches it exactly too
+static STBI__AVX2_TARGET stbi_uc* stbi__resample_row_hv_2_avx2(stbi_uc* out, stbi_uc* in_near, stbi_uc* in_far, int w, int hs)
+{
+    int i = 0, t0, t1;
+
+    if (w == 1) {
+        out[0] = out[1] = stbi__div4(3 * in_near[0] + in_far[0] + 2);
+        return out;
+    }
+
+    t1 = 3 * in_near[0] + in_far[0];
+    for (; i < ((w - 1) & ~15); i += 16) {
+        // vertical pass, 3*x + y = 4*x + (y - x); pixels 0-7 in the low lane
+        __m256i farw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (in_far + i)));
+        __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (in_near + i)));
+        __m256i diff = _mm256_sub_epi16(farw, nearw);
+        __m256i nears = _mm256_slli_epi16(nearw, 2);
+        __m256i curr = _mm256_add_epi16(nears, diff);
+
+        // shift by one pixel across the lane boundary: alignr against the
+        // neighbouring lane, then insert the pixels from outside the group
+        __m256i lo_up = _mm256_permute2x128_si256(curr, curr, 0x08);   // (0, curr.lo)
+        __m256i hi_down = _mm256_permute2x128_si256(curr, curr, 0x81); // (curr.hi, 0)
+        __m256i prev = _mm256_insert_epi16(_mm256_alignr_epi8(curr, lo_up, 14), (short)t1, 0);
+        __m256i next = _mm256_insert_epi16(_mm256_alignr_epi8(hi_down, curr, 2), (short)(3 * in_near[i + 16] + in_far[i + 16]), 15);
+
+        // horizontal pass, polyphase as in the sse2 version
+        __m256i bias = _mm256_set1_epi16(8);
+        __m256i curs = _mm256_slli_epi16(curr, 2);
+        __m256i prvd = _mm256_sub_epi16(prev, curr);
+        __m256i nxtd = _mm256_sub_epi16(next, curr);
+        __m256i curb = _mm256_add_epi16(curs, bias);
+        __m256i even = _mm256_add_epi16(prvd, curb);
+        __m256i odd = _mm256_add_epi16(nxtd, curb);
+
+        // interleave, descale, pack; each lane holds 16 output bytes in order
+        __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+        __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+        __m256i de0 = _mm256_srli_epi16(int0, 4);
+        __m256i de1 = _mm256_srli_epi16(int1, 4);
+        __m256i outv = _mm256_packus_epi16(de0, de1);
+        _mm256_storeu_si256((__m256i*) (out + i * 2), outv);
+
+        t1 = 3 * in_near[i + 15] + in_far[i + 15];
+    }
+
+    t0 = t1;
+    t1 = 3 * in_near[i] + in_far[i];
+    out[i * 2] = stbi__div16(3 * t1 + t0 + 8);
+
+    for (++i; i < w; ++i) {
+        t0 = t1;
+        t1 = 3 * in_near[i] + in_far[i];
+        out[i * 2 - 1] = stbi__div16(3 * t0 + t1 + 8);
+        out[i * 2] = stbi__div16(3 * t1 + t0 + 8);
+    }
+    out[w * 2 - 1] = stbi__div4(t1 + 2);
+
+    STBI_NOTUSED(hs);
+
+    return out;
+}
+#endif
+
 static stbi_uc* stbi__resample_row_generic(stbi_uc* out, stbi_uc* in_near, stbi_uc* in_far, int w, int hs)
 {
     // resample with nearest-neighbor
@@ -3840,6 +4398,71 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc* out, stbi_uc const* y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// stbi__YCbCr_to_RGB_simd for 16 pixels per iteration (step == 4 only, like
+// the sse2 path); the remainder goes through the sse2 function
+static STBI__AVX2_TARGET void stbi__YCbCr_to_RGB_avx2(stbi_uc* out, stbi_uc const* y, stbi_uc const* pcb, stbi_uc const* pcr, int count, int step)
+{
+    int i = 0;
+    if (step == 4) {
+        __m256i signflip = _mm256_set1_epi8(-0x80);
+        __m256i cr_const0 = _mm256_set1_epi16((short)(1.40200f * 4096.0f + 0.5f));
+        __m256i cr_const1 = _mm256_set1_epi16(-(short)(0.71414f * 4096.0f + 0.5f));
+        __m256i cb_const0 = _mm256_set1_epi16(-(short)(0.34414f * 4096.0f + 0.5f));
+        __m256i cb_const1 = _mm256_set1_epi16((short)(1.77200f * 4096.0f + 0.5f));
+        __m256i y_bias = _mm256_set1_epi8((char)(unsigned char)128);
+        __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+        for (; i + 15 < count; i += 16) {
+            // load 16 of each; 64-bit halves duplicated as (0,0,1,1) so the
+            // in-lane unpacks below see pixels 0-7 low and 8-15 high
+            __m256i y_bytes = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((__m128i*) (y + i))), 0x50);
+            __m256i cr_bytes = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((__m128i*) (pcr + i))), 0x50);
+            __m256i cb_bytes = _mm256_permute4x64_epi64(_mm256_castsi128_si256(_mm_loadu_si128((__m128i*) (pcb + i))), 0x50);
+            __m256i cr_biased = _mm256_xor_si256(cr_bytes, signflip); // -128
+            __m256i cb_biased = _mm256_xor_si256(cb_bytes, signflip); // -128
+
+            // unpack to short (and left-shift cr, cb by 8)
+            __m256i yw = _mm256_unpacklo_epi8(y_bias, y_bytes);
+            __m256i crw = _mm256_unpacklo_epi8(_mm256_setzero_si256(), cr_biased);
+            __m256i cbw = _mm256_unpacklo_epi8(_mm256_setzero_si256(), cb_biased);
+
+            // color transform
+            __m256i yws = _mm256_srli_epi16(yw, 4);
+            __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+            __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+            __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+            __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+            __m256i rws = _mm256_add_epi16(cr0, yws);
+            __m256i gwt = _mm256_add_epi16(cb0, yws);
+            __m256i bws = _mm256_add_epi16(yws, cb1);
+            __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+            // descale
+            __m256i rw = _mm256_srai_epi16(rws, 4);
+            __m256i bw = _mm256_srai_epi16(bws, 4);
+            __m256i gw = _mm256_srai_epi16(gws, 4);
+
+            // back to byte, set up for transpose
+            __m256i brb = _mm256_packus_epi16(rw, bw);
+            __m256i gxb = _mm256_packus_epi16(gw, xw);
+
+            // transpose to interleave channels; o0 has pixels 0-3 | 8-11, o1 4-7 | 12-15
+            __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+            __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+            __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+            __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+            // store
+            _mm256_storeu_si256((__m256i*) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i*) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+            out += 64;
+        }
+    }
+    stbi__YCbCr_to_RGB_simd(out, y + i, pcb + i, pcr + i, count - i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg* j)
 {
@@ -3855,6 +4478,14 @@ static void stbi__setup_jpeg(stbi__jpeg* j)
     }
 #endif
 
+#ifdef STBI_AVX2
+    if (stbi__jpeg_avx2 && stbi__avx2_supported()) {
+        j->idct_block2_kernel = stbi__idct_avx2;
+        j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+        j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+    }
+#endif
+
 #ifdef STBI_NEON
     j->idct_block_kernel = stbi__idct_simd;
     j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
@@ -3885,6 +4516,201 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
     return (stbi_uc)((t + (t >> 8)) >> 8);
 }
 
+// resample and color-convert output rows [row_begin, row_end) into output,
+// which starts at row_begin; linebuf[k] needs img_x + 3 bytes per decoded
+// component. The resampler state for row_begin is computed directly, so row
+// ranges can run independently. With n == 3 each row also writes one byte
+// past its end (a dummy alpha).
+static void stbi__jpeg_convert_rows(stbi__jpeg* z, stbi_uc* output, int n, int decode_n, int is_rgb,
+    stbi_uc** linebuf, unsigned int row_begin, unsigned int row_end)
+{
+    int k;
+    unsigned int i, j;
+    stbi_uc* coutput[4] = { NULL, NULL, NULL, NULL };
+
+    stbi__resample res_comp[4];
+
+    for (k = 0; k < decode_n; ++k) {
+        stbi__resample* r = &res_comp[k];
+        int t, wraps, last;
+
+        r->hs = z->img_h_max / z->img_comp[k].h;
+        r->vs = z->img_v_max / z->img_comp[k].v;
+        r->w_lores = (z->s->img_x + r->hs - 1) / r->hs;
+
+        // state after row_begin steps of the serial walk below
+        t = (r->vs >> 1) + (int)row_begin;
+        wraps = t / r->vs;
+        r->ystep = t % r->vs;
+        r->ypos = wraps;
+        last = z->img_comp[k].y - 1;
+        r->line1 = z->img_comp[k].data + z->img_comp[k].w2 * (wraps < last ? wraps : last);
+        r->line0 = wraps == 0 ? z->img_comp[k].data
+            : z->img_comp[k].data + z->img_comp[k].w2 * (wraps - 1 < last ? wraps - 1 : last);
+
+        if (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
+        else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
+        else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+        else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
+        else                               r->resample = stbi__resample_row_generic;
+    }
+
+    for (j = row_begin; j < row_end; ++j) {
+        stbi_uc* out = output + n * z->s->img_x * (j - row_begin);
+        for (k = 0; k < decode_n; ++k) {
+            stbi__resample* r = &res_comp[k];
+            int y_bot = r->ystep >= (r->vs >> 1);
+            coutput[k] = r->resample(linebuf[k],
+                y_bot ? r->line1 : r->line0,
+                y_bot ? r->line0 : r->line1,
+                r->w_lores, r->hs);
+            if (++r->ystep >= r->vs) {
+                r->ystep = 0;
+                r->line0 = r->line1;
+                if (++r->ypos < z->img_comp[k].y)
+                    r->line1 += z->img_comp[k].w2;
+            }
+        }
+        if (n >= 3) {
+            stbi_uc* y = coutput[0];
+            if (z->s->img_n == 3) {
+                if (is_rgb) {
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        out[0] = y[i];
+                        out[1] = coutput[1][i];
+                        out[2] = coutput[2][i];
+                        out[3] = 255;
+                        out += n;
+                    }
+                }
+                else {
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                }
+            }
+            else if (z->s->img_n == 4) {
+                if (z->app14_color_transform == 0) { // CMYK
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        stbi_uc m = coutput[3][i];
+                        out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                        out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                        out[2] = stbi__blinn_8x8(coutput[2][i], m);
+                        out[3] = 255;
+                        out += n;
+                    }
+                }
+                else if (z->app14_color_transform == 2) { // YCCK
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        stbi_uc m = coutput[3][i];
+                        out[0] = stbi__blinn_8x8(255 - out[0], m);
+                        out[1] = stbi__blinn_8x8(255 - out[1], m);
+                        out[2] = stbi__blinn_8x8(255 - out[2], m);
+                        out += n;
+                    }
+                }
+                else { // YCbCr + alpha?  Ignore the fourth channel for now
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                }
+            }
+            else
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = out[1] = out[2] = y[i];
+                    out[3] = 255; // not used if n==3
+                    out += n;
+                }
+        }
+        else {
+            if (is_rgb) {
+                if (n == 1)
+                    for (i = 0; i < z->s->img_x; ++i)
+                        *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                else {
+                    for (i = 0; i < z->s->img_x; ++i, out += 2) {
+                        out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                        out[1] = 255;
+                    }
+                }
+            }
+            else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+                for (i = 0; i < z->s->img_x; ++i) {
+                    stbi_uc m = coutput[3][i];
+                    stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+                    stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+                    stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+                    out[0] = stbi__compute_y(r, g, b);
+                    out[1] = 255;
+                    out += n;
+                }
+            }
+            else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+                    out[1] = 255;
+                    out += n;
+                }
+            }
+            else {
+                stbi_uc* y = coutput[0];
+                if (n == 1)
+                    for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
+                else
+                    for (i = 0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+            }
+        }
+    }
+}
+
+typedef struct
+{
+    stbi__jpeg* z;
+    stbi_uc* output;
+    stbi_uc* scratch;    // per task: decode_n line buffers of img_x + 3 bytes, one output row + 1
+    int scratch_size;
+    int n, decode_n, is_rgb;
+    int tasks;
+} stbi__jpeg_convert_job;
+
+static void stbi__jpeg_convert_task(void* task_data, int index)
+{
+    stbi__jpeg_convert_job* job = (stbi__jpeg_convert_job*)task_data;
+    stbi__jpeg* z = job->z;
+    unsigned int chunk = (z->s->img_y + job->tasks - 1) / job->tasks;
+    unsigned int begin = index * chunk;
+    unsigned int end = begin + chunk < z->s->img_y ? begin + chunk : z->s->img_y;
+    unsigned int row_bytes = job->n * z->s->img_x;
+    stbi_uc* scratch = job->scratch + (size_t)index * job->scratch_size;
+    stbi_uc* linebuf[4] = { NULL, NULL, NULL, NULL };
+    int k;
+    if (begin >= end) return;
+    for (k = 0; k < job->decode_n; ++k)
+        linebuf[k] = scratch + k * (z->s->img_x + 3);
+    if (job->n != 3 || end == z->s->img_y) {
+        stbi__jpeg_convert_rows(z, job->output + row_bytes * begin, job->n, job->decode_n, job->is_rgb, linebuf, begin, end);
+        return;
+    }
+    // the last row's dummy alpha byte would land in the next task's first row
+    stbi__jpeg_convert_rows(z, job->output + row_bytes * begin, job->n, job->decode_n, job->is_rgb, linebuf, begin, end - 1);
+    stbi__jpeg_convert_rows(z, scratch + job->decode_n * (z->s->img_x + 3), job->n, job->decode_n, job->is_rgb, linebuf, end - 1, end);
+    memcpy(job->output + row_bytes * (end - 1), scratch + job->decode_n * (z->s->img_x + 3), row_bytes);
+}
+
+static int stbi__jpeg_convert_parallel(stbi__jpeg* z, stbi_uc* output, int n, int decode_n, int is_rgb)
+{
+    stbi__jpeg_convert_job job;
+    job.z = z;
+    job.output = output;
+    job.n = n;
+    job.decode_n = decode_n;
+    job.is_rgb = is_rgb;
+    job.tasks = stbi__jpeg_task_count(z, z->s->img_y);
+    job.scratch_size = decode_n * (z->s->img_x + 3) + n * z->s->img_x + 1;
+    job.scratch = (stbi_uc*)stbi__malloc_mad2(job.tasks, job.scratch_size, 0);
+    if (!job.scratch) return 0;
+    stbi__jpeg_run(z, job.tasks, stbi__jpeg_convert_task, &job);
+    STBI_FREE(job.scratch);
+    return 1;
+}
+
 static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp, int req_comp)
 {
     int n, decode_n, is_rgb;
@@ -3913,32 +4739,15 @@ static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp
     // resample and color-convert
     {
         int k;
-        unsigned int i, j;
         stbi_uc* output;
-        stbi_uc* coutput[4] = { NULL, NULL, NULL, NULL };
-
-        stbi__resample res_comp[4];
+        stbi_uc* linebuf[4] = { NULL, NULL, NULL, NULL };
 
         for (k = 0; k < decode_n; ++k) {
-            stbi__resample* r = &res_comp[k];
-
             // allocate line buffer big enough for upsampling off the edges
             // with upsample factor of 4
             z->img_comp[k].linebuf = (stbi_uc*)stbi__malloc(z->s->img_x + 3);
             if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
-
-            r->hs = z->img_h_max / z->img_comp[k].h;
-            r->vs = z->img_v_max / z->img_comp[k].v;
-            r->ystep = r->vs >> 1;
-            r->w_lores = (z->s->img_x + r->hs - 1) / r->hs;
-            r->ypos = 0;
-            r->line0 = r->line1 = z->img_comp[k].data;
-
-            if (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
-            else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
-            else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
-            else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
-            else                               r->resample = stbi__resample_row_generic;
+            linebuf[k] = z->img_comp[k].linebuf;
         }
 
         // can't error after this so, this is safe
@@ -3946,109 +4755,15 @@ static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp
         if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
         // now go ahead and resample
-        for (j = 0; j < z->s->img_y; ++j) {
-            stbi_uc* out = output + n * z->s->img_x * j;
-            for (k = 0; k < decode_n; ++k) {
-                stbi__resample* r = &res_comp[k];
-                int y_bot = r->ystep >= (r->vs >> 1);
-                coutput[k] = r->resample(z->img_comp[k].linebuf,
-                    y_bot ? r->line1 : r->line0,
-                    y_bot ? r->line0 : r->line1,
-                    r->w_lores, r->hs);
-                if (++r->ystep >= r->vs) {
-                    r->ystep = 0;
-                    r->line0 = r->line1;
-                    if (++r->ypos < z->img_comp[k].y)
-                        r->line1 += z->img_comp[k].w2;
-                }
-            }
-            if (n >= 3) {
-                stbi_uc* y = coutput[0];
-                if (z->s->img_n == 3) {
-                    if (is_rgb) {
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            out[0] = y[i];
-                            out[1] = coutput[1][i];
-                            out[2] = coutput[2][i];
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else {
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else if (z->s->img_n == 4) {
-                    if (z->app14_color_transform == 0) { // CMYK
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            stbi_uc m = coutput[3][i];
-                            out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                            out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                            out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else if (z->app14_color_transform == 2) { // YCCK
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            stbi_uc m = coutput[3][i];
-                            out[0] = stbi__blinn_8x8(255 - out[0], m);
-                            out[1] = stbi__blinn_8x8(255 - out[1], m);
-                            out[2] = stbi__blinn_8x8(255 - out[2], m);
-                            out += n;
-                        }
-                    }
-                    else { // YCbCr + alpha?  Ignore the fourth channel for now
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = out[1] = out[2] = y[i];
-                        out[3] = 255; // not used if n==3
-                        out += n;
-                    }
-            }
-            else {
-                if (is_rgb) {
-                    if (n == 1)
-                        for (i = 0; i < z->s->img_x; ++i)
-                            *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                    else {
-                        for (i = 0; i < z->s->img_x; ++i, out += 2) {
-                            out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                            out[1] = 255;
-                        }
-                    }
-                }
-                else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        stbi_uc m = coutput[3][i];
-                        stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                        stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                        stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                        out[0] = stbi__compute_y(r, g, b);
-                        out[1] = 255;
-                        out += n;
-                    }
-                }
-                else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                        out[1] = 255;
-                        out += n;
-                    }
-                }
-                else {
-                    stbi_uc* y = coutput[0];
-                    if (n == 1)
-                        for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
-                    else
-                        for (i = 0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-                }
+        if (z->pool && z->pool->tasks > 1) {
+            if (!stbi__jpeg_convert_parallel(z, output, n, decode_n, is_rgb)) {
+                STBI_FREE(output);
+                stbi__cleanup_jpeg(z);
+                return stbi__errpuc("outofmem", "Out of memory");
             }
         }
+        else
+            stbi__jpeg_convert_rows(z, output, n, decode_n, is_rgb, linebuf, 0, z->s->img_y);
         stbi__cleanup_jpeg(z);
         *out_x = z->s->img_x;
         *out_y = z->s->img_y;
@@ -4071,6 +4786,36 @@ static void* stbi__jpeg_load(stbi__context* s, int* x, int* y, int* comp, int re
     return result;
 }
 
+STBIDEF stbi_uc* stbi_load_from_memory_parallel(stbi_uc const* buffer, int len, int* x, int* y, int* comp, int req_comp,
+    stbi_parallel_for parallel_for, void* user, int max_tasks)
+{
+    stbi__context s;
+    stbi__jpeg* j;
+    stbi__jpeg_pool pool;
+    stbi_uc* result;
+    stbi__start_mem(&s, buffer, len);
+    if (!parallel_for || max_tasks <= 1 || !stbi__jpeg_test(&s))
+        return stbi_load_from_memory(buffer, len, x, y, comp, req_comp);
+
+    j = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    if (!j) return stbi__errpuc("outofmem", "Out of memory");
+    memset(j, 0, sizeof(stbi__jpeg));
+    j->s = &s;
+    stbi__setup_jpeg(j);
+    pool.run = parallel_for;
+    pool.user = user;
+    pool.tasks = max_tasks;
+    j->pool = &pool;
+    result = load_jpeg_image(j, x, y, comp, req_comp);
+    STBI_FREE(j);
+
+    if (result && stbi__vertically_flip_on_load) {
+        int channels = req_comp ? req_comp : *comp;
+        stbi__vertical_flip(result, *x, *y, channels * sizeof(stbi_uc));
+    }
+    return result;
+}
+
 static int stbi__jpeg_test(stbi__context* s)
 {
     int r;
@@ -4108,6 +4853,15 @@ static int stbi__jpeg_info(stbi__context* s, int* x, int* y, int* comp)
     STBI_FREE(j);
     return result;
 }
+#else
+STBIDEF stbi_uc* stbi_load_from_memory_parallel(stbi_uc const* buffer, int len, int* x, int* y, int* comp, int req_comp,
+    stbi_parallel_for parallel_for, void* user, int max_tasks)
+{
+    STBI_NOTUSED(parallel_for);
+    STBI_NOTUSED(user);
+    STBI_NOTUSED(max_tasks);
+    return stbi_load_from_memory(buffer, len, x, y, comp, req_comp);
+}
 #endif
 
 // public domain zlib decode    v0.2  Sean Barrett 2006-11-18
@@ -3,18 +3,37 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aAttr;   // sphere: normal, tetra: color
 
 out vec3 vAttr;
+out vec3 vNormal;      // world space, unnormalized
 out vec3 vWorldPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// bit-identical to depth.vert for the pre-pass's GL_EQUAL test
+invariant gl_Position;
+
+// affine model transform, its three rows as the columns (Affine3x4.h)
+uniform mat3x4 model;
+#ifdef CPU_MVP
+uniform mat4 mvp;          // viewProj * model, per draw (FrameParams::computeMvp)
+#else
+uniform mat4 viewProj;     // projection * view, once per frame
+#endif
 
 void main()
 {
     vAttr = aAttr;
 
-    vec4 world = model * vec4(aPos, 1.0);
-    vWorldPos = world.xyz;
+    vec3 world = vec4(aPos, 1.0) * model;
+    vWorldPos = world;
+
+    // normal matrix = cofactors of the linear part over its determinant
+    mat3 linear = transpose(mat3(model));
+    vec3 c0 = cross(linear[1], linear[2]);
+    vec3 c1 = cross(linear[2], linear[0]);
+    vec3 c2 = cross(linear[0], linear[1]);
+    vNormal = mat3(c0, c1, c2) * aAttr / dot(linear[0], c0);
 
-    gl_Position = projection * view * world;
+#ifdef CPU_MVP
+    gl_Position = mvp * vec4(aPos, 1.0);
+#else
+    gl_Position = viewProj * vec4(world, 1.0);
+#endif
 }
@@ -0,0 +1,42 @@
+#ifndef BENCH_GL_H
+#define BENCH_GL_H
+
+// Headless GL shared by the benchmarks that draw.
+
+#include "FileView.h"
+#include "HeadlessContext.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+// One context for the whole process, created by the first benchmark that
+// asks (at its size); nullptr when there is none.
+inline HeadlessContext* BenchGlContext(int width, int height)
+{
+    static HeadlessContext context;
+    static int created = -1;
+    if (created < 0)
+        created = context.Create(width, height) ? 1 : 0;
+    return created ? &context : nullptr;
+}
+
+// false, with the benchmark skipped, without a context or when `asset` (a
+// file the build copies next to the binaries, if not nullptr) is missing
+inline bool BenchGlReady(benchmark::State& state, int width, int height, const char* asset)
+{
+    if (!BenchGlContext(width, height))
+    {
+        state.SkipWithError("no headless GL context");
+        return false;
+    }
+    if (asset && !FileView(asset).valid())
+    {
+        std::string message = std::string("run from the build directory (needs ") + asset + ")";
+        state.SkipWithError(message.c_str());
+        return false;
+    }
+    return true;
+}
+
+#endif
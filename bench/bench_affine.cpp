@@ -0,0 +1,143 @@
+// Per-object transform math for one million objects, glm::mat4 against
+// Affine3x4 (RenderQueue.h's model type): building translate * rotate
+// models, inverting them (general and rigid) and deriving normal matrices,
+// plus the bytes each representation stores per object.
+#include "Affine3x4.h"
+#include "RenderQueue.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+static const size_t COUNT = 1 << 20;
+
+struct Objects
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::mat4> mat4s;
+    std::vector<Affine3x4> affines;
+    std::vector<glm::mat3> normals;
+    glm::mat4 rotation;
+};
+
+static Objects& Get()
+{
+    static Objects o;
+    if (!o.positions.empty())
+        return o;
+    uint32_t noise = 3;
+    o.positions.resize(COUNT);
+    for (glm::vec3& p : o.positions)
+        for (int k = 0; k < 3; ++k)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            p[k] = (float)(noise >> 8) / 16777216.0f * 100.0f - 50.0f;
+        }
+    o.rotation = glm::rotate(glm::mat4(1.0f), 0.7f, glm::vec3(0.5f, 1.0f, 0.0f));
+    o.mat4s.resize(COUNT);
+    o.affines.resize(COUNT);
+    o.normals.resize(COUNT);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        o.mat4s[i] = glm::translate(glm::mat4(1.0f), o.positions[i]) * o.rotation;
+        o.affines[i] = Affine3x4::FromMat4(o.mat4s[i]);
+    }
+    return o;
+}
+
+static void Rates(benchmark::State& state, size_t bytesPerObject)
+{
+    state.SetItemsProcessed(state.iterations() * (int64_t)COUNT);
+    state.counters["bytes/object"] = (double)bytesPerObject;
+}
+
+// ---------- model composition, as FramePipeline builds it ----------
+static void BM_ComposeMat4(benchmark::State& state)
+{
+    Objects& o = Get();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+            o.mat4s[i] = glm::translate(glm::mat4(1.0f), o.positions[i]) * o.rotation;
+        benchmark::ClobberMemory();
+    }
+    Rates(state, sizeof(glm::mat4));
+}
+BENCHMARK(BM_ComposeMat4)->Unit(benchmark::kMillisecond);
+
+static void BM_ComposeAffine(benchmark::State& state)
+{
+    Objects& o = Get();
+    Affine3x4 rotation = Affine3x4::FromMat4(o.rotation);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+            o.affines[i] = Affine3x4::Translation(o.positions[i]) * rotation;
+        benchmark::ClobberMemory();
+    }
+    Rates(state, sizeof(Affine3x4));
+}
+BENCHMARK(BM_ComposeAffine)->Unit(benchmark::kMillisecond);
+
+// ---------- inverse ----------
+static void BM_InverseMat4(benchmark::State& state)
+{
+    Objects& o = Get();
+    glm::mat4 sum(0.0f);
+    for (auto _ : state)
+        for (size_t i = 0; i < COUNT; ++i)
+            sum += glm::inverse(o.mat4s[i]);
+    benchmark::DoNotOptimize(sum);
+    Rates(state, sizeof(glm::mat4));
+}
+BENCHMARK(BM_InverseMat4)->Unit(benchmark::kMillisecond);
+
+// state.range(0): 1 = InverseRigid
+static void BM_InverseAffine(benchmark::State& state)
+{
+    Objects& o = Get();
+    bool rigid = state.range(0) != 0;
+    Affine3x4 sum = {};
+    for (auto _ : state)
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            Affine3x4 inv = rigid ? InverseRigid(o.affines[i]) : Inverse(o.affines[i]);
+            for (int r = 0; r < 3; ++r)
+                sum.rows[r] += inv.rows[r];
+        }
+    benchmark::DoNotOptimize(sum);
+    Rates(state, sizeof(Affine3x4));
+}
+BENCHMARK(BM_InverseAffine)->ArgName("rigid")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// ---------- normal matrix ----------
+static void BM_NormalMatrixMat4(benchmark::State& state)
+{
+    Objects& o = Get();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+            o.normals[i] = glm::mat3(glm::transpose(glm::inverse(o.mat4s[i])));
+        benchmark::ClobberMemory();
+    }
+    Rates(state, sizeof(glm::mat4));
+}
+BENCHMARK(BM_NormalMatrixMat4)->Unit(benchmark::kMillisecond);
+
+static void BM_NormalMatrixAffine(benchmark::State& state)
+{
+    Objects& o = Get();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+            o.normals[i] = NormalMatrix(o.affines[i]);
+        benchmark::ClobberMemory();
+    }
+    Rates(state, sizeof(Affine3x4));
+}
+BENCHMARK(BM_NormalMatrixAffine)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
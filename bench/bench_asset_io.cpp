@@ -0,0 +1,273 @@
+// Asset I/O: 1000 files (a third each JPEG, GLSL, mesh blob) loaded through
+// the old std::ifstream + std::stringstream path vs mapped FileViews, with a
+// warm page cache and with every file evicted first (posix_fadvise
+// DONTNEED, Linux only). Each asset is consumed the same way in both paths:
+// stbi_info_from_memory for images, ParseMeshBlob for meshes, and a checksum
+// over every byte standing in for glShaderSource / glBufferData copies.
+// JPEG decoding is left out on purpose so the numbers are about I/O.
+#include "FileView.h"
+#include "Mesh.h"
+#include "stb_image.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const int ASSET_COUNT = 1000;
+static const char* ASSET_DIR = "bench_assets";
+
+enum AssetKind { ASSET_IMAGE, ASSET_SHADER, ASSET_MESH };
+
+struct Asset
+{
+    std::string name;       // relative to ASSET_DIR
+    AssetKind kind;
+};
+
+static std::vector<unsigned char> ReadWhole(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteWhole(const std::string& path, const std::vector<unsigned char>& bytes)
+{
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return;
+    std::fwrite(bytes.data(), 1, bytes.size(), f);
+    std::fflush(f);
+#ifdef __linux__
+    fdatasync(fileno(f));   // dirty pages cannot be evicted
+#endif
+    std::fclose(f);
+}
+
+// writes the asset set into the working directory once per process
+static const std::vector<Asset>& Assets()
+{
+    static std::vector<Asset> assets;
+    if (!assets.empty())
+        return assets;
+
+#ifdef _WIN32
+    CreateDirectoryA(ASSET_DIR, NULL);
+#else
+    std::string mk = std::string("mkdir -p ") + ASSET_DIR;
+    if (std::system(mk.c_str()) != 0)
+        return assets;
+#endif
+
+    std::vector<unsigned char> image = ReadWhole("res.jpg");
+    std::vector<unsigned char> shaders[2] = { ReadWhole("vertex.vert"), ReadWhole("fragment.frag") };
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    GenerateSpherePN(1.0f, SPHERE_LODS[0][0], SPHERE_LODS[0][1], vertices, indices);
+
+    for (int i = 0; i < ASSET_COUNT; ++i)
+    {
+        char name[64];
+        Asset a;
+        a.kind = (AssetKind)(i % 3);
+        switch (a.kind)
+        {
+        case ASSET_IMAGE:
+            std::snprintf(name, sizeof(name), "image_%04d.jpg", i);
+            WriteWhole(std::string(ASSET_DIR) + "/" + name, image);
+            break;
+        case ASSET_SHADER:
+            std::snprintf(name, sizeof(name), "shader_%04d.glsl", i);
+            WriteWhole(std::string(ASSET_DIR) + "/" + name, shaders[i & 1]);
+            break;
+        default:
+            std::snprintf(name, sizeof(name), "mesh_%04d.mesh", i);
+            WriteMeshBlob((std::string(ASSET_DIR) + "/" + name).c_str(), vertices, indices);
+            break;
+        }
+        a.name = name;
+        assets.push_back(a);
+    }
+    return assets;
+}
+
+static uint64_t Checksum(const unsigned char* data, size_t size)
+{
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        sum += word;
+    }
+    for (; i < size; ++i)
+        sum += data[i];
+    return sum;
+}
+
+// the same work for both paths, so only the way the bytes arrive differs
+static uint64_t Consume(AssetKind kind, const unsigned char* data, size_t size)
+{
+    uint64_t sum = Checksum(data, size);
+    if (kind == ASSET_IMAGE)
+    {
+        int w = 0, h = 0, c = 0;
+        if (stbi_info_from_memory(data, (int)size, &w, &h, &c))
+            sum += (uint64_t)w * h;
+    }
+    else if (kind == ASSET_MESH)
+    {
+        MeshBlobView mesh;
+        if (ParseMeshBlob(data, size, mesh))
+            sum += mesh.indexCount;
+    }
+    return sum;
+}
+
+#ifdef __linux__
+static bool Evict(const std::vector<Asset>& assets)
+{
+    for (const Asset& a : assets)
+    {
+        int fd = open((std::string(ASSET_DIR) + "/" + a.name).c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+    return true;
+}
+
+// fraction of the first asset's pages still in the page cache
+static double ResidentFraction(const Asset& a)
+{
+    FileView view((std::string(ASSET_DIR) + "/" + a.name).c_str());
+    long page = sysconf(_SC_PAGESIZE);
+    size_t pages = (view.size() + page - 1) / page;
+    if (!pages)
+        return 0.0;
+    std::vector<unsigned char> resident(pages);
+    if (mincore((void*)view.data(), view.size(), resident.data()) != 0)
+        return -1.0;
+    size_t count = 0;
+    for (unsigned char r : resident)
+        count += r & 1;
+    return (double)count / pages;
+}
+#endif
+
+// state.range(0): 1 = evict every file before each iteration
+static bool PrepareIteration(benchmark::State& state, const std::vector<Asset>& assets)
+{
+    if (!state.range(0))
+        return true;
+#ifdef __linux__
+    state.PauseTiming();
+    bool ok = Evict(assets);
+    state.ResumeTiming();
+    return ok;
+#else
+    (void)assets;
+    return false;
+#endif
+}
+
+static void Report(benchmark::State& state, const std::vector<Asset>& assets, uint64_t bytes)
+{
+    state.SetItemsProcessed(state.iterations() * assets.size());
+    state.SetBytesProcessed((int64_t)bytes);
+#ifdef __linux__
+    // tmpfs and some overlay mounts ignore DONTNEED: "cold" is only cold if this is ~0
+    if (state.range(0))
+    {
+        Evict(assets);
+        state.counters["resident_after_evict"] = ResidentFraction(assets[0]);
+    }
+#endif
+}
+
+static void BM_LoadAssets_Stream(benchmark::State& state)
+{
+    const std::vector<Asset>& assets = Assets();
+    if (assets.empty())
+    {
+        state.SkipWithError("cannot write bench_assets");
+        return;
+    }
+
+    uint64_t bytes = 0, sink = 0;
+    for (auto _ : state)
+    {
+        if (!PrepareIteration(state, assets))
+        {
+            state.SkipWithError("page cache eviction not available");
+            return;
+        }
+        for (const Asset& a : assets)
+        {
+            // what Shader.h used to do: ifstream -> stringstream -> std::string
+            std::ifstream file((std::string(ASSET_DIR) + "/" + a.name).c_str(), std::ios::binary);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            std::string content = stream.str();
+            sink += Consume(a.kind, (const unsigned char*)content.data(), content.size());
+            bytes += content.size();
+        }
+    }
+    benchmark::DoNotOptimize(sink);
+    Report(state, assets, bytes);
+}
+BENCHMARK(BM_LoadAssets_Stream)->ArgName("cold")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_LoadAssets_Mmap(benchmark::State& state)
+{
+    const std::vector<Asset>& assets = Assets();
+    if (assets.empty())
+    {
+        state.SkipWithError("cannot write bench_assets");
+        return;
+    }
+
+    Vfs vfs;
+    vfs.Mount(ASSET_DIR);
+    uint64_t bytes = 0, sink = 0;
+    for (auto _ : state)
+    {
+        if (!PrepareIteration(state, assets))
+        {
+            state.SkipWithError("page cache eviction not available");
+            return;
+        }
+        for (const Asset& a : assets)
+        {
+            FileView view = vfs.Open(a.name.c_str());
+            sink += Consume(a.kind, view.data(), view.size());
+            bytes += view.size();
+        }
+    }
+    benchmark::DoNotOptimize(sink);
+    Report(state, assets, bytes);
+}
+BENCHMARK(BM_LoadAssets_Mmap)->ArgName("cold")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
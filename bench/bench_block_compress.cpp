@@ -0,0 +1,109 @@
+// BC1/BC3 encode throughput and quality. BM_CompressBlocks encodes a
+// photo-like 4:4:4 test pattern (gradients, waves and grain, with an alpha
+// ramp for BC3) at 1024 and 4096 on 1 and 4 threads and reports MP/s and
+// the PSNR of the decoded result. BM_CompressCorpus runs res.jpg, which is
+// the texture the scene streams. BM_DecompressBlocks is the CPU fallback
+// used when the context has no S3TC.
+#include "BlockCompress.h"
+#include "ImageDecode.h"
+#include "JobSystem.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+static const std::vector<unsigned char>& Pattern(int size)
+{
+    static std::map<int, std::vector<unsigned char>> images;
+    std::vector<unsigned char>& pixels = images[size];
+    if (!pixels.empty())
+        return pixels;
+    pixels.resize((size_t)size * size * 4);
+    uint32_t noise = 5;
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            int grain = (int)(noise >> 28) - 8;
+            unsigned char* p = &pixels[((size_t)y * size + x) * 4];
+            int v[4] = { x * 255 / size + grain, y * 255 / size + grain,
+                128 + (int)(80.0f * std::sin(x * 0.02f) * std::cos(y * 0.03f)) + grain, 255 * x / size };
+            for (int c = 0; c < 4; ++c)
+                p[c] = (unsigned char)(v[c] < 0 ? 0 : v[c] > 255 ? 255 : v[c]);
+        }
+    return pixels;
+}
+
+static double Psnr(BlockFormat format, const unsigned char* rgba, int w, int h, const std::vector<unsigned char>& blocks)
+{
+    std::vector<unsigned char> decoded((size_t)w * h * 4);
+    DecompressBlocks(format, blocks.data(), w, h, decoded.data());
+    int channels = format == BLOCK_BC1 ? 3 : 4;
+    double sum = 0.0;
+    for (size_t i = 0; i < decoded.size(); ++i)
+    {
+        if ((int)(i % 4) < channels)
+        {
+            double d = (double)decoded[i] - rgba[i];
+            sum += d * d;
+        }
+    }
+    double mse = sum / ((double)w * h * channels);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+static void Encode(benchmark::State& state, BlockFormat format, const unsigned char* rgba, int w, int h, unsigned int threads)
+{
+    JobSystem jobs(threads - 1);
+    std::vector<unsigned char> blocks(BlockCompressedSize(format, w, h));
+    for (auto _ : state)
+    {
+        CompressBlocks(&jobs, format, rgba, w, h, blocks.data());
+        benchmark::DoNotOptimize(blocks[0]);
+    }
+    state.counters["MP/s"] = benchmark::Counter(state.iterations() * (double)w * h * 1e-6, benchmark::Counter::kIsRate);
+    state.counters["PSNR_dB"] = Psnr(format, rgba, w, h, blocks);
+}
+
+static void BM_CompressBlocks(benchmark::State& state)
+{
+    int size = (int)state.range(1);
+    Encode(state, state.range(0) == 1 ? BLOCK_BC1 : BLOCK_BC3, Pattern(size).data(), size, size, (unsigned int)state.range(2));
+}
+BENCHMARK(BM_CompressBlocks)
+    ->ArgNames({ "bc", "size", "threads" })
+    ->ArgsProduct({ { 1, 3 }, { 1024, 4096 }, { 1, 4 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_CompressCorpus(benchmark::State& state)
+{
+    static DecodedImage image;
+    if (!image.pixels && !DecodeImage("res.jpg", 4, image))
+    {
+        state.SkipWithError("res.jpg missing");
+        return;
+    }
+    Encode(state, state.range(0) == 1 ? BLOCK_BC1 : BLOCK_BC3, image.pixels, image.width, image.height, 1);
+}
+BENCHMARK(BM_CompressCorpus)->ArgName("bc")->Arg(1)->Arg(3)->Unit(benchmark::kMillisecond);
+
+static void BM_DecompressBlocks(benchmark::State& state)
+{
+    const int size = 1024;
+    BlockFormat format = state.range(0) == 1 ? BLOCK_BC1 : BLOCK_BC3;
+    std::vector<unsigned char> blocks(BlockCompressedSize(format, size, size));
+    CompressBlocks(nullptr, format, Pattern(size).data(), size, size, blocks.data());
+    std::vector<unsigned char> rgba((size_t)size * size * 4);
+    for (auto _ : state)
+    {
+        DecompressBlocks(format, blocks.data(), size, size, rgba.data());
+        benchmark::DoNotOptimize(rgba[0]);
+    }
+    state.counters["MP/s"] = benchmark::Counter(state.iterations() * (double)size * size * 1e-6, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_DecompressBlocks)->ArgName("bc")->Arg(1)->Arg(3)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
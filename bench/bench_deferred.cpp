@@ -0,0 +1,80 @@
+// Forward against deferred shading of the default scene plus 0 to 5000
+// clustered point lights, through SceneRenderer (headless GL, 400x300,
+// glFinish per frame). Both modes use the same froxel light lists; deferred
+// shades each covered pixel once from the G-buffer (RG16 octahedral normal,
+// RGBA8 albedo, 24-bit depth) instead of every fragment that passes the
+// depth test. Counters, from GL_SAMPLES_PASSED on one frame of each mode:
+//   frags/px  fragments written by the geometry per pixel (overdraw)
+//   B/px      colour / G-buffer bytes written and read per pixel: forward
+//             writes RGBA8 + depth per fragment; deferred writes 12 bytes per
+//             fragment, copies the depth to the target (4 + 4 per pixel),
+//             then reads 12 and writes RGBA8 per covered pixel. Depth test
+//             reads and clears are left out of both.
+// Run from the build directory (the shaders are read from the working
+// directory).
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "BenchGl.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+static const int WIDTH = 400;
+static const int HEIGHT = 300;
+
+// samples that passed the depth test over one frame in `mode`
+static double SamplesPassed(SceneRenderer& renderer, ShadingMode mode)
+{
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    renderer.SetShadingMode(mode);
+    glBeginQuery(GL_SAMPLES_PASSED, query);
+    renderer.Render(0.0f, WIDTH, HEIGHT, nullptr);
+    glEndQuery(GL_SAMPLES_PASSED);
+    GLuint samples = 0;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+    glDeleteQueries(1, &query);
+    return (double)samples;
+}
+
+// state.range(0): ShadingMode, state.range(1): lights
+static void BM_Shading(benchmark::State& state)
+{
+    if (!BenchGlReady(state, WIDTH, HEIGHT, "deferred.frag"))
+        return;
+
+    Scene scene = BuildDefaultScene();
+    AddLightField(scene, (size_t)state.range(1));
+    JobSystem jobs(0);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    ShadingMode mode = (ShadingMode)state.range(0);
+
+    // the lighting pass's fragments are the covered pixels
+    double pixels = (double)WIDTH * HEIGHT;
+    double fragments = SamplesPassed(*renderer, SHADING_FORWARD);
+    double covered = SamplesPassed(*renderer, SHADING_DEFERRED) - fragments;
+    double bytes = mode == SHADING_FORWARD ? fragments * 8.0
+        : fragments * SceneRenderer::GBUFFER_BYTES_PER_PIXEL + pixels * 8.0 + covered * (SceneRenderer::GBUFFER_BYTES_PER_PIXEL + 4.0);
+
+    renderer->SetShadingMode(mode);
+    float t = 0.0f;
+    for (auto _ : state)
+    {
+        renderer->Render(t, WIDTH, HEIGHT, nullptr);
+        glFinish();
+        t += 1.0f / 60.0f;
+    }
+    state.SetLabel(mode == SHADING_FORWARD ? "forward" : "deferred");
+    state.counters["frags/px"] = fragments / pixels;
+    state.counters["B/px"] = bytes / pixels;
+    renderer.reset();
+}
+BENCHMARK(BM_Shading)
+    ->ArgNames({ "mode", "lights" })
+    ->ArgsProduct({ { SHADING_FORWARD, SHADING_DEFERRED }, { 0, 100, 1000, 5000 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
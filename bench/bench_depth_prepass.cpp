@@ -0,0 +1,58 @@
+// Depth pre-pass and draw order on the default scene plus layers of objects
+// straight behind it (BuildLayeredScene) and clustered point lights, through
+// SceneRenderer (headless GL, 400x300, glFinish per frame). With the
+// pre-pass the colour pass shades each visible pixel once (GL_EQUAL) at the
+// cost of drawing every vertex twice; front-to-back order cuts the fragments
+// GL_LESS lets through without the extra pass. Counters, from the renderer's GL_SAMPLES_PASSED
+// queries:
+//   depth/px   fragments written by the depth pre-pass per pixel
+//   shaded/px  fragments the colour pass shaded per pixel
+// Run from the build directory (the shaders are read from the working
+// directory).
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "BenchGl.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+static const int WIDTH = 400;
+static const int HEIGHT = 300;
+
+// state.range(0): layered objects, state.range(1): lights,
+// state.range(2): 1 = front to back, state.range(3): 1 = depth pre-pass
+static void BM_Prepass(benchmark::State& state)
+{
+    if (!BenchGlReady(state, WIDTH, HEIGHT, "depth.vert"))
+        return;
+
+    Scene scene = BuildLayeredScene((size_t)state.range(0));
+    AddLightField(scene, (size_t)state.range(1));
+    JobSystem jobs(0);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    renderer->SetFrontToBack(state.range(2) != 0);
+    renderer->SetDepthPrepass(state.range(3) != 0);
+    renderer->SetCountFragments(true);
+
+    float t = 0.0f;
+    for (auto _ : state)
+    {
+        renderer->Render(t, WIDTH, HEIGHT, nullptr);
+        glFinish();
+        t += 1.0f / 60.0f;
+    }
+    const FragmentStats& f = renderer->fragmentStats();
+    double pixels = (double)WIDTH * HEIGHT * (f.frames ? f.frames : 1);
+    state.counters["depth/px"] = f.depthFragments / pixels;
+    state.counters["shaded/px"] = f.colorFragments / pixels;
+    renderer.reset();
+}
+BENCHMARK(BM_Prepass)
+    ->ArgNames({ "objects", "lights", "front_to_back", "prepass" })
+    ->ArgsProduct({ { 150 }, { 0, 2000 }, { 0, 1 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,81 @@
+// Job system microbenchmarks: spawn/wait and steal latency, fork-join scaling.
+#include "JobSystem.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+// submit one empty job and wait for it; main thread may run it itself
+static void BM_SpawnWait(benchmark::State& state)
+{
+    JobSystem jobs((unsigned int)state.range(0));
+    for (auto _ : state)
+    {
+        JobCounter counter;
+        jobs.Run(counter, [] {});
+        jobs.Wait(counter);
+    }
+}
+BENCHMARK(BM_SpawnWait)->Arg(0)->Arg(1)->Arg(3);
+
+// main thread only spins, so every job has to be stolen by a worker
+static void BM_StealLatency(benchmark::State& state)
+{
+    JobSystem jobs(1);
+    for (auto _ : state)
+    {
+        JobCounter counter;
+        jobs.Run(counter, [] {});
+        while (!counter.done())
+        {
+        }
+    }
+}
+BENCHMARK(BM_StealLatency)->UseRealTime();
+
+// spawn a batch of empty jobs and wait (per-job overhead)
+static void BM_SpawnBatch(benchmark::State& state)
+{
+    JobSystem jobs((unsigned int)state.range(0));
+    const int batch = 1024;
+    for (auto _ : state)
+    {
+        JobCounter counter;
+        for (int i = 0; i < batch; ++i)
+            jobs.Run(counter, [] {});
+        jobs.Wait(counter);
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_SpawnBatch)->Arg(0)->Arg(1)->Arg(3)->UseRealTime();
+
+// fixed amount of ALU work split across 1..64 threads
+static void BM_ForkJoin(benchmark::State& state)
+{
+    unsigned int threads = (unsigned int)state.range(0);
+    JobSystem jobs(threads - 1);
+
+    const size_t count = 1 << 20;
+    std::vector<float> data(count, 1.0f);
+    float* values = data.data();
+    auto kernel = [values](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            values[i] = std::sqrt(values[i] * 1.0001f + 0.5f);
+    };
+    size_t grain = count / (threads * 8);
+
+    for (auto _ : state)
+    {
+        JobCounter counter;
+        jobs.ParallelFor(counter, count, grain, kernel);
+        jobs.Wait(counter);
+        benchmark::DoNotOptimize(values[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ForkJoin)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,94 @@
+// JPEG decode throughput on a 24 MP (6000x4000) 4:2:0 photo-like image:
+// plain stbi_load_from_memory against stbi_load_from_memory_parallel on the
+// job system. "restart" = 1 encodes one restart interval per MCU row, so the
+// entropy decode splits across threads too; without restarts only the IDCT
+// and upsampling/color conversion do.
+#include "ImageDecode.h"
+#include "ImageWrite.h"
+#include "JobSystem.h"
+#include "stb_image.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+static const int WIDTH = 6000;
+static const int HEIGHT = 4000;
+
+// smooth gradients plus fine texture, so the entropy decode has real work
+static const std::vector<unsigned char>& Encoded(bool restarts)
+{
+    static std::vector<unsigned char> files[2];
+    std::vector<unsigned char>& file = files[restarts];
+    if (!file.empty())
+        return file;
+
+    std::vector<unsigned char> pixels((size_t)WIDTH * HEIGHT * 3);
+    uint32_t noise = 12345;
+    for (int y = 0; y < HEIGHT; ++y)
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            int grain = (int)(noise >> 28) - 8;
+            float wave = 60.0f * std::sin(x * 0.013f) * std::cos(y * 0.011f);
+            unsigned char* p = &pixels[((size_t)y * WIDTH + x) * 3];
+            int v[3] = { x * 255 / WIDTH + grain, y * 255 / HEIGHT + grain, 128 + (int)wave + grain };
+            for (int c = 0; c < 3; ++c)
+                p[c] = (unsigned char)(v[c] < 0 ? 0 : v[c] > 255 ? 255 : v[c]);
+        }
+    int mcusPerRow = (WIDTH + 15) / 16;
+    EncodeJpeg(file, WIDTH, HEIGHT, 3, pixels.data(), 90, restarts ? mcusPerRow : 0);
+    return file;
+}
+
+static void Report(benchmark::State& state)
+{
+    state.counters["MP/s"] = benchmark::Counter(state.iterations() * (double)WIDTH * HEIGHT * 1e-6,
+        benchmark::Counter::kIsRate);
+}
+
+static void BM_JpegDecodeSerial(benchmark::State& state)
+{
+    const std::vector<unsigned char>& file = Encoded(state.range(0) != 0);
+    for (auto _ : state)
+    {
+        int w = 0, h = 0, c = 0;
+        unsigned char* pixels = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, 4);
+        if (!pixels)
+        {
+            state.SkipWithError(stbi_failure_reason());
+            return;
+        }
+        benchmark::DoNotOptimize(pixels[0]);
+        stbi_image_free(pixels);
+    }
+    Report(state);
+}
+BENCHMARK(BM_JpegDecodeSerial)->ArgName("restart")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_JpegDecodeParallel(benchmark::State& state)
+{
+    int threads = (int)state.range(0);
+    const std::vector<unsigned char>& file = Encoded(state.range(1) != 0);
+    JobSystem jobs(threads - 1);
+    for (auto _ : state)
+    {
+        DecodedImage image;
+        if (!DecodeImageParallel(jobs, file.data(), file.size(), 4, image))
+        {
+            state.SkipWithError(stbi_failure_reason());
+            return;
+        }
+        benchmark::DoNotOptimize(image.pixels[0]);
+        FreeDecodedImage(image);
+    }
+    Report(state);
+}
+BENCHMARK(BM_JpegDecodeParallel)
+    ->ArgNames({ "threads", "restart" })
+    ->ArgsProduct({ { 1, 2, 4, 8, 16 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
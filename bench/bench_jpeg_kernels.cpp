@@ -0,0 +1,90 @@
+// JPEG decode throughput with the SSE2 kernels vs the AVX2 ones (two-block
+// IDCT, 16-pixel upsampling and color conversion), single-threaded, over the
+// texture sizes the scene loads: square 4:2:0 RGBA textures from 256 to 4096
+// and the progressive res.jpg. The AVX2 rows skip on CPUs without AVX2.
+#include "FileView.h"
+#include "ImageWrite.h"
+#include "stb_image.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+static const std::vector<unsigned char>& Encoded(int size)
+{
+    static std::map<int, std::vector<unsigned char>> files;
+    std::vector<unsigned char>& file = files[size];
+    if (!file.empty())
+        return file;
+
+    std::vector<unsigned char> pixels((size_t)size * size * 3);
+    uint32_t noise = 99;
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            int grain = (int)(noise >> 28) - 8;
+            unsigned char* p = &pixels[((size_t)y * size + x) * 3];
+            int v[3] = { x * 255 / size + grain, y * 255 / size + grain,
+                128 + (int)(60.0f * std::sin(x * 0.03f) * std::cos(y * 0.02f)) + grain };
+            for (int c = 0; c < 3; ++c)
+                p[c] = (unsigned char)(v[c] < 0 ? 0 : v[c] > 255 ? 255 : v[c]);
+        }
+    EncodeJpeg(file, size, size, 3, pixels.data(), 90);
+    return file;
+}
+
+static void Decode(benchmark::State& state, const unsigned char* data, size_t size)
+{
+    bool avx2 = state.range(1) != 0;
+    if (stbi_set_jpeg_avx2(avx2 ? 1 : 0) != avx2)
+    {
+        stbi_set_jpeg_avx2(1);
+        state.SkipWithError("AVX2 not available");
+        return;
+    }
+
+    double pixels = 0.0;
+    for (auto _ : state)
+    {
+        int w = 0, h = 0, c = 0;
+        unsigned char* image = stbi_load_from_memory(data, (int)size, &w, &h, &c, 4);
+        if (!image)
+        {
+            state.SkipWithError(stbi_failure_reason());
+            break;
+        }
+        benchmark::DoNotOptimize(image[0]);
+        stbi_image_free(image);
+        pixels += (double)w * h;
+    }
+    stbi_set_jpeg_avx2(1);
+    state.counters["MP/s"] = benchmark::Counter(pixels * 1e-6, benchmark::Counter::kIsRate);
+}
+
+static void BM_JpegDecodeTexture(benchmark::State& state)
+{
+    const std::vector<unsigned char>& file = Encoded((int)state.range(0));
+    Decode(state, file.data(), file.size());
+}
+BENCHMARK(BM_JpegDecodeTexture)
+    ->ArgNames({ "size", "avx2" })
+    ->ArgsProduct({ { 256, 512, 1024, 2048, 4096 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_JpegDecodeProgressive(benchmark::State& state)
+{
+    FileView file("res.jpg");
+    if (!file.valid())
+    {
+        state.SkipWithError("res.jpg missing");
+        return;
+    }
+    Decode(state, file.data(), file.size());
+}
+BENCHMARK(BM_JpegDecodeProgressive)->ArgNames({ "", "avx2" })->Args({ 0, 0 })->Args({ 0, 1 })->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,106 @@
+// Clustered point lights, 1k to 10k of them. BM_AssignLights is the CPU
+// side alone: LightClusters::Build on 1 and 4 job threads, with every light
+// in the field around the default scene's objects. BM_RenderLights draws the
+// default scene through SceneRenderer (headless GL, 400x300, glFinish per
+// frame) in two layouts: all lights in the field, so the lights per froxel
+// grow with the count, and 1000 lights in the field with the rest behind
+// the camera, where the per-froxel lists and so the shading cost should
+// stay flat however many lights there are. Run from the build directory
+// (the shaders are read from the working directory).
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "BenchGl.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+static const int WIDTH = 400;
+static const int HEIGHT = 300;
+static const size_t ONSCREEN = 1000;
+
+// state.range(1): 1 = only ONSCREEN lights in the field, the rest behind the camera
+static Scene LightScene(size_t lights, bool fixedDensity)
+{
+    Scene scene = BuildDefaultScene();
+    AddLightField(scene, lights);
+    if (fixedDensity)
+        for (size_t i = ONSCREEN; i < scene.lights.size(); ++i)
+            scene.lights[i].center.z += 30.0f;
+    return scene;
+}
+
+static void Stats(benchmark::State& state, const LightClusters& clusters)
+{
+    size_t used = 0, most = 0;
+    for (int c = 0; c < CLUSTER_COUNT; ++c)
+    {
+        size_t n = clusters.ranges()[c * 2 + 1];
+        used += n ? 1 : 0;
+        most = std::max(most, n);
+    }
+    state.counters["lights/froxel"] = used ? (double)clusters.indexCount() / used : 0.0;
+    state.counters["max/froxel"] = (double)most;
+    state.counters["dropped"] = (double)clusters.droppedCount();
+}
+
+// ---------- CPU assignment ----------
+// state.range(0): lights, state.range(1): threads
+static void BM_AssignLights(benchmark::State& state)
+{
+    Scene scene = LightScene((size_t)state.range(0), false);
+    std::vector<PointLight> lights(scene.lights.size());
+    for (size_t i = 0; i < lights.size(); ++i)
+        lights[i] = { LightPosition(scene.lights[i], 0.0f), scene.lights[i].range, scene.lights[i].color, 0.0f };
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 8.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / HEIGHT, 0.1f, 200.0f);
+
+    JobSystem jobs((unsigned int)state.range(1) - 1);
+    LightClusters clusters(jobs);
+    for (auto _ : state)
+    {
+        clusters.Build(view, projection, lights.data(), lights.size());
+        benchmark::DoNotOptimize(clusters.indices());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)lights.size());
+    Stats(state, clusters);
+}
+BENCHMARK(BM_AssignLights)
+    ->ArgNames({ "lights", "threads" })
+    ->ArgsProduct({ { 1000, 2000, 5000, 10000 }, { 1, 4 } })
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// ---------- full frames ----------
+// state.range(0): lights, state.range(1): 1 = ONSCREEN lights in view, the rest behind the camera
+static void BM_RenderLights(benchmark::State& state)
+{
+    if (!BenchGlReady(state, WIDTH, HEIGHT, "fragment.frag"))
+        return;
+
+    Scene scene = LightScene((size_t)state.range(0), state.range(1) != 0);
+    JobSystem jobs(0);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    float t = 0.0f;
+    for (auto _ : state)
+    {
+        renderer->Render(t, WIDTH, HEIGHT, nullptr);
+        glFinish();
+        t += 1.0f / 60.0f;
+    }
+    Stats(state, renderer->lightClusters());
+    renderer.reset();
+}
+BENCHMARK(BM_RenderLights)
+    ->ArgNames({ "lights", "fixed_density" })
+    ->ArgsProduct({ { 1000, 2000, 5000, 10000 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
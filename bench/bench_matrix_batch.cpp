@@ -0,0 +1,280 @@
+// One million transforms: glm one matrix at a time (operator* loops, and
+// glm's own SSE glm_mat4_mul from glm/simd/matrix.h) against
+// the batched AoSoA kernels of MatrixBatch.h on each instruction set the CPU
+// runs. Covers mat4 x mat4 per element and with a shared left matrix
+// (viewProj * model), mat4 x vec4 streams, affine inverses and normal
+// matrices. Single-threaded; 1M matrices are 64 MB per array, so the larger
+// kernels are near memory bound and the counters report both rates; the
+// mat4 x mat4 rows also run over the first 4096 (cache-resident) matrices.
+//
+// glm is built with its SSE intrinsics here (the scene builds it without),
+// so the baselines are the fastest glm has.
+#define GLM_FORCE_INTRINSICS
+#include "MatrixBatch.h"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/simd/matrix.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+static const size_t COUNT = 1 << 20;
+
+struct Data
+{
+    std::vector<glm::mat4> a, b, out;
+    std::vector<glm::vec4> v, vout;
+    std::vector<glm::mat3> normals;
+    std::vector<Mat4Block> pa, pb, pout;
+    std::vector<Vec4Block> pv, pvout;
+    std::vector<Mat3Block> pnormals;
+    glm::mat4 viewProj;
+};
+
+static Data& Get()
+{
+    static Data d;
+    if (!d.a.empty())
+        return d;
+    uint32_t noise = 5;
+    auto random = [&](float lo, float hi)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        return lo + (hi - lo) * (float)(noise >> 8) / 16777216.0f;
+    };
+    d.a.resize(COUNT);
+    d.b.resize(COUNT);
+    d.out.resize(COUNT);
+    d.v.resize(COUNT);
+    d.vout.resize(COUNT);
+    d.normals.resize(COUNT);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        glm::vec3 axis = glm::normalize(glm::vec3(random(-1, 1), random(-1, 1), random(0.1f, 1)));
+        d.a[i] = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(random(-50, 50), random(-50, 50), random(-50, 50))),
+            random(-3, 3), axis), glm::vec3(random(0.5f, 2), random(0.5f, 2), random(0.5f, 2)));
+        d.b[i] = glm::rotate(glm::mat4(1.0f), random(-3, 3), axis);
+        d.v[i] = glm::vec4(random(-10, 10), random(-10, 10), random(-10, 10), 1.0f);
+    }
+    size_t blocks = MatrixBlockCount(COUNT);
+    d.pa.resize(blocks);
+    d.pb.resize(blocks);
+    d.pout.resize(blocks);
+    d.pv.resize(blocks);
+    d.pvout.resize(blocks);
+    d.pnormals.resize(blocks);
+    PackMat4(d.a.data(), COUNT, d.pa.data());
+    PackMat4(d.b.data(), COUNT, d.pb.data());
+    PackVec4(d.v.data(), COUNT, d.pv.data());
+    d.viewProj = glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f) *
+        glm::lookAt(glm::vec3(0, 0, 8), glm::vec3(0, 0, -10), glm::vec3(0, 1, 0));
+    return d;
+}
+
+// bytes read and written per transform
+static void Rates(benchmark::State& state, size_t bytes, size_t count = COUNT)
+{
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.SetBytesProcessed(state.iterations() * (int64_t)(count * bytes));
+}
+
+// state.range(0): MatrixIsa
+static bool UseIsa(benchmark::State& state)
+{
+    MatrixIsa isa = (MatrixIsa)state.range(0);
+    if (SetMatrixIsa(isa) != isa)
+    {
+        state.SkipWithError("instruction set not available");
+        return false;
+    }
+    state.SetLabel(MatrixIsaName(isa));
+    return true;
+}
+
+// ---------- mat4 x mat4 ----------
+// state.range(0): matrices
+static void BM_GlmMultiply(benchmark::State& state)
+{
+    Data& d = Get();
+    size_t count = (size_t)state.range(0);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < count; ++i)
+            d.out[i] = d.a[i] * d.b[i];
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 3 * sizeof(glm::mat4), count);
+}
+BENCHMARK(BM_GlmMultiply)->ArgName("count")->Arg(4096)->Arg(COUNT)->Unit(benchmark::kMicrosecond);
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+static void BM_GlmSseMultiply(benchmark::State& state)
+{
+    Data& d = Get();
+    size_t count = (size_t)state.range(0);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < count; ++i)
+            glm_mat4_mul((const glm_vec4*)&d.a[i], (const glm_vec4*)&d.b[i], (glm_vec4*)&d.out[i]);
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 3 * sizeof(glm::mat4), count);
+}
+BENCHMARK(BM_GlmSseMultiply)->ArgName("count")->Arg(4096)->Arg(COUNT)->Unit(benchmark::kMicrosecond);
+#endif
+
+// state.range(1): matrices
+static void BM_BatchMultiply(benchmark::State& state)
+{
+    Data& d = Get();
+    if (!UseIsa(state))
+        return;
+    size_t count = (size_t)state.range(1);
+    for (auto _ : state)
+    {
+        MultiplyMat4Batch(d.pa.data(), d.pb.data(), d.pout.data(), MatrixBlockCount(count));
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 3 * sizeof(glm::mat4), count);
+}
+BENCHMARK(BM_BatchMultiply)
+    ->ArgNames({ "isa", "count" })
+    ->ArgsProduct({ { MATRIX_ISA_PORTABLE, MATRIX_ISA_AVX2, MATRIX_ISA_AVX512 }, { 4096, COUNT } })
+    ->Unit(benchmark::kMicrosecond);
+
+// viewProj * model
+static void BM_GlmMultiplyShared(benchmark::State& state)
+{
+    Data& d = Get();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+            d.out[i] = d.viewProj * d.a[i];
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 2 * sizeof(glm::mat4));
+}
+BENCHMARK(BM_GlmMultiplyShared)->Unit(benchmark::kMillisecond);
+
+static void BM_BatchMultiplyShared(benchmark::State& state)
+{
+    Data& d = Get();
+    if (!UseIsa(state))
+        return;
+    for (auto _ : state)
+    {
+        MultiplyMat4Batch(d.viewProj, d.pa.data(), d.pout.data(), d.pa.size());
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 2 * sizeof(glm::mat4));
+}
+BENCHMARK(BM_BatchMultiplyShared)->ArgName("isa")->DenseRange(MATRIX_ISA_PORTABLE, MATRIX_ISA_AVX512)->Unit(benchmark::kMillisecond);
+
+// ---------- mat4 x vec4 ----------
+static void BM_GlmTransform(benchmark::State& state)
+{
+    Data& d = Get();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+            d.vout[i] = d.viewProj * d.v[i];
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 2 * sizeof(glm::vec4));
+}
+BENCHMARK(BM_GlmTransform)->Unit(benchmark::kMillisecond);
+
+static void BM_BatchTransform(benchmark::State& state)
+{
+    Data& d = Get();
+    if (!UseIsa(state))
+        return;
+    for (auto _ : state)
+    {
+        TransformVec4Batch(d.viewProj, d.pv.data(), d.pvout.data(), d.pv.size());
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 2 * sizeof(glm::vec4));
+}
+BENCHMARK(BM_BatchTransform)->ArgName("isa")->DenseRange(MATRIX_ISA_PORTABLE, MATRIX_ISA_AVX512)->Unit(benchmark::kMillisecond);
+
+// ---------- inverse ----------
+// state.range(0): 0 = glm::inverse, 1 = glm::affineInverse
+static void BM_GlmInverse(benchmark::State& state)
+{
+    Data& d = Get();
+    bool affine = state.range(0) != 0;
+    for (auto _ : state)
+    {
+        if (affine)
+            for (size_t i = 0; i < COUNT; ++i)
+                d.out[i] = glm::affineInverse(d.a[i]);
+        else
+            for (size_t i = 0; i < COUNT; ++i)
+                d.out[i] = glm::inverse(d.a[i]);
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 2 * sizeof(glm::mat4));
+}
+BENCHMARK(BM_GlmInverse)->ArgName("affine")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_BatchInverseAffine(benchmark::State& state)
+{
+    Data& d = Get();
+    if (!UseIsa(state))
+        return;
+    for (auto _ : state)
+    {
+        InverseAffineBatch(d.pa.data(), d.pout.data(), d.pa.size());
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 2 * sizeof(glm::mat4));
+}
+BENCHMARK(BM_BatchInverseAffine)->ArgName("isa")->DenseRange(MATRIX_ISA_PORTABLE, MATRIX_ISA_AVX512)->Unit(benchmark::kMillisecond);
+
+// ---------- normal matrix ----------
+static void BM_GlmNormalMatrix(benchmark::State& state)
+{
+    Data& d = Get();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+            d.normals[i] = glm::inverseTranspose(glm::mat3(d.a[i]));
+        benchmark::ClobberMemory();
+    }
+    Rates(state, sizeof(glm::mat4) + sizeof(glm::mat3));
+}
+BENCHMARK(BM_GlmNormalMatrix)->Unit(benchmark::kMillisecond);
+
+static void BM_BatchNormalMatrix(benchmark::State& state)
+{
+    Data& d = Get();
+    if (!UseIsa(state))
+        return;
+    for (auto _ : state)
+    {
+        NormalMatrixBatch(d.pa.data(), d.pnormals.data(), d.pa.size());
+        benchmark::ClobberMemory();
+    }
+    Rates(state, sizeof(glm::mat4) + sizeof(glm::mat3));
+}
+BENCHMARK(BM_BatchNormalMatrix)->ArgName("isa")->DenseRange(MATRIX_ISA_PORTABLE, MATRIX_ISA_AVX512)->Unit(benchmark::kMillisecond);
+
+// ---------- layout ----------
+// the one-off cost of converting an array of glm matrices
+static void BM_PackMat4(benchmark::State& state)
+{
+    Data& d = Get();
+    for (auto _ : state)
+    {
+        PackMat4(d.a.data(), COUNT, d.pout.data());
+        benchmark::ClobberMemory();
+    }
+    Rates(state, 2 * sizeof(glm::mat4));
+}
+BENCHMARK(BM_PackMat4)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,136 @@
+// CPU occlusion culling (OcclusionCuller, FrameParams::occlusionCulling),
+// no GL involved. The occluders are the layered scene's largest objects as
+// FramePipeline picks them, seen from the app's camera.
+//   BM_RasterizeOccluders  Begin + occluders + Rasterize (bands on the job
+//                          threads, then the min pyramid), 1 and 4 threads
+//   BM_TestSpheres         SphereVisible on one thread for 100k spheres
+//                          scattered through the view behind the occluders
+//   BM_Record              FramePipeline::Record of the layered scene with
+//                          and without occlusion culling
+// Counters: tris = occluder triangles, hidden = share / count of spheres
+// found hidden.
+#include "FramePipeline.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "Scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+static glm::mat4 View()
+{
+    return glm::lookAt(glm::vec3(0.0f, 0.0f, 8.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static glm::mat4 Projection()
+{
+    return glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.0f);
+}
+
+// the default scene and the first layers of BuildLayeredScene, nearest
+// first, like the biggest-on-screen pick in FramePipeline
+static void AddOccluders(OcclusionCuller& culler, size_t count)
+{
+    Scene scene = BuildLayeredScene(count);
+    for (size_t i = 0; i < count && i < scene.objects.size(); ++i)
+    {
+        const SceneObject& obj = scene.objects[i];
+        if (obj.shape == SHAPE_SPHERE)
+            culler.AddSphereOccluder(obj.position, obj.boundingRadius * 0.95f);
+        else
+            culler.AddMeshOccluder(TETRA_VERTICES, 6, TETRA_INDICES, 12, Affine3x4::Translation(obj.position));
+    }
+}
+
+// state.range(0): occluders, state.range(1): threads
+static void BM_RasterizeOccluders(benchmark::State& state)
+{
+    JobSystem jobs((unsigned int)state.range(1) - 1);
+    OcclusionCuller culler(jobs);
+    glm::mat4 view = View(), projection = Projection();
+    for (auto _ : state)
+    {
+        culler.Begin(view, projection);
+        AddOccluders(culler, (size_t)state.range(0));
+        culler.Rasterize();
+        benchmark::DoNotOptimize(culler.level(OcclusionCuller::LEVELS - 1));
+    }
+    state.counters["tris"] = (double)culler.triangleCount();
+}
+BENCHMARK(BM_RasterizeOccluders)
+    ->ArgNames({ "occluders", "threads" })
+    ->ArgsProduct({ { 8, 32 }, { 1, 4 } })
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// state.range(0): spheres
+static void BM_TestSpheres(benchmark::State& state)
+{
+    JobSystem jobs(0);
+    OcclusionCuller culler(jobs);
+    culler.Begin(View(), Projection());
+    AddOccluders(culler, 32);
+    culler.Rasterize();
+
+    // inside the view from just behind the first layer back to depth 80
+    std::vector<glm::vec4> spheres((size_t)state.range(0));
+    uint32_t noise = 7u;
+    auto random = [&noise](float a, float b)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        return a + (b - a) * (float)(noise >> 8) / 16777216.0f;
+    };
+    for (glm::vec4& s : spheres)
+    {
+        float depth = random(24.0f, 80.0f);
+        s = glm::vec4(random(-0.5f, 0.5f) * depth, random(-0.4f, 0.4f) * depth, 8.0f - depth, random(0.3f, 1.7f));
+    }
+
+    size_t hidden = 0;
+    for (auto _ : state)
+    {
+        hidden = 0;
+        for (const glm::vec4& s : spheres)
+            hidden += culler.SphereVisible(glm::vec3(s), s.w) ? 0 : 1;
+        benchmark::DoNotOptimize(hidden);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)spheres.size());
+    state.counters["hidden"] = (double)hidden / spheres.size();
+}
+BENCHMARK(BM_TestSpheres)->Arg(100000)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// state.range(0): layered objects, state.range(1): 1 = occlusion culling,
+// state.range(2): threads
+static void BM_Record(benchmark::State& state)
+{
+    Scene scene = BuildLayeredScene((size_t)state.range(0));
+    JobSystem jobs((unsigned int)state.range(2) - 1);
+    FramePipeline pipeline(scene, jobs);
+
+    FrameParams frame;
+    frame.view = View();
+    frame.projection = Projection();
+    frame.time = 0.0f;
+    frame.viewportHeight = 600;
+    frame.occlusionCulling = state.range(1) != 0;
+
+    size_t drawn = 0;
+    for (auto _ : state)
+    {
+        drawn = pipeline.Record(frame).size();
+        frame.time += 1.0f / 60.0f;
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)scene.objects.size());
+    state.counters["drawn"] = (double)drawn;
+    state.counters["hidden"] = (double)pipeline.occludedCount();
+}
+BENCHMARK(BM_Record)
+    ->ArgNames({ "objects", "occlusion", "threads" })
+    ->ArgsProduct({ { 1500, 100000 }, { 0, 1 }, { 1, 4 } })
+    ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,57 @@
+// Hardware occlusion culling (SceneRenderer::SetOcclusionQueries) on the
+// default scene plus layers of objects straight behind it (BuildLayeredScene),
+// through SceneRenderer (headless GL, 400x300, glFinish per frame). With the
+// queries on, every drawn object's bounding box is tested after the frame and
+// the next frame draws it under glBeginConditionalRender. Counters, read back
+// two frames late:
+//   tested/frame  objects whose box was tested (the ones in the frustum)
+//   hidden/frame  of those, found hidden: draws the GPU skips next frame
+// Run from the build directory (the shaders are read from the working
+// directory).
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "BenchGl.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+static const int WIDTH = 400;
+static const int HEIGHT = 300;
+
+// state.range(0): layered objects, state.range(1): 1 = occlusion queries
+static void BM_OcclusionQueries(benchmark::State& state)
+{
+    if (!BenchGlReady(state, WIDTH, HEIGHT, "bbox.vert"))
+        return;
+
+    Scene scene = BuildLayeredScene((size_t)state.range(0));
+    JobSystem jobs(0);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    renderer->SetOcclusionQueries(state.range(1) != 0);
+    renderer->SetCountFragments(true);
+
+    float t = 0.0f;
+    for (auto _ : state)
+    {
+        renderer->Render(t, WIDTH, HEIGHT, nullptr);
+        glFinish();
+        t += 1.0f / 60.0f;
+    }
+    if (const OcclusionQueries* occlusion = renderer->occlusionQueries())
+    {
+        const OcclusionQueries::Stats& s = occlusion->stats();
+        double frames = s.frames ? (double)s.frames : 1.0;
+        state.counters["tested/frame"] = s.tested / frames;
+        state.counters["hidden/frame"] = s.occluded / frames;
+    }
+    renderer.reset();
+}
+BENCHMARK(BM_OcclusionQueries)
+    ->ArgNames({ "objects", "queries" })
+    ->ArgsProduct({ { 150, 1500 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
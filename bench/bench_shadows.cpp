@@ -0,0 +1,65 @@
+// Key light shadows (SceneRenderer::SetShadows) on the default scene plus
+// layers of objects behind it (BuildLayeredScene), through SceneRenderer
+// (headless GL, 400x300, glFinish per frame):
+//   mode 0  no shadows
+//   mode 1  the point light's single map
+//   mode 2  the sun, 4 cascades
+// state.range(2) = 1 caches the static casters' maps (SetShadowCaching);
+// the light is held still so the cache stays valid.
+// Counters: casters/frame = caster draws over all maps after per-map
+// culling; shadow cpu / gpu ms = the profiler's "shadows" scope per frame.
+// Run from the build directory (the shaders are read from the working
+// directory).
+#include "FrameProfiler.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "BenchGl.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+static const int WIDTH = 400;
+static const int HEIGHT = 300;
+
+// state.range(0): layered objects, state.range(1): mode, state.range(2): cache
+static void BM_Shadows(benchmark::State& state)
+{
+    if (!BenchGlReady(state, WIDTH, HEIGHT, "depth.vert"))
+        return;
+
+    Scene scene = BuildLayeredScene((size_t)state.range(0));
+    JobSystem jobs(0);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    renderer->SetDirectionalLight(state.range(1) == 2);
+    renderer->SetShadows(state.range(1) != 0, 4);
+    renderer->SetShadowCaching(state.range(2) != 0);
+    renderer->SetFixedLightTime(1.2f);
+    FrameProfiler profiler;
+
+    float t = 0.0f;
+    for (auto _ : state)
+    {
+        profiler.BeginFrame();
+        renderer->Render(t, WIDTH, HEIGHT, &profiler);
+        profiler.EndFrame();
+        glFinish();
+        t += 1.0f / 60.0f;
+    }
+    profiler.Flush();
+    state.counters["casters/frame"] = (double)renderer->shadowDraws();
+    if (const FrameProfiler::Stats* s = profiler.Find("shadows"))
+    {
+        state.counters["shadow cpu ms"] = s->count ? s->cpuSum / s->count : 0.0;
+        state.counters["shadow gpu ms"] = s->gpuCount ? s->gpuSum / s->gpuCount : 0.0;
+    }
+    renderer.reset();
+}
+BENCHMARK(BM_Shadows)
+    ->ArgNames({ "objects", "mode", "cache" })
+    ->ArgsProduct({ { 150, 1500 }, { 0, 1, 2 }, { 0, 1 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,201 @@
+// Texture load time for a 4096x4096 RGBA texture with its full mip chain:
+// the JPEG path (map, stb_image decode, box mips on the CPU, glTexImage2D
+// per level) against a cooked .tex file (map, one memcpy into a pixel unpack
+// buffer, glTexImage2D per level from it), each with a warm page cache and
+// with the file evicted first ("cold", posix_fadvise DONTNEED, Linux only).
+// Every iteration ends in glFinish so the upload is inside the timing.
+// BM_CookTexture is the offline side: mip generation per filter and thread
+// count, the work the cooked file saves at run time.
+#include "FileView.h"
+#include "ImageWrite.h"
+#include "JobSystem.h"
+#include "TextureFile.h"
+#include "stb_image.h"
+
+#include "BenchGl.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const int SIZE = 4096;
+static const char* JPEG_PATH = "bench_texture_4k.jpg";
+static const char* COOKED_PATH = "bench_texture_4k.tex";
+
+static const std::vector<unsigned char>& Pixels()
+{
+    static std::vector<unsigned char> pixels;
+    if (!pixels.empty())
+        return pixels;
+    pixels.resize((size_t)SIZE * SIZE * 4);
+    uint32_t noise = 42;
+    for (int y = 0; y < SIZE; ++y)
+        for (int x = 0; x < SIZE; ++x)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            int grain = (int)(noise >> 28) - 8;
+            unsigned char* p = &pixels[((size_t)y * SIZE + x) * 4];
+            int v[3] = { x * 255 / SIZE + grain, y * 255 / SIZE + grain,
+                128 + (int)(60.0f * std::sin(x * 0.01f) * std::cos(y * 0.013f)) + grain };
+            for (int c = 0; c < 3; ++c)
+                p[c] = (unsigned char)(v[c] < 0 ? 0 : v[c] > 255 ? 255 : v[c]);
+            p[3] = 255;
+        }
+    return pixels;
+}
+
+// both files, written once per process
+static bool PrepareFiles()
+{
+    static int ready = -1;
+    if (ready >= 0)
+        return ready != 0;
+
+    std::vector<unsigned char> jpeg;
+    bool ok = EncodeJpeg(jpeg, SIZE, SIZE, 4, Pixels().data(), 90);
+    FILE* f = ok ? std::fopen(JPEG_PATH, "wb") : NULL;
+    ok = f && std::fwrite(jpeg.data(), 1, jpeg.size(), f) == jpeg.size();
+    if (f)
+        ok = std::fclose(f) == 0 && ok;
+
+    CookedTexture cooked;
+    CookTexture(nullptr, Pixels().data(), SIZE, SIZE, MIP_FILTER_BOX, false, cooked);
+    ok = ok && WriteTextureFile(COOKED_PATH, cooked);
+    ready = ok ? 1 : 0;
+    return ok;
+}
+
+static void Evict(const char* path)
+{
+#ifdef __linux__
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// state.range(0): 1 = evict the file before each iteration
+static bool Setup(benchmark::State& state)
+{
+    if (!PrepareFiles())
+    {
+        state.SkipWithError("cannot write the test files");
+        return false;
+    }
+    if (!BenchGlReady(state, 16, 16, nullptr))
+        return false;
+#ifndef __linux__
+    if (state.range(0))
+    {
+        state.SkipWithError("cold runs need posix_fadvise");
+        return false;
+    }
+#endif
+    return true;
+}
+
+static void BM_LoadJpeg(benchmark::State& state)
+{
+    if (!Setup(state))
+        return;
+    for (auto _ : state)
+    {
+        if (state.range(0))
+        {
+            state.PauseTiming();
+            Evict(JPEG_PATH);
+            state.ResumeTiming();
+        }
+        FileView file(JPEG_PATH);
+        int w = 0, h = 0, c = 0;
+        unsigned char* rgba = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, 4);
+        if (!rgba)
+        {
+            state.SkipWithError(stbi_failure_reason());
+            return;
+        }
+        CookedTexture mips;
+        CookTexture(nullptr, rgba, w, h, MIP_FILTER_BOX, false, mips);
+        stbi_image_free(rgba);
+
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for (size_t i = 0; i < mips.levels.size(); ++i)
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA8, mips.widths[i], mips.heights[i], 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                mips.levels[i].data());
+        glFinish();
+        glDeleteTextures(1, &texture);
+    }
+}
+BENCHMARK(BM_LoadJpeg)->ArgName("cold")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_LoadCooked(benchmark::State& state)
+{
+    if (!Setup(state))
+        return;
+    TextureLoadStats total;
+    for (auto _ : state)
+    {
+        if (state.range(0))
+        {
+            state.PauseTiming();
+            Evict(COOKED_PATH);
+            state.ResumeTiming();
+        }
+        TextureLoadStats stats;
+        GLuint texture = LoadTextureFile(COOKED_PATH, &stats);
+        if (!texture)
+        {
+            state.SkipWithError("load failed");
+            return;
+        }
+        glFinish();
+        glDeleteTextures(1, &texture);
+        total.bytes += stats.bytes;
+        total.mapSeconds += stats.mapSeconds;
+        total.copySeconds += stats.copySeconds;
+        total.uploadSeconds += stats.uploadSeconds;
+    }
+    double n = (double)state.iterations();
+    state.counters["map_ms"] = total.mapSeconds * 1e3 / n;
+    state.counters["memcpy_ms"] = total.copySeconds * 1e3 / n;
+    state.counters["teximage_ms"] = total.uploadSeconds * 1e3 / n;
+    state.counters["memcpy_GB/s"] = total.copySeconds > 0.0 ? total.bytes / total.copySeconds * 1e-9 : 0.0;
+}
+BENCHMARK(BM_LoadCooked)->ArgName("cold")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_CookTexture(benchmark::State& state)
+{
+    MipFilter filter = state.range(0) ? MIP_FILTER_KAISER : MIP_FILTER_BOX;
+    bool srgb = state.range(1) != 0;
+    JobSystem jobs((unsigned int)state.range(2) - 1);
+    const std::vector<unsigned char>& pixels = Pixels();
+
+    for (auto _ : state)
+    {
+        CookedTexture cooked;
+        CookTexture(&jobs, pixels.data(), SIZE, SIZE, filter, srgb, cooked);
+        benchmark::DoNotOptimize(cooked.levels.back()[0]);
+    }
+    state.counters["MP/s"] = benchmark::Counter(state.iterations() * (double)SIZE * SIZE * 1e-6, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_CookTexture)
+    ->ArgNames({ "kaiser", "srgb", "threads" })
+    ->ArgsProduct({ { 0, 1 }, { 0, 1 }, { 1, 4 } })
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,183 @@
+// Vertex-bound draws of one sphere, up to 4096 stacks x 8192 sectors (33.6M
+// vertices, 201M indices), into a 64x64 target so the vertex shader
+// dominates. The scene's own vertex shaders, each in both variants: the
+// per-frame viewProj uniform applied to the world position
+// (FramePipeline::viewProjection) and the CPU-side viewProj * model
+// (FrameParams::computeMvp, the CPU_MVP define) applied to the object-space
+// position, for the colour passes' vertex.vert and the position-only
+// depth.vert. Each iteration is one draw and a glFinish. Run from the build
+// directory, where the shaders are.
+#include "Affine3x4.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+#include "BenchGl.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <new>
+#include <vector>
+
+static const int TARGET_SIZE = 64;
+
+enum TransformVariant
+{
+    TRANSFORM_VIEW_PROJ,        // vertex.vert: viewProj * vec4(world, 1.0)
+    TRANSFORM_CPU_MVP,          // vertex.vert: mvp * vec4(aPos, 1.0)
+    TRANSFORM_DEPTH_VIEW_PROJ,  // depth.vert, the same two
+    TRANSFORM_DEPTH_CPU_MVP,
+    TRANSFORM_VARIANTS
+};
+
+static const char* const CPU_MVP_DEFINES = "#define CPU_MVP\n";
+
+// gbuffer.frag reads every varying, so none of vertex.vert's work is dead
+static GLuint BuildProgram(int variant)
+{
+    bool depth = variant >= TRANSFORM_DEPTH_VIEW_PROJ;
+    bool cpuMvp = variant == TRANSFORM_CPU_MVP || variant == TRANSFORM_DEPTH_CPU_MVP;
+    Shader program(depth ? "depth.vert" : "vertex.vert", depth ? "depth.frag" : "gbuffer.frag",
+        cpuMvp ? CPU_MVP_DEFINES : nullptr);
+    GLint ok = 0;
+    glGetProgramiv(program.ID, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        glDeleteProgram(program.ID);
+        return 0;
+    }
+    return program.ID;
+}
+
+struct Fixture
+{
+    GLuint programs[TRANSFORM_VARIANTS] = {};
+
+    // the sphere currently in the buffers
+    int stacks = 0;
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLsizei indexCount = 0;
+    size_t vertexCount = 0;
+};
+
+static Fixture* Get()
+{
+    static Fixture f;
+    static int state = -1;
+    if (state >= 0)
+        return state ? &f : nullptr;
+    state = 0;
+    for (int v = 0; v < TRANSFORM_VARIANTS; ++v)
+        if (!(f.programs[v] = BuildProgram(v)))
+            return nullptr;
+    glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    state = 1;
+    return &f;
+}
+
+// Regenerates the sphere when the size changes. The biggest one is ~805 MB of
+// vertices and as much again of indices, so the vertex array is uploaded and
+// freed before the indices are copied.
+static bool UseSphere(Fixture& f, int stacks)
+{
+    if (f.stacks == stacks)
+        return true;
+    if (f.vao)
+    {
+        glDeleteVertexArrays(1, &f.vao);
+        glDeleteBuffers(1, &f.vbo);
+        glDeleteBuffers(1, &f.ebo);
+        f.vao = f.vbo = f.ebo = 0;
+        f.stacks = 0;
+    }
+    try
+    {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        GenerateSpherePN(1.0f, stacks, stacks * 2, vertices, indices);
+
+        glGenVertexArrays(1, &f.vao);
+        glGenBuffers(1, &f.vbo);
+        glGenBuffers(1, &f.ebo);
+        glBindVertexArray(f.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, f.vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        f.vertexCount = vertices.size() / 6;
+        std::vector<float>().swap(vertices);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, f.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        f.indexCount = (GLsizei)indices.size();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return false;
+    }
+    if (glGetError() == GL_OUT_OF_MEMORY)
+        return false;
+    f.stacks = stacks;
+    return true;
+}
+
+// state.range(0): stacks (sectors = 2 * stacks), state.range(1): TransformVariant
+static void BM_DrawSphere(benchmark::State& state)
+{
+    if (!BenchGlReady(state, TARGET_SIZE, TARGET_SIZE, "vertex.vert"))
+        return;
+    Fixture* f = Get();
+    if (!f)
+    {
+        state.SkipWithError("the scene's shaders do not build");
+        return;
+    }
+    if (!UseSphere(*f, (int)state.range(0)))
+    {
+        state.SkipWithError("not enough memory for the sphere");
+        return;
+    }
+
+    int variant = (int)state.range(1);
+    GLuint program = f->programs[variant];
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 4), glm::vec3(0), glm::vec3(0, 1, 0));
+    glm::mat4 viewProj = projection * view;
+    Affine3x4 model = Affine3x4::Translation(glm::vec3(0.2f, -0.1f, 0.0f)) *
+        Affine3x4::FromMat4(glm::rotate(glm::mat4(1.0f), 0.7f, glm::vec3(0.5f, 1.0f, 0.0f)));
+    glm::mat4 mvp = viewProj * model.ToMat4();
+
+    glUseProgram(program);
+    glUniformMatrix3x4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, &model.rows[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "viewProj"), 1, GL_FALSE, glm::value_ptr(viewProj));
+    glUniformMatrix4fv(glGetUniformLocation(program, "mvp"), 1, GL_FALSE, glm::value_ptr(mvp));
+    glBindVertexArray(f->vao);
+
+    for (auto _ : state)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDrawElements(GL_TRIANGLES, f->indexCount, GL_UNSIGNED_INT, 0);
+        glFinish();
+    }
+    static const char* names[TRANSFORM_VARIANTS] = { "viewProj", "cpu mvp", "depth viewProj", "depth cpu mvp" };
+    state.SetLabel(names[variant]);
+    state.counters["Mvert"] = benchmark::Counter(state.iterations() * (double)f->vertexCount * 1e-6, benchmark::Counter::kIsRate);
+}
+
+// sizes outermost so each sphere is generated once for all the shaders
+static void SphereArgs(benchmark::internal::Benchmark* b)
+{
+    for (int stacks : { 256, 1024, 4096 })
+        for (int variant = 0; variant < TRANSFORM_VARIANTS; ++variant)
+            b->Args({ stacks, variant });
+}
+BENCHMARK(BM_DrawSphere)->ArgNames({ "stacks", "variant" })->Apply(SphereArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
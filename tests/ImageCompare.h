@@ -0,0 +1,71 @@
+#ifndef IMAGE_COMPARE_H
+#define IMAGE_COMPARE_H
+
+// Perceptual image comparison shared by the image tests.
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Squared YIQ distance (Kotsarenko & Ramos 2010, as used by pixelmatch):
+// weights luma over chroma so small hue shifts from rasterizer differences
+// count less than a visible brightness change. Max is ~35215.
+inline float ColorDelta(const unsigned char* a, const unsigned char* b)
+{
+    float dr = (float)a[0] - b[0];
+    float dg = (float)a[1] - b[1];
+    float db = (float)a[2] - b[2];
+
+    float y = dr * 0.29889531f + dg * 0.58662247f + db * 0.11448223f;
+    float i = dr * 0.59597799f - dg * 0.27417610f - db * 0.32180189f;
+    float q = dr * 0.21147017f - dg * 0.52261711f + db * 0.31114694f;
+    return 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+}
+
+struct CompareResult
+{
+    size_t mismatched = 0;
+    float maxDelta = 0.0f;
+};
+
+// rgba is the rendered frame, golden is RGB; diff gets red where they differ
+inline CompareResult CompareImages(const std::vector<unsigned char>& rgba, const unsigned char* golden,
+    size_t pixels, std::vector<unsigned char>& diff)
+{
+    // pixelmatch's default threshold of 0.1
+    const float threshold = 35215.0f * 0.1f * 0.1f;
+
+    CompareResult r;
+    diff.assign(pixels * 3, 0);
+    for (size_t p = 0; p < pixels; ++p)
+    {
+        float d = ColorDelta(&rgba[p * 4], &golden[p * 3]);
+        r.maxDelta = std::max(r.maxDelta, d);
+        if (d > threshold)
+        {
+            ++r.mismatched;
+            diff[p * 3] = 255;
+        }
+        else
+        {
+            // faded copy of the frame so the mismatches stand out
+            unsigned char gray = (unsigned char)((rgba[p * 4] + rgba[p * 4 + 1] + rgba[p * 4 + 2]) / 12);
+            diff[p * 3] = diff[p * 3 + 1] = diff[p * 3 + 2] = gray;
+        }
+    }
+    return r;
+}
+
+inline std::vector<unsigned char> ToRgb(const std::vector<unsigned char>& rgba)
+{
+    std::vector<unsigned char> rgb(rgba.size() / 4 * 3);
+    for (size_t p = 0, n = rgba.size() / 4; p < n; ++p)
+    {
+        rgb[p * 3] = rgba[p * 4];
+        rgb[p * 3 + 1] = rgba[p * 4 + 1];
+        rgb[p * 3 + 2] = rgba[p * 4 + 2];
+    }
+    return rgb;
+}
+
+#endif
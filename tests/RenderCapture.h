@@ -0,0 +1,24 @@
+#ifndef RENDER_CAPTURE_H
+#define RENDER_CAPTURE_H
+
+// The image a SceneRenderer draws into the headless context.
+
+#include "HeadlessContext.h"
+#include "SceneRenderer.h"
+
+#include <vector>
+
+// `frames` frames at the same t (so queries and caches settle), then the
+// context's pixels, RGBA8
+inline std::vector<unsigned char> RenderAt(HeadlessContext& context, SceneRenderer& renderer, float t,
+    int width, int height, int frames = 1)
+{
+    for (int i = 0; i < frames; ++i)
+        renderer.Render(t, width, height, nullptr);
+    glFinish();
+    std::vector<unsigned char> rgba;
+    context.ReadPixels(rgba);
+    return rgba;
+}
+
+#endif
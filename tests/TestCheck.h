@@ -0,0 +1,17 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+// The check macro every test counts its failures with, and the exit code
+// of a test that cannot run here.
+
+#include <cstdio>
+
+// ctest SKIP_RETURN_CODE
+static const int SKIPPED = 77;
+
+inline int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TEXTURE_READBACK_H
+#define TEXTURE_READBACK_H
+
+// What the texture tests compare GL's mip levels against, and how they read
+// them back.
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// the streamer's 2x2 box filter (odd edges clamp), on RGBA8
+inline std::vector<unsigned char> Downsample(const std::vector<unsigned char>& src, int w, int h, int dw, int dh)
+{
+    std::vector<unsigned char> dst((size_t)dw * dh * 4);
+    for (int y = 0; y < dh; ++y)
+    {
+        for (int x = 0; x < dw; ++x)
+        {
+            int sx[2] = { 2 * x < w ? 2 * x : w - 1, 2 * x + 1 < w ? 2 * x + 1 : w - 1 };
+            int sy[2] = { 2 * y < h ? 2 * y : h - 1, 2 * y + 1 < h ? 2 * y + 1 : h - 1 };
+            for (int c = 0; c < 4; ++c)
+            {
+                int sum = 2;
+                for (int j = 0; j < 2; ++j)
+                    for (int i = 0; i < 2; ++i)
+                        sum += src[((size_t)sy[j] * w + sx[i]) * 4 + c];
+                dst[((size_t)y * dw + x) * 4 + c] = (unsigned char)(sum >> 2);
+            }
+        }
+    }
+    return dst;
+}
+
+// one level as RGBA8, tightly packed
+inline std::vector<unsigned char> ReadLevel(GLuint texture, int level, int w, int h)
+{
+    std::vector<unsigned char> pixels((size_t)w * h * 4);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return pixels;
+}
+
+#endif
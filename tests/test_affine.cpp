@@ -0,0 +1,92 @@
+// Affine3x4 checks against the glm::mat4 math it replaces: conversion both
+// ways, composition (exact for translate * rotate, as the frame pipeline
+// builds its models), point and vector transforms, general and rigid
+// inverses, and the normal matrix under non-uniform scale.
+#include "Affine3x4.h"
+#include "RenderQueue.h"
+
+#include "TestCheck.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+static uint32_t g_random = 77;
+
+static float Random(float lo, float hi)
+{
+    g_random = g_random * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(g_random >> 8) / 16777216.0f;
+}
+
+static glm::vec3 RandomVec(float lo, float hi)
+{
+    return glm::vec3(Random(lo, hi), Random(lo, hi), Random(lo, hi));
+}
+
+static glm::mat4 RandomRigid()
+{
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), RandomVec(-20, 20));
+    return glm::rotate(m, Random(-3, 3), glm::normalize(RandomVec(-1, 1) + glm::vec3(0, 0, 0.01f)));
+}
+
+static glm::mat4 RandomAffine()
+{
+    return glm::scale(RandomRigid(), RandomVec(0.25f, 3));
+}
+
+template <class M>
+static bool Near(const M& a, const M& b, float tolerance = 1e-4f)
+{
+    for (int c = 0; c < M::length(); ++c)
+        for (int r = 0; r < M::col_type::length(); ++r)
+            if (!(std::fabs(a[c][r] - b[c][r]) <= tolerance * std::fmax(1.0f, std::fabs(b[c][r]))))
+                return false;
+    return true;
+}
+
+static bool Near(const glm::vec3& a, const glm::vec3& b)
+{
+    return glm::length(a - b) <= 1e-4f * std::fmax(1.0f, glm::length(b));
+}
+
+int main()
+{
+    CHECK(sizeof(Affine3x4) == 48);
+    CHECK(sizeof(DrawPacket) <= 64);
+    CHECK(Affine3x4::Identity().ToMat4() == glm::mat4(1.0f));
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        glm::mat4 a = RandomAffine(), b = RandomAffine(), rigid = RandomRigid();
+        Affine3x4 fa = Affine3x4::FromMat4(a), fb = Affine3x4::FromMat4(b), frigid = Affine3x4::FromMat4(rigid);
+
+        CHECK(fa.ToMat4() == a);
+        CHECK(Near((fa * fb).ToMat4(), a * b));
+
+        glm::vec3 p = RandomVec(-10, 10);
+        CHECK(Near(fa.TransformPoint(p), glm::vec3(a * glm::vec4(p, 1.0f))));
+        CHECK(Near(fa.TransformVector(p), glm::vec3(a * glm::vec4(p, 0.0f))));
+
+        CHECK(Near(Inverse(fa).ToMat4(), glm::inverse(a)));
+        CHECK(Near((Inverse(fa) * fa).ToMat4(), glm::mat4(1.0f)));
+        CHECK(Near(InverseRigid(frigid).ToMat4(), glm::inverse(rigid)));
+        CHECK(Near(NormalMatrix(fa), glm::transpose(glm::inverse(glm::mat3(a)))));
+
+        // how FramePipeline composes: bit-exact with the mat4 it used to build
+        glm::vec3 position = RandomVec(-50, 50);
+        glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), Random(-3, 3), glm::vec3(0.5f, 1.0f, 0.0f));
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position) * rotation;
+        CHECK((Affine3x4::Translation(position) * Affine3x4::FromMat4(rotation)).ToMat4() == model);
+    }
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all affine checks passed\n");
+    return 0;
+}
@@ -0,0 +1,330 @@
+// BC1/BC3 checks: the decoder against hand-built blocks, exact round trips
+// for colors the format can hold, quality floors (PSNR) over a small corpus
+// of photo, gradient, noise and alpha images, partial edge blocks, and
+// threaded encoding matching serial byte for byte. With a GL context, cooked
+// BC files must reach GL unchanged (or expanded to RGBA8 without S3TC), and
+// the streamer's load-time compression must sample close to its source.
+#include "BlockCompress.h"
+#include "HeadlessContext.h"
+#include "ImageDecode.h"
+#include "JobSystem.h"
+#include "TextureFile.h"
+#include "TextureStreamer.h"
+
+#include "TestCheck.h"
+#include "TextureReadback.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static const char* COOKED_PATH = "block_compress_test.tex";
+
+struct Image
+{
+    const char* name;
+    int width, height;
+    std::vector<unsigned char> rgba;
+};
+
+static Image Generate(const char* name, int w, int h, int kind)
+{
+    Image image = { name, w, h, std::vector<unsigned char>((size_t)w * h * 4) };
+    uint32_t noise = 11;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            unsigned char* p = &image.rgba[((size_t)y * w + x) * 4];
+            float v[4];
+            switch (kind)
+            {
+            case 0:     // smooth two-axis gradient
+                v[0] = 255.0f * x / w; v[1] = 255.0f * y / h; v[2] = 128.0f; v[3] = 255.0f;
+                break;
+            case 1:     // soft waves
+                v[0] = 128 + 100 * std::sin(x * 0.11f); v[1] = 128 + 100 * std::cos(y * 0.07f);
+                v[2] = 128 + 60 * std::sin((x + y) * 0.05f); v[3] = 255.0f;
+                break;
+            case 2:     // white noise, the worst case
+                v[0] = (float)(noise >> 24); v[1] = (float)((noise >> 16) & 255); v[2] = (float)((noise >> 8) & 255); v[3] = 255.0f;
+                break;
+            default:    // waves with an alpha ramp and a cut-out
+                v[0] = 128 + 100 * std::sin(x * 0.11f); v[1] = 90.0f; v[2] = 128 + 100 * std::cos(y * 0.09f);
+                v[3] = (x / 8 + y / 8) % 5 == 0 ? 0.0f : 255.0f * x / w;
+                break;
+            }
+            for (int c = 0; c < 4; ++c)
+                p[c] = (unsigned char)v[c];
+        }
+    return image;
+}
+
+static double Psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int channels)
+{
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if ((int)(i % 4) >= channels)
+            continue;
+        double d = (double)a[i] - b[i];
+        sum += d * d;
+        ++count;
+    }
+    double mse = sum / count;
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+static std::vector<unsigned char> RoundTrip(BlockFormat format, const std::vector<unsigned char>& rgba, int w, int h)
+{
+    std::vector<unsigned char> blocks(BlockCompressedSize(format, w, h));
+    CompressBlocks(nullptr, format, rgba.data(), w, h, blocks.data());
+    std::vector<unsigned char> decoded(rgba.size());
+    DecompressBlocks(format, blocks.data(), w, h, decoded.data());
+    return decoded;
+}
+
+static void TestDecoder()
+{
+    // c0 = pure red, c1 = pure blue, indices 0,1,2,3 repeating
+    const unsigned char bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0xE4, 0xE4, 0xE4 };
+    unsigned char rgba[16 * 4];
+    DecompressBlocks(BLOCK_BC1, bc1, 4, 4, rgba);
+    const unsigned char expected[4][4] = { { 255, 0, 0, 255 }, { 0, 0, 255, 255 }, { 170, 0, 85, 255 }, { 85, 0, 170, 255 } };
+    for (int p = 0; p < 16; ++p)
+        CHECK(std::memcmp(rgba + p * 4, expected[p % 4], 4) == 0);
+
+    // three-color mode (c0 <= c1), which other encoders emit: index 3 is transparent black
+    const unsigned char bc1Punch[8] = { 0x1F, 0x00, 0x00, 0xF8, 0xFF, 0xFF, 0xFF, 0xFF };
+    DecompressBlocks(BLOCK_BC1, bc1Punch, 4, 4, rgba);
+    CHECK(rgba[0] == 0 && rgba[1] == 0 && rgba[2] == 0 && rgba[3] == 0);
+
+    // BC3 alpha: a0 = 255, a1 = 0, indices 0 and 1 alternating, then step 4 (index 4: (4*255 + 3*0)/7 = 145)
+    unsigned char bc3[16] = { 255, 0 };
+    uint64_t bits = 0;
+    for (int p = 0; p < 16; ++p)
+        bits |= (uint64_t)(p < 15 ? p & 1 : 4) << (3 * p);
+    for (int i = 0; i < 6; ++i)
+        bc3[2 + i] = (unsigned char)(bits >> (8 * i));
+    std::memcpy(bc3 + 8, bc1, 8);
+    DecompressBlocks(BLOCK_BC3, bc3, 4, 4, rgba);
+    CHECK(rgba[3] == 255 && rgba[7] == 0 && rgba[15 * 4 + 3] == 145);
+}
+
+static void TestExact()
+{
+    // colors on the 565 grid survive unchanged, solid or as a two-color block
+    std::vector<unsigned char> solid(8 * 8 * 4);
+    for (size_t i = 0; i < solid.size(); i += 4)
+    {
+        solid[i] = 0x84; solid[i + 1] = 0x41; solid[i + 2] = 0xC6; solid[i + 3] = 255;
+    }
+    CHECK(RoundTrip(BLOCK_BC1, solid, 8, 8) == solid);
+    CHECK(RoundTrip(BLOCK_BC3, solid, 8, 8) == solid);
+
+    std::vector<unsigned char> two(4 * 4 * 4);
+    for (int p = 0; p < 16; ++p)
+    {
+        bool dark = (p * 7) % 3 == 0;
+        unsigned char* px = &two[p * 4];
+        px[0] = dark ? 0 : 255; px[1] = dark ? 0 : 255; px[2] = dark ? 0 : 255; px[3] = dark ? 0 : 255;
+    }
+    std::vector<unsigned char> bc3 = RoundTrip(BLOCK_BC3, two, 4, 4);
+    CHECK(bc3 == two);
+    std::vector<unsigned char> bc1 = RoundTrip(BLOCK_BC1, two, 4, 4);
+    for (int p = 0; p < 16; ++p)
+        CHECK(bc1[p * 4] == two[p * 4] && bc1[p * 4 + 3] == 255);
+}
+
+static void TestQuality()
+{
+    std::vector<Image> corpus;
+    DecodedImage photo;
+    CHECK(DecodeImage("res.jpg", 4, photo));
+    if (!photo.pixels)
+        return;
+    corpus.push_back(Image{ "res.jpg", photo.width, photo.height,
+        std::vector<unsigned char>(photo.pixels, photo.pixels + (size_t)photo.width * photo.height * 4) });
+    FreeDecodedImage(photo);
+    corpus.push_back(Generate("gradient", 256, 256, 0));
+    corpus.push_back(Generate("waves", 253, 131, 1));
+    corpus.push_back(Generate("noise", 128, 128, 2));
+    corpus.push_back(Generate("alpha", 190, 90, 3));
+
+    // floors a few dB under what the encoder reaches today
+    const double floors[] = { 33.0, 37.0, 34.0, 13.0, 32.0 };
+    for (size_t i = 0; i < corpus.size(); ++i)
+    {
+        const Image& image = corpus[i];
+        double bc1 = Psnr(RoundTrip(BLOCK_BC1, image.rgba, image.width, image.height), image.rgba, 3);
+        std::vector<unsigned char> bc3 = RoundTrip(BLOCK_BC3, image.rgba, image.width, image.height);
+        double bc3Rgb = Psnr(bc3, image.rgba, 3), bc3Rgba = Psnr(bc3, image.rgba, 4);
+        std::printf("%-9s %4dx%-4d BC1 rgb %5.2f dB  BC3 rgb %5.2f dB, rgba %5.2f dB\n", image.name, image.width, image.height,
+            bc1, bc3Rgb, bc3Rgba);
+        CHECK(bc1 >= floors[i]);
+        CHECK(bc3Rgba >= floors[i]);
+    }
+}
+
+static void TestEdges()
+{
+    // partial blocks: each size must encode to the same blocks as the image
+    // padded to whole blocks by repeating its last column and row
+    static const int sizes[][2] = { { 1, 1 }, { 2, 2 }, { 5, 3 }, { 13, 7 }, { 4, 9 } };
+    for (const int* size : sizes)
+    {
+        int w = size[0], h = size[1];
+        Image image = Generate("edge", w, h, 3);
+        int pw = (w + 3) & ~3, ph = (h + 3) & ~3;
+        std::vector<unsigned char> padded((size_t)pw * ph * 4);
+        for (int y = 0; y < ph; ++y)
+            for (int x = 0; x < pw; ++x)
+                std::memcpy(&padded[((size_t)y * pw + x) * 4], &image.rgba[((size_t)std::min(y, h - 1) * w + std::min(x, w - 1)) * 4], 4);
+
+        for (BlockFormat format : { BLOCK_BC1, BLOCK_BC3 })
+        {
+            std::vector<unsigned char> a(BlockCompressedSize(format, w, h)), b(BlockCompressedSize(format, pw, ph));
+            CHECK(a.size() == b.size());
+            CompressBlocks(nullptr, format, image.rgba.data(), w, h, a.data());
+            CompressBlocks(nullptr, format, padded.data(), pw, ph, b.data());
+            CHECK(a == b);
+        }
+    }
+}
+
+static void TestThreads()
+{
+    Image image = Generate("waves", 517, 389, 3);
+    JobSystem jobs(3);
+    for (BlockFormat format : { BLOCK_BC1, BLOCK_BC3 })
+    {
+        std::vector<unsigned char> serial(BlockCompressedSize(format, image.width, image.height));
+        std::vector<unsigned char> threaded(serial.size());
+        CompressBlocks(nullptr, format, image.rgba.data(), image.width, image.height, serial.data());
+        CompressBlocks(&jobs, format, image.rgba.data(), image.width, image.height, threaded.data());
+        CHECK(serial == threaded);
+    }
+}
+
+static std::vector<unsigned char> ReadCompressedLevel(GLuint texture, int level)
+{
+    GLint size = 0;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+    std::vector<unsigned char> blocks((size_t)std::max(size, 0));
+    if (size > 0)
+        glGetCompressedTexImage(GL_TEXTURE_2D, level, blocks.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return blocks;
+}
+
+static void WaitForStreamer(TextureStreamer& streamer)
+{
+    for (int frames = 0; !streamer.Idle() && frames < 100000; ++frames)
+    {
+        streamer.Update(16 << 10);
+        if (!streamer.Idle())
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    glFinish();
+}
+
+// what GL hands back for a level: the blocks themselves with S3TC, the
+// CPU-expanded pixels without
+static bool LevelMatches(GLuint texture, bool s3tc, const CookedTexture& cooked, size_t i)
+{
+    BlockFormat format = cooked.format == TEXTURE_FORMAT_BC1 ? BLOCK_BC1 : BLOCK_BC3;
+    if (s3tc)
+        return ReadCompressedLevel(texture, (int)i) == cooked.levels[i];
+    std::vector<unsigned char> expanded((size_t)cooked.widths[i] * cooked.heights[i] * 4);
+    DecompressBlocks(format, cooked.levels[i].data(), cooked.widths[i], cooked.heights[i], expanded.data());
+    return ReadLevel(texture, (int)i, cooked.widths[i], cooked.heights[i]) == expanded;
+}
+
+static void TestGl()
+{
+    JobSystem jobs(1);
+    Image image = Generate("alpha", 90, 70, 3);
+    for (uint32_t format : { (uint32_t)TEXTURE_FORMAT_BC1, (uint32_t)TEXTURE_FORMAT_BC3 })
+    {
+        for (uint32_t flags : { 0u, (uint32_t)TEXTURE_FILE_SRGB })
+        {
+            bool s3tc = TextureFormatSupported(format, flags);
+            CookedTexture cooked;
+            CookTexture(nullptr, image.rgba.data(), image.width, image.height, MIP_FILTER_BOX, flags != 0, cooked);
+            CompressTexture(nullptr, format, cooked);
+            CHECK(cooked.format == format);
+            CHECK(WriteTextureFile(COOKED_PATH, cooked));
+
+            GLuint texture = LoadTextureFile(COOKED_PATH);
+            CHECK(texture != 0);
+            GLint internalFormat = 0;
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            CHECK((GLenum)internalFormat == TextureInternalFormat(s3tc ? format : (uint32_t)TEXTURE_FORMAT_RGBA8, flags));
+            for (size_t i = 0; i < cooked.levels.size(); ++i)
+                CHECK(LevelMatches(texture, s3tc, cooked, i));
+            glDeleteTextures(1, &texture);
+
+            // the streamer uploads the same blocks in rows of blocks
+            TextureStreamer streamer(jobs, 256, 2);
+            GLuint streamed = streamer.Request(COOKED_PATH);
+            WaitForStreamer(streamer);
+            CHECK(streamer.IsResident(streamed));
+            CHECK(streamer.stats().uploadedBytes == streamer.stats().decodedBytes);
+            for (size_t i = 0; i < cooked.levels.size(); ++i)
+                CHECK(LevelMatches(streamed, s3tc, cooked, i));
+        }
+    }
+
+    // compression at load time
+    bool s3tc = TextureFormatSupported(TEXTURE_FORMAT_BC1, 0);
+    std::printf("EXT_texture_compression_s3tc: %s\n", s3tc ? "yes" : "no, RGBA8 fallback checked");
+    DecodedImage reference;
+    CHECK(DecodeImage("res.jpg", 4, reference));
+    TextureStreamer streamer(jobs, 64 << 10, 3, true);
+    GLuint texture = streamer.Request("res.jpg");
+    WaitForStreamer(streamer);
+    CHECK(streamer.IsResident(texture));
+    TextureStreamer::Stats stats = streamer.stats();
+    size_t rgbaBytes = (size_t)reference.width * reference.height * 4;
+    CHECK(s3tc ? stats.uploadedBytes < rgbaBytes / 2 : stats.uploadedBytes > rgbaBytes);
+    if (reference.pixels)
+    {
+        std::vector<unsigned char> pixels(reference.pixels, reference.pixels + rgbaBytes);
+        double psnr = Psnr(ReadLevel(texture, 0, reference.width, reference.height), pixels, 4);
+        std::printf("streamed res.jpg%s: %.2f dB, %.1f MB uploaded\n", s3tc ? " as BC1" : "", psnr, stats.uploadedBytes * 1e-6);
+        CHECK(psnr >= 33.0);
+    }
+    FreeDecodedImage(reference);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    TestDecoder();
+    TestExact();
+    TestQuality();
+    TestEdges();
+    TestThreads();
+
+    HeadlessContext context;
+    if (context.Create(16, 16))
+        TestGl();
+    else
+        std::printf("no headless GL context, skipping the GL checks\n");
+    std::remove(COOKED_PATH);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all block compression checks passed\n");
+    return 0;
+}
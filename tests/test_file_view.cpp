@@ -0,0 +1,102 @@
+// FileView / Vfs / mesh blob checks: mapped bytes match what was written,
+// empty and missing files behave, mount order decides, and mesh blobs
+// round-trip and reject truncation.
+#include "FileView.h"
+#include "Mesh.h"
+
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+static void WriteBytes(const char* path, const std::string& bytes)
+{
+    FILE* f = std::fopen(path, "wb");
+    if (!f)
+        return;
+    std::fwrite(bytes.data(), 1, bytes.size(), f);
+    std::fclose(f);
+}
+
+static void TestFileView()
+{
+    std::string content = "#version 330 core\nvoid main() {}\n";
+    WriteBytes("fv_test_shader.glsl", content);
+    WriteBytes("fv_test_empty.bin", "");
+
+    FileView view("fv_test_shader.glsl");
+    CHECK(view.valid());
+    CHECK(view.size() == content.size());
+    CHECK(view.data() && std::memcmp(view.data(), content.data(), content.size()) == 0);
+
+    // moves hand the mapping over
+    FileView moved(std::move(view));
+    CHECK(!view.valid() && view.data() == nullptr);
+    CHECK(moved.valid() && moved.size() == content.size());
+
+    FileView empty("fv_test_empty.bin");
+    CHECK(empty.valid() && empty.size() == 0 && empty.data() == nullptr);
+
+    FileView missing("fv_test_missing.bin");
+    CHECK(!missing.valid() && missing.size() == 0);
+
+    std::remove("fv_test_shader.glsl");
+    std::remove("fv_test_empty.bin");
+}
+
+static void TestVfsMountOrder()
+{
+    // the assets sit in the working directory; "." mounted after a miss
+    Vfs vfs;
+    vfs.Mount("fv_no_such_dir");
+    vfs.Mount(".");
+    FileView shader = vfs.Open("vertex.vert");
+    CHECK(shader.valid() && shader.size() > 0);
+    CHECK(!vfs.Open("fv_test_missing.bin").valid());
+}
+
+static void TestMeshBlob()
+{
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    GenerateSpherePN(1.0f, 8, 16, vertices, indices);
+    CHECK(WriteMeshBlob("fv_test_sphere.mesh", vertices, indices));
+
+    FileView file("fv_test_sphere.mesh");
+    MeshBlobView mesh;
+    CHECK(ParseMeshBlob(file.data(), file.size(), mesh));
+    CHECK(mesh.vertexCount * 6 == vertices.size());
+    CHECK(mesh.indexCount == indices.size());
+    CHECK(mesh.vertices && std::memcmp(mesh.vertices, vertices.data(), vertices.size() * sizeof(float)) == 0);
+    CHECK(mesh.indices && std::memcmp(mesh.indices, indices.data(), indices.size() * sizeof(unsigned int)) == 0);
+
+    // in place: the arrays point into the mapping
+    CHECK((const unsigned char*)mesh.vertices == file.data() + sizeof(MeshBlobHeader));
+
+    MeshBlobView rejected;
+    CHECK(!ParseMeshBlob(file.data(), file.size() - 1, rejected));
+    CHECK(!ParseMeshBlob(file.data(), sizeof(MeshBlobHeader) - 1, rejected));
+    std::vector<unsigned char> corrupt(file.data(), file.data() + file.size());
+    corrupt[0] ^= 0xFF;
+    CHECK(!ParseMeshBlob(corrupt.data(), corrupt.size(), rejected));
+
+    std::remove("fv_test_sphere.mesh");
+}
+
+int main()
+{
+    TestFileView();
+    TestVfsMountOrder();
+    TestMeshBlob();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all file view checks passed\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+// FrameArena / ObjectPool / ArenaAllocator checks and the steady-state
+// "no heap allocations per frame" guarantee of the recording pipeline.
+// Every operator new in the process is counted (AllocationCounter.h).
+#include "FrameMemory.h"
+#include "FramePipeline.h"
+#include "JobSystem.h"
+#include "Scene.h"
+
+#include "AllocationCounter.h"
+#include "TestCheck.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static void TestFrameArena()
+{
+    FrameArena arena(1024, 3);
+    arena.BeginFrame();
+
+    void* a = arena.Allocate(10, 1);
+    void* b = arena.Allocate(16, 16);
+    CHECK(a != b);
+    CHECK(((uintptr_t)b & 15) == 0);
+
+    // overflow goes to the heap, then the buffer grows when it comes around again
+    for (int i = 0; i < 3; ++i)
+        arena.Allocate(1024, 16);
+    CHECK(arena.used() > arena.capacity());
+
+    arena.BeginFrame();
+    arena.BeginFrame();
+    arena.BeginFrame();   // back to the overflowed buffer
+    CHECK(arena.capacity() >= 4096);
+
+    size_t before = g_allocations.load();
+    for (int i = 0; i < 3; ++i)
+        arena.Allocate(1024, 16);
+    CHECK(g_allocations.load() == before);
+}
+
+static void TestArenaAllocator()
+{
+    FrameArena arena(64 * 1024, 2);
+    arena.BeginFrame();
+
+    size_t before = g_allocations.load();
+    {
+        std::vector<int, ArenaAllocator<int>> values{ ArenaAllocator<int>(arena) };
+        for (int i = 0; i < 1000; ++i)
+            values.push_back(i);
+        CHECK(values[999] == 999);
+    }
+    CHECK(g_allocations.load() == before);
+}
+
+static void TestObjectPool()
+{
+    struct Item
+    {
+        int a;
+        double b;
+    };
+
+    ObjectPool<Item, 4> pool;
+    Item* x = pool.Create(Item{ 1, 2.0 });
+    Item* y = pool.Create(Item{ 3, 4.0 });
+    CHECK(pool.liveCount() == 2);
+    CHECK(x->a == 1 && y->a == 3);
+
+    pool.Destroy(x);
+    Item* z = pool.Create(Item{ 5, 6.0 });
+    CHECK(z == x);   // free list hands back the last freed slot
+
+    size_t before = g_allocations.load();
+    pool.Destroy(y);
+    pool.Destroy(z);
+    for (int i = 0; i < 4; ++i)
+        pool.Create(Item{ i, 0.0 });
+    CHECK(g_allocations.load() == before);
+    CHECK(pool.capacity() == 4);
+}
+
+static void TestSteadyStateFrames(size_t extraObjects)
+{
+    JobSystem jobs(3);
+    Scene scene = BuildStressScene(extraObjects);
+    FramePipeline pipeline(scene, jobs);
+
+    FrameParams frame;
+    frame.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 8.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.0f);
+    frame.viewportHeight = 600;
+
+    // warm-up: arenas grow to their high-water mark, thread locals settle
+    for (int i = 0; i < 10; ++i)
+    {
+        frame.time = i / 60.0f;
+        pipeline.Record(frame);
+    }
+
+    size_t before = g_allocations.load();
+    size_t packets = 0;
+    for (int i = 10; i < 110; ++i)
+    {
+        frame.time = i / 60.0f;
+        packets += pipeline.Record(frame).size();
+    }
+    size_t allocations = g_allocations.load() - before;
+
+    std::printf("%zu objects: %zu packets over 100 frames, %zu heap allocations\n",
+        scene.objects.size(), packets, allocations);
+    CHECK(packets > 0);
+    CHECK(allocations == 0);
+}
+
+int main()
+{
+    TestFrameArena();
+    TestArenaAllocator();
+    TestObjectPool();
+    TestSteadyStateFrames(0);
+    TestSteadyStateFrames(100000);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all frame memory checks passed\n");
+    return 0;
+}
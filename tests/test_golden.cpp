@@ -0,0 +1,363 @@
+// Golden-image and perf-budget regression test for the default scene.
+// Renders headless through software GL (llvmpipe) at fixed simulated times,
+// compares each frame against tests/golden/*.png with a perceptual tolerance
+// (forward, then once more per renderer variant that must draw the same
+// image: deferred shading, the depth pre-pass, front-to-back order) and
+// checks median frame times against tests/golden/perf_budget.txt. The
+// pre-pass must also cut the colour pass's fragments on the layered scene.
+//
+//   test_golden [--golden-dir D] [--frames N] [--perf-tolerance PCT]
+//               [--max-mismatch PCT] [--timings F] [--update]
+//
+// Run from the directory holding vertex.vert / fragment.frag. --update
+// rewrites the goldens and the budget from the current build. Budgets are
+// only meaningful on the host they were recorded on, so the perf check only
+// runs when given a --perf-tolerance of 0 or more (SCENE_PERF_TOLERANCE in
+// CMake); the images are always compared.
+#include <glad/glad.h>
+
+#include "FrameProfiler.h"
+#include "HeadlessContext.h"
+#include "ImageDecode.h"
+#include "ImageWrite.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "ImageCompare.h"
+#include "RenderCapture.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const int WIDTH = 320;
+static const int HEIGHT = 240;
+static const int WARMUP_FRAMES = 5;
+
+// timer resolution / scheduling noise: smaller regressions never fail, and
+// GPU scopes this short (llvmpipe resolves timestamps at submit) are not kept
+static const double NOISE_MS = 0.02;
+
+// fixed times: light orbit and tetra rotation both differ between them
+struct GoldenShot
+{
+    const char* name;
+    float time;
+};
+static const GoldenShot SHOTS[] = {
+    { "scene_t0", 0.0f },
+    { "scene_t2_5", 2.5f },
+};
+
+struct Options
+{
+    std::string goldenDir = "../tests/golden";
+    int frames = 60;
+    double perfTolerance = -1.0;    // % over budget before failing, negative: no check
+    double maxMismatch = 0.1;       // % of pixels allowed to differ visibly
+    const char* timingsPath = "golden_timings.csv";
+    bool update = false;
+};
+
+// ---------- perf budget ----------
+// "<key> <ms>" per line, '#' starts a comment
+
+static std::map<std::string, double> ReadBudget(const std::string& path)
+{
+    std::map<std::string, double> budget;
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f)
+        return budget;
+
+    char line[256];
+    while (std::fgets(line, sizeof(line), f))
+    {
+        char key[128];
+        double value;
+        if (line[0] != '#' && std::sscanf(line, "%127s %lf", key, &value) == 2)
+            budget[key] = value;
+    }
+    std::fclose(f);
+    return budget;
+}
+
+static bool WriteBudget(const std::string& path, const std::map<std::string, double>& measured, const char* renderer)
+{
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    std::fprintf(f, "# median ms per frame at %dx%d, recorded on: %s\n", WIDTH, HEIGHT, renderer);
+    for (const auto& kv : measured)
+        std::fprintf(f, "%s %.4f\n", kv.first.c_str(), kv.second);
+    std::fclose(f);
+    return true;
+}
+
+static double Median(std::vector<double> values)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// compares a frame against <goldenDir>/<golden>.png; on failure leaves the
+// frame and a diff image as <name>_actual.png / <name>_diff.png
+static void CheckAgainstGolden(const char* name, const char* goldenName, const std::vector<unsigned char>& rgba, const Options& opts)
+{
+    std::string goldenPath = opts.goldenDir + "/" + goldenName + ".png";
+    DecodedImage golden;
+    if (!DecodeImage(goldenPath.c_str(), 3, golden))
+    {
+        std::printf("FAILED %s: cannot read golden %s\n", name, goldenPath.c_str());
+        ++g_failures;
+        return;
+    }
+    if (golden.width != WIDTH || golden.height != HEIGHT)
+    {
+        std::printf("FAILED %s: golden is %dx%d, expected %dx%d\n", name, golden.width, golden.height, WIDTH, HEIGHT);
+        ++g_failures;
+        FreeDecodedImage(golden);
+        return;
+    }
+
+    std::vector<unsigned char> diff;
+    CompareResult r = CompareImages(rgba, golden.pixels, (size_t)WIDTH * HEIGHT, diff);
+    FreeDecodedImage(golden);
+
+    double mismatchPct = 100.0 * r.mismatched / ((double)WIDTH * HEIGHT);
+    std::printf("%s: %zu pixels differ (%.3f%%), max YIQ delta %.1f\n", name, r.mismatched, mismatchPct, r.maxDelta);
+    if (mismatchPct > opts.maxMismatch)
+    {
+        // leave the evidence next to the test's working directory
+        std::string actualPath = std::string(name) + "_actual.png";
+        std::string diffPath = std::string(name) + "_diff.png";
+        std::vector<unsigned char> rgb = ToRgb(rgba);
+        WritePng(actualPath.c_str(), WIDTH, HEIGHT, 3, rgb.data());
+        WritePng(diffPath.c_str(), WIDTH, HEIGHT, 3, diff.data());
+        std::printf("FAILED %s: over the %.3f%% limit, wrote %s and %s\n", name, opts.maxMismatch, actualPath.c_str(), diffPath.c_str());
+        ++g_failures;
+    }
+}
+
+// renderer settings that must draw the goldens too; the CPU MVP rounds
+// differently, which moves an edge pixel or so
+struct GoldenVariant
+{
+    const char* suffix;
+    ShadingMode shading;
+    bool depthPrepass;
+    bool frontToBack;
+    bool cpuMvp;
+};
+static const GoldenVariant VARIANTS[] = {
+    { "_deferred", SHADING_DEFERRED, false, false, false },
+    { "_prepass", SHADING_FORWARD, true, false, false },
+    { "_deferred_prepass", SHADING_DEFERRED, true, false, false },
+    { "_front_to_back", SHADING_FORWARD, false, true, false },
+    { "_cpu_mvp", SHADING_FORWARD, false, false, true },
+    { "_cpu_mvp_prepass", SHADING_FORWARD, true, false, true },
+};
+
+static void ConfigureVariant(SceneRenderer& renderer, const GoldenVariant& v)
+{
+    renderer.SetShadingMode(v.shading);
+    renderer.SetDepthPrepass(v.depthPrepass);
+    renderer.SetFrontToBack(v.frontToBack);
+    renderer.SetCpuMvp(v.cpuMvp);
+}
+
+// colour-pass fragments per frame on the layered scene
+static double ColorFragmentsPerFrame(JobSystem& jobs, bool depthPrepass)
+{
+    Scene scene = BuildLayeredScene(300);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    renderer->SetDepthPrepass(depthPrepass);
+    renderer->SetCountFragments(true);
+    for (int i = 0; i < 10; ++i)
+        renderer->Render(1.0f, WIDTH, HEIGHT, nullptr);
+    glFinish();
+    const FragmentStats& f = renderer->fragmentStats();
+    return f.frames ? (double)f.colorFragments / (double)f.frames : 0.0;
+}
+
+static Options ParseOptions(int argc, char** argv)
+{
+    Options o;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (std::strcmp(arg, "--update") == 0)
+            o.update = true;
+        else if (value && std::strcmp(arg, "--golden-dir") == 0)
+            o.goldenDir = argv[++i];
+        else if (value && std::strcmp(arg, "--frames") == 0)
+            o.frames = std::max(1, std::atoi(argv[++i]));
+        else if (value && std::strcmp(arg, "--perf-tolerance") == 0)
+            o.perfTolerance = std::atof(argv[++i]);
+        else if (value && std::strcmp(arg, "--max-mismatch") == 0)
+            o.maxMismatch = std::atof(argv[++i]);
+        else if (value && std::strcmp(arg, "--timings") == 0)
+            o.timingsPath = argv[++i];
+        else
+            std::printf("Unknown option %s\n", arg);
+    }
+    return o;
+}
+
+int main(int argc, char** argv)
+{
+    Options opts = ParseOptions(argc, argv);
+
+#ifndef _WIN32
+    // deterministic output needs the same rasterizer the goldens came from
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    setenv("GALLIUM_DRIVER", "llvmpipe", 1);
+#endif
+
+    HeadlessContext context;
+    if (!context.Create(WIDTH, HEIGHT))
+    {
+        std::printf("no headless GL context, skipping\n");
+        return SKIPPED;
+    }
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    std::printf("Renderer: %s\n", renderer);
+
+    JobSystem jobs(3);
+    Scene scene = BuildDefaultScene();
+    std::unique_ptr<SceneRenderer> sceneRenderer(new SceneRenderer(scene, jobs));
+    FrameProfiler profiler;
+
+    FILE* timings = opts.timingsPath ? std::fopen(opts.timingsPath, "w") : NULL;
+    if (timings)
+        std::fprintf(timings, "shot,frame,cpu_ms\n");
+
+    std::vector<double> frameMs;
+    for (const GoldenShot& shot : SHOTS)
+    {
+        // the same t every frame: the image must come out identical each time
+        for (int i = 0; i < WARMUP_FRAMES + opts.frames; ++i)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            profiler.BeginFrame();
+            int frameScope = profiler.BeginScope("frame");
+            sceneRenderer->Render(shot.time, WIDTH, HEIGHT, &profiler);
+            profiler.EndScope(frameScope);
+            profiler.EndFrame();
+            glFinish();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if (i < WARMUP_FRAMES)
+                continue;
+            frameMs.push_back(ms);
+            if (timings)
+                std::fprintf(timings, "%s,%d,%.6f\n", shot.name, i - WARMUP_FRAMES, ms);
+        }
+
+        std::vector<unsigned char> rgba;
+        context.ReadPixels(rgba);
+        std::string goldenPath = opts.goldenDir + "/" + shot.name + ".png";
+
+        if (opts.update)
+        {
+            std::vector<unsigned char> rgb = ToRgb(rgba);
+            CHECK(WritePng(goldenPath.c_str(), WIDTH, HEIGHT, 3, rgb.data()));
+            std::printf("%s: updated %s\n", shot.name, goldenPath.c_str());
+            continue;
+        }
+
+        CheckAgainstGolden(shot.name, shot.name, rgba, opts);
+    }
+    if (timings)
+        std::fclose(timings);
+
+    // the other paths must draw the same image (the pre-pass's GL_EQUAL
+    // colour pass relies on both vertex shaders giving bit-identical depth);
+    // untimed, so the perf budget stays the default path's
+    if (!opts.update)
+    {
+        for (const GoldenVariant& variant : VARIANTS)
+        {
+            ConfigureVariant(*sceneRenderer, variant);
+            for (const GoldenShot& shot : SHOTS)
+            {
+                std::vector<unsigned char> rgba = RenderAt(context, *sceneRenderer, shot.time, WIDTH, HEIGHT);
+                CheckAgainstGolden((std::string(shot.name) + variant.suffix).c_str(), shot.name, rgba, opts);
+            }
+        }
+        ConfigureVariant(*sceneRenderer, GoldenVariant{ "", SHADING_FORWARD, false, false, false });
+
+        double plain = ColorFragmentsPerFrame(jobs, false);
+        double prepass = ColorFragmentsPerFrame(jobs, true);
+        std::printf("layered scene: %.0f colour fragments per frame, %.0f after the depth pre-pass\n", plain, prepass);
+        CHECK(prepass > 0.0);
+        CHECK(prepass < plain);
+    }
+
+    // ---------- perf ----------
+    profiler.Flush();
+    std::map<std::string, double> measured;
+    measured["frame_cpu_ms"] = Median(frameMs);
+    if (const FrameProfiler::Stats* s = profiler.Find("scene pass"))
+    {
+        double gpuMs = s->gpuCount ? s->gpuSum / s->gpuCount : 0.0;
+        if (gpuMs > NOISE_MS)
+            measured["scene_pass_gpu_ms"] = gpuMs;
+    }
+    for (const auto& kv : measured)
+        std::printf("%s: %.4f\n", kv.first.c_str(), kv.second);
+
+    std::string budgetPath = opts.goldenDir + "/perf_budget.txt";
+    if (opts.update)
+    {
+        CHECK(WriteBudget(budgetPath, measured, renderer));
+        std::printf("updated %s\n", budgetPath.c_str());
+    }
+    else if (opts.perfTolerance < 0.0)
+        std::printf("perf check off (--perf-tolerance)\n");
+    else
+    {
+        std::map<std::string, double> budget = ReadBudget(budgetPath);
+        if (budget.empty())
+            std::printf("no perf budget at %s, perf check skipped\n", budgetPath.c_str());
+        for (const auto& kv : budget)
+        {
+            auto it = measured.find(kv.first);
+            if (it == measured.end())
+            {
+                std::printf("%s: not measured on this renderer\n", kv.first.c_str());
+                continue;
+            }
+            double limit = kv.second * (1.0 + opts.perfTolerance / 100.0);
+            double change = kv.second > 0.0 ? 100.0 * (it->second / kv.second - 1.0) : 0.0;
+            std::printf("%s: %.4f ms vs budget %.4f ms (%+.1f%%, limit +%.0f%%)\n",
+                kv.first.c_str(), it->second, kv.second, change, opts.perfTolerance);
+            if (it->second > limit && it->second - kv.second > NOISE_MS)
+            {
+                std::printf("FAILED %s regressed past the budget\n", kv.first.c_str());
+                ++g_failures;
+            }
+        }
+    }
+
+    sceneRenderer.reset();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all golden checks passed\n");
+    return 0;
+}
@@ -0,0 +1,226 @@
+// WorkStealingDeque and JobSystem checks: every pushed job is taken exactly
+// once while thieves race the owner, RunAfter() jobs start only after their
+// dependency drained, jobs can wait on jobs they submitted, and a thread can
+// keep far more jobs in flight than its ring and deque hold (JOBS_PER_THREAD)
+// without any of them being lost or run twice. Background jobs all run, in
+// order when one thread runs them, and Wait() never picks them up.
+#include "JobSystem.h"
+
+#include "TestCheck.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// the owner pushes and pops at the bottom while three threads steal
+static void TestDequeRaces()
+{
+    const int COUNT = 200000;
+    const int THIEVES = 3;
+    std::unique_ptr<Job[]> jobs(new Job[COUNT]());
+    std::unique_ptr<std::atomic<int>[]> taken(new std::atomic<int>[COUNT]);
+    for (int i = 0; i < COUNT; ++i)
+        taken[i].store(0);
+
+    WorkStealingDeque deque(256);
+    std::atomic<bool> pushing{ true };
+    std::atomic<int> stolen{ 0 };
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < THIEVES; ++t)
+    {
+        thieves.emplace_back([&]
+        {
+            while (pushing.load() || stolen.load() < 0)
+            {
+                if (Job* job = deque.Steal())
+                {
+                    taken[job - jobs.get()].fetch_add(1);
+                    stolen.fetch_add(1);
+                }
+            }
+            while (Job* job = deque.Steal())
+            {
+                taken[job - jobs.get()].fetch_add(1);
+                stolen.fetch_add(1);
+            }
+        });
+    }
+
+    int popped = 0;
+    for (int i = 0; i < COUNT; ++i)
+    {
+        while (!deque.Push(&jobs[i]))
+        {
+            if (Job* job = deque.Pop())
+            {
+                taken[job - jobs.get()].fetch_add(1);
+                ++popped;
+            }
+        }
+        if (i % 3 == 0)
+        {
+            if (Job* job = deque.Pop())
+            {
+                taken[job - jobs.get()].fetch_add(1);
+                ++popped;
+            }
+        }
+    }
+    while (Job* job = deque.Pop())
+    {
+        taken[job - jobs.get()].fetch_add(1);
+        ++popped;
+    }
+    pushing.store(false);
+    for (std::thread& t : thieves)
+        t.join();
+
+    int wrong = 0;
+    for (int i = 0; i < COUNT; ++i)
+        wrong += taken[i].load() != 1;
+    std::printf("deque: %d popped, %d stolen, %d taken other than once\n", popped, stolen.load(), wrong);
+    CHECK(wrong == 0);
+    CHECK(popped + stolen.load() == COUNT);
+}
+
+static void TestRunAfter(JobSystem& jobs)
+{
+    const int COUNT = 64;
+    std::atomic<int> finished{ 0 };
+    std::atomic<int> early{ 0 };
+    JobCounter first, second;
+    for (int i = 0; i < COUNT; ++i)
+    {
+        std::atomic<int>* f = &finished;
+        jobs.Run(first, [f]
+        {
+            volatile int spin = 0;
+            for (int k = 0; k < 20000; ++k)
+                spin = spin + k;
+            f->fetch_add(1);
+        });
+    }
+    for (int i = 0; i < COUNT; ++i)
+    {
+        std::atomic<int>* f = &finished;
+        std::atomic<int>* e = &early;
+        jobs.RunAfter(first, second, [f, e] { e->fetch_add(f->load() != COUNT); });
+    }
+    jobs.Wait(second);
+    CHECK(first.done());
+    CHECK(finished.load() == COUNT);
+    CHECK(early.load() == 0);
+}
+
+// each job fans out again and waits for its children
+static void TestNestedWait(JobSystem& jobs)
+{
+    const int OUTER = 32;
+    const int INNER = 256;
+    std::atomic<int> leaves{ 0 };
+    std::atomic<int> incomplete{ 0 };
+    JobCounter outer;
+    for (int i = 0; i < OUTER; ++i)
+    {
+        JobSystem* system = &jobs;
+        std::atomic<int>* l = &leaves;
+        std::atomic<int>* bad = &incomplete;
+        system->Run(outer, [system, l, bad]
+        {
+            std::atomic<int> mine{ 0 };
+            std::atomic<int>* m = &mine;
+            JobCounter inner;
+            for (int k = 0; k < INNER; ++k)
+                system->Run(inner, [m, l] { m->fetch_add(1); l->fetch_add(1); });
+            system->Wait(inner);
+            bad->fetch_add(mine.load() != INNER);
+        });
+    }
+    jobs.Wait(outer);
+    CHECK(leaves.load() == OUTER * INNER);
+    CHECK(incomplete.load() == 0);
+}
+
+// several times JOBS_PER_THREAD jobs submitted before anything waits: the
+// ring wraps while older jobs are still queued or running elsewhere
+static void TestManyOutstanding(JobSystem& jobs)
+{
+    const size_t COUNT = 50000;
+    std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[COUNT]);
+    for (size_t i = 0; i < COUNT; ++i)
+        runs[i].store(0);
+
+    JobCounter counter;
+    jobs.ParallelFor(counter, COUNT, 1, [&runs](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            runs[i].fetch_add(1);
+    });
+    jobs.Wait(counter);
+
+    size_t wrong = 0;
+    for (size_t i = 0; i < COUNT; ++i)
+        wrong += runs[i].load() != 1;
+    std::printf("%u thread(s), %zu jobs in flight: %zu run other than once\n", jobs.threadCount(), COUNT, wrong);
+    CHECK(wrong == 0);
+}
+
+static void TestBackground(JobSystem& jobs)
+{
+    const int COUNT = 100;
+    std::atomic<int> order[COUNT];
+    std::atomic<int> next{ 0 };
+    JobCounter background;
+    for (int i = 0; i < COUNT; ++i)
+    {
+        std::atomic<int>* slot = &order[i];
+        std::atomic<int>* n = &next;
+        slot->store(-1);
+        jobs.RunInBackground(background, [slot, n] { slot->store(n->fetch_add(1)); });
+    }
+
+    // an ordinary job and its Wait() leave the background ones alone
+    JobCounter frame;
+    std::atomic<int> frameRan{ 0 };
+    std::atomic<int>* f = &frameRan;
+    jobs.Run(frame, [f] { f->store(1); });
+    jobs.Wait(frame);
+    CHECK(frameRan.load() == 1);
+    if (jobs.threadCount() == 1)
+        CHECK(next.load() == 0);
+
+    while (!background.done())
+    {
+        if (!jobs.RunBackgroundJob())
+            std::this_thread::yield();
+    }
+    int outOfOrder = 0;
+    for (int i = 0; i < COUNT; ++i)
+        outOfOrder += order[i].load() < 0 || (jobs.threadCount() == 1 && order[i].load() != i);
+    CHECK(next.load() == COUNT);
+    CHECK(outOfOrder == 0);
+    CHECK(!jobs.RunBackgroundJob());
+}
+
+int main()
+{
+    TestDequeRaces();
+    for (unsigned int workers : { 0u, 3u })
+    {
+        JobSystem jobs(workers);
+        TestRunAfter(jobs);
+        TestNestedWait(jobs);
+        TestManyOutstanding(jobs);
+        TestBackground(jobs);
+    }
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all job system checks passed\n");
+    return 0;
+}
@@ -0,0 +1,128 @@
+// AVX2 JPEG kernel checks: decoding with the AVX2 IDCT / upsampler / color
+// converter must give exactly the bytes of the SSE2 kernels, for progressive
+// and baseline input, every row-tail length of the 16-pixel loops, noise
+// that saturates the IDCT, and through the parallel decoder as well.
+// Skipped when the CPU (or the build) has no AVX2.
+#include "ImageWrite.h"
+#include "FileView.h"
+#include "stb_image.h"
+
+#include "TestCheck.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static std::vector<unsigned char> MakeImage(int w, int h, int channels, bool noise)
+{
+    std::vector<unsigned char> pixels((size_t)w * h * channels);
+    uint32_t state = 7;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            for (int c = 0; c < channels; ++c)
+            {
+                state = state * 1664525u + 1013904223u;
+                float smooth = 128.0f + 120.0f * std::sin(x * 0.09f + c) * std::cos(y * 0.05f - c);
+                pixels[((size_t)y * w + x) * channels + c] = noise ? (unsigned char)(state >> 24) : (unsigned char)smooth;
+            }
+    return pixels;
+}
+
+static void SerialParallelFor(void*, int count, stbi_parallel_task task, void* data)
+{
+    for (int i = 0; i < count; ++i)
+        task(data, i);
+}
+
+static unsigned char* Decode(const std::vector<unsigned char>& file, bool avx2, bool parallel, int desired, int& w, int& h, int& c)
+{
+    stbi_set_jpeg_avx2(avx2 ? 1 : 0);
+    unsigned char* pixels = parallel
+        ? stbi_load_from_memory_parallel(file.data(), (int)file.size(), &w, &h, &c, desired, SerialParallelFor, nullptr, 5)
+        : stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, desired);
+    stbi_set_jpeg_avx2(1);
+    return pixels;
+}
+
+static bool SameAsSse2(const std::vector<unsigned char>& file, const char* what)
+{
+    bool same = true;
+    for (int parallel = 0; parallel < 2; ++parallel)
+    {
+        for (int desired = 0; desired <= 4; ++desired)
+        {
+            int w = 0, h = 0, c = 0, aw = 0, ah = 0, ac = 0;
+            unsigned char* sse2 = Decode(file, false, parallel != 0, desired, w, h, c);
+            unsigned char* avx2 = Decode(file, true, parallel != 0, desired, aw, ah, ac);
+            bool ok = sse2 && avx2 && w == aw && h == ah && c == ac
+                && std::memcmp(sse2, avx2, (size_t)w * h * (desired ? desired : c)) == 0;
+            if (!ok)
+                std::printf("  %s: %d channel(s)%s differ\n", what, desired, parallel ? " (parallel)" : "");
+            same = same && ok;
+            stbi_image_free(sse2);
+            stbi_image_free(avx2);
+        }
+    }
+    return same;
+}
+
+static void TestProgressive()
+{
+    FileView file("res.jpg");
+    CHECK(file.valid());
+    if (file.valid())
+        CHECK(SameAsSse2(std::vector<unsigned char>(file.data(), file.data() + file.size()), "res.jpg"));
+}
+
+static void TestRowTails()
+{
+    // 4:2:0 chroma rows are (w+1)/2 wide: widths 1..70 cover every tail of
+    // the 16-pixel upsampler and color loops, and odd block pairs
+    for (int w = 1; w <= 70; ++w)
+    {
+        int h = 3 + w % 19;
+        std::vector<unsigned char> pixels = MakeImage(w, h, 3, false);
+        std::vector<unsigned char> file;
+        CHECK(EncodeJpeg(file, w, h, 3, pixels.data(), 90, w % 3 == 0 ? 2 : 0));
+        char what[32];
+        std::snprintf(what, sizeof(what), "%dx%d", w, h);
+        CHECK(SameAsSse2(file, what));
+    }
+}
+
+static void TestSaturation()
+{
+    // noise at quality 100 drives the IDCT into its clamps
+    for (int channels : { 1, 3 })
+    {
+        std::vector<unsigned char> pixels = MakeImage(131, 77, channels, true);
+        std::vector<unsigned char> file;
+        CHECK(EncodeJpeg(file, 131, 77, channels, pixels.data(), 100, 0));
+        CHECK(SameAsSse2(file, channels == 1 ? "noise gray" : "noise color"));
+        CHECK(EncodeJpeg(file, 131, 77, channels, pixels.data(), 100, 5));
+        CHECK(SameAsSse2(file, channels == 1 ? "noise gray ri5" : "noise color ri5"));
+    }
+}
+
+int main()
+{
+    if (!stbi_set_jpeg_avx2(1))
+    {
+        std::printf("no AVX2 here, skipping\n");
+        return SKIPPED;
+    }
+
+    TestProgressive();
+    TestRowTails();
+    TestSaturation();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all avx2 jpeg checks passed\n");
+    return 0;
+}
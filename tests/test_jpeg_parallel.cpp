@@ -0,0 +1,153 @@
+// Parallel JPEG decode checks: stbi_load_from_memory_parallel must return
+// exactly the bytes of stbi_load_from_memory for progressive input (res.jpg),
+// baseline color and grayscale with and without restart intervals, odd sizes
+// and any task count; non-JPEG input must pass straight through. Also checks
+// the test encoder itself round-trips close to its source.
+#include "FileView.h"
+#include "ImageDecode.h"
+#include "ImageWrite.h"
+#include "JobSystem.h"
+#include "stb_image.h"
+
+#include "TestCheck.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static std::vector<unsigned char> MakeImage(int w, int h, int channels)
+{
+    std::vector<unsigned char> pixels((size_t)w * h * channels);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            unsigned char* p = &pixels[((size_t)y * w + x) * channels];
+            float v[4] = { 255.0f * x / w, 255.0f * y / h,
+                128.0f + 100.0f * std::sin(x * 0.05f) * std::cos(y * 0.07f), 255.0f };
+            for (int c = 0; c < channels; ++c)
+                p[c] = (unsigned char)v[c];
+        }
+    return pixels;
+}
+
+// runs the tasks back to front on the calling thread: any hidden ordering
+// dependency between tasks shows up as a mismatch
+static void ReverseParallelFor(void*, int count, stbi_parallel_task task, void* data)
+{
+    for (int i = count - 1; i >= 0; --i)
+        task(data, i);
+}
+
+// the serial decode vs every parallel flavour, for each requested channel count
+static void CheckSameAsSerial(JobSystem& jobs, const std::vector<unsigned char>& file, const char* what)
+{
+    static const int taskCounts[] = { 2, 3, 7, 64, 5000 };
+    for (int desired = 0; desired <= 4; ++desired)
+    {
+        int w = 0, h = 0, c = 0;
+        unsigned char* serial = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, desired);
+        CHECK(serial != nullptr);
+        if (!serial)
+            return;
+        size_t bytes = (size_t)w * h * (desired ? desired : c);
+
+        for (int tasks : taskCounts)
+        {
+            int pw = 0, ph = 0, pc = 0;
+            unsigned char* parallel = stbi_load_from_memory_parallel(file.data(), (int)file.size(), &pw, &ph, &pc, desired,
+                ReverseParallelFor, nullptr, tasks);
+            bool same = parallel && pw == w && ph == h && pc == c && std::memcmp(parallel, serial, bytes) == 0;
+            if (!same)
+                std::printf("  %s: %d channel(s), %d tasks differ from the serial decode\n", what, desired, tasks);
+            CHECK(same);
+            stbi_image_free(parallel);
+        }
+
+        DecodedImage image;
+        CHECK(DecodeImageParallel(jobs, file.data(), file.size(), desired, image));
+        CHECK(image.pixels && image.width == w && image.height == h && std::memcmp(image.pixels, serial, bytes) == 0);
+        FreeDecodedImage(image);
+        stbi_image_free(serial);
+    }
+}
+
+static void TestProgressive(JobSystem& jobs)
+{
+    FileView file("res.jpg");
+    CHECK(file.valid());
+    if (!file.valid())
+        return;
+    CheckSameAsSerial(jobs, std::vector<unsigned char>(file.data(), file.data() + file.size()), "res.jpg");
+}
+
+static void TestBaseline(JobSystem& jobs)
+{
+    // odd sizes leave partial MCUs on both edges
+    static const int sizes[][2] = { { 333, 201 }, { 64, 48 }, { 17, 9 } };
+    static const int restarts[] = { 0, 1, 3, 7, 100000 };
+    for (const int* size : sizes)
+    {
+        for (int channels : { 1, 3 })
+        {
+            std::vector<unsigned char> pixels = MakeImage(size[0], size[1], channels);
+            for (int interval : restarts)
+            {
+                std::vector<unsigned char> file;
+                CHECK(EncodeJpeg(file, size[0], size[1], channels, pixels.data(), 85, interval > 65535 ? 65535 : interval));
+                char what[64];
+                std::snprintf(what, sizeof(what), "%dx%d c%d ri%d", size[0], size[1], channels, interval);
+                CheckSameAsSerial(jobs, file, what);
+            }
+        }
+    }
+}
+
+static void TestEncoderRoundTrip()
+{
+    const int w = 160, h = 120;
+    std::vector<unsigned char> pixels = MakeImage(w, h, 3);
+    std::vector<unsigned char> file;
+    CHECK(EncodeJpeg(file, w, h, 3, pixels.data(), 90, 4));
+    int dw = 0, dh = 0, dc = 0;
+    unsigned char* decoded = stbi_load_from_memory(file.data(), (int)file.size(), &dw, &dh, &dc, 3);
+    CHECK(decoded && dw == w && dh == h && dc == 3);
+    if (!decoded)
+        return;
+    double error = 0.0;
+    for (size_t i = 0; i < pixels.size(); ++i)
+        error += std::abs((int)decoded[i] - (int)pixels[i]);
+    error /= pixels.size();
+    std::printf("encoder round trip: mean abs error %.2f\n", error);
+    CHECK(error < 3.0);
+    stbi_image_free(decoded);
+}
+
+static void TestNonJpeg(JobSystem& jobs)
+{
+    std::vector<unsigned char> pixels = MakeImage(37, 21, 4);
+    CHECK(WritePng("jpeg_parallel_test.png", 37, 21, 4, pixels.data()));
+    DecodedImage image;
+    CHECK(DecodeImageParallel(jobs, "jpeg_parallel_test.png", 4, image));
+    CHECK(image.pixels && image.width == 37 && image.height == 21 && std::memcmp(image.pixels, pixels.data(), pixels.size()) == 0);
+    FreeDecodedImage(image);
+    std::remove("jpeg_parallel_test.png");
+}
+
+int main()
+{
+    JobSystem jobs(3);
+    TestEncoderRoundTrip();
+    TestProgressive(jobs);
+    TestBaseline(jobs);
+    TestNonJpeg(jobs);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all parallel jpeg checks passed\n");
+    return 0;
+}
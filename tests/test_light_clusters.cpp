@@ -0,0 +1,173 @@
+// LightClusters checks: random points inside the frustum are looked up the
+// way fragment.frag does (tile from the projected position, slice from the
+// log of the view depth), and every light that reaches the point must be in
+// that froxel's list. Also the index list stays within bounds, light counts
+// above MAX_LIGHTS_PER_CLUSTER are dropped and counted, and the result does
+// not depend on the number of job threads.
+#include "JobSystem.h"
+#include "LightClusters.h"
+
+#include "TestCheck.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static uint32_t g_random = 99;
+
+static float Random(float lo, float hi)
+{
+    g_random = g_random * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(g_random >> 8) / 16777216.0f;
+}
+
+static std::vector<PointLight> RandomLights(size_t count, const glm::vec3& lo, const glm::vec3& hi, float minRange, float maxRange)
+{
+    std::vector<PointLight> lights(count);
+    for (PointLight& l : lights)
+    {
+        l.position = glm::vec3(Random(lo.x, hi.x), Random(lo.y, hi.y), Random(lo.z, hi.z));
+        l.range = Random(minRange, maxRange);
+        l.color = glm::vec3(1.0f);
+        l.pad = 0.0f;
+    }
+    return lights;
+}
+
+// the froxel fragment.frag reads for a world-space point, -1 when clipped
+static int ClusterOf(const LightClusters& clusters, const glm::mat4& viewProj, const glm::vec3& p)
+{
+    glm::vec4 clip = viewProj * glm::vec4(p, 1.0f);
+    if (clip.w <= 0.0f)
+        return -1;
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    if (std::fabs(ndc.x) >= 1.0f || std::fabs(ndc.y) >= 1.0f || std::fabs(ndc.z) >= 1.0f)
+        return -1;
+    int tx = std::min((int)((ndc.x * 0.5f + 0.5f) * CLUSTER_TILES_X), CLUSTER_TILES_X - 1);
+    int ty = std::min((int)((ndc.y * 0.5f + 0.5f) * CLUSTER_TILES_Y), CLUSTER_TILES_Y - 1);
+    float depth = glm::dot(clusters.depthRow(), glm::vec4(p, 1.0f));
+    int slice = (int)(std::log(std::max(depth, 1e-4f)) * clusters.sliceScale() + clusters.sliceBias());
+    slice = std::max(0, std::min(slice, CLUSTER_SLICES - 1));
+    return (slice * CLUSTER_TILES_Y + ty) * CLUSTER_TILES_X + tx;
+}
+
+static bool Listed(const LightClusters& clusters, int cluster, size_t light)
+{
+    const uint32_t* range = clusters.ranges() + cluster * 2;
+    for (uint32_t i = 0; i < range[1]; ++i)
+        if (clusters.indices()[range[0] + i] == light)
+            return true;
+    return false;
+}
+
+static void CheckLookups(const LightClusters& clusters, const glm::mat4& viewProj, const std::vector<PointLight>& lights)
+{
+    int misses = 0, lookups = 0;
+    for (int i = 0; i < 20000; ++i)
+    {
+        // a point near a random light, inside its range
+        const PointLight& near = lights[(size_t)Random(0.0f, (float)lights.size() - 1.0f)];
+        glm::vec3 p = near.position + glm::vec3(Random(-1, 1), Random(-1, 1), Random(-1, 1)) * near.range * 0.55f;
+        int cluster = ClusterOf(clusters, viewProj, p);
+        if (cluster < 0)
+            continue;
+        ++lookups;
+        for (size_t l = 0; l < lights.size(); ++l)
+        {
+            // a little inside the range, so float rounding at froxel borders does not count
+            float reach = lights[l].range * 0.999f;
+            glm::vec3 d = p - lights[l].position;
+            if (glm::dot(d, d) < reach * reach && !Listed(clusters, cluster, l))
+                ++misses;
+        }
+    }
+    CHECK(lookups > 1000);
+    CHECK(misses == 0);
+    if (misses)
+        std::printf("  %d light(s) missing over %d lookups\n", misses, lookups);
+}
+
+static void CheckRanges(const LightClusters& clusters, size_t lightCount)
+{
+    for (int c = 0; c < CLUSTER_COUNT; ++c)
+    {
+        const uint32_t* range = clusters.ranges() + c * 2;
+        CHECK(range[1] <= (uint32_t)MAX_LIGHTS_PER_CLUSTER);
+        CHECK(range[0] + range[1] <= clusters.indexCount());
+    }
+    for (size_t i = 0; i < clusters.indexCount(); ++i)
+        CHECK(clusters.indices()[i] < lightCount);
+}
+
+int main()
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 8.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.0f);
+    glm::mat4 viewProj = projection * view;
+
+    // lights around the scene, some behind the camera and past the sides
+    std::vector<PointLight> lights = RandomLights(3000, glm::vec3(-30, -20, -60), glm::vec3(30, 20, 12), 0.3f, 4.0f);
+
+    // the one-thread reference; a thread can only drive one JobSystem at a time
+    std::vector<uint32_t> singleRanges;
+    std::vector<uint16_t> singleIndices;
+    {
+        JobSystem single(0);
+        LightClusters alone(single);
+        alone.Build(view, projection, lights.data(), lights.size());
+        singleRanges.assign(alone.ranges(), alone.ranges() + CLUSTER_COUNT * 2);
+        singleIndices.assign(alone.indices(), alone.indices() + alone.indexCount());
+    }
+
+    JobSystem jobs(3);
+    LightClusters clusters(jobs);
+
+    // no lights: every froxel empty
+    clusters.Build(view, projection, nullptr, 0);
+    CHECK(clusters.indexCount() == 0);
+    for (int c = 0; c < CLUSTER_COUNT; ++c)
+        CHECK(clusters.ranges()[c * 2 + 1] == 0);
+
+    clusters.Build(view, projection, lights.data(), lights.size());
+    CheckRanges(clusters, lights.size());
+    CheckLookups(clusters, viewProj, lights);
+    CHECK(clusters.droppedCount() == 0);
+
+    // a rotated camera with a wide, short frustum
+    glm::mat4 turned = glm::lookAt(glm::vec3(5.0f, 3.0f, 2.0f), glm::vec3(-4.0f, -1.0f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 wide = glm::perspective(glm::radians(80.0f), 2.0f, 0.5f, 60.0f);
+    clusters.Build(turned, wide, lights.data(), lights.size());
+    CheckRanges(clusters, lights.size());
+    CheckLookups(clusters, wide * turned, lights);
+
+    // same lists as from one thread
+    clusters.Build(view, projection, lights.data(), lights.size());
+    CHECK(std::equal(singleRanges.begin(), singleRanges.end(), clusters.ranges()));
+    CHECK(clusters.indexCount() == singleIndices.size() &&
+        std::equal(singleIndices.begin(), singleIndices.end(), clusters.indices()));
+
+    // a crowd in front of the camera overflows its froxels
+    std::vector<PointLight> crowd = RandomLights(2000, glm::vec3(-0.5f, -0.5f, -2.5f), glm::vec3(0.5f, 0.5f, -1.5f), 2.0f, 3.0f);
+    clusters.Build(view, projection, crowd.data(), crowd.size());
+    CheckRanges(clusters, crowd.size());
+    CHECK(clusters.droppedCount() > 0);
+
+    // a small index budget keeps the list within it
+    LightClusters capped(jobs, 1000);
+    capped.Build(view, projection, lights.data(), lights.size());
+    CheckRanges(capped, lights.size());
+    CHECK(capped.indexCount() <= 1000);
+    CHECK(capped.droppedCount() > 0);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all light cluster checks passed\n");
+    return 0;
+}
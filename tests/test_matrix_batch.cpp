@@ -0,0 +1,180 @@
+// Batched matrix checks: every kernel, on every instruction set this CPU
+// runs, against glm on random affine transforms (rotation, non-uniform scale,
+// translation) and random projective matrices; counts that leave a partial
+// last block; packing padding; and the fallback when an instruction set is
+// missing.
+#include "MatrixBatch.h"
+
+#include "TestCheck.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static uint32_t g_random = 1234;
+
+static float Random(float lo, float hi)
+{
+    g_random = g_random * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(g_random >> 8) / 16777216.0f;
+}
+
+static glm::mat4 RandomAffine()
+{
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(Random(-50, 50), Random(-50, 50), Random(-50, 50)));
+    m = glm::rotate(m, Random(-3.1f, 3.1f), glm::normalize(glm::vec3(Random(-1, 1), Random(-1, 1), Random(0.1f, 1))));
+    return glm::scale(m, glm::vec3(Random(0.2f, 4), Random(0.2f, 4), Random(0.2f, 4)));
+}
+
+static glm::mat4 RandomMatrix()
+{
+    glm::mat4 m;
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            m[c][r] = Random(-2, 2);
+    return m;
+}
+
+// relative to the largest element of the reference
+template <class M>
+static bool Near(const M& got, const M& want, float tolerance = 1e-5f)
+{
+    float scale = 1.0f;
+    for (int c = 0; c < M::length(); ++c)
+        for (int r = 0; r < M::col_type::length(); ++r)
+            scale = std::fmax(scale, std::fabs(want[c][r]));
+    for (int c = 0; c < M::length(); ++c)
+        for (int r = 0; r < M::col_type::length(); ++r)
+            if (!(std::fabs(got[c][r] - want[c][r]) <= tolerance * scale))
+                return false;
+    return true;
+}
+
+static bool Near(const glm::vec4& got, const glm::vec4& want)
+{
+    float scale = std::fmax(1.0f, std::fmax(std::fmax(std::fabs(want.x), std::fabs(want.y)), std::fmax(std::fabs(want.z), std::fabs(want.w))));
+    for (int k = 0; k < 4; ++k)
+        if (!(std::fabs(got[k] - want[k]) <= 1e-5f * scale))
+            return false;
+    return true;
+}
+
+static void TestKernels(MatrixIsa isa, size_t count)
+{
+    const char* name = MatrixIsaName(isa);
+    std::vector<glm::mat4> a(count), b(count), general(count);
+    std::vector<glm::vec4> v(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        a[i] = RandomAffine();
+        b[i] = RandomAffine();
+        general[i] = RandomMatrix();
+        v[i] = glm::vec4(Random(-10, 10), Random(-10, 10), Random(-10, 10), Random(0, 1));
+    }
+    glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f) *
+        glm::lookAt(glm::vec3(1, 2, 8), glm::vec3(0, 0, -10), glm::vec3(0, 1, 0));
+
+    size_t blocks = MatrixBlockCount(count);
+    std::vector<Mat4Block> pa(blocks), pb(blocks), pg(blocks), pout(blocks);
+    std::vector<Mat3Block> pn(blocks);
+    std::vector<Vec4Block> pv(blocks), pvout(blocks);
+    PackMat4(a.data(), count, pa.data());
+    PackMat4(b.data(), count, pb.data());
+    PackMat4(general.data(), count, pg.data());
+    PackVec4(v.data(), count, pv.data());
+
+    std::vector<glm::mat4> m4(count);
+    std::vector<glm::mat3> m3(count);
+    std::vector<glm::vec4> v4(count);
+    int bad[6] = {};
+
+    MultiplyMat4Batch(pg.data(), pb.data(), pout.data(), blocks);
+    UnpackMat4(pout.data(), count, m4.data());
+    for (size_t i = 0; i < count; ++i)
+        bad[0] += !Near(m4[i], general[i] * b[i]);
+
+    MultiplyMat4Batch(viewProj, pa.data(), pout.data(), blocks);
+    UnpackMat4(pout.data(), count, m4.data());
+    for (size_t i = 0; i < count; ++i)
+        bad[1] += !Near(m4[i], viewProj * a[i]);
+
+    TransformVec4Batch(pg.data(), pv.data(), pvout.data(), blocks);
+    UnpackVec4(pvout.data(), count, v4.data());
+    for (size_t i = 0; i < count; ++i)
+        bad[2] += !Near(v4[i], general[i] * v[i]);
+
+    TransformVec4Batch(viewProj, pv.data(), pvout.data(), blocks);
+    UnpackVec4(pvout.data(), count, v4.data());
+    for (size_t i = 0; i < count; ++i)
+        bad[3] += !Near(v4[i], viewProj * v[i]);
+
+    InverseAffineBatch(pa.data(), pout.data(), blocks);
+    UnpackMat4(pout.data(), count, m4.data());
+    for (size_t i = 0; i < count; ++i)
+        bad[4] += !Near(m4[i], glm::inverse(a[i]), 1e-4f) || !Near(m4[i] * a[i], glm::mat4(1.0f), 1e-4f);
+
+    NormalMatrixBatch(pa.data(), pn.data(), blocks);
+    UnpackMat3(pn.data(), count, m3.data());
+    for (size_t i = 0; i < count; ++i)
+        bad[5] += !Near(m3[i], glm::transpose(glm::inverse(glm::mat3(a[i]))), 1e-4f);
+
+    static const char* kernels[6] = { "multiply", "multiply broadcast", "transform", "transform broadcast", "inverse affine", "normal matrix" };
+    for (int k = 0; k < 6; ++k)
+        if (bad[k])
+            std::printf("  %s %s, %zu matrices: %d wrong\n", name, kernels[k], count, bad[k]);
+    CHECK(bad[0] == 0 && bad[1] == 0 && bad[2] == 0 && bad[3] == 0 && bad[4] == 0 && bad[5] == 0);
+
+    // the padding lanes are identities, so their inverse and normal matrix are too
+    if (count % MATRIX_BATCH_LANES)
+    {
+        size_t last = blocks * MATRIX_BATCH_LANES - 1;
+        std::vector<glm::mat4> all(blocks * MATRIX_BATCH_LANES);
+        InverseAffineBatch(pa.data(), pout.data(), blocks);
+        UnpackMat4(pout.data(), all.size(), all.data());
+        CHECK(all[last] == glm::mat4(1.0f));
+        std::vector<glm::mat3> normals(all.size());
+        UnpackMat3(pn.data(), normals.size(), normals.data());
+        CHECK(normals[last] == glm::mat3(1.0f));
+    }
+}
+
+static void TestFallback()
+{
+    MatrixIsa best = SetMatrixIsa(MATRIX_ISA_AVX512);
+    CHECK(MatrixIsaSupported(MATRIX_ISA_PORTABLE));
+    CHECK(MatrixIsaSupported(best));
+    CHECK(GetMatrixIsa() == best);
+    for (int isa = best + 1; isa <= MATRIX_ISA_AVX512; ++isa)
+        CHECK(!MatrixIsaSupported((MatrixIsa)isa));
+    CHECK(SetMatrixIsa(MATRIX_ISA_PORTABLE) == MATRIX_ISA_PORTABLE);
+    std::printf("best instruction set here: %s\n", MatrixIsaName(best));
+}
+
+int main()
+{
+    TestFallback();
+
+    static const size_t counts[] = { 1, 16, 37, 1000 };
+    for (int isa = MATRIX_ISA_PORTABLE; isa <= MATRIX_ISA_AVX512; ++isa)
+    {
+        if (!MatrixIsaSupported((MatrixIsa)isa))
+        {
+            std::printf("%s not available, skipped\n", MatrixIsaName((MatrixIsa)isa));
+            continue;
+        }
+        CHECK(SetMatrixIsa((MatrixIsa)isa) == isa);
+        for (size_t count : counts)
+            TestKernels((MatrixIsa)isa, count);
+    }
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all matrix batch checks passed\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+// OcclusionCuller checks. Against one sphere occluder, random spheres the
+// culler hides must really be hidden: their cone from the eye inside the
+// occluder's and all of them behind it. A wall of two triangles hides what
+// is straight behind it and nothing that reaches past its edges. Through
+// FramePipeline on the layered scene, occlusion only removes packets (what
+// is left was drawn without it too) and the count does not depend on the
+// number of job threads.
+#include "FramePipeline.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "Scene.h"
+
+#include "TestCheck.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static uint32_t g_random = 4242;
+
+static float Random(float lo, float hi)
+{
+    g_random = g_random * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(g_random >> 8) / 16777216.0f;
+}
+
+// the eye is at the origin: is the sphere (c, r) entirely behind the sphere
+// (oc, orad) as seen from there
+static bool HiddenBehindSphere(const glm::vec3& c, float r, const glm::vec3& oc, float orad)
+{
+    float d = glm::length(c), od = glm::length(oc);
+    if (d - r <= od)
+        return false;
+    float angle = std::acos(glm::clamp(glm::dot(c, oc) / (d * od), -1.0f, 1.0f));
+    return angle + std::asin(r / d) <= std::asin(orad / od);
+}
+
+static void CheckSphereOccluder(OcclusionCuller& culler, const glm::mat4& projection)
+{
+    glm::vec3 occluder(0.0f, 0.0f, -10.0f);
+    const float radius = 3.0f;
+    culler.Begin(glm::mat4(1.0f), projection);
+    culler.AddSphereOccluder(occluder, radius);
+    culler.Rasterize();
+    CHECK(culler.triangleCount() == 6);
+
+    CHECK(!culler.SphereVisible(glm::vec3(0.0f, 0.0f, -30.0f), 1.0f));     // straight behind
+    CHECK(culler.SphereVisible(glm::vec3(0.0f, 0.0f, -5.0f), 1.0f));       // in front
+    CHECK(culler.SphereVisible(glm::vec3(0.0f, 0.0f, -9.0f), 0.5f));       // inside, in front of the centre
+    CHECK(culler.SphereVisible(glm::vec3(9.0f, 0.0f, -30.0f), 1.0f));      // peeks out
+    CHECK(culler.SphereVisible(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f));        // around the eye
+
+    int hidden = 0;
+    for (int i = 0; i < 20000; ++i)
+    {
+        glm::vec3 c(Random(-12.0f, 12.0f), Random(-6.0f, 6.0f), Random(-60.0f, -2.0f));
+        float r = Random(0.1f, 2.0f);
+        if (culler.SphereVisible(c, r))
+            continue;
+        ++hidden;
+        if (!HiddenBehindSphere(c, r, occluder, radius))
+        {
+            std::printf("  sphere (%g, %g, %g) r %g reported hidden\n", c.x, c.y, c.z, r);
+            CHECK(HiddenBehindSphere(c, r, occluder, radius));
+            break;
+        }
+    }
+    CHECK(hidden > 500);
+    std::printf("sphere occluder: %d of 20000 random spheres hidden\n", hidden);
+}
+
+static void CheckWall(OcclusionCuller& culler, const glm::mat4& projection)
+{
+    // x in [-5, 5], y in [-3, 3] at z = -10, seen from a camera turned a
+    // little; the spheres behind it stay clear of the diagonal it loses
+    const float quad[] = { -5, -3, 0, 5, -3, 0, 5, 3, 0, -5, 3, 0 };
+    const unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+    glm::mat4 view = glm::rotate(glm::mat4(1.0f), 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+    culler.Begin(view, projection);
+    culler.AddMeshOccluder(quad, 3, indices, 6, Affine3x4::Translation(glm::vec3(0.0f, 0.0f, -10.0f)));
+    culler.Rasterize();
+
+    CHECK(!culler.SphereVisible(glm::vec3(2.5f, -1.5f, -20.0f), 0.5f));
+    CHECK(!culler.SphereVisible(glm::vec3(-8.0f, 1.0f, -40.0f), 1.5f));
+    CHECK(culler.SphereVisible(glm::vec3(2.5f, -1.5f, -8.0f), 1.0f));      // in front
+    CHECK(culler.SphereVisible(glm::vec3(11.0f, 0.0f, -20.0f), 1.0f));     // past the sides
+    CHECK(culler.SphereVisible(glm::vec3(0.0f, -6.5f, -20.0f), 1.0f));
+}
+
+// the layered scene with and without occlusion culling
+static void CheckPipeline(const Scene& scene, JobSystem& jobs, size_t& occluded)
+{
+    FramePipeline pipeline(scene, jobs);
+    FrameParams frame;
+    frame.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 8.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.0f);
+    frame.time = 0.7f;
+    frame.viewportHeight = 600;
+
+    std::vector<uint32_t> all;
+    PacketStream plain = pipeline.Record(frame);
+    for (size_t i = 0; i < plain.size(); ++i)
+        all.push_back(plain.packets[i]->object);
+    size_t culled = pipeline.culledCount();
+
+    frame.occlusionCulling = true;
+    PacketStream kept = pipeline.Record(frame);
+    occluded = pipeline.occludedCount();
+    CHECK(pipeline.culledCount() == culled);
+    CHECK(kept.size() + occluded == all.size());
+    CHECK(occluded > 0);
+
+    // a subset of the same objects, each once
+    std::vector<int> drawn(scene.objects.size(), 0);
+    for (uint32_t object : all)
+        drawn[object] = 1;
+    size_t missing = 0;
+    for (size_t i = 0; i < kept.size(); ++i)
+        missing += drawn[kept.packets[i]->object]-- != 1;
+    CHECK(missing == 0);
+}
+
+int main()
+{
+    // the one-thread reference; a thread can only drive one JobSystem at a time
+    Scene scene = BuildLayeredScene(1500);
+    size_t singleOccluded = 0;
+    {
+        JobSystem single(0);
+        CheckPipeline(scene, single, singleOccluded);
+    }
+
+    JobSystem jobs(3);
+    OcclusionCuller culler(jobs);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 2.0f, 0.1f, 200.0f);
+
+    // nothing drawn hides nothing
+    culler.Begin(glm::mat4(1.0f), projection);
+    culler.Rasterize();
+    CHECK(culler.SphereVisible(glm::vec3(0.0f, 0.0f, -50.0f), 0.1f));
+
+    CheckSphereOccluder(culler, projection);
+    CheckWall(culler, projection);
+
+    size_t occluded = 0;
+    CheckPipeline(scene, jobs, occluded);
+    CHECK(occluded == singleOccluded);
+    std::printf("layered scene: %zu of %zu objects hidden\n", occluded, scene.objects.size());
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all occlusion culler checks passed\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Occlusion query checks on the layered scene (most objects straight behind
+// others): once the queries have caught up, the frame drawn with conditional
+// rendering must be identical to the one drawn without, while the queries
+// report objects hidden. Forward and deferred both.
+#include "HeadlessContext.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "RenderCapture.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+static const int WIDTH = 320;
+static const int HEIGHT = 240;
+// frames at the same t, so the queries and the image settle
+static const int SETTLE_FRAMES = 4;
+
+int main()
+{
+    HeadlessContext context;
+    if (!context.Create(WIDTH, HEIGHT))
+    {
+        std::printf("no headless GL context, skipping\n");
+        return SKIPPED;
+    }
+
+    JobSystem jobs(1);
+    Scene scene = BuildLayeredScene(300);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    renderer->SetCountFragments(true);
+
+    for (float t : { 0.0f, 1.3f })
+    {
+        renderer->SetOcclusionQueries(false);
+        std::vector<unsigned char> plain = RenderAt(context, *renderer, t, WIDTH, HEIGHT, SETTLE_FRAMES);
+        renderer->SetOcclusionQueries(true);
+        std::vector<unsigned char> culled = RenderAt(context, *renderer, t, WIDTH, HEIGHT, SETTLE_FRAMES);
+        CHECK(plain == culled);
+
+        // deferred draws the G-buffer under the same conditions
+        renderer->SetShadingMode(SHADING_DEFERRED);
+        renderer->SetOcclusionQueries(false);
+        plain = RenderAt(context, *renderer, t, WIDTH, HEIGHT, SETTLE_FRAMES);
+        renderer->SetOcclusionQueries(true);
+        culled = RenderAt(context, *renderer, t, WIDTH, HEIGHT, SETTLE_FRAMES);
+        CHECK(plain == culled);
+        renderer->SetShadingMode(SHADING_FORWARD);
+    }
+
+    const OcclusionQueries::Stats& s = renderer->occlusionQueries()->stats();
+    CHECK(s.frames > 0);
+    CHECK(s.occluded > 0);
+    CHECK(s.occluded < s.tested);
+    std::printf("%llu frames: %.1f objects tested, %.1f hidden per frame\n", (unsigned long long)s.frames,
+        s.frames ? (double)s.tested / s.frames : 0.0, s.frames ? (double)s.occluded / s.frames : 0.0);
+
+    renderer.reset();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all occlusion query checks passed\n");
+    return 0;
+}
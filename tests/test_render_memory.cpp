@@ -0,0 +1,98 @@
+// The steady-state "no heap allocations per frame" guarantee for the whole
+// render loop: SceneRenderer::Render through headless GL with clustered
+// lights, sun shadows (cascade fitting and caster recording), the cached
+// shadow path, occlusion queries, the CPU occluders and fragment counters,
+// for forward and deferred shading, and with the depth pre-pass, the
+// front-to-back sort, CPU MVPs or the point light's cube maps on top of
+// forward. Every operator new in the process is counted
+// (AllocationCounter.h); the GL driver's own C allocations are not.
+#include "HeadlessContext.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "AllocationCounter.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <memory>
+
+static const int WIDTH = 320;
+static const int HEIGHT = 240;
+static const int WARMUP_FRAMES = 10;
+static const int FRAMES = 100;
+
+enum Variant
+{
+    FORWARD,
+    DEFERRED,
+    SHADOW_CACHE,
+    DEPTH_PREPASS,
+    FRONT_TO_BACK,
+    CPU_MVP,
+    POINT_SHADOWS,  // the layered scene's light is among the objects: cube maps
+};
+
+static void CheckSteadyState(JobSystem& jobs, Variant variant)
+{
+    static const char* const NAMES[] = { "forward", "deferred", "shadow cache", "depth pre-pass",
+        "front to back", "cpu mvp", "point shadows" };
+
+    size_t start = g_allocations.load();
+    Scene scene = BuildLayeredScene(300);
+    AddLightField(scene, 64);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    CHECK(g_allocations.load() > start);   // the counter sees this code's allocations
+    renderer->SetShadingMode(variant == DEFERRED ? SHADING_DEFERRED : SHADING_FORWARD);
+    renderer->SetDepthPrepass(variant == DEPTH_PREPASS);
+    renderer->SetFrontToBack(variant == FRONT_TO_BACK);
+    renderer->SetCpuMvp(variant == CPU_MVP);
+    renderer->SetDirectionalLight(variant != POINT_SHADOWS);
+    renderer->SetShadows(true, 4);
+    renderer->SetShadowCaching(variant == SHADOW_CACHE);
+    renderer->SetOcclusionQueries(true);
+    renderer->SetCpuOcclusion(true);
+    renderer->SetCountFragments(true);
+
+    // warm-up: arenas and per-frame vectors reach their high-water mark
+    for (int i = 0; i < WARMUP_FRAMES; ++i)
+    {
+        renderer->Render((float)i / 60.0f, WIDTH, HEIGHT, nullptr);
+        glFinish();
+    }
+
+    size_t before = g_allocations.load();
+    for (int i = WARMUP_FRAMES; i < WARMUP_FRAMES + FRAMES; ++i)
+    {
+        renderer->Render((float)i / 60.0f, WIDTH, HEIGHT, nullptr);
+        glFinish();
+    }
+    size_t allocations = g_allocations.load() - before;
+
+    std::printf("%s: %zu objects, %zu lights, %zu heap allocations over %d frames\n",
+        NAMES[variant], scene.objects.size(), scene.lights.size(), allocations, FRAMES);
+    CHECK(renderer->shadowDraws() > 0);
+    CHECK(allocations == 0);
+}
+
+int main()
+{
+    HeadlessContext context;
+    if (!context.Create(WIDTH, HEIGHT))
+    {
+        std::printf("no headless GL context, skipping\n");
+        return SKIPPED;
+    }
+
+    JobSystem jobs(3);
+    for (Variant variant : { FORWARD, DEFERRED, SHADOW_CACHE, DEPTH_PREPASS, FRONT_TO_BACK, CPU_MVP, POINT_SHADOWS })
+        CheckSteadyState(jobs, variant);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all render memory checks passed\n");
+    return 0;
+}
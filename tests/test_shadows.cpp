@@ -0,0 +1,244 @@
+// Shadow map checks. A sphere held between the key light and the lit
+// sphere must darken it with shadows on, and nothing may get brighter,
+// for the point light's map and the sun's cascades alike, and with the
+// point light among the objects its cube faces shade every side of it; the
+// lit sphere alone must not shadow itself. Deferred shading samples the same maps as
+// forward. On the layered scene every cascade draws only its own casters,
+// and caching the static casters' maps changes no pixel: with the light held
+// still the cache is drawn once and each frame draws only the moving casters.
+#include "HeadlessContext.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include "RenderCapture.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+static const int WIDTH = 320;
+static const int HEIGHT = 240;
+
+// the key light straight in front of the receiver, at (0, 4, -4)
+static const float LIGHT_TIME = 1.5707963f;
+
+struct Difference
+{
+    int brighter = 0;   // channels brighter than without shadows by more than 2
+    int darker = 0;     // pixels darker by more than 30
+    int maxDarker = 0;
+};
+
+// over the columns [x0, x1)
+static Difference Compare(const std::vector<unsigned char>& plain, const std::vector<unsigned char>& shadowed,
+    int x0 = 0, int x1 = WIDTH)
+{
+    Difference d;
+    for (size_t p = 0; p + 3 < plain.size(); p += 4)
+    {
+        int x = (int)(p / 4 % WIDTH);
+        if (x < x0 || x >= x1)
+            continue;
+        int darkest = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            int delta = (int)shadowed[p + c] - (int)plain[p + c];
+            d.brighter += delta > 2;
+            darkest = std::max(darkest, -delta);
+        }
+        d.darker += darkest > 30;
+        d.maxDarker = std::max(d.maxDarker, darkest);
+    }
+    return d;
+}
+
+// with and without shadows, the light as a point or a sun
+static Difference ShadowDifference(HeadlessContext& context, SceneRenderer& renderer, bool sun)
+{
+    renderer.SetDirectionalLight(sun);
+    renderer.SetShadows(false);
+    std::vector<unsigned char> plain = RenderAt(context, renderer, LIGHT_TIME, WIDTH, HEIGHT);
+    renderer.SetShadows(true);
+    std::vector<unsigned char> image = RenderAt(context, renderer, LIGHT_TIME, WIDTH, HEIGHT);
+    renderer.SetShadows(false);
+    return Compare(plain, image);
+}
+
+static void CheckCasterAndReceiver(HeadlessContext& context, JobSystem& jobs)
+{
+    Scene scene;
+    scene.objects.push_back({ glm::vec3(0.0f, 0.0f, -10.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_PHONG, false });
+    scene.objects.push_back({ glm::vec3(0.0f, 2.875f, -6.7f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_COORD, false });
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+
+    for (bool sun : { false, true })
+    {
+        Difference d = ShadowDifference(context, *renderer, sun);
+        std::printf("%s: %d pixels darker by > 30 (up to %d), %d channels brighter\n",
+            sun ? "sun" : "point light", d.darker, d.maxDarker, d.brighter);
+        CHECK(d.brighter == 0);
+        CHECK(d.darker > 500);
+        CHECK(renderer->shadowDraws() > 0);
+    }
+
+    // deferred lights the same pixels through the same maps
+    renderer->SetDirectionalLight(false);
+    renderer->SetShadows(true);
+    std::vector<unsigned char> forward = RenderAt(context, *renderer, LIGHT_TIME, WIDTH, HEIGHT);
+    renderer->SetShadingMode(SHADING_DEFERRED);
+    std::vector<unsigned char> deferred = RenderAt(context, *renderer, LIGHT_TIME, WIDTH, HEIGHT);
+    renderer->SetShadingMode(SHADING_FORWARD);
+    int differing = 0;
+    for (size_t i = 0; i < forward.size(); ++i)
+        differing += std::abs((int)forward[i] - (int)deferred[i]) > 8;
+    std::printf("forward / deferred with shadows: %d channels differ by > 8\n", differing);
+    CHECK(differing < 100);
+}
+
+// casters on either side of the light and below it, each between it and a
+// lit sphere: too wide apart for one spot, every receiver is shaded
+static void CheckPointLightAmongObjects(HeadlessContext& context, JobSystem& jobs)
+{
+    Scene scene;
+    scene.objects.push_back({ glm::vec3(0.0f, 0.0f, -10.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_PHONG, false });
+    scene.objects.push_back({ glm::vec3(0.0f, 2.875f, -6.7f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_COORD, false });
+    for (float side : { -1.0f, 1.0f })
+    {
+        scene.objects.push_back({ glm::vec3(side * 7.0f, 4.0f, -4.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_PHONG, false });
+        scene.objects.push_back({ glm::vec3(side * 3.5f, 4.0f, -4.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_COORD, false });
+    }
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+
+    renderer->SetDirectionalLight(false);
+    std::vector<unsigned char> plain = RenderAt(context, *renderer, LIGHT_TIME, WIDTH, HEIGHT);
+    renderer->SetShadows(true);
+    std::vector<unsigned char> image = RenderAt(context, *renderer, LIGHT_TIME, WIDTH, HEIGHT);
+    Difference left = Compare(plain, image, 0, WIDTH / 3);
+    Difference middle = Compare(plain, image, WIDTH / 3, 2 * WIDTH / 3);
+    Difference right = Compare(plain, image, 2 * WIDTH / 3, WIDTH);
+    std::printf("point light among the objects: %d / %d / %d pixels darker by > 30 (left / middle / right), %zu caster draws\n",
+        left.darker, middle.darker, right.darker, renderer->shadowDraws());
+    CHECK(left.brighter + middle.brighter + right.brighter == 0);
+    CHECK(left.darker > 50);
+    CHECK(middle.darker > 500);
+    CHECK(right.darker > 50);
+    // each caster lands in about one face
+    CHECK(renderer->shadowDraws() >= scene.objects.size());
+    CHECK(renderer->shadowDraws() < 2 * scene.objects.size());
+}
+
+// convex receivers alone, one (the point light's spot) or around the light
+// (its cube faces): what their own maps say must match N . L
+static void CheckNoSelfShadowing(HeadlessContext& context, JobSystem& jobs)
+{
+    Scene single;
+    single.objects.push_back({ glm::vec3(0.0f, 0.0f, -10.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_PHONG, false });
+    Scene around = single;
+    for (float side : { -1.0f, 1.0f })
+        around.objects.push_back({ glm::vec3(side * 7.0f, 4.0f, -4.0f), SPHERE_RADIUS, SHAPE_SPHERE, MAT_PHONG, false });
+
+    for (const Scene* scene : { &single, &around })
+    {
+        std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(*scene, jobs));
+        for (bool sun : { false, true })
+        {
+            Difference d = ShadowDifference(context, *renderer, sun);
+            CHECK(d.brighter == 0);
+            CHECK(d.maxDarker <= 8);
+        }
+    }
+}
+
+// objects outside a light frustum are not drawn into that map
+static void CheckCasterCulling(JobSystem& jobs)
+{
+    Scene scene = BuildLayeredScene(600);
+    std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+    renderer->SetDirectionalLight(true);
+    renderer->SetShadows(true, 4);
+    renderer->Render(0.7f, WIDTH, HEIGHT, nullptr);
+    size_t cascadeDraws = renderer->shadowDraws();
+    CHECK(cascadeDraws > 0);
+    CHECK(cascadeDraws < 4 * scene.objects.size());
+
+    renderer->SetDirectionalLight(false);
+    renderer->Render(0.7f, WIDTH, HEIGHT, nullptr);
+    CHECK(renderer->shadowDraws() > 0);
+    CHECK(renderer->shadowDraws() < 2 * scene.objects.size());
+    std::printf("layered scene, %zu objects: %zu caster draws over 4 cascades, %zu for the point light\n",
+        scene.objects.size(), cascadeDraws, renderer->shadowDraws());
+}
+
+// the layered scene through frames; the last one's pixels
+static std::vector<unsigned char> RenderFrames(HeadlessContext& context, SceneRenderer& renderer, int frames)
+{
+    std::vector<unsigned char> rgba;
+    for (int i = 0; i < frames; ++i)
+        rgba = RenderAt(context, renderer, 0.7f + (float)i / 60.0f, WIDTH, HEIGHT);
+    return rgba;
+}
+
+static void CheckShadowCache(HeadlessContext& context, JobSystem& jobs)
+{
+    const int FRAMES = 5;
+    Scene scene = BuildLayeredScene(300);
+    for (bool sun : { false, true })
+    {
+        std::unique_ptr<SceneRenderer> renderer(new SceneRenderer(scene, jobs));
+        renderer->SetDirectionalLight(sun);
+        renderer->SetShadows(true, 4);
+        renderer->SetFixedLightTime(LIGHT_TIME);
+        std::vector<unsigned char> uncached = RenderFrames(context, *renderer, FRAMES);
+        size_t uncachedDraws = renderer->shadowDraws();
+
+        renderer->SetShadowCaching(true);
+        std::vector<unsigned char> cached = RenderFrames(context, *renderer, FRAMES);
+        CHECK(cached == uncached);
+        CHECK(renderer->shadowCacheUpdates() == 1);
+        CHECK(renderer->shadowDraws() < uncachedDraws);
+        std::printf("%s, shadow cache: %zu caster draws a frame instead of %zu\n",
+            sun ? "sun" : "point light", renderer->shadowDraws(), uncachedDraws);
+
+        renderer->InvalidateShadowCache();
+        CHECK(RenderFrames(context, *renderer, FRAMES) == uncached);
+        CHECK(renderer->shadowCacheUpdates() == 2);
+
+        // an orbiting light moves the maps every frame
+        renderer->SetFixedLightTime(-1.0f);
+        renderer->SetShadowCaching(false);
+        uncached = RenderFrames(context, *renderer, FRAMES);
+        renderer->SetShadowCaching(true);
+        size_t updates = renderer->shadowCacheUpdates();
+        CHECK(RenderFrames(context, *renderer, FRAMES) == uncached);
+        CHECK(renderer->shadowCacheUpdates() == updates + FRAMES);
+    }
+}
+
+int main()
+{
+    HeadlessContext context;
+    if (!context.Create(WIDTH, HEIGHT))
+    {
+        std::printf("no headless GL context, skipping\n");
+        return SKIPPED;
+    }
+
+    JobSystem jobs(1);
+    CheckCasterAndReceiver(context, jobs);
+    CheckPointLightAmongObjects(context, jobs);
+    CheckNoSelfShadowing(context, jobs);
+    CheckCasterCulling(jobs);
+    CheckShadowCache(context, jobs);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all shadow checks passed\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Software rasterizer checks: its frames must match the GL goldens within a
+// perceptual tolerance (edge pixels may land differently) and must not depend
+// on the number of job threads.
+//
+//   test_soft_raster [--golden-dir D] [--max-mismatch PCT]
+#include "ImageDecode.h"
+#include "ImageWrite.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "SoftwareRenderer.h"
+
+#include "ImageCompare.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// same shots as test_golden
+static const int WIDTH = 320;
+static const int HEIGHT = 240;
+
+struct GoldenShot
+{
+    const char* name;
+    float time;
+};
+static const GoldenShot SHOTS[] = {
+    { "scene_t0", 0.0f },
+    { "scene_t2_5", 2.5f },
+};
+
+static std::vector<unsigned char> RenderSoftware(const Scene& scene, unsigned int workers, float t, int width, int height)
+{
+    JobSystem jobs(workers);
+    SoftwareRenderer renderer(scene, jobs);
+    renderer.Render(t, width, height);
+
+    std::vector<unsigned char> rgba;
+    renderer.ReadPixels(rgba);
+    return rgba;
+}
+
+static void TestMatchesGolden(const std::string& goldenDir, double maxMismatch)
+{
+    Scene scene = BuildDefaultScene();
+    for (const GoldenShot& shot : SHOTS)
+    {
+        std::vector<unsigned char> rgba = RenderSoftware(scene, 3, shot.time, WIDTH, HEIGHT);
+
+        std::string goldenPath = goldenDir + "/" + shot.name + ".png";
+        DecodedImage golden;
+        if (!DecodeImage(goldenPath.c_str(), 3, golden))
+        {
+            std::printf("FAILED %s: cannot read golden %s\n", shot.name, goldenPath.c_str());
+            ++g_failures;
+            continue;
+        }
+        CHECK(golden.width == WIDTH && golden.height == HEIGHT);
+        if (golden.width != WIDTH || golden.height != HEIGHT)
+        {
+            FreeDecodedImage(golden);
+            continue;
+        }
+
+        std::vector<unsigned char> diff;
+        CompareResult r = CompareImages(rgba, golden.pixels, (size_t)WIDTH * HEIGHT, diff);
+        FreeDecodedImage(golden);
+
+        double mismatchPct = 100.0 * r.mismatched / ((double)WIDTH * HEIGHT);
+        std::printf("%s: %zu pixels differ from GL (%.3f%%)\n", shot.name, r.mismatched, mismatchPct);
+        if (mismatchPct > maxMismatch)
+        {
+            std::string actualPath = std::string("soft_") + shot.name + "_actual.png";
+            std::string diffPath = std::string("soft_") + shot.name + "_diff.png";
+            std::vector<unsigned char> rgb = ToRgb(rgba);
+            WritePng(actualPath.c_str(), WIDTH, HEIGHT, 3, rgb.data());
+            WritePng(diffPath.c_str(), WIDTH, HEIGHT, 3, diff.data());
+            std::printf("FAILED %s: over the %.3f%% limit, wrote %s and %s\n", shot.name, maxMismatch, actualPath.c_str(), diffPath.c_str());
+            ++g_failures;
+        }
+    }
+}
+
+// tiles are owned by one job each, so scheduling must not change a pixel;
+// an odd size also exercises the partial tiles on the right and bottom
+static void TestThreadIndependent()
+{
+    Scene scene = BuildStressScene(200);
+    std::vector<unsigned char> single = RenderSoftware(scene, 0, 1.25f, 333, 211);
+    std::vector<unsigned char> multi = RenderSoftware(scene, 5, 1.25f, 333, 211);
+    CHECK(single.size() == (size_t)333 * 211 * 4);
+    CHECK(single == multi);
+}
+
+int main(int argc, char** argv)
+{
+    std::string goldenDir = "../tests/golden";
+    double maxMismatch = 0.5;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--golden-dir") == 0)
+            goldenDir = argv[i + 1];
+        else if (std::strcmp(argv[i], "--max-mismatch") == 0)
+            maxMismatch = std::atof(argv[i + 1]);
+    }
+
+    TestMatchesGolden(goldenDir, maxMismatch);
+    TestThreadIndependent();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all software rasterizer checks passed\n");
+    return 0;
+}
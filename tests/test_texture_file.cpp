@@ -0,0 +1,257 @@
+// Cooked texture checks: the box mip chain must match the streamer's 2x2
+// filter (to within the float round trip), Kaiser must keep flat colors flat,
+// sRGB filtering must happen in linear light, threaded and serial cooking
+// must agree, and the container must round-trip and reject damaged files.
+// With a GL context, LoadTextureFile and the streamer must put the same
+// bytes into every level.
+#include "HeadlessContext.h"
+#include "JobSystem.h"
+#include "TextureFile.h"
+#include "TextureStreamer.h"
+
+#include "TestCheck.h"
+#include "TextureReadback.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static const char* COOKED_PATH = "texture_file_test.tex";
+
+static std::vector<unsigned char> MakeImage(int w, int h)
+{
+    std::vector<unsigned char> pixels((size_t)w * h * 4);
+    uint32_t noise = 3;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            unsigned char* p = &pixels[((size_t)y * w + x) * 4];
+            p[0] = (unsigned char)(255 * x / w);
+            p[1] = (unsigned char)(128 + 100 * std::sin(x * 0.3f) * std::cos(y * 0.2f));
+            p[2] = (unsigned char)(noise >> 24);
+            p[3] = (unsigned char)(255 - 255 * y / h);
+        }
+    return pixels;
+}
+
+static int MaxDifference(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    if (a.size() != b.size())
+        return 256;
+    int worst = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        worst = std::max(worst, std::abs((int)a[i] - (int)b[i]));
+    return worst;
+}
+
+static void TestBoxMatchesStreamer()
+{
+    static const int sizes[][2] = { { 64, 64 }, { 37, 21 }, { 1, 9 }, { 130, 3 } };
+    for (const int* size : sizes)
+    {
+        std::vector<unsigned char> image = MakeImage(size[0], size[1]);
+        CookedTexture cooked;
+        CookTexture(nullptr, image.data(), size[0], size[1], MIP_FILTER_BOX, false, cooked);
+        CHECK((int)cooked.levels.size() == TextureLevelCount(size[0], size[1]));
+        CHECK(cooked.widths.back() == 1 && cooked.heights.back() == 1);
+        CHECK(cooked.levels[0] == image);
+
+        // each level from the previous cooked one: rounding may differ by one
+        int worst = 0;
+        for (size_t i = 1; i < cooked.levels.size(); ++i)
+        {
+            std::vector<unsigned char> expected = Downsample(cooked.levels[i - 1], cooked.widths[i - 1], cooked.heights[i - 1],
+                cooked.widths[i], cooked.heights[i]);
+            worst = std::max(worst, MaxDifference(cooked.levels[i], expected));
+        }
+        if (worst > 1)
+            std::printf("  box %dx%d: off by %d\n", size[0], size[1], worst);
+        CHECK(worst <= 1);
+    }
+}
+
+static void TestKaiser()
+{
+    // normalized weights: a flat color stays exactly that color
+    std::vector<unsigned char> flat((size_t)45 * 29 * 4);
+    for (size_t i = 0; i < flat.size(); ++i)
+        flat[i] = (unsigned char)(i % 4 == 3 ? 255 : 40 + 70 * (i % 4));
+    for (int srgb = 0; srgb < 2; ++srgb)
+    {
+        CookedTexture cooked;
+        CookTexture(nullptr, flat.data(), 45, 29, MIP_FILTER_KAISER, srgb != 0, cooked);
+        for (size_t i = 1; i < cooked.levels.size(); ++i)
+            CHECK(std::memcmp(cooked.levels[i].data(), flat.data(), cooked.levels[i].size()) == 0);
+    }
+
+    // sharper than box on a fine pattern, but still close on average
+    std::vector<unsigned char> image = MakeImage(128, 128);
+    CookedTexture box, kaiser;
+    CookTexture(nullptr, image.data(), 128, 128, MIP_FILTER_BOX, false, box);
+    CookTexture(nullptr, image.data(), 128, 128, MIP_FILTER_KAISER, false, kaiser);
+    double diff = 0.0;
+    for (size_t i = 0; i < box.levels[1].size(); ++i)
+        diff += std::abs((int)box.levels[1][i] - (int)kaiser.levels[1][i]);
+    diff /= box.levels[1].size();
+    std::printf("kaiser vs box, level 1: mean abs difference %.2f\n", diff);
+    CHECK(diff > 0.0 && diff < 12.0);
+}
+
+static void TestSrgb()
+{
+    // black/white checkerboard: half the light is 0.5 linear, sRGB 188, not 128
+    std::vector<unsigned char> checker((size_t)8 * 8 * 4);
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            for (int c = 0; c < 4; ++c)
+                checker[((size_t)y * 8 + x) * 4 + c] = c == 3 || (x + y) % 2 ? 255 : 0;
+
+    CookedTexture linear, srgb;
+    CookTexture(nullptr, checker.data(), 8, 8, MIP_FILTER_BOX, false, linear);
+    CookTexture(nullptr, checker.data(), 8, 8, MIP_FILTER_BOX, true, srgb);
+    CHECK(linear.flags == 0 && srgb.flags == TEXTURE_FILE_SRGB);
+    CHECK(linear.levels[1][0] == 128 && linear.levels[1][3] == 255);
+    CHECK(srgb.levels[1][0] == 188 && srgb.levels[1][1] == 188 && srgb.levels[1][3] == 255);
+}
+
+static void TestThreadsMatchSerial()
+{
+    std::vector<unsigned char> image = MakeImage(300, 257);
+    JobSystem jobs(3);
+    for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+    {
+        CookedTexture serial, threaded;
+        CookTexture(nullptr, image.data(), 300, 257, filter, true, serial);
+        CookTexture(&jobs, image.data(), 300, 257, filter, true, threaded);
+        CHECK(serial.levels == threaded.levels);
+    }
+}
+
+static void TestContainer()
+{
+    std::vector<unsigned char> image = MakeImage(37, 21);
+    CookedTexture cooked;
+    CookTexture(nullptr, image.data(), 37, 21, MIP_FILTER_KAISER, true, cooked);
+    CHECK(WriteTextureFile(COOKED_PATH, cooked));
+
+    std::vector<unsigned char> file;
+    FILE* f = std::fopen(COOKED_PATH, "rb");
+    CHECK(f != nullptr);
+    if (!f)
+        return;
+    unsigned char buffer[4096];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) > 0;)
+        file.insert(file.end(), buffer, buffer + n);
+    std::fclose(f);
+
+    TextureFileView view;
+    CHECK(ParseTextureFile(file.data(), file.size(), view));
+    if (!view.header)
+        return;
+    CHECK(view.header->width == 37 && view.header->height == 21 && view.header->flags == TEXTURE_FILE_SRGB);
+    CHECK(view.header->levelCount == cooked.levels.size());
+    CHECK(view.dataEnd == file.size());
+    for (uint32_t i = 0; i < view.header->levelCount; ++i)
+    {
+        CHECK(view.levels[i].offset % TEXTURE_FILE_ALIGNMENT == 0);
+        CHECK(view.levels[i].size == cooked.levels[i].size());
+        CHECK(std::memcmp(file.data() + view.levels[i].offset, cooked.levels[i].data(), cooked.levels[i].size()) == 0);
+        // smallest level first
+        if (i > 0)
+            CHECK(view.levels[i].offset < view.levels[i - 1].offset);
+    }
+
+    // truncated, bad magic, level overlapping the index, wrong level size
+    TextureFileView bad;
+    CHECK(!ParseTextureFile(file.data(), file.size() - 1, bad));
+    CHECK(!ParseTextureFile(file.data(), sizeof(TextureFileHeader) - 1, bad));
+    std::vector<unsigned char> broken = file;
+    broken[0] ^= 1;
+    CHECK(!ParseTextureFile(broken.data(), broken.size(), bad));
+    broken = file;
+    ((TextureFileLevel*)(broken.data() + sizeof(TextureFileHeader)))[2].offset = 8;
+    CHECK(!ParseTextureFile(broken.data(), broken.size(), bad));
+    broken = file;
+    ((TextureFileLevel*)(broken.data() + sizeof(TextureFileHeader)))[1].size += 4;
+    CHECK(!ParseTextureFile(broken.data(), broken.size(), bad));
+    broken = file;
+    ((TextureFileHeader*)broken.data())->format = 99;
+    CHECK(!ParseTextureFile(broken.data(), broken.size(), bad));
+}
+
+static bool SameLevels(GLuint texture, const CookedTexture& cooked)
+{
+    bool same = true;
+    for (size_t i = 0; i < cooked.levels.size(); ++i)
+        same = same && ReadLevel(texture, (int)i, cooked.widths[i], cooked.heights[i]) == cooked.levels[i];
+    return same;
+}
+
+static void TestGlLoad()
+{
+    std::vector<unsigned char> image = MakeImage(100, 60);
+    CookedTexture cooked;
+    CookTexture(nullptr, image.data(), 100, 60, MIP_FILTER_KAISER, true, cooked);
+    CHECK(WriteTextureFile(COOKED_PATH, cooked));
+
+    TextureLoadStats stats;
+    GLuint texture = LoadTextureFile(COOKED_PATH, &stats);
+    CHECK(texture != 0);
+    CHECK(stats.bytes >= 100 * 60 * 4);
+    GLint format = 0, maxLevel = 0;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    CHECK(format == GL_SRGB8_ALPHA8);
+    CHECK(maxLevel == (GLint)cooked.levels.size() - 1);
+    CHECK(SameLevels(texture, cooked));
+    glDeleteTextures(1, &texture);
+
+    CHECK(LoadTextureFile("does_not_exist.tex") == 0);
+
+    // the streamer maps cooked files instead of decoding them
+    JobSystem jobs(1);
+    TextureStreamer streamer(jobs, 4 << 10, 2);
+    GLuint streamed = streamer.Request(COOKED_PATH);
+    for (int frames = 0; !streamer.Idle() && frames < 100000; ++frames)
+    {
+        streamer.Update(8 << 10);
+        if (!streamer.Idle())
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    glFinish();
+    CHECK(streamer.IsResident(streamed));
+    CHECK(streamer.stats().uploadedBytes == streamer.stats().decodedBytes);
+    CHECK(SameLevels(streamed, cooked));
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    TestBoxMatchesStreamer();
+    TestKaiser();
+    TestSrgb();
+    TestThreadsMatchSerial();
+    TestContainer();
+
+    HeadlessContext context;
+    if (context.Create(16, 16))
+        TestGlLoad();
+    else
+        std::printf("no headless GL context, skipping the GL checks\n");
+    std::remove(COOKED_PATH);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all cooked texture checks passed\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Texture streaming checks: every mip level that reaches GL must match the
+// synchronous stb_image decode, the base level must only ever point at
+// complete levels, and a missing file must leave the placeholder in place.
+// Small staging buffers and budgets force each level through several PBOs.
+// Decodes run on job workers, and on the GL thread in Update() when the job
+// system has none. Paths resolve through the streamer's Vfs mounts.
+#include "HeadlessContext.h"
+#include "ImageDecode.h"
+#include "JobSystem.h"
+#include "TextureStreamer.h"
+
+#include "TestCheck.h"
+#include "TextureReadback.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+static void TestStreamMatchesDecode(unsigned int workers)
+{
+    DecodedImage reference;
+    if (!DecodeImage("res.jpg", 4, reference))
+    {
+        ++g_failures;
+        return;
+    }
+
+    // 64 KiB staging: level 0 of res.jpg needs dozens of copies
+    JobSystem jobs(workers);
+    TextureStreamer streamer(jobs, 64 << 10, 3);
+    GLuint texture = streamer.Request("res.jpg");
+    GLuint missing = streamer.Request("does_not_exist.jpg");
+    CHECK(texture != 0 && missing != 0 && texture != missing);
+    CHECK(!streamer.IsResident(texture));
+
+    int frames = 0;
+    int lastBase = 1 << 30;
+    bool baseMonotonic = true;
+    while (!streamer.Idle() && frames < 100000)
+    {
+        streamer.Update(256 << 10);
+        ++frames;
+
+        // once the chain is allocated the base level may only move towards 0
+        GLint base = 0, max = 0;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &base);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &max);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (max > 0)
+        {
+            if (base > lastBase)
+                baseMonotonic = false;
+            lastBase = base;
+        }
+
+        if (!streamer.Idle())
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    glFinish();
+
+    TextureStreamer::Stats stats = streamer.stats();
+    std::printf("%u worker(s), streamed in %d updates: decode %.1f MB/s, upload %.1f MB/s\n", workers, frames, stats.decodeMBps(), stats.uploadMBps());
+    CHECK(streamer.Idle());
+    CHECK(streamer.IsResident(texture));
+    CHECK(!streamer.IsResident(missing));
+    CHECK(stats.requested == 2 && stats.resident == 1 && stats.failed == 1);
+    CHECK(stats.uploadedBytes == stats.decodedBytes);
+    CHECK(baseMonotonic);
+    CHECK(lastBase == 0);
+
+    // every level, down to 1x1
+    std::vector<unsigned char> expected(reference.pixels, reference.pixels + (size_t)reference.width * reference.height * 4);
+    int w = reference.width, h = reference.height;
+    int levels = 0;
+    for (int level = 0; ; ++level)
+    {
+        std::vector<unsigned char> actual = ReadLevel(texture, level, w, h);
+        if (actual != expected)
+        {
+            std::printf("FAILED level %d (%dx%d) differs from the synchronous decode\n", level, w, h);
+            ++g_failures;
+        }
+        ++levels;
+        if (w == 1 && h == 1)
+            break;
+        int dw = w > 1 ? w / 2 : 1, dh = h > 1 ? h / 2 : 1;
+        expected = Downsample(expected, w, h, dw, dh);
+        w = dw;
+        h = dh;
+    }
+    GLint maxLevel = 0;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    CHECK(maxLevel == levels - 1);
+
+    // the failed request still samples as the 1x1 placeholder
+    std::vector<unsigned char> placeholder = ReadLevel(missing, 0, 1, 1);
+    CHECK(placeholder[0] == 128 && placeholder[3] == 255);
+
+    FreeDecodedImage(reference);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+// paths go through the streamer's Vfs: found in the second mounted directory
+static void TestStreamFromMount()
+{
+    Vfs files;
+    files.Mount("no_such_directory");
+    files.Mount(".");
+    JobSystem jobs(0);
+    TextureStreamer streamer(jobs, 4 << 20, 3, false, files);
+    GLuint texture = streamer.Request("res.jpg");
+    for (int frames = 0; !streamer.Idle() && frames < 100000; ++frames)
+        streamer.Update();
+    CHECK(streamer.IsResident(texture));
+    CHECK(streamer.stats().failed == 0);
+}
+
+int main()
+{
+    HeadlessContext context;
+    if (!context.Create(16, 16))
+    {
+        std::printf("no headless GL context, skipping\n");
+        return SKIPPED;
+    }
+
+    for (unsigned int workers : { 0u, 2u })
+        TestStreamMatchesDecode(workers);
+    TestStreamFromMount();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all texture streaming checks passed\n");
+    return 0;
+}
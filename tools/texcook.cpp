@@ -0,0 +1,111 @@
+// texcook: bakes an image into a cooked texture (TextureFile.h) with its
+// whole mip chain, so the app loads it with a mapping and one memcpy.
+//
+//   texcook [options] input.(jpg|png|...) output.tex
+//   --filter box|kaiser   mip filter (kaiser)
+//   --srgb                color channels are sRGB: filter in linear light and
+//                         sample as GL_SRGB8_ALPHA8
+//   --format F            rgba8 (default), bc1, bc3, or bc: BC1 when the image
+//                         is opaque, BC3 otherwise
+//   --threads N           job system worker threads (default: cores - 1)
+#include "BlockCompress.h"
+#include "ImageDecode.h"
+#include "JobSystem.h"
+#include "TextureFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static int Usage()
+{
+    std::printf("usage: texcook [--filter box|kaiser] [--srgb] [--format rgba8|bc1|bc3|bc] [--threads N] input output\n");
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    MipFilter filter = MIP_FILTER_KAISER;
+    bool srgb = false;
+    const char* format = "rgba8";
+    unsigned int cores = std::thread::hardware_concurrency();
+    unsigned int workers = cores > 1 ? cores - 1 : 0;
+    const char* paths[2] = { NULL, NULL };
+    int pathCount = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--srgb") == 0)
+            srgb = true;
+        else if (std::strcmp(arg, "--filter") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "box") == 0)
+                filter = MIP_FILTER_BOX;
+            else if (std::strcmp(name, "kaiser") == 0)
+                filter = MIP_FILTER_KAISER;
+            else
+                return Usage();
+        }
+        else if (std::strcmp(arg, "--format") == 0 && i + 1 < argc)
+        {
+            format = argv[++i];
+            if (std::strcmp(format, "rgba8") != 0 && std::strcmp(format, "bc1") != 0 && std::strcmp(format, "bc3") != 0
+                && std::strcmp(format, "bc") != 0)
+                return Usage();
+        }
+        else if (std::strcmp(arg, "--threads") == 0 && i + 1 < argc)
+            workers = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+        else if (arg[0] != '-' && pathCount < 2)
+            paths[pathCount++] = arg;
+        else
+            return Usage();
+    }
+    if (pathCount != 2)
+        return Usage();
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    JobSystem jobs(workers);
+    DecodedImage image;
+    if (!DecodeImageParallel(jobs, paths[0], 4, image))
+        return 1;
+    Clock::time_point decoded = Clock::now();
+
+    CookedTexture texture;
+    CookTexture(&jobs, image.pixels, image.width, image.height, filter, srgb, texture);
+    Clock::time_point cooked = Clock::now();
+
+    uint32_t blocks = TEXTURE_FORMAT_RGBA8;
+    if (std::strcmp(format, "bc1") == 0)
+        blocks = TEXTURE_FORMAT_BC1;
+    else if (std::strcmp(format, "bc3") == 0)
+        blocks = TEXTURE_FORMAT_BC3;
+    else if (std::strcmp(format, "bc") == 0)
+        blocks = IsOpaque(image.pixels, image.width, image.height) ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_BC3;
+    FreeDecodedImage(image);
+    CompressTexture(&jobs, blocks, texture);
+    Clock::time_point compressed = Clock::now();
+
+    if (!WriteTextureFile(paths[1], texture))
+    {
+        std::printf("Failed to write %s\n", paths[1]);
+        return 1;
+    }
+
+    size_t bytes = 0;
+    for (const std::vector<unsigned char>& level : texture.levels)
+        bytes += level.size();
+    static const char* formatNames[] = { "", "rgba8", "bc1", "bc3" };
+    std::printf("%s: %dx%d %s, %d levels, %.1f MiB%s; decode %.1f ms, mips %.1f ms (%s), compress %.1f ms, %u threads\n",
+        paths[1], texture.widths[0], texture.heights[0], formatNames[texture.format], (int)texture.levels.size(),
+        bytes / (1024.0 * 1024.0), srgb ? ", sRGB" : "",
+        std::chrono::duration<double, std::milli>(decoded - start).count(),
+        std::chrono::duration<double, std::milli>(cooked - decoded).count(),
+        filter == MIP_FILTER_BOX ? "box" : "kaiser",
+        std::chrono::duration<double, std::milli>(compressed - cooked).count(), jobs.threadCount());
+    return 0;
+}